@@ -40,9 +40,14 @@ LOCAL_SRC_FILES := \
 	src/image.c \
 	src/crypto.c \
 	src/file.c \
+	src/fiber.c \
+	src/fileio.c \
+	src/dir.c \
+	src/filewatch.c \
 	src/json.c \
 	src/log.c \
 	src/memory.c \
+	src/sort.c \
 	src/thread.c \
 	src/tlocal.c \
 	src/tls.c \
@@ -50,8 +55,15 @@ LOCAL_SRC_FILES := \
 	src/render.c \
 	src/system.c \
 	src/list.c \
+	src/cache.c \
 	src/queue.c \
+	src/ring.c \
+	src/task.c \
+	src/trace.c \
+	src/metrics.c \
+	src/timer.c \
 	src/hash.c \
+	src/chash.c \
 	src/version.c \
 	src/hid/utils.c \
 	src/gfx/gl.c \
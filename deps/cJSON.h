@@ -37,6 +37,8 @@
 
 #define cJSON_IsReference   256
 #define cJSON_StringIsConst 512
+#define cJSON_InArena       1024 /* node and strings live in the document's arena, not freed individually */
+#define cJSON_ArenaRoot     2048 /* first node of the arena, freeing it frees the whole document */
 
 /* The cJSON structure: */
 typedef struct cJSON {
@@ -58,6 +60,9 @@ typedef struct cJSON {
 
 	/* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
 	char *string;
+
+	/* Lookup tables for the item's children owned by the user, released with CJSON_INDEX_FREE */
+	MTY_AtomicPtr index;
 } cJSON;
 
 typedef int cJSON_bool;
@@ -67,11 +72,6 @@ typedef int cJSON_bool;
 #define CJSON_NESTING_LIMIT 1000
 
 /* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse (with cJSON_Delete) and cJSON_Print (with stdlib free, cJSON_Hooks.free_fn, or cJSON_free as appropriate). The exception is cJSON_PrintPreallocated, where the caller has full responsibility of the buffer. */
-/* Supply a block of JSON, and this returns a cJSON object you can interrogate. */
-CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value);
-/* ParseWithOpts allows you to require (and check) that the JSON is null terminated, and to retrieve the pointer to the final byte parsed. */
-/* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *)
 cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
@@ -117,8 +117,9 @@ CJSON_PUBLIC(void) cJSON_DeleteItemFromObjectCaseSensitive(cJSON *object, const
 
 /* Update array items. */
 CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem); /* Shifts pre-existing items to the right. */
+CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemViaPointer(cJSON *array, cJSON *after_inserted, cJSON *newitem);
 CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON *const parent, cJSON *const item, cJSON *replacement);
-CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectCaseSensitive(cJSON *object, const char *string, cJSON *newitem);
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectViaPointer(cJSON *object, cJSON *item, const char *string, cJSON *newitem);
 
 /* Duplicate a cJSON item */
 /* Duplicate will create a new, identical cJSON item to the one you pass, in new memory that will
@@ -130,6 +131,10 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse);
 #define CJSON_REALLOC(ptr, size) MTY_Realloc(ptr, size, 1)
 #define CJSON_FREE(ptr)          MTY_Free(ptr)
 
+#ifndef CJSON_INDEX_FREE
+	#define CJSON_INDEX_FREE(index) CJSON_FREE(index)
+#endif
+
 /* define our own boolean type */
 #ifdef true
 	#undef true
@@ -158,16 +163,22 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 	cJSON *next = NULL;
 	while (item != NULL) {
 		next = item->next;
+		if (item->index.value != NULL) {
+			CJSON_INDEX_FREE(item->index.value);
+		}
 		if (!(item->type & cJSON_IsReference) && (item->child != NULL)) {
 			cJSON_Delete(item->child);
 		}
-		if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL)) {
+		if (!(item->type & (cJSON_IsReference | cJSON_InArena)) && (item->valuestring != NULL)) {
 			CJSON_FREE(item->valuestring);
 		}
 		if (!(item->type & cJSON_StringIsConst) && (item->string != NULL)) {
 			CJSON_FREE(item->string);
 		}
-		CJSON_FREE(item);
+		/* children were released above, so the arena can go with its root */
+		if (!(item->type & cJSON_InArena) || (item->type & cJSON_ArenaRoot)) {
+			CJSON_FREE(item);
+		}
 		item = next;
 	}
 }
@@ -803,20 +814,6 @@ static parse_buffer *skip_utf8_bom(parse_buffer *const buffer)
 	return buffer;
 }
 
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
-{
-	size_t buffer_length;
-
-	if (NULL == value) {
-		return NULL;
-	}
-
-	/* Adding null character size due to require_null_terminated. */
-	buffer_length = strlen(value) + sizeof("");
-
-	return cJSON_ParseWithLengthOpts(value, buffer_length, return_parse_end, require_null_terminated);
-}
-
 /* Parse an object - create a new root, and populate. */
 CJSON_PUBLIC(cJSON *)
 cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
@@ -880,12 +877,6 @@ fail:
 	return NULL;
 }
 
-/* Default options for cJSON_Parse */
-CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
-{
-	return cJSON_ParseWithOpts(value, 0, 0);
-}
-
 static unsigned char *print(const cJSON *const item, cJSON_bool format)
 {
 	static const size_t default_buffer_size = 256;
@@ -1547,6 +1538,9 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON *const ite
 	if (item == parent->child) {
 		/* first element */
 		parent->child = item->next;
+	} else if (item->next == NULL) {
+		/* last element */
+		parent->child->prev = item->prev;
 	}
 	/* make sure the detached item doesn't point anywhere anymore */
 	item->prev = NULL;
@@ -1584,13 +1578,15 @@ CJSON_PUBLIC(void) cJSON_DeleteItemFromObjectCaseSensitive(cJSON *object, const
 /* Replace array/object items with new ones. */
 CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem)
 {
-	cJSON *after_inserted = NULL;
-
 	if (which < 0) {
 		return false;
 	}
 
-	after_inserted = get_array_item(array, (size_t) which);
+	return cJSON_InsertItemViaPointer(array, get_array_item(array, (size_t) which), newitem);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemViaPointer(cJSON *array, cJSON *after_inserted, cJSON *newitem)
+{
 	if (after_inserted == NULL) {
 		return add_item_to_array(array, newitem);
 	}
@@ -1623,6 +1619,9 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON *const parent, cJSON
 		replacement->next->prev = replacement;
 	}
 	if (parent->child == item) {
+		if (parent->child->prev == parent->child) {
+			replacement->prev = replacement;
+		}
 		parent->child = replacement;
 	} else { /*
          * To find the last item in array quickly, we use prev in array.
@@ -1631,6 +1630,9 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON *const parent, cJSON
 		if (replacement->prev != NULL) {
 			replacement->prev->next = replacement;
 		}
+		if (replacement->next == NULL) {
+			parent->child->prev = replacement;
+		}
 	}
 
 	item->next = NULL;
@@ -1640,7 +1642,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON *const parent, cJSON
 	return true;
 }
 
-static cJSON_bool replace_item_in_object(cJSON *object, const char *string, cJSON *replacement)
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectViaPointer(cJSON *object, cJSON *item, const char *string, cJSON *replacement)
 {
 	if ((replacement == NULL) || (string == NULL)) {
 		return false;
@@ -1653,12 +1655,7 @@ static cJSON_bool replace_item_in_object(cJSON *object, const char *string, cJSO
 	replacement->string = (char *) MTY_Strdup(string);
 	replacement->type &= ~cJSON_StringIsConst;
 
-	return cJSON_ReplaceItemViaPointer(object, get_object_item(object, string), replacement);
-}
-
-CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectCaseSensitive(cJSON *object, const char *string, cJSON *newitem)
-{
-	return replace_item_in_object(object, string, newitem);
+	return cJSON_ReplaceItemViaPointer(object, item, replacement);
 }
 
 /* Create basic types: */
@@ -1755,7 +1752,7 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
 		goto fail;
 	}
 	/* Copy over all vars */
-	newitem->type = item->type & (~cJSON_IsReference);
+	newitem->type = item->type & ~(cJSON_IsReference | cJSON_InArena | cJSON_ArenaRoot);
 	newitem->valueint = item->valueint;
 	newitem->valuedouble = item->valuedouble;
 	if (item->valuestring) {
@@ -1765,7 +1762,13 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
 		}
 	}
 	if (item->string) {
-		newitem->string = (item->type & cJSON_StringIsConst) ? item->string : (char *) MTY_Strdup(item->string);
+		/* keys in an arena are const but only live as long as their document */
+		if ((item->type & cJSON_StringIsConst) && !(item->type & cJSON_InArena)) {
+			newitem->string = item->string;
+		} else {
+			newitem->string = (char *) MTY_Strdup(item->string);
+			newitem->type &= ~cJSON_StringIsConst;
+		}
 		if (!newitem->string) {
 			goto fail;
 		}
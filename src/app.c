@@ -8,6 +8,8 @@
 
 #include <stdio.h>
 
+#include "metrics.h"
+
 
 // GFX
 
@@ -17,13 +19,47 @@ GFX_CTX_PROTOTYPES(_d3d11_)
 GFX_CTX_PROTOTYPES(_metal_)
 GFX_CTX_DECLARE_TABLE()
 
+#define APP_PRESENT_GAP 1000000000
+
+static int64_t APP_PRESENT_TS[MTY_WINDOW_MAX];
+static int64_t APP_PRESENT_AVG[MTY_WINDOW_MAX];
+
+static void app_present_metrics(MTY_Window window)
+{
+	if (window < 0 || window >= MTY_WINDOW_MAX)
+		return;
+
+	int64_t now = MTY_GetTimeNs();
+	int64_t interval = now - APP_PRESENT_TS[window];
+	int64_t avg = APP_PRESENT_AVG[window];
+
+	APP_PRESENT_TS[window] = now;
+
+	// Long gaps mean the window stopped presenting for a while, not a slow frame
+	if (interval <= 0 || interval >= APP_PRESENT_GAP)
+		return;
+
+	mty_metric_record(METRIC_PRESENT_INTERVAL, interval);
+
+	// An interval well past the usual one means frames were missed, which stay out
+	// of the average so a stall doesn't raise the bar for the next one
+	if (avg > 0 && interval > avg + avg / 2) {
+		mty_metric_add(METRIC_FRAMES_DROPPED, MTY_MAX((interval + avg / 2) / avg - 1, 1));
+
+	} else {
+		APP_PRESENT_AVG[window] = avg > 0 ? avg + (interval - avg) / 16 : interval;
+	}
+}
+
 void MTY_WindowPresent(MTY_App *app, MTY_Window window, uint32_t numFrames)
 {
 	struct gfx_ctx *gfx_ctx = NULL;
 	MTY_GFX api = mty_window_get_gfx(app, window, &gfx_ctx);
 
-	if (api != MTY_GFX_NONE)
+	if (api != MTY_GFX_NONE) {
 		GFX_CTX_API[api].present(gfx_ctx, numFrames);
+		app_present_metrics(window);
+	}
 }
 
 MTY_Device *MTY_WindowGetDevice(MTY_App *app, MTY_Window window)
@@ -0,0 +1,400 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define CACHE_DEFAULT_BUCKETS 1024
+
+// 2Q sizing: new entries wait in a FIFO taking up to a quarter of the capacity,
+// and the keys of entries evicted from it are remembered for half the entry count
+#define CACHE_IN_SHARE    4
+#define CACHE_GHOST_SHARE 2
+
+enum cache_queue {
+	CACHE_MAIN  = 0, // LRU, or 2Q's Am
+	CACHE_IN    = 1, // 2Q's A1in FIFO
+	CACHE_GHOST = 2, // 2Q's A1out, keys only
+};
+
+struct cache_entry {
+	MTY_Link link;
+	char *key;
+	void *value;
+	size_t size;
+	enum cache_queue queue;
+};
+
+struct cache_list {
+	MTY_LinkList list;
+	uint32_t entries;
+	size_t bytes;
+};
+
+struct cache_shard {
+	MTY_Mutex *mutex;
+	MTY_Hash *hash;
+	MTY_Hash *ghosts;
+
+	uint32_t max_entries;
+	size_t max_bytes;
+
+	struct cache_list queues[3];
+	MTY_CacheStats stats;
+};
+
+struct MTY_Cache {
+	MTY_CachePolicy policy;
+	MTY_CacheEvictFunc evict;
+	void *opaque;
+
+	uint32_t num_shards;
+	struct cache_shard *shards;
+};
+
+#define CACHE_ENTRY(ptr) \
+	MTY_LINK_ENTRY(ptr, struct cache_entry, link)
+
+
+// Lists
+
+static void cache_push(struct cache_shard *s, struct cache_entry *e, enum cache_queue queue)
+{
+	struct cache_list *q = &s->queues[queue];
+
+	e->queue = queue;
+	MTY_LinkListPrepend(&q->list, &e->link);
+	q->entries++;
+	q->bytes += e->size;
+}
+
+static void cache_unlink(struct cache_shard *s, struct cache_entry *e)
+{
+	struct cache_list *q = &s->queues[e->queue];
+
+	MTY_LinkListRemove(&q->list, &e->link);
+	q->entries--;
+	q->bytes -= e->size;
+}
+
+static void cache_entry_free(struct cache_entry *e)
+{
+	MTY_Free(e->key);
+	MTY_Free(e);
+}
+
+static bool cache_over(struct cache_shard *s, uint32_t entries, size_t bytes, uint32_t share)
+{
+	return (s->max_entries > 0 && entries > s->max_entries / share) ||
+		(s->max_bytes > 0 && bytes > s->max_bytes / share);
+}
+
+
+// Eviction
+
+static void cache_evict_one(MTY_Cache *ctx, struct cache_shard *s, struct cache_entry **evicted)
+{
+	struct cache_list *in = &s->queues[CACHE_IN];
+	struct cache_list *lru = &s->queues[CACHE_MAIN];
+
+	// 2Q evicts from the probationary FIFO first once it exceeds its share
+	bool from_in = in->list.last && (!lru->list.last || cache_over(s, in->entries, in->bytes, CACHE_IN_SHARE));
+	struct cache_entry *e = CACHE_ENTRY(from_in ? in->list.last : lru->list.last);
+
+	cache_unlink(s, e);
+	MTY_HashPop(s->hash, e->key);
+	s->stats.evictions++;
+
+	if (from_in && ctx->policy == MTY_CACHE_POLICY_2Q) {
+		struct cache_entry *ghost = MTY_Alloc(1, sizeof(struct cache_entry));
+		ghost->key = MTY_Strdup(e->key);
+
+		MTY_HashSet(s->ghosts, ghost->key, ghost);
+		cache_push(s, ghost, CACHE_GHOST);
+
+		struct cache_list *ghosts = &s->queues[CACHE_GHOST];
+		uint32_t max_ghosts = s->max_entries > 0 ? s->max_entries / CACHE_GHOST_SHARE : CACHE_DEFAULT_BUCKETS;
+
+		if (ghosts->entries > max_ghosts) {
+			struct cache_entry *old = CACHE_ENTRY(ghosts->list.last);
+			cache_unlink(s, old);
+			MTY_HashPop(s->ghosts, old->key);
+			cache_entry_free(old);
+		}
+	}
+
+	// Callbacks are deferred until the shard is unlocked
+	e->link.next = (MTY_Link *) *evicted;
+	*evicted = e;
+}
+
+static void cache_evict(MTY_Cache *ctx, struct cache_shard *s, struct cache_entry **evicted)
+{
+	while (true) {
+		uint32_t entries = s->queues[CACHE_MAIN].entries + s->queues[CACHE_IN].entries;
+		size_t bytes = s->queues[CACHE_MAIN].bytes + s->queues[CACHE_IN].bytes;
+
+		if (entries == 0 || !cache_over(s, entries, bytes, 1))
+			break;
+
+		cache_evict_one(ctx, s, evicted);
+	}
+}
+
+static void cache_release(MTY_Cache *ctx, struct cache_entry *evicted)
+{
+	for (struct cache_entry *e = evicted; e;) {
+		struct cache_entry *next = (struct cache_entry *) e->link.next;
+
+		if (ctx->evict)
+			ctx->evict(e->key, e->value, ctx->opaque);
+
+		cache_entry_free(e);
+		e = next;
+	}
+}
+
+
+// Shards
+
+static struct cache_shard *cache_shard(MTY_Cache *ctx, const char *key)
+{
+	struct cache_shard *s = &ctx->shards[ctx->num_shards > 1 ? MTY_DJB2(key) % ctx->num_shards : 0];
+
+	if (s->mutex)
+		MTY_MutexLock(s->mutex);
+
+	return s;
+}
+
+static void cache_shard_unlock(struct cache_shard *s)
+{
+	if (s->mutex)
+		MTY_MutexUnlock(s->mutex);
+}
+
+
+// Public
+
+MTY_Cache *MTY_CacheCreate(MTY_CachePolicy policy, uint32_t maxEntries, size_t maxBytes,
+	uint32_t numShards, MTY_CacheEvictFunc func, void *opaque)
+{
+	MTY_Cache *ctx = MTY_Alloc(1, sizeof(MTY_Cache));
+	ctx->policy = policy;
+	ctx->evict = func;
+	ctx->opaque = opaque;
+	ctx->num_shards = numShards > 0 ? numShards : 1;
+
+	// Every shard needs a non-zero share of each limit, 0 would mean unlimited
+	if (maxEntries > 0 && maxEntries < ctx->num_shards)
+		ctx->num_shards = maxEntries;
+
+	if (maxBytes > 0 && maxBytes < ctx->num_shards)
+		ctx->num_shards = (uint32_t) maxBytes;
+
+	ctx->shards = MTY_Alloc(ctx->num_shards, sizeof(struct cache_shard));
+
+	uint32_t buckets = maxEntries > 0 ? maxEntries / ctx->num_shards + 1 : CACHE_DEFAULT_BUCKETS;
+
+	for (uint32_t x = 0; x < ctx->num_shards; x++) {
+		struct cache_shard *s = &ctx->shards[x];
+
+		// Capacity is split evenly, a remainder is given to the first shards
+		s->max_entries = maxEntries / ctx->num_shards + (x < maxEntries % ctx->num_shards ? 1 : 0);
+		s->max_bytes = maxBytes / ctx->num_shards + (x < maxBytes % ctx->num_shards ? 1 : 0);
+
+		s->hash = MTY_HashCreate(buckets);
+		s->ghosts = MTY_HashCreate(policy == MTY_CACHE_POLICY_2Q ? buckets : 1);
+
+		if (numShards > 0)
+			s->mutex = MTY_MutexCreate();
+	}
+
+	return ctx;
+}
+
+void MTY_CacheDestroy(MTY_Cache **cache)
+{
+	if (!cache || !*cache)
+		return;
+
+	MTY_Cache *ctx = *cache;
+
+	for (uint32_t x = 0; x < ctx->num_shards; x++) {
+		struct cache_shard *s = &ctx->shards[x];
+
+		for (uint8_t y = 0; y < 3; y++) {
+			for (MTY_Link *l = s->queues[y].list.first; l;) {
+				MTY_Link *next = l->next;
+				struct cache_entry *e = CACHE_ENTRY(l);
+
+				if (y != CACHE_GHOST && ctx->evict)
+					ctx->evict(e->key, e->value, ctx->opaque);
+
+				cache_entry_free(e);
+				l = next;
+			}
+		}
+
+		MTY_HashDestroy(&s->hash, NULL);
+		MTY_HashDestroy(&s->ghosts, NULL);
+		MTY_MutexDestroy(&s->mutex);
+	}
+
+	MTY_Free(ctx->shards);
+
+	MTY_Free(ctx);
+	*cache = NULL;
+}
+
+void *MTY_CacheGet(MTY_Cache *ctx, const char *key)
+{
+	struct cache_shard *s = cache_shard(ctx, key);
+	struct cache_entry *e = MTY_HashGet(s->hash, key);
+
+	void *value = NULL;
+
+	if (e) {
+		// Entries still in 2Q's FIFO are not promoted by a hit
+		if (e->queue == CACHE_MAIN)
+			MTY_LinkListMoveToFront(&s->queues[CACHE_MAIN].list, &e->link);
+
+		value = e->value;
+		s->stats.hits++;
+
+	} else {
+		s->stats.misses++;
+	}
+
+	cache_shard_unlock(s);
+
+	return value;
+}
+
+void MTY_CacheSet(MTY_Cache *ctx, const char *key, void *value, size_t size)
+{
+	struct cache_entry *evicted = NULL;
+
+	struct cache_shard *s = cache_shard(ctx, key);
+	struct cache_entry *e = MTY_HashGet(s->hash, key);
+
+	if (e) {
+		cache_unlink(s, e);
+
+		// The replaced value is handed to the eviction callback
+		if (e->value != value) {
+			struct cache_entry *old = MTY_Alloc(1, sizeof(struct cache_entry));
+			old->key = MTY_Strdup(key);
+			old->value = e->value;
+			old->link.next = (MTY_Link *) evicted;
+			evicted = old;
+		}
+
+		e->value = value;
+		e->size = size;
+		cache_push(s, e, e->queue == CACHE_IN ? CACHE_IN : CACHE_MAIN);
+
+	} else {
+		e = MTY_Alloc(1, sizeof(struct cache_entry));
+		e->key = MTY_Strdup(key);
+		e->value = value;
+		e->size = size;
+
+		MTY_HashSet(s->hash, key, e);
+
+		// Keys seen again shortly after being evicted go straight to the main queue
+		struct cache_entry *ghost = MTY_HashPop(s->ghosts, key);
+
+		if (ghost) {
+			cache_unlink(s, ghost);
+			cache_entry_free(ghost);
+		}
+
+		bool probation = ctx->policy == MTY_CACHE_POLICY_2Q && !ghost;
+		cache_push(s, e, probation ? CACHE_IN : CACHE_MAIN);
+
+		s->stats.insertions++;
+	}
+
+	cache_evict(ctx, s, &evicted);
+
+	cache_shard_unlock(s);
+
+	cache_release(ctx, evicted);
+}
+
+void *MTY_CachePop(MTY_Cache *ctx, const char *key)
+{
+	struct cache_shard *s = cache_shard(ctx, key);
+	struct cache_entry *e = MTY_HashPop(s->hash, key);
+
+	void *value = NULL;
+
+	if (e) {
+		cache_unlink(s, e);
+		value = e->value;
+		cache_entry_free(e);
+	}
+
+	cache_shard_unlock(s);
+
+	return value;
+}
+
+void *MTY_CacheGetInt(MTY_Cache *ctx, int64_t key)
+{
+	char key_str[32];
+	snprintf(key_str, 32, "#%" PRIx64, key);
+
+	return MTY_CacheGet(ctx, key_str);
+}
+
+void MTY_CacheSetInt(MTY_Cache *ctx, int64_t key, void *value, size_t size)
+{
+	char key_str[32];
+	snprintf(key_str, 32, "#%" PRIx64, key);
+
+	MTY_CacheSet(ctx, key_str, value, size);
+}
+
+void *MTY_CachePopInt(MTY_Cache *ctx, int64_t key)
+{
+	char key_str[32];
+	snprintf(key_str, 32, "#%" PRIx64, key);
+
+	return MTY_CachePop(ctx, key_str);
+}
+
+void MTY_CacheGetStats(MTY_Cache *ctx, MTY_CacheStats *stats, bool reset)
+{
+	memset(stats, 0, sizeof(MTY_CacheStats));
+
+	for (uint32_t x = 0; x < ctx->num_shards; x++) {
+		struct cache_shard *s = &ctx->shards[x];
+
+		if (s->mutex)
+			MTY_MutexLock(s->mutex);
+
+		stats->hits += s->stats.hits;
+		stats->misses += s->stats.misses;
+		stats->insertions += s->stats.insertions;
+		stats->evictions += s->stats.evictions;
+		stats->entries += s->queues[CACHE_MAIN].entries + s->queues[CACHE_IN].entries;
+		stats->bytes += s->queues[CACHE_MAIN].bytes + s->queues[CACHE_IN].bytes;
+
+		if (reset) {
+			s->stats.hits = 0;
+			s->stats.misses = 0;
+			s->stats.insertions = 0;
+			s->stats.evictions = 0;
+		}
+
+		cache_shard_unlock(s);
+	}
+}
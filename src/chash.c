@@ -0,0 +1,451 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "tlocal.h"
+
+// Readers never lock: they announce themselves in an epoch counter, walk the
+// bucket chains, then leave. Writers serialize on a lock stripe chosen by the
+// key's hash, and unlinked nodes are only freed after every reader that could
+// have seen them has left its epoch. Resizing takes every stripe and publishes a
+// freshly built table, so readers on the old table keep walking intact chains.
+
+#define CHASH_DEFAULT_BUCKETS 128
+#define CHASH_STRIPES         64
+#define CHASH_READER_SLOTS    32
+#define CHASH_RETIRE_MAX      64
+#define CHASH_LOAD_FACTOR     2
+
+#define CHASH_PTR(atomic) \
+	((void *) (intptr_t) MTY_Atomic64Get(atomic))
+
+#define CHASH_SET_PTR(atomic, ptr) \
+	MTY_Atomic64Set(atomic, (int64_t) (intptr_t) (ptr))
+
+struct chash_node {
+	char *key;
+	uint32_t hash;
+	MTY_Atomic64 val;
+	MTY_Atomic64 next;
+	struct chash_node *retired;
+};
+
+struct chash_table {
+	uint32_t num_buckets;
+	MTY_Atomic64 *buckets;
+	struct chash_table *retired;
+};
+
+// Padded to keep reader slots on separate cache lines
+struct chash_slot {
+	MTY_Atomic32 readers[2];
+	uint8_t pad[56];
+};
+
+struct MTY_ConcurrentHash {
+	MTY_Atomic64 table;
+	MTY_Atomic32 count;
+	MTY_Mutex *stripes[CHASH_STRIPES];
+
+	MTY_Atomic32 epoch;
+	struct chash_slot slots[CHASH_READER_SLOTS];
+
+	MTY_Mutex *reclaim;
+	struct chash_node *retired;
+	struct chash_table *retired_tables;
+	uint32_t num_retired;
+};
+
+static MTY_Atomic32 CHASH_THREAD_INDEX;
+static TLOCAL uint32_t CHASH_SLOT;
+
+
+// Epochs
+
+static uint32_t chash_slot(void)
+{
+	if (CHASH_SLOT == 0)
+		CHASH_SLOT = MTY_Atomic32Add(&CHASH_THREAD_INDEX, 1);
+
+	return CHASH_SLOT % CHASH_READER_SLOTS;
+}
+
+static MTY_Atomic32 *chash_read_begin(MTY_ConcurrentHash *ctx)
+{
+	struct chash_slot *slot = &ctx->slots[chash_slot()];
+
+	while (true) {
+		int32_t epoch = MTY_Atomic32Get(&ctx->epoch);
+		MTY_Atomic32 *readers = &slot->readers[epoch & 1];
+
+		MTY_Atomic32Add(readers, 1);
+
+		// The epoch flipped before the reader was visible, retry in the new one
+		if (MTY_Atomic32Get(&ctx->epoch) == epoch)
+			return readers;
+
+		MTY_Atomic32Add(readers, -1);
+	}
+}
+
+static void chash_read_end(MTY_Atomic32 *readers)
+{
+	MTY_Atomic32Add(readers, -1);
+}
+
+static void chash_synchronize(MTY_ConcurrentHash *ctx)
+{
+	int32_t epoch = MTY_Atomic32Get(&ctx->epoch);
+	MTY_Atomic32Set(&ctx->epoch, epoch + 1);
+
+	for (uint32_t x = 0; x < CHASH_READER_SLOTS; x++)
+		while (MTY_Atomic32Get(&ctx->slots[x].readers[epoch & 1]) > 0)
+			MTY_Sleep(0);
+}
+
+static void chash_node_free(struct chash_node *n)
+{
+	MTY_Free(n->key);
+	MTY_Free(n);
+}
+
+static void chash_table_free(struct chash_table *t)
+{
+	MTY_Free(t->buckets);
+	MTY_Free(t);
+}
+
+static void chash_retire(MTY_ConcurrentHash *ctx, struct chash_node *node)
+{
+	node->retired = ctx->retired;
+	ctx->retired = node;
+	ctx->num_retired++;
+}
+
+static void chash_reclaim(MTY_ConcurrentHash *ctx, bool force)
+{
+	// Batch frees so the grace period is amortized over many removals
+	if (!force && ctx->num_retired < CHASH_RETIRE_MAX)
+		return;
+
+	chash_synchronize(ctx);
+
+	for (struct chash_node *n = ctx->retired; n;) {
+		struct chash_node *next = n->retired;
+		chash_node_free(n);
+		n = next;
+	}
+
+	for (struct chash_table *t = ctx->retired_tables; t;) {
+		struct chash_table *next = t->retired;
+		chash_table_free(t);
+		t = next;
+	}
+
+	ctx->retired = NULL;
+	ctx->retired_tables = NULL;
+	ctx->num_retired = 0;
+}
+
+
+// Table
+
+static struct chash_table *chash_table_create(uint32_t num_buckets)
+{
+	struct chash_table *t = MTY_Alloc(1, sizeof(struct chash_table));
+	t->num_buckets = num_buckets;
+	t->buckets = MTY_Alloc(num_buckets, sizeof(MTY_Atomic64));
+
+	return t;
+}
+
+static struct chash_node *chash_find(struct chash_table *t, const char *key, uint32_t hash,
+	struct chash_node **prev)
+{
+	if (prev)
+		*prev = NULL;
+
+	for (struct chash_node *n = CHASH_PTR(&t->buckets[hash % t->num_buckets]); n; n = CHASH_PTR(&n->next)) {
+		if (n->hash == hash && !strcmp(n->key, key))
+			return n;
+
+		if (prev)
+			*prev = n;
+	}
+
+	return NULL;
+}
+
+static void chash_resize(MTY_ConcurrentHash *ctx)
+{
+	for (uint32_t x = 0; x < CHASH_STRIPES; x++)
+		MTY_MutexLock(ctx->stripes[x]);
+
+	struct chash_table *old = CHASH_PTR(&ctx->table);
+	struct chash_table *t = NULL;
+
+	// Another writer may have already resized while the stripes were being taken
+	if ((uint32_t) MTY_Atomic32Get(&ctx->count) > old->num_buckets * CHASH_LOAD_FACTOR) {
+		t = chash_table_create(old->num_buckets * 2);
+
+		for (uint32_t x = 0; x < old->num_buckets; x++) {
+			for (struct chash_node *n = CHASH_PTR(&old->buckets[x]); n; n = CHASH_PTR(&n->next)) {
+				struct chash_node *copy = MTY_Alloc(1, sizeof(struct chash_node));
+				copy->key = MTY_Strdup(n->key);
+				copy->hash = n->hash;
+				MTY_Atomic64Set(&copy->val, MTY_Atomic64Get(&n->val));
+
+				MTY_Atomic64 *bucket = &t->buckets[n->hash % t->num_buckets];
+				MTY_Atomic64Set(&copy->next, MTY_Atomic64Get(bucket));
+				CHASH_SET_PTR(bucket, copy);
+			}
+		}
+
+		CHASH_SET_PTR(&ctx->table, t);
+	}
+
+	for (uint32_t x = CHASH_STRIPES; x > 0; x--)
+		MTY_MutexUnlock(ctx->stripes[x - 1]);
+
+	if (!t)
+		return;
+
+	// Readers may still be walking the old table
+	MTY_MutexLock(ctx->reclaim);
+
+	for (uint32_t x = 0; x < old->num_buckets; x++) {
+		for (struct chash_node *n = CHASH_PTR(&old->buckets[x]); n;) {
+			struct chash_node *next = CHASH_PTR(&n->next);
+			chash_retire(ctx, n);
+			n = next;
+		}
+	}
+
+	old->retired = ctx->retired_tables;
+	ctx->retired_tables = old;
+
+	chash_reclaim(ctx, true);
+
+	MTY_MutexUnlock(ctx->reclaim);
+}
+
+
+// Public
+
+MTY_ConcurrentHash *MTY_ConcurrentHashCreate(uint32_t numBuckets)
+{
+	MTY_ConcurrentHash *ctx = MTY_Alloc(1, sizeof(MTY_ConcurrentHash));
+
+	CHASH_SET_PTR(&ctx->table, chash_table_create(numBuckets == 0 ? CHASH_DEFAULT_BUCKETS : numBuckets));
+
+	for (uint32_t x = 0; x < CHASH_STRIPES; x++)
+		ctx->stripes[x] = MTY_MutexCreate();
+
+	ctx->reclaim = MTY_MutexCreate();
+
+	return ctx;
+}
+
+void MTY_ConcurrentHashDestroy(MTY_ConcurrentHash **hash, MTY_FreeFunc freeFunc)
+{
+	if (!hash || !*hash)
+		return;
+
+	MTY_ConcurrentHash *ctx = *hash;
+
+	struct chash_table *t = CHASH_PTR(&ctx->table);
+
+	for (uint32_t x = 0; x < t->num_buckets; x++) {
+		for (struct chash_node *n = CHASH_PTR(&t->buckets[x]); n;) {
+			struct chash_node *next = CHASH_PTR(&n->next);
+			void *val = CHASH_PTR(&n->val);
+
+			if (freeFunc && val)
+				freeFunc(val);
+
+			chash_node_free(n);
+			n = next;
+		}
+	}
+
+	chash_table_free(t);
+
+	for (struct chash_node *n = ctx->retired; n;) {
+		struct chash_node *next = n->retired;
+		chash_node_free(n);
+		n = next;
+	}
+
+	for (struct chash_table *rt = ctx->retired_tables; rt;) {
+		struct chash_table *next = rt->retired;
+		chash_table_free(rt);
+		rt = next;
+	}
+
+	for (uint32_t x = 0; x < CHASH_STRIPES; x++)
+		MTY_MutexDestroy(&ctx->stripes[x]);
+
+	MTY_MutexDestroy(&ctx->reclaim);
+
+	MTY_Free(ctx);
+	*hash = NULL;
+}
+
+void *MTY_ConcurrentHashGet(MTY_ConcurrentHash *ctx, const char *key)
+{
+	uint32_t hash = MTY_DJB2(key);
+
+	MTY_Atomic32 *readers = chash_read_begin(ctx);
+
+	struct chash_node *n = chash_find(CHASH_PTR(&ctx->table), key, hash, NULL);
+	void *r = n ? CHASH_PTR(&n->val) : NULL;
+
+	chash_read_end(readers);
+
+	return r;
+}
+
+static void *chash_set(MTY_ConcurrentHash *ctx, const char *key, void *value, bool replace)
+{
+	uint32_t hash = MTY_DJB2(key);
+	MTY_Mutex *stripe = ctx->stripes[hash % CHASH_STRIPES];
+
+	MTY_MutexLock(stripe);
+
+	struct chash_table *t = CHASH_PTR(&ctx->table);
+	struct chash_node *n = chash_find(t, key, hash, NULL);
+
+	void *r = NULL;
+	bool grow = false;
+
+	if (n) {
+		r = CHASH_PTR(&n->val);
+
+		if (replace)
+			CHASH_SET_PTR(&n->val, value);
+
+	} else {
+		n = MTY_Alloc(1, sizeof(struct chash_node));
+		n->key = MTY_Strdup(key);
+		n->hash = hash;
+		CHASH_SET_PTR(&n->val, value);
+
+		// The node is fully built before it becomes reachable
+		MTY_Atomic64 *bucket = &t->buckets[hash % t->num_buckets];
+		MTY_Atomic64Set(&n->next, MTY_Atomic64Get(bucket));
+		CHASH_SET_PTR(bucket, n);
+
+		uint32_t count = MTY_Atomic32Add(&ctx->count, 1);
+		grow = count > t->num_buckets * CHASH_LOAD_FACTOR;
+	}
+
+	MTY_MutexUnlock(stripe);
+
+	if (grow)
+		chash_resize(ctx);
+
+	return r;
+}
+
+void *MTY_ConcurrentHashSet(MTY_ConcurrentHash *ctx, const char *key, void *value)
+{
+	return chash_set(ctx, key, value, true);
+}
+
+void *MTY_ConcurrentHashGetOrSet(MTY_ConcurrentHash *ctx, const char *key, void *value)
+{
+	// Most calls find an existing entry, so try without locking first
+	void *r = MTY_ConcurrentHashGet(ctx, key);
+
+	if (!r) {
+		r = chash_set(ctx, key, value, false);
+
+		if (!r)
+			r = value;
+	}
+
+	return r;
+}
+
+void *MTY_ConcurrentHashPop(MTY_ConcurrentHash *ctx, const char *key)
+{
+	uint32_t hash = MTY_DJB2(key);
+	MTY_Mutex *stripe = ctx->stripes[hash % CHASH_STRIPES];
+
+	MTY_MutexLock(stripe);
+
+	struct chash_table *t = CHASH_PTR(&ctx->table);
+
+	struct chash_node *prev = NULL;
+	struct chash_node *n = chash_find(t, key, hash, &prev);
+
+	void *r = NULL;
+
+	if (n) {
+		r = CHASH_PTR(&n->val);
+
+		MTY_Atomic64Set(prev ? &prev->next : &t->buckets[hash % t->num_buckets],
+			MTY_Atomic64Get(&n->next));
+
+		MTY_Atomic32Add(&ctx->count, -1);
+	}
+
+	MTY_MutexUnlock(stripe);
+
+	// Readers may still be looking at the unlinked node
+	if (n) {
+		MTY_MutexLock(ctx->reclaim);
+
+		chash_retire(ctx, n);
+		chash_reclaim(ctx, false);
+
+		MTY_MutexUnlock(ctx->reclaim);
+	}
+
+	return r;
+}
+
+uint32_t MTY_ConcurrentHashGetLength(MTY_ConcurrentHash *ctx)
+{
+	return MTY_Atomic32Get(&ctx->count);
+}
+
+void *MTY_ConcurrentHashGetInt(MTY_ConcurrentHash *ctx, int64_t key)
+{
+	char key_str[32];
+	snprintf(key_str, 32, "#%" PRIx64, key);
+
+	return MTY_ConcurrentHashGet(ctx, key_str);
+}
+
+void *MTY_ConcurrentHashSetInt(MTY_ConcurrentHash *ctx, int64_t key, void *value)
+{
+	char key_str[32];
+	snprintf(key_str, 32, "#%" PRIx64, key);
+
+	return MTY_ConcurrentHashSet(ctx, key_str, value);
+}
+
+void *MTY_ConcurrentHashGetOrSetInt(MTY_ConcurrentHash *ctx, int64_t key, void *value)
+{
+	char key_str[32];
+	snprintf(key_str, 32, "#%" PRIx64, key);
+
+	return MTY_ConcurrentHashGetOrSet(ctx, key_str, value);
+}
+
+void *MTY_ConcurrentHashPopInt(MTY_ConcurrentHash *ctx, int64_t key)
+{
+	char key_str[32];
+	snprintf(key_str, 32, "#%" PRIx64, key);
+
+	return MTY_ConcurrentHashPop(ctx, key_str);
+}
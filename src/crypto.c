@@ -167,8 +167,27 @@ uint32_t MTY_GetRandomUInt(uint32_t minVal, uint32_t maxVal)
 		return minVal;
 	}
 
+	uint32_t range = maxVal - minVal + 1;
+
 	uint32_t val = 0;
 	MTY_GetRandomBytes(&val, sizeof(uint32_t));
 
-	return val % (maxVal - minVal) + minVal;
+	// The full 32-bit range needs no reduction
+	if (range == 0)
+		return val;
+
+	// Lemire's multiply-shift reduction, rejecting the low values that would bias
+	// the result towards the bottom of the range
+	uint64_t m = (uint64_t) val * range;
+
+	if ((uint32_t) m < range) {
+		uint32_t threshold = (0 - range) % range;
+
+		while ((uint32_t) m < threshold) {
+			MTY_GetRandomBytes(&val, sizeof(uint32_t));
+			m = (uint64_t) val * range;
+		}
+	}
+
+	return (uint32_t) (m >> 32) + minVal;
 }
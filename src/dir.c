@@ -0,0 +1,497 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _GNU_SOURCE      // fstatat, DT_DIR
+#define _DARWIN_C_SOURCE // DT_DIR
+
+#include "matoya.h"
+
+#include <string.h>
+
+#include "dirread.h"
+
+// Directories waiting to be read sit on a stack, so only one directory per reader is
+// open at a time and memory grows with the number of directories rather than files. A
+// parallel walk shares the stack between threads, each collecting the entries it reads
+// into batches that are handed to MTY_DirIterNext, with a cap on the number of batches
+// waiting so a slow consumer doesn't cause the whole tree to be buffered.
+
+#define DIR_MAX_THREADS   8
+#define DIR_BATCH_ENTRIES 256
+#define DIR_MAX_BATCHES   16
+
+struct dir_pending {
+	char *path;
+	uint32_t depth;
+};
+
+struct dir_cursor {
+	struct dirread *dr;
+	struct dir_pending dir;
+	char *path;
+	size_t size;
+	MTY_DirEntry entry;
+};
+
+struct dir_record {
+	size_t path;
+	size_t name;
+	MTY_FileType type;
+	uint32_t depth;
+};
+
+struct dir_batch {
+	struct dir_batch *next;
+	struct dir_record records[DIR_BATCH_ENTRIES];
+	uint32_t len;
+	uint32_t pos;
+
+	char *text;
+	size_t text_len;
+	size_t text_size;
+};
+
+struct MTY_DirIter {
+	char *filter;
+	bool glob;
+	MTY_DirFlag flags;
+
+	struct dir_pending *stack;
+	uint32_t stack_len;
+	uint32_t stack_size;
+
+	// Serial
+	struct dir_cursor cursor;
+
+	// Parallel
+	MTY_Thread *threads[DIR_MAX_THREADS];
+	uint32_t nthreads;
+	uint32_t active;
+	uint32_t finished;
+	bool stop;
+
+	MTY_Mutex *mutex;
+	MTY_Cond *work_cond;
+	MTY_Cond *ready_cond;
+	MTY_Cond *space_cond;
+
+	struct dir_batch *ready;
+	struct dir_batch *ready_tail;
+	uint32_t ready_len;
+	struct dir_batch *batch;
+	MTY_DirEntry entry;
+};
+
+
+// Filters
+
+static bool dir_glob(const char *pattern, const char *name)
+{
+	const char *star = NULL;
+	const char *resume = NULL;
+
+	while (*name) {
+		if (*pattern == '*') {
+			star = pattern++;
+			resume = name;
+
+		} else if (*pattern == '?' || *pattern == *name) {
+			pattern++;
+			name++;
+
+		// Let the last star swallow one more character and try again
+		} else if (star) {
+			pattern = star + 1;
+			name = ++resume;
+
+		} else {
+			return false;
+		}
+	}
+
+	while (*pattern == '*')
+		pattern++;
+
+	return *pattern == '\0';
+}
+
+static bool dir_wanted(MTY_DirIter *ctx, const MTY_DirEntry *entry)
+{
+	if (entry->type == MTY_FILE_TYPE_DIR)
+		return !(ctx->flags & MTY_DIR_FLAG_NO_DIRS);
+
+	if (!ctx->filter)
+		return true;
+
+	if (ctx->glob)
+		return dir_glob(ctx->filter, entry->name);
+
+	size_t name_len = strlen(entry->name);
+	size_t filter_len = strlen(ctx->filter);
+
+	return name_len >= filter_len && !strcmp(entry->name + name_len - filter_len, ctx->filter);
+}
+
+
+// Reading
+
+static void dir_push(MTY_DirIter *ctx, const char *path, uint32_t depth)
+{
+	if (ctx->mutex)
+		MTY_MutexLock(ctx->mutex);
+
+	if (ctx->stack_len == ctx->stack_size) {
+		ctx->stack_size = ctx->stack_size > 0 ? ctx->stack_size * 2 : 64;
+		ctx->stack = MTY_Realloc(ctx->stack, ctx->stack_size, sizeof(struct dir_pending));
+	}
+
+	struct dir_pending *dir = &ctx->stack[ctx->stack_len++];
+	dir->path = MTY_Strdup(path);
+	dir->depth = depth;
+
+	if (ctx->mutex) {
+		MTY_CondSignal(ctx->work_cond);
+		MTY_MutexUnlock(ctx->mutex);
+	}
+}
+
+static void dir_cursor_close(struct dir_cursor *cur)
+{
+	mty_dirread_close(&cur->dr);
+
+	MTY_Free(cur->dir.path);
+	cur->dir.path = NULL;
+}
+
+static bool dir_cursor_open(struct dir_cursor *cur, struct dir_pending *dir)
+{
+	cur->dir = *dir;
+	cur->dr = mty_dirread_open(dir->path);
+
+	if (!cur->dr) {
+		dir_cursor_close(cur);
+		return false;
+	}
+
+	return true;
+}
+
+static const MTY_DirEntry *dir_cursor_next(MTY_DirIter *ctx, struct dir_cursor *cur)
+{
+	while (true) {
+		MTY_FileType type = MTY_FILE_TYPE_UNKNOWN;
+		const char *name = mty_dirread_next(cur->dr, &type);
+		if (!name)
+			return NULL;
+
+		if (!strcmp(name, ".") || !strcmp(name, ".."))
+			continue;
+
+		size_t dir_len = strlen(cur->dir.path);
+		size_t name_len = strlen(name);
+		size_t size = dir_len + name_len + 2;
+
+		if (size > cur->size) {
+			cur->size = MTY_MAX(size, cur->size * 2);
+			cur->path = MTY_Realloc(cur->path, cur->size, 1);
+		}
+
+		memcpy(cur->path, cur->dir.path, dir_len);
+		cur->path[dir_len] = DIRREAD_DELIM;
+		memcpy(cur->path + dir_len + 1, name, name_len + 1);
+
+		cur->entry.path = cur->path;
+		cur->entry.name = cur->path + dir_len + 1;
+		cur->entry.type = type;
+		cur->entry.depth = cur->dir.depth;
+
+		if (type == MTY_FILE_TYPE_DIR && (ctx->flags & MTY_DIR_FLAG_RECURSIVE))
+			dir_push(ctx, cur->path, cur->dir.depth + 1);
+
+		if (dir_wanted(ctx, &cur->entry))
+			return &cur->entry;
+	}
+}
+
+
+// Parallel
+
+static struct dir_batch *dir_batch_create(void)
+{
+	struct dir_batch *batch = MTY_Alloc(1, sizeof(struct dir_batch));
+	batch->text_size = DIR_BATCH_ENTRIES * 64;
+	batch->text = MTY_Alloc(batch->text_size, 1);
+
+	return batch;
+}
+
+static void dir_batch_destroy(struct dir_batch **batch)
+{
+	if (!batch || !*batch)
+		return;
+
+	MTY_Free((*batch)->text);
+
+	MTY_Free(*batch);
+	*batch = NULL;
+}
+
+static void dir_batch_add(struct dir_batch *batch, const MTY_DirEntry *entry)
+{
+	size_t len = strlen(entry->path) + 1;
+
+	if (batch->text_len + len > batch->text_size) {
+		batch->text_size = MTY_MAX(batch->text_len + len, batch->text_size * 2);
+		batch->text = MTY_Realloc(batch->text, batch->text_size, 1);
+	}
+
+	struct dir_record *rec = &batch->records[batch->len++];
+	rec->path = batch->text_len;
+	rec->name = batch->text_len + (entry->name - entry->path);
+	rec->type = entry->type;
+	rec->depth = entry->depth;
+
+	memcpy(batch->text + batch->text_len, entry->path, len);
+	batch->text_len += len;
+}
+
+static void dir_publish(MTY_DirIter *ctx, struct dir_batch **batch)
+{
+	// Called with the mutex held
+	while (ctx->ready_len >= DIR_MAX_BATCHES && !ctx->stop)
+		MTY_CondWait(ctx->space_cond, ctx->mutex, -1);
+
+	if (ctx->stop) {
+		(*batch)->len = 0;
+		(*batch)->text_len = 0;
+		return;
+	}
+
+	if (ctx->ready_tail) {
+		ctx->ready_tail->next = *batch;
+
+	} else {
+		ctx->ready = *batch;
+	}
+
+	ctx->ready_tail = *batch;
+	ctx->ready_len++;
+
+	MTY_CondSignal(ctx->ready_cond);
+
+	*batch = dir_batch_create();
+}
+
+static void *dir_thread(void *opaque)
+{
+	MTY_DirIter *ctx = opaque;
+
+	struct dir_cursor cur = {0};
+	struct dir_batch *batch = dir_batch_create();
+
+	MTY_MutexLock(ctx->mutex);
+
+	while (true) {
+		// Partial results are handed over before going idle so they aren't held back
+		if (ctx->stack_len == 0 && batch->len > 0 && !ctx->stop) {
+			dir_publish(ctx, &batch);
+			continue;
+		}
+
+		while (ctx->stack_len == 0 && ctx->active > 0 && !ctx->stop)
+			MTY_CondWait(ctx->work_cond, ctx->mutex, -1);
+
+		// Nothing left to read and no one left to find more
+		if (ctx->stop || ctx->stack_len == 0)
+			break;
+
+		struct dir_pending dir = ctx->stack[--ctx->stack_len];
+		ctx->active++;
+
+		MTY_MutexUnlock(ctx->mutex);
+
+		if (dir_cursor_open(&cur, &dir)) {
+			for (const MTY_DirEntry *entry = dir_cursor_next(ctx, &cur); entry; entry = dir_cursor_next(ctx, &cur)) {
+				dir_batch_add(batch, entry);
+
+				if (batch->len == DIR_BATCH_ENTRIES) {
+					MTY_MutexLock(ctx->mutex);
+					dir_publish(ctx, &batch);
+					bool stop = ctx->stop;
+					MTY_MutexUnlock(ctx->mutex);
+
+					if (stop)
+						break;
+				}
+			}
+
+			dir_cursor_close(&cur);
+		}
+
+		MTY_MutexLock(ctx->mutex);
+
+		if (--ctx->active == 0 && ctx->stack_len == 0)
+			MTY_CondSignalAll(ctx->work_cond);
+	}
+
+	ctx->finished++;
+	MTY_CondSignal(ctx->ready_cond);
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	MTY_Free(cur.path);
+	dir_batch_destroy(&batch);
+
+	return NULL;
+}
+
+static const MTY_DirEntry *dir_parallel_next(MTY_DirIter *ctx)
+{
+	while (true) {
+		struct dir_batch *batch = ctx->batch;
+
+		if (batch && batch->pos < batch->len) {
+			struct dir_record *rec = &batch->records[batch->pos++];
+
+			ctx->entry.path = batch->text + rec->path;
+			ctx->entry.name = batch->text + rec->name;
+			ctx->entry.type = rec->type;
+			ctx->entry.depth = rec->depth;
+
+			return &ctx->entry;
+		}
+
+		dir_batch_destroy(&ctx->batch);
+
+		MTY_MutexLock(ctx->mutex);
+
+		while (!ctx->ready && ctx->finished < ctx->nthreads)
+			MTY_CondWait(ctx->ready_cond, ctx->mutex, -1);
+
+		if (ctx->ready) {
+			ctx->batch = ctx->ready;
+			ctx->ready = ctx->ready->next;
+			ctx->ready_len--;
+
+			if (!ctx->ready)
+				ctx->ready_tail = NULL;
+
+			MTY_CondSignal(ctx->space_cond);
+		}
+
+		MTY_MutexUnlock(ctx->mutex);
+
+		if (!ctx->batch)
+			return NULL;
+	}
+}
+
+
+// Public
+
+MTY_DirIter *MTY_DirIterCreate(const char *path, const char *filter, MTY_DirFlag flags)
+{
+	struct dirread *dr = mty_dirread_open(path);
+	if (!dr)
+		return NULL;
+
+	MTY_DirIter *ctx = MTY_Alloc(1, sizeof(MTY_DirIter));
+	ctx->flags = flags;
+
+	if (filter && filter[0]) {
+		ctx->filter = MTY_Strdup(filter);
+		ctx->glob = strpbrk(filter, "*?");
+	}
+
+	ctx->cursor.dr = dr;
+	ctx->cursor.dir.path = MTY_Strdup(path);
+
+	if ((flags & MTY_DIR_FLAG_RECURSIVE) && (flags & MTY_DIR_FLAG_PARALLEL)) {
+		// The threads start from the stack, the root is read again by one of them
+		dir_push(ctx, path, 0);
+		dir_cursor_close(&ctx->cursor);
+
+		ctx->mutex = MTY_MutexCreate();
+		ctx->work_cond = MTY_CondCreate();
+		ctx->ready_cond = MTY_CondCreate();
+		ctx->space_cond = MTY_CondCreate();
+
+		ctx->nthreads = MTY_MAX(1, MTY_MIN(MTY_GetNumProcessors(), DIR_MAX_THREADS));
+
+		for (uint32_t x = 0; x < ctx->nthreads; x++)
+			ctx->threads[x] = MTY_ThreadCreate(dir_thread, ctx);
+	}
+
+	return ctx;
+}
+
+void MTY_DirIterDestroy(MTY_DirIter **iter)
+{
+	if (!iter || !*iter)
+		return;
+
+	MTY_DirIter *ctx = *iter;
+
+	if (ctx->mutex) {
+		MTY_MutexLock(ctx->mutex);
+		ctx->stop = true;
+		MTY_CondSignalAll(ctx->work_cond);
+		MTY_CondSignalAll(ctx->space_cond);
+		MTY_MutexUnlock(ctx->mutex);
+
+		for (uint32_t x = 0; x < ctx->nthreads; x++)
+			MTY_ThreadDestroy(&ctx->threads[x]);
+
+		while (ctx->ready) {
+			struct dir_batch *next = ctx->ready->next;
+			dir_batch_destroy(&ctx->ready);
+			ctx->ready = next;
+		}
+
+		dir_batch_destroy(&ctx->batch);
+
+		MTY_CondDestroy(&ctx->space_cond);
+		MTY_CondDestroy(&ctx->ready_cond);
+		MTY_CondDestroy(&ctx->work_cond);
+		MTY_MutexDestroy(&ctx->mutex);
+	}
+
+	dir_cursor_close(&ctx->cursor);
+	MTY_Free(ctx->cursor.path);
+
+	for (uint32_t x = 0; x < ctx->stack_len; x++)
+		MTY_Free(ctx->stack[x].path);
+
+	MTY_Free(ctx->stack);
+	MTY_Free(ctx->filter);
+
+	MTY_Free(ctx);
+	*iter = NULL;
+}
+
+const MTY_DirEntry *MTY_DirIterNext(MTY_DirIter *ctx)
+{
+	if (ctx->mutex)
+		return dir_parallel_next(ctx);
+
+	struct dir_cursor *cur = &ctx->cursor;
+
+	while (true) {
+		if (cur->dr) {
+			const MTY_DirEntry *entry = dir_cursor_next(ctx, cur);
+			if (entry)
+				return entry;
+
+			dir_cursor_close(cur);
+		}
+
+		if (ctx->stack_len == 0)
+			return NULL;
+
+		// Directories that can't be opened are logged and skipped
+		dir_cursor_open(cur, &ctx->stack[--ctx->stack_len]);
+	}
+}
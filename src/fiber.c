@@ -0,0 +1,310 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _DEFAULT_SOURCE  // MAP_ANONYMOUS
+#define _DARWIN_C_SOURCE // MAP_ANON
+
+#include "fiber.h"
+
+#include "tlocal.h"
+#include "fiberpoll.h"
+#include "fiberctx.h"
+
+// Each thread that starts fibers gets its own scheduler. MTY_FiberRun switches to
+// every ready fiber in turn, then blocks in the platform poller until a socket a
+// fiber is waiting on becomes ready or the earliest sleep or poll timeout expires.
+
+#define FIBER_STACK_SIZE (256 * 1024)
+
+struct fiber {
+	MTY_Link link;
+	struct fiberctx *ctx;
+
+	MTY_AnonFunc func;
+	void *opaque;
+
+	MTY_Time start;
+	uint32_t timeout;
+	bool timed;
+
+	intptr_t fd;
+	bool out;
+	bool polled;
+	MTY_Async result;
+};
+
+struct fiber_sched {
+	struct fiberctx *ctx;
+	struct fiberpoll *poll;
+
+	struct fiber *current;
+	struct fiber *dead;
+	uint32_t count;
+
+	MTY_LinkList ready;
+	MTY_LinkList timed;
+};
+
+static TLOCAL struct fiber_sched *FIBER_SCHED;
+
+#define FIBER(ptr) \
+	MTY_LINK_ENTRY(ptr, struct fiber, link)
+
+
+// Scheduler
+
+static struct fiber_sched *fiber_sched(void)
+{
+	if (!FIBER_SCHED) {
+		struct fiberctx *ctx = mty_fiberctx_create(0, NULL);
+		if (!ctx)
+			return NULL;
+
+		FIBER_SCHED = MTY_Alloc(1, sizeof(struct fiber_sched));
+		FIBER_SCHED->ctx = ctx;
+	}
+
+	return FIBER_SCHED;
+}
+
+static void fiber_sched_destroy(void)
+{
+	struct fiber_sched *s = FIBER_SCHED;
+
+	mty_fiberpoll_destroy(&s->poll);
+	mty_fiberctx_destroy(&s->ctx);
+
+	MTY_Free(s);
+	FIBER_SCHED = NULL;
+}
+
+static void fiber_destroy(struct fiber **fiber)
+{
+	if (!fiber || !*fiber)
+		return;
+
+	struct fiber *ctx = *fiber;
+
+	mty_fiberctx_destroy(&ctx->ctx);
+
+	MTY_Free(ctx);
+	*fiber = NULL;
+}
+
+static void fiber_suspend(struct fiber_sched *s, struct fiber *f)
+{
+	mty_fiberctx_switch(f->ctx, s->ctx);
+}
+
+static void fiber_wake(struct fiber_sched *s, struct fiber *f)
+{
+	if (f->timed) {
+		MTY_LinkListRemove(&s->timed, &f->link);
+		f->timed = false;
+	}
+
+	MTY_LinkListAppend(&s->ready, &f->link);
+}
+
+static void fiber_set_timeout(struct fiber_sched *s, struct fiber *f, uint32_t timeout)
+{
+	f->start = MTY_GetTime();
+	f->timeout = timeout;
+	f->timed = true;
+
+	MTY_LinkListAppend(&s->timed, &f->link);
+}
+
+static int32_t fiber_next_timeout(struct fiber_sched *s)
+{
+	if (!s->timed.first)
+		return -1;
+
+	MTY_Time now = MTY_GetTime();
+	float timeout = (float) INT32_MAX;
+
+	for (MTY_Link *l = s->timed.first; l; l = l->next) {
+		struct fiber *f = FIBER(l);
+		timeout = MTY_MIN(timeout, f->timeout - MTY_TimeDiff(f->start, now));
+	}
+
+	// Round up so the poller doesn't return just short of the deadline
+	return timeout > 0.0f ? (int32_t) timeout + 1 : 0;
+}
+
+static void fiber_expire(struct fiber_sched *s)
+{
+	MTY_Time now = MTY_GetTime();
+
+	for (MTY_Link *l = s->timed.first; l;) {
+		MTY_Link *next = l->next;
+		struct fiber *f = FIBER(l);
+
+		if (MTY_TimeDiff(f->start, now) >= f->timeout) {
+			if (f->polled) {
+				mty_fiberpoll_remove(s->poll, f->fd, f->out);
+				f->polled = false;
+				f->result = MTY_ASYNC_CONTINUE;
+			}
+
+			fiber_wake(s, f);
+		}
+
+		l = next;
+	}
+}
+
+static void fiber_entry(void)
+{
+	struct fiber_sched *s = FIBER_SCHED;
+	struct fiber *f = s->current;
+
+	f->func(f->opaque);
+
+	// The stack is still in use here, the scheduler frees it after switching away
+	s->dead = f;
+	s->count--;
+
+	fiber_suspend(s, f);
+}
+
+
+// Internal
+
+MTY_Async mty_fiber_poll(intptr_t fd, bool out, int32_t timeout)
+{
+	struct fiber_sched *s = FIBER_SCHED;
+	struct fiber *f = s ? s->current : NULL;
+
+	if (!f)
+		return MTY_ASYNC_ERROR;
+
+	if (!s->poll) {
+		s->poll = mty_fiberpoll_create();
+
+		if (!s->poll)
+			return MTY_ASYNC_ERROR;
+	}
+
+	if (!mty_fiberpoll_add(s->poll, fd, out, f))
+		return MTY_ASYNC_ERROR;
+
+	f->fd = fd;
+	f->out = out;
+	f->polled = true;
+	f->result = MTY_ASYNC_OK;
+
+	if (timeout >= 0)
+		fiber_set_timeout(s, f, timeout);
+
+	fiber_suspend(s, f);
+
+	return f->result;
+}
+
+
+// Public
+
+bool MTY_FiberStart(MTY_AnonFunc func, void *opaque, size_t stackSize)
+{
+	struct fiber *f = MTY_Alloc(1, sizeof(struct fiber));
+	f->func = func;
+	f->opaque = opaque;
+
+	f->ctx = mty_fiberctx_create(stackSize > 0 ? stackSize : FIBER_STACK_SIZE, fiber_entry);
+
+	struct fiber_sched *s = f->ctx ? fiber_sched() : NULL;
+
+	if (!s) {
+		fiber_destroy(&f);
+		return false;
+	}
+
+	MTY_LinkListAppend(&s->ready, &f->link);
+	s->count++;
+
+	return true;
+}
+
+void MTY_FiberRun(void)
+{
+	struct fiber_sched *s = FIBER_SCHED;
+
+	if (!s)
+		return;
+
+	if (s->current) {
+		MTY_Log("MTY_FiberRun can not be called from a fiber");
+		return;
+	}
+
+	void *ready[FIBERPOLL_EVENTS];
+
+	while (s->count > 0) {
+		while (s->ready.first) {
+			struct fiber *f = FIBER(s->ready.first);
+			MTY_LinkListRemove(&s->ready, &f->link);
+
+			s->current = f;
+			mty_fiberctx_switch(s->ctx, f->ctx);
+			s->current = NULL;
+
+			fiber_destroy(&s->dead);
+		}
+
+		if (s->count == 0)
+			break;
+
+		int32_t timeout = fiber_next_timeout(s);
+
+		if (s->poll) {
+			uint32_t n = mty_fiberpoll_wait(s->poll, timeout, ready, FIBERPOLL_EVENTS);
+
+			for (uint32_t x = 0; x < n; x++) {
+				struct fiber *f = ready[x];
+				f->polled = false;
+
+				fiber_wake(s, f);
+			}
+
+		} else if (timeout > 0) {
+			MTY_Sleep(timeout);
+		}
+
+		fiber_expire(s);
+	}
+
+	fiber_sched_destroy();
+}
+
+void MTY_FiberYield(void)
+{
+	struct fiber_sched *s = FIBER_SCHED;
+
+	if (!s || !s->current)
+		return;
+
+	MTY_LinkListAppend(&s->ready, &s->current->link);
+	fiber_suspend(s, s->current);
+}
+
+void MTY_FiberSleep(uint32_t timeout)
+{
+	struct fiber_sched *s = FIBER_SCHED;
+
+	if (!s || !s->current) {
+		MTY_Sleep(timeout);
+		return;
+	}
+
+	fiber_set_timeout(s, s->current, timeout);
+	fiber_suspend(s, s->current);
+}
+
+bool MTY_FiberIsActive(void)
+{
+	return FIBER_SCHED && FIBER_SCHED->current;
+}
@@ -98,6 +98,45 @@ bool MTY_AppendTextToFile(const char *path, const char *fmt, ...)
 	return r;
 }
 
+bool MTY_WriteFileAtomic(const char *path, const void *data, size_t size)
+{
+	char *tmp = MTY_SprintfD("%s.%08X.tmp", path, MTY_GetRandomUInt(0, UINT32_MAX));
+
+	bool r = false;
+
+	FILE *f = fsutil_open(tmp, "wb");
+	if (!f)
+		goto except;
+
+	fsutil_copy_mode(f, path);
+
+	r = fwrite(data, 1, size, f) == size;
+	if (!r)
+		MTY_Log("'fwrite' failed with ferror %d", ferror(f));
+
+	r = r && fsutil_sync(f);
+
+	if (fclose(f) != 0) {
+		MTY_Log("'fclose' failed with errno %d", errno);
+		r = false;
+	}
+
+	r = r && MTY_MoveFile(tmp, path);
+
+	if (r) {
+		fsutil_sync_dir(path);
+
+	} else {
+		MTY_DeleteFile(tmp);
+	}
+
+	except:
+
+	MTY_Free(tmp);
+
+	return r;
+}
+
 void MTY_FreeFileList(MTY_FileList **fl)
 {
 	if (!fl || !*fl)
@@ -151,3 +190,187 @@ const char *MTY_GetPathPrefix(const char *path)
 
 	return local;
 }
+
+
+// Writer
+
+#define FILE_WRITER_BUFFER (64 * 1024)
+
+struct MTY_FileWriter {
+	FILE *f;
+	MTY_FileWriterDesc desc;
+
+	uint8_t *buf;
+	size_t len;
+	uint64_t unsynced;
+	MTY_Time flushed;
+	MTY_Time synced;
+};
+
+MTY_FileWriter *MTY_FileWriterCreate(const char *path, const MTY_FileWriterDesc *desc)
+{
+	MTY_FileWriterDesc dtmp = {0};
+	if (!desc)
+		desc = &dtmp;
+
+	FILE *f = fsutil_open(path, desc->truncate ? "wb" : "ab");
+	if (!f)
+		return NULL;
+
+	// All buffering is done here so a full buffer is always a single write
+	setvbuf(f, NULL, _IONBF, 0);
+
+	MTY_FileWriter *ctx = MTY_Alloc(1, sizeof(MTY_FileWriter));
+	ctx->f = f;
+	ctx->desc = *desc;
+
+	if (ctx->desc.bufferSize == 0)
+		ctx->desc.bufferSize = FILE_WRITER_BUFFER;
+
+	ctx->buf = MTY_Alloc(ctx->desc.bufferSize, 1);
+	ctx->flushed = ctx->synced = MTY_GetTime();
+
+	return ctx;
+}
+
+void MTY_FileWriterDestroy(MTY_FileWriter **writer)
+{
+	if (!writer || !*writer)
+		return;
+
+	MTY_FileWriter *ctx = *writer;
+
+	if (ctx->desc.syncPolicy != MTY_SYNC_POLICY_NEVER) {
+		MTY_FileWriterSync(ctx);
+
+	} else {
+		MTY_FileWriterFlush(ctx);
+	}
+
+	fclose(ctx->f);
+
+	MTY_Free(ctx->buf);
+
+	MTY_Free(ctx);
+	*writer = NULL;
+}
+
+static bool file_writer_write(MTY_FileWriter *ctx, const void *data, size_t size)
+{
+	if (fwrite(data, 1, size, ctx->f) != size) {
+		MTY_Log("'fwrite' failed with ferror %d", ferror(ctx->f));
+		clearerr(ctx->f);
+		return false;
+	}
+
+	return true;
+}
+
+bool MTY_FileWriterFlush(MTY_FileWriter *ctx)
+{
+	ctx->flushed = MTY_GetTime();
+
+	if (ctx->len == 0)
+		return true;
+
+	bool r = file_writer_write(ctx, ctx->buf, ctx->len);
+
+	// On failure the buffered data is dropped rather than retried on every append
+	ctx->len = 0;
+
+	return r;
+}
+
+bool MTY_FileWriterSync(MTY_FileWriter *ctx)
+{
+	bool r = MTY_FileWriterFlush(ctx);
+
+	ctx->unsynced = 0;
+	ctx->synced = ctx->flushed;
+
+	return fsutil_sync(ctx->f) && r;
+}
+
+static bool file_writer_policy(MTY_FileWriter *ctx, size_t size)
+{
+	ctx->unsynced += size;
+
+	switch (ctx->desc.syncPolicy) {
+		case MTY_SYNC_POLICY_INTERVAL:
+			if (MTY_TimeDiff(ctx->synced, MTY_GetTime()) >= ctx->desc.syncInterval)
+				return MTY_FileWriterSync(ctx);
+			break;
+		case MTY_SYNC_POLICY_BYTES:
+			if (ctx->unsynced >= ctx->desc.syncBytes)
+				return MTY_FileWriterSync(ctx);
+			break;
+	}
+
+	if (ctx->desc.flushInterval > 0 && ctx->len > 0 &&
+		MTY_TimeDiff(ctx->flushed, MTY_GetTime()) >= ctx->desc.flushInterval)
+		return MTY_FileWriterFlush(ctx);
+
+	return true;
+}
+
+bool MTY_FileWriterWrite(MTY_FileWriter *ctx, const void *data, size_t size)
+{
+	if (ctx->len + size > ctx->desc.bufferSize && !MTY_FileWriterFlush(ctx))
+		return false;
+
+	// Data that would fill the buffer on its own skips it
+	if (size >= ctx->desc.bufferSize) {
+		if (!file_writer_write(ctx, data, size))
+			return false;
+
+	} else {
+		memcpy(ctx->buf + ctx->len, data, size);
+		ctx->len += size;
+	}
+
+	return file_writer_policy(ctx, size);
+}
+
+bool MTY_FileWriterPrintf(MTY_FileWriter *ctx, const char *fmt, ...)
+{
+	for (uint8_t x = 0; x < 2; x++) {
+		size_t avail = ctx->desc.bufferSize - ctx->len;
+
+		va_list args;
+		va_start(args, fmt);
+		int32_t n = vsnprintf((char *) ctx->buf + ctx->len, avail, fmt, args);
+		va_end(args);
+
+		if (n < 0) {
+			MTY_Log("'vsnprintf' failed with errno %d", errno);
+			return false;
+		}
+
+		// vsnprintf always leaves room for a null character, which isn't written out
+		if ((size_t) n < avail) {
+			ctx->len += n;
+			return file_writer_policy(ctx, n);
+		}
+
+		if (x == 0 && ctx->len > 0 && (size_t) n < ctx->desc.bufferSize) {
+			if (!MTY_FileWriterFlush(ctx))
+				return false;
+
+			continue;
+		}
+
+		break;
+	}
+
+	// Larger than the buffer
+	va_list args;
+	va_start(args, fmt);
+	char *str = MTY_VsprintfD(fmt, args);
+	va_end(args);
+
+	bool r = MTY_FileWriterWrite(ctx, str, strlen(str));
+
+	MTY_Free(str);
+
+	return r;
+}
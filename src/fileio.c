@@ -0,0 +1,397 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _DEFAULT_SOURCE // pread, pwrite
+
+#include "matoya.h"
+
+#include "fileio.h"
+
+// Requests are staged until MTY_FileIOSubmit, then handed to the platform's ring in one
+// go. Without a ring they go to a work queue serviced by threads owned by the
+// MTY_FileIO rather than the shared task workers, which are sized for CPU bound work and
+// would be starved by requests that block on the disk.
+
+#define FILEIO_MAX_SIZE    (1024 * 1024 * 1024)
+#define FILEIO_MAX_THREADS 4
+#define FILEIO_POLL_BATCH  64
+
+struct fileio_request {
+	intptr_t fd;
+	bool write;
+	void *buf;
+	size_t size;
+	uint64_t offset;
+	int32_t buf_index;
+	void *opaque;
+};
+
+struct fileio_buffer {
+	const uint8_t *base;
+	size_t size;
+};
+
+struct MTY_FileIO {
+	uint32_t depth;
+	uint32_t pending;
+	struct fileio_ring *ring;
+
+	intptr_t *files;
+	uint32_t nfiles;
+
+	struct fileio_buffer *buffers;
+	uint32_t nbuffers;
+
+	struct fileio_request *staged;
+	uint32_t nstaged;
+
+	MTY_Thread *threads[FILEIO_MAX_THREADS];
+	uint32_t nthreads;
+	MTY_Mutex *mutex;
+	MTY_Cond *work_cond;
+	MTY_Cond *done_cond;
+	bool stop;
+
+	struct fileio_request *work;
+	uint32_t work_head;
+	uint32_t work_len;
+
+	MTY_FileIOResult *done;
+	uint32_t done_head;
+	uint32_t done_len;
+};
+
+
+// Threads
+
+static void *fileio_thread(void *opaque)
+{
+	MTY_FileIO *ctx = opaque;
+
+	MTY_MutexLock(ctx->mutex);
+
+	while (true) {
+		while (ctx->work_len == 0 && !ctx->stop)
+			MTY_CondWait(ctx->work_cond, ctx->mutex, -1);
+
+		// Work still queued when stopping is drained before exiting
+		if (ctx->work_len == 0)
+			break;
+
+		struct fileio_request req = ctx->work[ctx->work_head];
+		ctx->work_head = (ctx->work_head + 1) % ctx->depth;
+		ctx->work_len--;
+
+		MTY_MutexUnlock(ctx->mutex);
+
+		int64_t r = req.write ? mty_fileio_write(req.fd, req.buf, req.size, req.offset) :
+			mty_fileio_read(req.fd, req.buf, req.size, req.offset);
+
+		MTY_MutexLock(ctx->mutex);
+
+		MTY_FileIOResult *res = &ctx->done[(ctx->done_head + ctx->done_len) % ctx->depth];
+		res->opaque = req.opaque;
+		res->result = r;
+		ctx->done_len++;
+
+		MTY_CondSignal(ctx->done_cond);
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return NULL;
+}
+
+static void fileio_threads_submit(MTY_FileIO *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	for (uint32_t x = 0; x < ctx->nstaged; x++) {
+		ctx->work[(ctx->work_head + ctx->work_len) % ctx->depth] = ctx->staged[x];
+		ctx->work_len++;
+	}
+
+	MTY_CondSignalAll(ctx->work_cond);
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+static uint32_t fileio_threads_wait(MTY_FileIO *ctx, int32_t timeout, MTY_FileIOResult *results, uint32_t max)
+{
+	int64_t deadline = MTY_GetTimeNs() + (int64_t) timeout * 1000 * 1000;
+
+	MTY_MutexLock(ctx->mutex);
+
+	while (ctx->done_len == 0 && timeout != 0) {
+		int32_t remaining = -1;
+
+		if (timeout > 0) {
+			int64_t now = MTY_GetTimeNs();
+			if (now >= deadline)
+				break;
+
+			remaining = (int32_t) ((deadline - now + 999999) / (1000 * 1000));
+		}
+
+		MTY_CondWait(ctx->done_cond, ctx->mutex, remaining);
+	}
+
+	uint32_t n = 0;
+
+	for (; ctx->done_len > 0 && n < max; n++) {
+		results[n] = ctx->done[ctx->done_head];
+		ctx->done_head = (ctx->done_head + 1) % ctx->depth;
+		ctx->done_len--;
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return n;
+}
+
+
+// Public
+
+MTY_FileIO *MTY_FileIOCreate(uint32_t depth)
+{
+	if (depth == 0) {
+		MTY_Log("'depth' must be greater than 0");
+		return NULL;
+	}
+
+	MTY_FileIO *ctx = MTY_Alloc(1, sizeof(MTY_FileIO));
+	ctx->depth = depth;
+
+	ctx->ring = mty_fileio_ring_create(depth);
+
+	if (ctx->ring) {
+		ctx->depth = MTY_MIN(depth, mty_fileio_ring_entries(ctx->ring));
+
+	} else {
+		ctx->mutex = MTY_MutexCreate();
+		ctx->work_cond = MTY_CondCreate();
+		ctx->done_cond = MTY_CondCreate();
+		ctx->work = MTY_Alloc(depth, sizeof(struct fileio_request));
+		ctx->done = MTY_Alloc(depth, sizeof(MTY_FileIOResult));
+
+		ctx->nthreads = MTY_MIN(depth, FILEIO_MAX_THREADS);
+
+		for (uint32_t x = 0; x < ctx->nthreads; x++)
+			ctx->threads[x] = MTY_ThreadCreate(fileio_thread, ctx);
+	}
+
+	ctx->staged = MTY_Alloc(ctx->depth, sizeof(struct fileio_request));
+
+	return ctx;
+}
+
+void MTY_FileIODestroy(MTY_FileIO **fio)
+{
+	if (!fio || !*fio)
+		return;
+
+	MTY_FileIO *ctx = *fio;
+
+	// The ring waits for the requests the kernel has accepted before the buffers and
+	// files they refer to go away
+	mty_fileio_ring_destroy(&ctx->ring);
+
+	if (ctx->mutex) {
+		MTY_MutexLock(ctx->mutex);
+		ctx->stop = true;
+		MTY_CondSignalAll(ctx->work_cond);
+		MTY_MutexUnlock(ctx->mutex);
+
+		for (uint32_t x = 0; x < ctx->nthreads; x++)
+			MTY_ThreadDestroy(&ctx->threads[x]);
+
+		MTY_CondDestroy(&ctx->done_cond);
+		MTY_CondDestroy(&ctx->work_cond);
+		MTY_MutexDestroy(&ctx->mutex);
+	}
+
+	for (uint32_t x = 0; x < ctx->nfiles; x++)
+		if (ctx->files[x] != -1)
+			mty_fileio_close(ctx->files[x]);
+
+	MTY_Free(ctx->files);
+	MTY_Free(ctx->buffers);
+	MTY_Free(ctx->staged);
+	MTY_Free(ctx->work);
+	MTY_Free(ctx->done);
+
+	MTY_Free(ctx);
+	*fio = NULL;
+}
+
+uint32_t MTY_FileIOOpen(MTY_FileIO *ctx, const char *path, bool write)
+{
+	intptr_t fd = mty_fileio_open(path, write);
+	if (fd == -1)
+		return 0;
+
+	uint32_t x = 0;
+
+	for (; x < ctx->nfiles; x++)
+		if (ctx->files[x] == -1)
+			break;
+
+	if (x == ctx->nfiles)
+		ctx->files = MTY_Realloc(ctx->files, ++ctx->nfiles, sizeof(intptr_t));
+
+	ctx->files[x] = fd;
+
+	return x + 1;
+}
+
+void MTY_FileIOClose(MTY_FileIO *ctx, uint32_t file)
+{
+	if (file == 0 || file > ctx->nfiles || ctx->files[file - 1] == -1)
+		return;
+
+	mty_fileio_close(ctx->files[file - 1]);
+	ctx->files[file - 1] = -1;
+}
+
+bool MTY_FileIORegisterBuffers(MTY_FileIO *ctx, void **buffers, const size_t *sizes, uint32_t count)
+{
+	if (!ctx->ring)
+		return true;
+
+	MTY_Free(ctx->buffers);
+	ctx->buffers = NULL;
+	ctx->nbuffers = 0;
+
+	if (!mty_fileio_ring_register(ctx->ring, buffers, sizes, count))
+		return false;
+
+	if (count > 0) {
+		ctx->buffers = MTY_Alloc(count, sizeof(struct fileio_buffer));
+		ctx->nbuffers = count;
+
+		for (uint32_t x = 0; x < count; x++) {
+			ctx->buffers[x].base = buffers[x];
+			ctx->buffers[x].size = sizes[x];
+		}
+	}
+
+	return true;
+}
+
+static int32_t fileio_buffer_index(MTY_FileIO *ctx, const void *buf, size_t size)
+{
+	const uint8_t *b = buf;
+
+	for (uint32_t x = 0; x < ctx->nbuffers; x++) {
+		const struct fileio_buffer *rb = &ctx->buffers[x];
+
+		if (b >= rb->base && size <= rb->size && (size_t) (b - rb->base) <= rb->size - size)
+			return x;
+	}
+
+	return -1;
+}
+
+static bool fileio_queue(MTY_FileIO *ctx, uint32_t file, bool write, void *buf, size_t size,
+	uint64_t offset, void *opaque)
+{
+	if (file == 0 || file > ctx->nfiles || ctx->files[file - 1] == -1) {
+		MTY_Log("File %u is not open", file);
+		return false;
+	}
+
+	if (size > FILEIO_MAX_SIZE) {
+		MTY_Log("Request of %zu bytes is larger than the maximum of %d", size, FILEIO_MAX_SIZE);
+		return false;
+	}
+
+	if (ctx->pending >= ctx->depth)
+		return false;
+
+	struct fileio_request *req = &ctx->staged[ctx->nstaged++];
+	req->fd = ctx->files[file - 1];
+	req->write = write;
+	req->buf = buf;
+	req->size = size;
+	req->offset = offset;
+	req->buf_index = fileio_buffer_index(ctx, buf, size);
+	req->opaque = opaque;
+
+	ctx->pending++;
+
+	return true;
+}
+
+bool MTY_FileIORead(MTY_FileIO *ctx, uint32_t file, void *buf, size_t size, uint64_t offset,
+	void *opaque)
+{
+	return fileio_queue(ctx, file, false, buf, size, offset, opaque);
+}
+
+bool MTY_FileIOWrite(MTY_FileIO *ctx, uint32_t file, const void *buf, size_t size,
+	uint64_t offset, void *opaque)
+{
+	return fileio_queue(ctx, file, true, (void *) buf, size, offset, opaque);
+}
+
+uint32_t MTY_FileIOSubmit(MTY_FileIO *ctx)
+{
+	if (ctx->nstaged == 0)
+		return 0;
+
+	uint32_t n = ctx->nstaged;
+
+	if (ctx->ring) {
+		for (uint32_t x = 0; x < ctx->nstaged; x++) {
+			struct fileio_request *req = &ctx->staged[x];
+
+			mty_fileio_ring_push(ctx->ring, req->fd, req->write, req->buf, req->size,
+				req->offset, req->buf_index, req->opaque);
+		}
+
+		n = mty_fileio_ring_submit(ctx->ring);
+
+	} else {
+		fileio_threads_submit(ctx);
+	}
+
+	ctx->nstaged = 0;
+
+	return n;
+}
+
+uint32_t MTY_FileIOWait(MTY_FileIO *ctx, int32_t timeout, MTY_FileIOResult *results, uint32_t max)
+{
+	MTY_FileIOSubmit(ctx);
+
+	if (ctx->pending == 0 || max == 0)
+		return 0;
+
+	uint32_t n = ctx->ring ? mty_fileio_ring_wait(ctx->ring, timeout, results, max) :
+		fileio_threads_wait(ctx, timeout, results, max);
+
+	ctx->pending -= n;
+
+	return n;
+}
+
+uint32_t MTY_FileIOPoll(MTY_FileIO *ctx, int32_t timeout, MTY_FileIOFunc func, void *opaque)
+{
+	MTY_FileIOResult results[FILEIO_POLL_BATCH];
+	uint32_t total = 0;
+
+	// Only the first batch waits, anything after it is already complete
+	for (uint32_t n = FILEIO_POLL_BATCH; n == FILEIO_POLL_BATCH; timeout = 0) {
+		n = MTY_FileIOWait(ctx, timeout, results, FILEIO_POLL_BATCH);
+
+		for (uint32_t x = 0; x < n; x++)
+			func(&results[x], opaque);
+
+		total += n;
+	}
+
+	return total;
+}
@@ -0,0 +1,158 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include "fswatch.h"
+
+// Changes read from the platform are held per path until the path has gone `debounce`
+// milliseconds without another change, folding everything that happened in between
+// into one event.
+
+struct filewatch_pending {
+	MTY_FileChange changes;
+	bool dir;
+	int64_t last;
+};
+
+struct MTY_FileWatch {
+	struct fswatch *fsw;
+	int64_t debounce;
+	MTY_Hash *pending;
+	uint32_t npending;
+};
+
+MTY_FileWatch *MTY_FileWatchCreate(uint32_t debounce)
+{
+	struct fswatch *fsw = mty_fswatch_create();
+	if (!fsw)
+		return NULL;
+
+	MTY_FileWatch *ctx = MTY_Alloc(1, sizeof(MTY_FileWatch));
+	ctx->fsw = fsw;
+	ctx->debounce = (int64_t) debounce * 1000 * 1000;
+	ctx->pending = MTY_HashCreate(0);
+
+	return ctx;
+}
+
+void MTY_FileWatchDestroy(MTY_FileWatch **watch)
+{
+	if (!watch || !*watch)
+		return;
+
+	MTY_FileWatch *ctx = *watch;
+
+	MTY_HashDestroy(&ctx->pending, MTY_Free);
+	mty_fswatch_destroy(&ctx->fsw);
+
+	MTY_Free(ctx);
+	*watch = NULL;
+}
+
+bool MTY_FileWatchAdd(MTY_FileWatch *ctx, const char *path, bool recursive)
+{
+	return mty_fswatch_add(ctx->fsw, path, recursive);
+}
+
+void MTY_FileWatchRemove(MTY_FileWatch *ctx, const char *path)
+{
+	mty_fswatch_remove(ctx->fsw, path);
+}
+
+intptr_t MTY_FileWatchGetHandle(MTY_FileWatch *ctx)
+{
+	return mty_fswatch_handle(ctx->fsw);
+}
+
+static void filewatch_record(const char *path, MTY_FileChange change, bool dir, void *opaque)
+{
+	MTY_FileWatch *ctx = opaque;
+
+	struct filewatch_pending *p = MTY_HashGet(ctx->pending, path);
+
+	if (!p) {
+		p = MTY_Alloc(1, sizeof(struct filewatch_pending));
+		MTY_HashSet(ctx->pending, path, p);
+		ctx->npending++;
+	}
+
+	p->changes |= change;
+	p->dir = dir;
+	p->last = MTY_GetTimeNs();
+}
+
+static uint32_t filewatch_deliver(MTY_FileWatch *ctx, int64_t now, int64_t *next, MTY_FileWatchFunc func,
+	void *opaque)
+{
+	if (ctx->npending == 0)
+		return 0;
+
+	uint32_t n = 0;
+	char **ready = MTY_Alloc(ctx->npending, sizeof(char *));
+
+	uint64_t iter = 0;
+	const char *key = NULL;
+
+	while (MTY_HashGetNextKey(ctx->pending, &iter, &key)) {
+		struct filewatch_pending *p = MTY_HashGet(ctx->pending, key);
+		int64_t due = p->last + ctx->debounce;
+
+		if (due <= now) {
+			ready[n++] = MTY_Strdup(key);
+
+		} else if (*next == 0 || due < *next) {
+			*next = due;
+		}
+	}
+
+	for (uint32_t x = 0; x < n; x++) {
+		struct filewatch_pending *p = MTY_HashPop(ctx->pending, ready[x]);
+		ctx->npending--;
+
+		MTY_FileWatchEvent evt = {0};
+		evt.path = ready[x];
+		evt.changes = p->changes;
+		evt.dir = p->dir;
+
+		func(&evt, opaque);
+
+		MTY_Free(ready[x]);
+		MTY_Free(p);
+	}
+
+	MTY_Free(ready);
+
+	return n;
+}
+
+uint32_t MTY_FileWatchPoll(MTY_FileWatch *ctx, int32_t timeout, MTY_FileWatchFunc func, void *opaque)
+{
+	int64_t deadline = MTY_GetTimeNs() + (int64_t) timeout * 1000 * 1000;
+
+	while (true) {
+		mty_fswatch_read(ctx->fsw, filewatch_record, ctx);
+
+		int64_t now = MTY_GetTimeNs();
+		int64_t next = 0;
+
+		uint32_t n = filewatch_deliver(ctx, now, &next, func, opaque);
+		if (n > 0 || timeout == 0)
+			return n;
+
+		if (timeout > 0 && now >= deadline)
+			return 0;
+
+		// Sleep until something arrives, the next pending change is due, or the timeout
+		int64_t until = next;
+		if (timeout > 0 && (until == 0 || deadline < until))
+			until = deadline;
+
+		int32_t wait = until > 0 ? (int32_t) ((until - now + 999999) / (1000 * 1000)) : -1;
+
+		mty_fswatch_wait(ctx->fsw, wait);
+	}
+}
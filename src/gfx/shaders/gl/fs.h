@@ -0,0 +1,2 @@
+static const GLchar FRAG[]={
+0x00};
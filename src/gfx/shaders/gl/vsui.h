@@ -0,0 +1,2 @@
+static const GLchar VERT[]={
+0x00};
@@ -13,12 +13,852 @@
 #include <string.h>
 #include <limits.h>
 #include <math.h>
+#include <locale.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+	#define JSON_SSE2
+	#include <emmintrin.h>
+
+#elif defined(__aarch64__)
+	#define JSON_NEON
+	#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+static void json_lookup_free(void *index);
+#define CJSON_INDEX_FREE(index) json_lookup_free(index)
 
 #include "cJSON.h"
 
+
+// Parser
+
+// Stage 1 classifies the input 64 bytes at a time with SIMD compares and records the
+// offset of every structural character ({}[]:,) and of every value that starts outside
+// of a string. Stage 2 walks those offsets to build the same cJSON nodes the rest of
+// this file works with. All nodes and strings of a document are carved from one
+// allocation headed by the root node, so destroying the root releases the document.
+
+#define JSON_BLOCK 64
+
+struct json_block {
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t op;
+	uint64_t space;
+};
+
+struct json_scan {
+	uint64_t escaped;
+	uint64_t in_string;
+	uint64_t scalar;
+};
+
+struct json_parser {
+	const uint8_t *buf;
+	const uint8_t *end;
+	const uint32_t *idx;
+	uint32_t n;
+	uint32_t pos;
+	cJSON *nodes;
+	uint32_t nnodes;
+	uint8_t *str;
+	uint32_t depth;
+};
+
+static const double JSON_POW10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static uint32_t json_ctz(uint64_t v)
+{
+	#if defined(_MSC_VER)
+		unsigned long i = 0;
+
+		if ((uint32_t) v) {
+			_BitScanForward(&i, (uint32_t) v);
+			return i;
+		}
+
+		_BitScanForward(&i, (uint32_t) (v >> 32));
+		return i + 32;
+
+	#else
+		return __builtin_ctzll(v);
+	#endif
+}
+
+#if defined(JSON_NEON)
+
+static uint64_t json_neon_mask(uint8x16_t v)
+{
+	static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+
+	uint8x16_t m = vandq_u8(v, vld1q_u8(bits));
+
+	return vaddv_u8(vget_low_u8(m)) | ((uint64_t) vaddv_u8(vget_high_u8(m)) << 8);
+}
+
+#endif
+
+static void json_classify(const uint8_t *p, struct json_block *b)
+{
+	memset(b, 0, sizeof(struct json_block));
+
+	for (uint32_t x = 0; x < JSON_BLOCK; x += 16) {
+		uint64_t quote = 0;
+		uint64_t backslash = 0;
+		uint64_t op = 0;
+		uint64_t space = 0;
+
+		#if defined(JSON_SSE2)
+			__m128i v = _mm_loadu_si128((const __m128i *) (p + x));
+
+			// Setting 0x20 folds '[' onto '{' and ']' onto '}'
+			__m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+			quote = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+			backslash = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+
+			op = (uint16_t) _mm_movemask_epi8(_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(',')))));
+
+			space = (uint16_t) _mm_movemask_epi8(_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))));
+
+		#elif defined(JSON_NEON)
+			uint8x16_t v = vld1q_u8(p + x);
+			uint8x16_t folded = vorrq_u8(v, vdupq_n_u8(0x20));
+
+			quote = json_neon_mask(vceqq_u8(v, vdupq_n_u8('"')));
+			backslash = json_neon_mask(vceqq_u8(v, vdupq_n_u8('\\')));
+
+			op = json_neon_mask(vorrq_u8(
+				vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')), vceqq_u8(v, vdupq_n_u8(',')))));
+
+			space = json_neon_mask(vorrq_u8(
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), vceqq_u8(v, vdupq_n_u8('\t'))),
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8('\r')))));
+
+		#else
+			for (uint32_t y = 0; y < 16; y++) {
+				uint8_t c = p[x + y];
+				uint64_t bit = 1ull << y;
+
+				quote |= c == '"' ? bit : 0;
+				backslash |= c == '\\' ? bit : 0;
+				op |= (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') ? bit : 0;
+				space |= (c == ' ' || c == '\t' || c == '\n' || c == '\r') ? bit : 0;
+			}
+		#endif
+
+		b->quote |= quote << x;
+		b->backslash |= backslash << x;
+		b->op |= op << x;
+		b->space |= space << x;
+	}
+}
+
+static uint64_t json_escaped(uint64_t backslash, uint64_t *carry)
+{
+	const uint64_t even = 0x5555555555555555ull;
+
+	// A backslash escaped by the previous block does not start a run
+	backslash &= ~*carry;
+
+	uint64_t follows = (backslash << 1) | *carry;
+
+	// Runs of backslashes escape the next character when their length is odd. Adding
+	// the odd aligned starts to the runs carries out of every run that starts on an odd bit
+	uint64_t odd_starts = backslash & ~even & ~follows;
+	uint64_t even_runs = odd_starts + backslash;
+
+	*carry = even_runs < backslash ? 1 : 0;
+
+	return (even ^ (even_runs << 1)) & follows;
+}
+
+static uint64_t json_prefix_xor(uint64_t v)
+{
+	v ^= v << 1;
+	v ^= v << 2;
+	v ^= v << 4;
+	v ^= v << 8;
+	v ^= v << 16;
+	v ^= v << 32;
+
+	return v;
+}
+
+static uint64_t json_structurals(const uint8_t *p, struct json_scan *s)
+{
+	struct json_block b;
+	json_classify(p, &b);
+
+	uint64_t quote = b.quote & ~json_escaped(b.backslash, &s->escaped);
+
+	// Set from an opening quote up to, but not including, its closing quote
+	uint64_t in_string = json_prefix_xor(quote) ^ s->in_string;
+	s->in_string = (uint64_t) ((int64_t) in_string >> 63);
+
+	// Everything after an opening quote up to and including its closing quote
+	uint64_t string_tail = in_string ^ quote;
+
+	// Only the first byte of a scalar is interesting, the rest is validated by stage 2
+	uint64_t scalar = ~(b.op | b.space);
+	uint64_t nonquote = scalar & ~quote;
+	uint64_t follows = (nonquote << 1) | s->scalar;
+	s->scalar = nonquote >> 63;
+
+	return (b.op | (scalar & ~follows)) & ~string_tail;
+}
+
+static uint32_t *json_index(const uint8_t *buf, size_t len, uint32_t *n)
+{
+	uint32_t count = 0;
+	uint32_t cap = (uint32_t) (len / 8) + JSON_BLOCK;
+	uint32_t *idx = MTY_Alloc(cap, sizeof(uint32_t));
+
+	struct json_scan s = {0};
+	uint8_t tail[JSON_BLOCK];
+
+	for (size_t x = 0; x < len; x += JSON_BLOCK) {
+		const uint8_t *block = buf + x;
+
+		// The last block is padded with whitespace rather than reading past the end
+		if (len - x < JSON_BLOCK) {
+			memset(tail, ' ', JSON_BLOCK);
+			memcpy(tail, block, len - x);
+			block = tail;
+		}
+
+		uint64_t bits = json_structurals(block, &s);
+
+		if (count + JSON_BLOCK > cap) {
+			cap *= 2;
+			idx = MTY_Realloc(idx, cap, sizeof(uint32_t));
+		}
+
+		for (; bits; bits &= bits - 1)
+			idx[count++] = (uint32_t) x + json_ctz(bits);
+	}
+
+	// Unterminated string
+	if (s.in_string) {
+		MTY_Free(idx);
+		return NULL;
+	}
+
+	*n = count;
+
+	return idx;
+}
+
+static bool json_is_end(uint8_t c)
+{
+	switch (c) {
+		case ' ': case '\t': case '\n': case '\r':
+		case '{': case '}': case '[': case ']': case ':': case ',':
+			return true;
+	}
+
+	return false;
+}
+
+static bool json_is_hex4(const uint8_t *s, const uint8_t *end)
+{
+	if (end - s < 4)
+		return false;
+
+	for (uint8_t x = 0; x < 4; x++)
+		if (!isxdigit(s[x]))
+			return false;
+
+	return true;
+}
+
+static size_t json_span(const uint8_t *s, const uint8_t *end, uint8_t *dst)
+{
+	const uint8_t *start = s;
+
+	// Copies 16 bytes at a time until a quote or backslash turns up, the arena has
+	// room for the final store overshooting the string
+	#if defined(JSON_SSE2)
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+
+		for (; end - s >= 16; s += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *) s);
+			_mm_storeu_si128((__m128i *) (dst + (s - start)), v);
+
+			uint32_t m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+			if (m)
+				return (s - start) + json_ctz(m);
+		}
+
+	#elif defined(JSON_NEON)
+		const uint8x16_t quote = vdupq_n_u8('"');
+		const uint8x16_t backslash = vdupq_n_u8('\\');
+
+		for (; end - s >= 16; s += 16) {
+			uint8x16_t v = vld1q_u8(s);
+			vst1q_u8(dst + (s - start), v);
+
+			uint64_t m = json_neon_mask(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)));
+			if (m)
+				return (s - start) + json_ctz(m);
+		}
+	#endif
+
+	for (; s < end && *s != '"' && *s != '\\'; s++)
+		dst[s - start] = *s;
+
+	return s - start;
+}
+
+static char *json_parse_string(struct json_parser *p, const uint8_t *s)
+{
+	uint8_t *out = p->str;
+	uint8_t *o = out;
+
+	while (true) {
+		size_t span = json_span(s, p->end, o);
+		s += span;
+		o += span;
+
+		if (s >= p->end)
+			return NULL;
+
+		if (*s == '"')
+			break;
+
+		if (p->end - s < 2)
+			return NULL;
+
+		uint8_t len = 2;
+
+		switch (s[1]) {
+			case 'b': *o++ = '\b'; break;
+			case 'f': *o++ = '\f'; break;
+			case 'n': *o++ = '\n'; break;
+			case 'r': *o++ = '\r'; break;
+			case 't': *o++ = '\t'; break;
+			case '"':
+			case '\\':
+			case '/':
+				*o++ = s[1];
+				break;
+			case 'u': {
+				// Checked up front so a bad sequence can't swallow the closing quote
+				if (!json_is_hex4(s + 2, p->end))
+					return NULL;
+
+				unsigned code = parse_hex4(s + 2);
+
+				if (code >= 0xD800 && code <= 0xDBFF && (p->end - s < 12 || s[6] != '\\' || s[7] != 'u' ||
+					!json_is_hex4(s + 8, p->end)))
+					return NULL;
+
+				len = utf16_literal_to_utf8(s, p->end, &o);
+				if (len == 0)
+					return NULL;
+				break;
+			}
+			default:
+				return NULL;
+		}
+
+		s += len;
+	}
+
+	*o++ = '\0';
+	p->str = o;
+
+	return (char *) out;
+}
+
+static bool json_parse_literal(struct json_parser *p, const uint8_t *s, const char *lit)
+{
+	size_t len = strlen(lit);
+
+	return (size_t) (p->end - s) >= len && !memcmp(s, lit, len) && (s + len == p->end || json_is_end(s[len]));
+}
+
+static bool json_parse_number(struct json_parser *p, const uint8_t *s, cJSON *item)
+{
+	const uint8_t *start = s;
+	const uint8_t *end = p->end;
+
+	bool neg = *s == '-';
+	if (neg)
+		s++;
+
+	uint64_t mantissa = 0;
+	uint32_t digits = 0;
+	int32_t exp = 0;
+
+	// Digits past the 19th no longer fit, leaving the number to strtod
+	const uint8_t *int_start = s;
+
+	for (; s < end && *s >= '0' && *s <= '9'; s++) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*s - '0');
+			digits += mantissa > 0;
+
+		} else {
+			digits++;
+		}
+	}
+
+	if (s == int_start || (*int_start == '0' && s - int_start > 1))
+		return false;
+
+	if (s < end && *s == '.') {
+		const uint8_t *frac_start = ++s;
+
+		for (; s < end && *s >= '0' && *s <= '9'; s++) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*s - '0');
+				digits += mantissa > 0;
+				exp--;
+
+			} else {
+				digits++;
+			}
+		}
+
+		if (s == frac_start)
+			return false;
+	}
+
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		s++;
+
+		bool exp_neg = s < end && *s == '-';
+		if (s < end && (*s == '-' || *s == '+'))
+			s++;
+
+		const uint8_t *exp_start = s;
+		int32_t e = 0;
+
+		for (; s < end && *s >= '0' && *s <= '9'; s++)
+			if (e < 100000)
+				e = e * 10 + (*s - '0');
+
+		if (s == exp_start)
+			return false;
+
+		exp += exp_neg ? -e : e;
+	}
+
+	if (s < end && !json_is_end(*s))
+		return false;
+
+	double number = 0;
+
+	// Both the mantissa and the power of ten are exact as doubles, so a single
+	// multiply or divide is correctly rounded
+	if (digits <= 19 && mantissa <= (1ull << 53) && exp >= -22 && exp <= 22) {
+		number = exp < 0 ? (double) mantissa / JSON_POW10[-exp] : (double) mantissa * JSON_POW10[exp];
+
+		if (neg)
+			number = -number;
+
+	} else {
+		size_t len = s - start;
+		char *tmp = MTY_Alloc(len + 1, 1);
+		memcpy(tmp, start, len);
+
+		// strtod follows the locale, which may use something other than '.'
+		char *dot = strchr(tmp, '.');
+		if (dot)
+			*dot = localeconv()->decimal_point[0];
+
+		number = strtod(tmp, NULL);
+		MTY_Free(tmp);
+	}
+
+	item->type = cJSON_Number;
+	item->valuedouble = number;
+	item->valueint = number >= INT_MAX ? INT_MAX : number <= (double) INT_MIN ? INT_MIN : (int) number;
+
+	return true;
+}
+
+static uint8_t json_next(struct json_parser *p)
+{
+	return p->pos < p->n ? p->buf[p->idx[p->pos++]] : '\0';
+}
+
+static uint8_t json_peek(struct json_parser *p)
+{
+	return p->pos < p->n ? p->buf[p->idx[p->pos]] : '\0';
+}
+
+static cJSON *json_node(struct json_parser *p)
+{
+	return &p->nodes[p->nnodes++];
+}
+
+static bool json_parse_value(struct json_parser *p, cJSON *item);
+
+static bool json_parse_container(struct json_parser *p, cJSON *item, bool object)
+{
+	item->type = object ? cJSON_Object : cJSON_Array;
+
+	if (p->depth >= CJSON_NESTING_LIMIT)
+		return false;
+
+	uint8_t close = object ? '}' : ']';
+
+	if (json_peek(p) == close) {
+		p->pos++;
+		return true;
+	}
+
+	p->depth++;
+
+	for (cJSON *prev = NULL; true;) {
+		cJSON *child = NULL;
+
+		if (object) {
+			if (json_peek(p) != '"')
+				return false;
+
+			child = json_node(p);
+			child->string = json_parse_string(p, p->buf + p->idx[p->pos++] + 1);
+
+			if (!child->string || json_next(p) != ':')
+				return false;
+
+		} else {
+			child = json_node(p);
+		}
+
+		if (!json_parse_value(p, child))
+			return false;
+
+		if (object)
+			child->type |= cJSON_StringIsConst;
+
+		if (prev) {
+			prev->next = child;
+			child->prev = prev;
+
+		} else {
+			item->child = child;
+		}
+
+		prev = child;
+
+		uint8_t c = json_next(p);
+
+		if (c == close) {
+			// The first child keeps track of the last so appends don't walk the list
+			item->child->prev = prev;
+			break;
+		}
+
+		if (c != ',')
+			return false;
+	}
+
+	p->depth--;
+
+	return true;
+}
+
+static bool json_parse_value(struct json_parser *p, cJSON *item)
+{
+	if (p->pos >= p->n)
+		return false;
+
+	const uint8_t *s = p->buf + p->idx[p->pos++];
+	bool r = false;
+
+	switch (*s) {
+		case '{':
+		case '[':
+			r = json_parse_container(p, item, *s == '{');
+			break;
+		case '"':
+			item->type = cJSON_String;
+			item->valuestring = json_parse_string(p, s + 1);
+			r = item->valuestring != NULL;
+			break;
+		case 't':
+			item->type = cJSON_True;
+			item->valueint = 1;
+			r = json_parse_literal(p, s, "true");
+			break;
+		case 'f':
+			item->type = cJSON_False;
+			r = json_parse_literal(p, s, "false");
+			break;
+		case 'n':
+			item->type = cJSON_NULL;
+			r = json_parse_literal(p, s, "null");
+			break;
+		default:
+			r = (*s == '-' || (*s >= '0' && *s <= '9')) && json_parse_number(p, s, item);
+			break;
+	}
+
+	item->type |= cJSON_InArena;
+
+	return r;
+}
+
+static cJSON *json_parse(const void *input, size_t len)
+{
+	// Offsets are 32-bit
+	if (len >= UINT32_MAX)
+		return cJSON_ParseWithLengthOpts(input, len, NULL, false);
+
+	const uint8_t *buf = input;
+
+	uint32_t n = 0;
+	uint32_t *idx = json_index(buf, len, &n);
+	if (!idx)
+		return NULL;
+
+	// Every node starts at an offset that isn't a separator or a closing bracket, plus
+	// one for a node that fails to parse. Strings never unescape to more than their input.
+	uint32_t nvalues = 1;
+
+	for (uint32_t x = 0; x < n; x++) {
+		uint8_t c = buf[idx[x]];
+		nvalues += c != ',' && c != ':' && c != ']' && c != '}';
+	}
+
+	size_t nodes_size = (size_t) nvalues * sizeof(cJSON);
+	uint8_t *arena = MTY_Alloc(nodes_size + len + nvalues + 16, 1);
+
+	struct json_parser p = {0};
+	p.buf = buf;
+	p.end = buf + len;
+	p.idx = idx;
+	p.n = n;
+	p.nodes = (cJSON *) arena;
+	p.str = arena + nodes_size;
+
+	cJSON *root = json_node(&p);
+
+	if (json_parse_value(&p, root)) {
+		root->type |= cJSON_ArenaRoot;
+
+	} else {
+		MTY_Free(arena);
+		root = NULL;
+	}
+
+	MTY_Free(idx);
+
+	return root;
+}
+
+
+// Lookup
+
+// Objects and arrays with at least JSON_LOOKUP_MIN children get an offset table, and
+// objects a key hash, built the first time they are searched. The tables hang off the
+// cJSON node and every mutation below keeps them in sync. With duplicate keys the hash
+// points at the first, matching the linear search.
+
+// Searching is a const operation, so readers sharing a document may race to build the
+// tables. Each builds its own, one is published with a compare and swap and the others
+// are freed.
+
+#define JSON_LOOKUP_MIN 16
+
+struct json_lookup {
+	MTY_Hash *keys;
+	uint32_t nkeys;
+	uint32_t buckets;
+	bool dups;
+
+	cJSON **items;
+	uint32_t len;
+	uint32_t cap;
+};
+
+static void json_lookup_free(void *index)
+{
+	struct json_lookup *l = index;
+
+	MTY_HashDestroy(&l->keys, NULL);
+	MTY_Free(l->items);
+	MTY_Free(l);
+}
+
+static void json_lookup_hash(struct json_lookup *l)
+{
+	MTY_HashDestroy(&l->keys, NULL);
+
+	l->buckets = l->len * 2;
+	l->keys = MTY_HashCreate(l->buckets);
+	l->nkeys = 0;
+	l->dups = false;
+
+	for (uint32_t x = 0; x < l->len; x++) {
+		const char *key = l->items[x]->string;
+
+		if (!key)
+			continue;
+
+		if (MTY_HashGet(l->keys, key)) {
+			l->dups = true;
+
+		} else {
+			MTY_HashSet(l->keys, key, l->items[x]);
+			l->nkeys++;
+		}
+	}
+}
+
+static struct json_lookup *json_lookup(const cJSON *cj)
+{
+	MTY_AtomicPtr *index = (MTY_AtomicPtr *) &cj->index;
+
+	struct json_lookup *l = MTY_AtomicPtrLoad(index, MTY_MEMORY_ORDER_ACQUIRE);
+	if (l)
+		return l;
+
+	uint32_t n = 0;
+	const cJSON *child = cj->child;
+
+	for (; child && n < JSON_LOOKUP_MIN; child = child->next)
+		n++;
+
+	if (n < JSON_LOOKUP_MIN)
+		return NULL;
+
+	for (; child; child = child->next)
+		n++;
+
+	l = MTY_Alloc(1, sizeof(struct json_lookup));
+	l->cap = n;
+	l->items = MTY_Alloc(l->cap, sizeof(cJSON *));
+
+	for (child = cj->child; child; child = child->next)
+		l->items[l->len++] = (cJSON *) child;
+
+	if (cJSON_IsObject(cj))
+		json_lookup_hash(l);
+
+	void *cur = NULL;
+
+	if (!MTY_AtomicPtrCompareExchange(index, &cur, l, MTY_MEMORY_ORDER_ACQ_REL)) {
+		json_lookup_free(l);
+		return cur;
+	}
+
+	return l;
+}
+
+static void json_lookup_insert(struct json_lookup *l, uint32_t index, cJSON *item)
+{
+	if (l->len == l->cap) {
+		l->cap *= 2;
+		l->items = MTY_Realloc(l->items, l->cap, sizeof(cJSON *));
+	}
+
+	if (index > l->len)
+		index = l->len;
+
+	memmove(&l->items[index + 1], &l->items[index], (l->len - index) * sizeof(cJSON *));
+	l->items[index] = item;
+	l->len++;
+
+	if (l->keys && item->string) {
+		if (MTY_HashGet(l->keys, item->string)) {
+			l->dups = true;
+
+		} else {
+			MTY_HashSet(l->keys, item->string, item);
+			l->nkeys++;
+		}
+
+		// MTY_Hash has a fixed number of buckets, rebuild before the chains get long
+		if (l->nkeys > l->buckets * 4)
+			json_lookup_hash(l);
+	}
+}
+
+static void json_lookup_remove(struct json_lookup *l, cJSON *item)
+{
+	for (uint32_t x = 0; x < l->len; x++) {
+		if (l->items[x] == item) {
+			memmove(&l->items[x], &l->items[x + 1], (l->len - x - 1) * sizeof(cJSON *));
+			l->len--;
+			break;
+		}
+	}
+
+	if (!l->keys || !item->string || MTY_HashGet(l->keys, item->string) != item)
+		return;
+
+	MTY_HashPop(l->keys, item->string);
+	l->nkeys--;
+
+	// The next item with the same key is now the first
+	if (l->dups) {
+		for (uint32_t x = 0; x < l->len; x++) {
+			if (l->items[x]->string && !strcmp(l->items[x]->string, item->string)) {
+				MTY_HashSet(l->keys, item->string, l->items[x]);
+				l->nkeys++;
+				break;
+			}
+		}
+	}
+}
+
+static void json_lookup_replace(struct json_lookup *l, cJSON *item, cJSON *replacement)
+{
+	for (uint32_t x = 0; x < l->len; x++) {
+		if (l->items[x] == item) {
+			l->items[x] = replacement;
+			break;
+		}
+	}
+
+	if (l->keys && replacement->string)
+		MTY_HashSet(l->keys, replacement->string, replacement);
+}
+
+static cJSON *json_obj_get(const cJSON *cj, const char *key)
+{
+	struct json_lookup *l = key && cJSON_IsObject(cj) ? json_lookup(cj) : NULL;
+
+	return l ? MTY_HashGet(l->keys, key) : cJSON_GetObjectItemCaseSensitive(cj, key);
+}
+
+static cJSON *json_array_get(const cJSON *cj, uint32_t index)
+{
+	struct json_lookup *l = json_lookup(cj);
+
+	if (l)
+		return index < l->len ? l->items[index] : NULL;
+
+	return cJSON_GetArrayItem(cj, index);
+}
+
+
+// Public
+
 MTY_JSON *MTY_JSONParse(const char *input)
 {
-	return (MTY_JSON *) cJSON_Parse(input);
+	if (!input)
+		return NULL;
+
+	return (MTY_JSON *) json_parse(input, strlen(input));
 }
 
 char *MTY_JSONSerialize(const MTY_JSON *json)
@@ -34,10 +874,11 @@ char *MTY_JSONSerialize(const MTY_JSON *json)
 MTY_JSON *MTY_JSONReadFile(const char *path)
 {
 	MTY_JSON *j = NULL;
-	void *jstr = MTY_ReadFile(path, NULL);
+	size_t size = 0;
+	void *jstr = MTY_ReadFile(path, &size);
 
 	if (jstr)
-		j = MTY_JSONParse(jstr);
+		j = (MTY_JSON *) json_parse(jstr, size);
 
 	MTY_Free(jstr);
 
@@ -63,8 +904,11 @@ uint32_t MTY_JSONGetLength(const MTY_JSON *json)
 {
 	cJSON *cj = (cJSON *) json;
 
+	if (!cj)
+		return 0;
+
 	// This will work on both arrays and objects
-	return !cj ? 0 : cJSON_GetArraySize(cj);
+	return (uint32_t) cJSON_GetArraySize(cj);
 }
 
 void MTY_JSONDestroy(MTY_JSON **json)
@@ -92,7 +936,7 @@ bool MTY_JSONObjKeyExists(const MTY_JSON *json, const char *key)
 	if (!json)
 		return false;
 
-	return cJSON_GetObjectItemCaseSensitive((cJSON *) json, key) ? true : false;
+	return json_obj_get((cJSON *) json, key) ? true : false;
 }
 
 const char *MTY_JSONObjGetKey(const MTY_JSON *json, uint32_t index)
@@ -102,7 +946,7 @@ const char *MTY_JSONObjGetKey(const MTY_JSON *json, uint32_t index)
 	if (!cj || !cJSON_IsObject(cj))
 		return NULL;
 
-	cJSON *item = cJSON_GetArrayItem(cj, index);
+	cJSON *item = json_array_get(cj, index);
 	if (!item)
 		return NULL;
 
@@ -111,10 +955,24 @@ const char *MTY_JSONObjGetKey(const MTY_JSON *json, uint32_t index)
 
 void MTY_JSONObjDeleteItem(MTY_JSON *json, const char *key)
 {
-	if (!json)
+	cJSON *cj = (cJSON *) json;
+
+	if (!cj)
+		return;
+
+	struct json_lookup *l = key && cJSON_IsObject(cj) ? json_lookup(cj) : NULL;
+
+	if (!l) {
+		cJSON_DeleteItemFromObjectCaseSensitive(cj, key);
+		return;
+	}
+
+	cJSON *item = MTY_HashGet(l->keys, key);
+	if (!item)
 		return;
 
-	cJSON_DeleteItemFromObjectCaseSensitive((cJSON *) json, key);
+	json_lookup_remove(l, item);
+	cJSON_Delete(cJSON_DetachItemViaPointer(cj, item));
 }
 
 const MTY_JSON *MTY_JSONObjGetItem(const MTY_JSON *json, const char *key)
@@ -124,21 +982,29 @@ const MTY_JSON *MTY_JSONObjGetItem(const MTY_JSON *json, const char *key)
 	if (!cj || !cJSON_IsObject(cj))
 		return NULL;
 
-	return (const MTY_JSON *) cJSON_GetObjectItemCaseSensitive(cj, key);
+	return (const MTY_JSON *) json_obj_get(cj, key);
 }
 
 void MTY_JSONObjSetItem(MTY_JSON *json, const char *key, const MTY_JSON *value)
 {
 	cJSON *cj = (cJSON *) json;
 
-	if (!cj || !cJSON_IsObject(cj) || !value)
+	// cJSON only refuses an item being added to itself on some paths
+	if (!cj || !cJSON_IsObject(cj) || !key || !value || value == json)
 		return;
 
-	if (cJSON_GetObjectItemCaseSensitive(cj, key)) {
-		cJSON_ReplaceItemInObjectCaseSensitive(cj, key, (cJSON *) value);
+	cJSON *v = (cJSON *) value;
+	cJSON *item = json_obj_get(cj, key);
+	struct json_lookup *l = cj->index.value;
+
+	// The tables only follow items cJSON actually took
+	if (item) {
+		if (cJSON_ReplaceItemInObjectViaPointer(cj, item, key, v) && l)
+			json_lookup_replace(l, item, v);
 
 	} else {
-		cJSON_AddItemToObject(cj, key, (cJSON *) value);
+		if (cJSON_AddItemToObject(cj, key, v) && l)
+			json_lookup_insert(l, l->len, v);
 	}
 }
 
@@ -147,15 +1013,30 @@ bool MTY_JSONArrayIndexExists(const MTY_JSON *json, uint32_t index)
 	if (!json)
 		return false;
 
-	return cJSON_GetArrayItem((cJSON *) json, index) ? true : false;
+	return json_array_get((cJSON *) json, index) ? true : false;
 }
 
 void MTY_JSONArrayDeleteItem(MTY_JSON *json, uint32_t index)
 {
-	if (!json)
+	cJSON *cj = (cJSON *) json;
+
+	if (!cj)
+		return;
+
+	struct json_lookup *l = json_lookup(cj);
+
+	if (!l) {
+		cJSON_DeleteItemFromArray(cj, index);
+		return;
+	}
+
+	if (index >= l->len)
 		return;
 
-	cJSON_DeleteItemFromArray((cJSON *) json, index);
+	cJSON *item = l->items[index];
+
+	json_lookup_remove(l, item);
+	cJSON_Delete(cJSON_DetachItemViaPointer(cj, item));
 }
 
 const MTY_JSON *MTY_JSONArrayGetItem(const MTY_JSON *json, uint32_t index)
@@ -166,17 +1047,25 @@ const MTY_JSON *MTY_JSONArrayGetItem(const MTY_JSON *json, uint32_t index)
 	if (!cj || (!cJSON_IsArray(cj) && !cJSON_IsObject(cj)))
 		return NULL;
 
-	return (const MTY_JSON *) cJSON_GetArrayItem(cj, index);
+	return (const MTY_JSON *) json_array_get(cj, index);
 }
 
 void MTY_JSONArraySetItem(MTY_JSON *json, uint32_t index, const MTY_JSON *value)
 {
 	cJSON *cj = (cJSON *) json;
 
-	if (!cj || !cJSON_IsArray(cj) || !value)
+	if (!cj || !cJSON_IsArray(cj) || !value || value == json)
 		return;
 
-	cJSON_InsertItemInArray(cj, index, (cJSON *) value);
+	struct json_lookup *l = json_lookup(cj);
+
+	if (!l) {
+		cJSON_InsertItemInArray(cj, index, (cJSON *) value);
+		return;
+	}
+
+	if (cJSON_InsertItemViaPointer(cj, index < l->len ? l->items[index] : NULL, (cJSON *) value))
+		json_lookup_insert(l, index, (cJSON *) value);
 }
 
 void MTY_JSONArrayAppendItem(MTY_JSON *json, const MTY_JSON *value)
@@ -186,7 +1075,8 @@ void MTY_JSONArrayAppendItem(MTY_JSON *json, const MTY_JSON *value)
 	if (!cj || !cJSON_IsArray(cj) || !value)
 		return;
 
-	cJSON_AddItemToArray(cj, (cJSON *) value);
+	if (cJSON_AddItemToArray(cj, (cJSON *) value) && cj->index.value)
+		json_lookup_insert(cj->index.value, UINT32_MAX, (cJSON *) value);
 }
 
 
@@ -9,6 +9,11 @@
 struct MTY_List {
 	MTY_ListNode *first;
 	MTY_ListNode *last;
+
+	// Node pool, the first node in each slab links to the next slab
+	uint32_t slab_len;
+	MTY_ListNode *slabs;
+	MTY_ListNode *free;
 };
 
 MTY_List *MTY_ListCreate(void)
@@ -16,6 +21,50 @@ MTY_List *MTY_ListCreate(void)
 	return MTY_Alloc(1, sizeof(MTY_List));
 }
 
+MTY_List *MTY_ListCreatePooled(uint32_t slabLen)
+{
+	MTY_List *ctx = MTY_ListCreate();
+	ctx->slab_len = slabLen > 0 ? slabLen : 64;
+
+	return ctx;
+}
+
+static MTY_ListNode *list_node_alloc(MTY_List *ctx)
+{
+	if (ctx->slab_len == 0)
+		return MTY_Alloc(1, sizeof(MTY_ListNode));
+
+	if (!ctx->free) {
+		MTY_ListNode *slab = MTY_Alloc(ctx->slab_len + 1, sizeof(MTY_ListNode));
+		slab->next = ctx->slabs;
+		ctx->slabs = slab;
+
+		for (uint32_t x = ctx->slab_len; x > 0; x--) {
+			slab[x].next = ctx->free;
+			ctx->free = &slab[x];
+		}
+	}
+
+	MTY_ListNode *node = ctx->free;
+	ctx->free = node->next;
+	node->next = NULL;
+
+	return node;
+}
+
+static void list_node_free(MTY_List *ctx, MTY_ListNode *node)
+{
+	if (ctx->slab_len == 0) {
+		MTY_Free(node);
+		return;
+	}
+
+	node->prev = NULL;
+	node->value = NULL;
+	node->next = ctx->free;
+	ctx->free = node;
+}
+
 MTY_ListNode *MTY_ListGetFirst(MTY_List *ctx)
 {
 	return ctx->first;
@@ -23,7 +72,7 @@ MTY_ListNode *MTY_ListGetFirst(MTY_List *ctx)
 
 void MTY_ListAppend(MTY_List *ctx, void *value)
 {
-	MTY_ListNode *node = MTY_Alloc(1, sizeof(MTY_ListNode));
+	MTY_ListNode *node = list_node_alloc(ctx);
 	node->value = value;
 
 	if (!ctx->first) {
@@ -54,7 +103,7 @@ void *MTY_ListRemove(MTY_List *ctx, MTY_ListNode *node)
 
 	void *r = node->value;
 
-	MTY_Free(node);
+	list_node_free(ctx, node);
 
 	return r;
 }
@@ -72,10 +121,117 @@ void MTY_ListDestroy(MTY_List **list, MTY_FreeFunc freeFunc)
 		if (freeFunc)
 			freeFunc(n->value);
 
-		MTY_Free(n);
+		if (ctx->slab_len == 0)
+			MTY_Free(n);
+
 		n = next;
 	}
 
+	for (MTY_ListNode *slab = ctx->slabs; slab;) {
+		MTY_ListNode *next = slab->next;
+
+		MTY_Free(slab);
+		slab = next;
+	}
+
 	MTY_Free(ctx);
 	*list = NULL;
 }
+
+
+// Intrusive
+
+void MTY_LinkListPrepend(MTY_LinkList *list, MTY_Link *link)
+{
+	link->prev = NULL;
+	link->next = list->first;
+
+	if (list->first) {
+		list->first->prev = link;
+
+	} else {
+		list->last = link;
+	}
+
+	list->first = link;
+}
+
+void MTY_LinkListAppend(MTY_LinkList *list, MTY_Link *link)
+{
+	link->next = NULL;
+	link->prev = list->last;
+
+	if (list->last) {
+		list->last->next = link;
+
+	} else {
+		list->first = link;
+	}
+
+	list->last = link;
+}
+
+void MTY_LinkListInsertAfter(MTY_LinkList *list, MTY_Link *pos, MTY_Link *link)
+{
+	if (!pos) {
+		MTY_LinkListPrepend(list, link);
+		return;
+	}
+
+	link->prev = pos;
+	link->next = pos->next;
+
+	if (pos->next) {
+		pos->next->prev = link;
+
+	} else {
+		list->last = link;
+	}
+
+	pos->next = link;
+}
+
+void MTY_LinkListRemove(MTY_LinkList *list, MTY_Link *link)
+{
+	if (link->prev) {
+		link->prev->next = link->next;
+
+	} else {
+		list->first = link->next;
+	}
+
+	if (link->next) {
+		link->next->prev = link->prev;
+
+	} else {
+		list->last = link->prev;
+	}
+
+	link->prev = link->next = NULL;
+}
+
+void MTY_LinkListMoveToFront(MTY_LinkList *list, MTY_Link *link)
+{
+	if (list->first == link)
+		return;
+
+	MTY_LinkListRemove(list, link);
+	MTY_LinkListPrepend(list, link);
+}
+
+void MTY_LinkListSplice(MTY_LinkList *dst, MTY_LinkList *src)
+{
+	if (!src->first)
+		return;
+
+	if (dst->last) {
+		dst->last->next = src->first;
+		src->first->prev = dst->last;
+
+	} else {
+		dst->first = src->first;
+	}
+
+	dst->last = src->last;
+	src->first = src->last = NULL;
+}
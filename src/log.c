@@ -8,60 +8,823 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "tlocal.h"
+#include "atomic.h"
+
+// A message is captured as its format pointer plus a binary copy of its arguments,
+// then pushed into a bounded lock-free queue. A background thread formats it and calls
+// the log function, so logging threads never format or take a lock unless the
+// background thread is asleep and has to be woken. MTY_GetLog formats the calling
+// thread's most recent record only when it is asked for.
+
+#define LOG_SLOTS         512
+#define LOG_PAYLOAD       464
+#define LOG_MSG_MAX       1024
+#define LOG_FLUSH_TIMEOUT 1000
+#define LOG_WAIT_TIMEOUT  1000
+
+enum log_class {
+	LOG_CLASS_NONE    = 0,
+	LOG_CLASS_INT     = 1,
+	LOG_CLASS_UINT    = 2,
+	LOG_CLASS_DOUBLE  = 3,
+	LOG_CLASS_LDOUBLE = 4,
+	LOG_CLASS_CHAR    = 5,
+	LOG_CLASS_STR     = 6,
+	LOG_CLASS_WSTR    = 7,
+	LOG_CLASS_PTR     = 8,
+	LOG_CLASS_COUNT   = 9,
+};
+
+enum log_arg {
+	LOG_ARG_NONE  = 0,
+	LOG_ARG_VALUE = 1,
+	LOG_ARG_STAR  = 2,
+};
+
+struct log_spec {
+	char flags[8];
+	enum log_arg width_arg;
+	int32_t width;
+	enum log_arg precision_arg;
+	int32_t precision;
+	char length;
+	char conv;
+	size_t len;
+};
+
+struct log_record {
+	const char *func;
+	const char *fmt;
+	uint32_t suppressed;
+	uint16_t size;
+	uint8_t payload[LOG_PAYLOAD];
+};
+
+struct log_slot {
+	MTY_Atomic64 seq;
+	struct log_record rec;
+};
+
+enum log_state {
+	LOG_STATE_NONE     = 0,
+	LOG_STATE_STARTING = 1,
+	LOG_STATE_RUNNING  = 2,
+};
 
 static void log_none(const char *msg, void *opaque)
 {
 }
 
 static MTY_Atomic32 LOG_DISABLED;
+static MTY_Atomic32 LOG_LEVEL = {MTY_LOG_LEVEL_INFO};
+static MTY_Atomic32 LOG_RATE_LIMIT = {100};
 static MTY_LogFunc LOG_FUNC = log_none;
 static void *LOG_OPAQUE;
+static MTY_Atomic32 LOG_FUNC_LOCK;
+static MTY_Atomic32 LOG_LISTENING;
 
-static TLOCAL char *LOG_MSG;
+static MTY_Atomic64 LOG_LOGGED;
+static MTY_Atomic64 LOG_DROPPED;
+static MTY_Atomic64 LOG_SUPPRESSED;
+
+static MTY_Atomic32 LOG_STATE;
+static MTY_Atomic32 LOG_SLEEPING;
+static MTY_Atomic64 LOG_TAIL;
+static MTY_Atomic64 LOG_DONE;
+static MTY_Mutex *LOG_MUTEX;
+static MTY_Cond *LOG_COND;
+static struct log_slot LOG_RING[LOG_SLOTS];
+
+static TLOCAL struct log_record LOG_LAST;
+static TLOCAL bool LOG_LAST_SET;
+static TLOCAL bool LOG_LAST_FORMATTED;
+static TLOCAL char LOG_MSG[LOG_MSG_MAX];
 static TLOCAL bool LOG_PREVENT_RECURSIVE;
+static TLOCAL bool LOG_IS_THREAD;
+
+
+// Format parsing, shared by capture and formatting so both walk the arguments alike
 
-static void log_internal(const char *func, const char *msg, va_list args)
+static bool log_is_digit(char c)
 {
-	if (MTY_Atomic32Get(&LOG_DISABLED) || LOG_PREVENT_RECURSIVE)
-		return;
+	return c >= '0' && c <= '9';
+}
+
+static bool log_spec(const char *p, struct log_spec *spec)
+{
+	memset(spec, 0, sizeof(struct log_spec));
+
+	const char *s = p;
+
+	for (size_t x = 0; *s && strchr("-+ #0", *s); s++)
+		if (x < sizeof(spec->flags) - 1)
+			spec->flags[x++] = *s;
+
+	if (*s == '*') {
+		spec->width_arg = LOG_ARG_STAR;
+		s++;
+
+	} else if (log_is_digit(*s)) {
+		spec->width_arg = LOG_ARG_VALUE;
+
+		for (; log_is_digit(*s); s++)
+			spec->width = MTY_MIN(spec->width * 10 + (*s - '0'), LOG_MSG_MAX);
+	}
+
+	if (*s == '.') {
+		s++;
+
+		if (*s == '*') {
+			spec->precision_arg = LOG_ARG_STAR;
+			s++;
+
+		} else {
+			spec->precision_arg = LOG_ARG_VALUE;
+
+			for (; log_is_digit(*s); s++)
+				spec->precision = MTY_MIN(spec->precision * 10 + (*s - '0'), LOG_MSG_MAX);
+		}
+	}
+
+	// 'H' and 'q' stand in for "hh" and "ll"
+	if (s[0] == 'h' && s[1] == 'h') {
+		spec->length = 'H';
+		s += 2;
+
+	} else if (s[0] == 'l' && s[1] == 'l') {
+		spec->length = 'q';
+		s += 2;
+
+	} else if (*s && strchr("hlzjtL", *s)) {
+		spec->length = *s++;
+	}
+
+	spec->conv = *s;
+	spec->len = s - p + (*s ? 1 : 0);
+
+	return *s != '\0';
+}
+
+static enum log_class log_class(const struct log_spec *spec)
+{
+	switch (spec->conv) {
+		case 'd':
+		case 'i':
+			return LOG_CLASS_INT;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			return LOG_CLASS_UINT;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			return spec->length == 'L' ? LOG_CLASS_LDOUBLE : LOG_CLASS_DOUBLE;
+		case 'c':
+			return LOG_CLASS_CHAR;
+		case 's':
+			return spec->length == 'l' ? LOG_CLASS_WSTR : LOG_CLASS_STR;
+		case 'p':
+			return LOG_CLASS_PTR;
+		case 'n':
+			return LOG_CLASS_COUNT;
+	}
+
+	return LOG_CLASS_NONE;
+}
+
+
+// Capture
+
+static bool log_put(struct log_record *rec, const void *data, size_t size)
+{
+	if (rec->size + size > LOG_PAYLOAD)
+		return false;
+
+	memcpy(rec->payload + rec->size, data, size);
+	rec->size += (uint16_t) size;
+
+	return true;
+}
+
+static bool log_put_str(struct log_record *rec, const char *str, int32_t precision)
+{
+	if (!str)
+		str = "(null)";
+
+	if (rec->size >= LOG_PAYLOAD)
+		return false;
+
+	// Long strings are cut short to whatever room is left. Like printf, a precision
+	// means the string does not need to be terminated
+	size_t max = LOG_PAYLOAD - rec->size - 1;
+	if (precision >= 0)
+		max = MTY_MIN(max, (size_t) precision);
+
+	size_t len = 0;
+	while (len < max && str[len])
+		len++;
+
+	memcpy(rec->payload + rec->size, str, len);
+	rec->payload[rec->size + len] = '\0';
+	rec->size += (uint16_t) (len + 1);
+
+	return true;
+}
+
+static int64_t log_va_int(va_list *args, char length)
+{
+	switch (length) {
+		case 'H': return (signed char) va_arg(*args, int);
+		case 'h': return (short) va_arg(*args, int);
+		case 'l': return va_arg(*args, long);
+		case 'q': return va_arg(*args, long long);
+		case 'z': return (int64_t) va_arg(*args, size_t);
+		case 'j': return va_arg(*args, intmax_t);
+		case 't': return va_arg(*args, ptrdiff_t);
+	}
+
+	return va_arg(*args, int);
+}
+
+static uint64_t log_va_uint(va_list *args, char length)
+{
+	switch (length) {
+		case 'H': return (unsigned char) va_arg(*args, unsigned int);
+		case 'h': return (unsigned short) va_arg(*args, unsigned int);
+		case 'l': return va_arg(*args, unsigned long);
+		case 'q': return va_arg(*args, unsigned long long);
+		case 'z': return va_arg(*args, size_t);
+		case 'j': return va_arg(*args, uintmax_t);
+		case 't': return (uint64_t) va_arg(*args, ptrdiff_t);
+	}
+
+	return va_arg(*args, unsigned int);
+}
+
+static bool log_capture_arg(struct log_record *rec, const struct log_spec *spec, va_list *args)
+{
+	if (spec->width_arg == LOG_ARG_STAR) {
+		int32_t v = va_arg(*args, int);
+		if (!log_put(rec, &v, sizeof(int32_t)))
+			return false;
+	}
+
+	// A negative precision passed via '*' is the same as none
+	int32_t precision = spec->precision_arg == LOG_ARG_VALUE ? spec->precision : -1;
+
+	if (spec->precision_arg == LOG_ARG_STAR) {
+		precision = va_arg(*args, int);
+		if (!log_put(rec, &precision, sizeof(int32_t)))
+			return false;
+	}
+
+	switch (log_class(spec)) {
+		case LOG_CLASS_INT: {
+			int64_t v = log_va_int(args, spec->length);
+			return log_put(rec, &v, sizeof(int64_t));
+		}
+		case LOG_CLASS_UINT: {
+			uint64_t v = log_va_uint(args, spec->length);
+			return log_put(rec, &v, sizeof(uint64_t));
+		}
+		case LOG_CLASS_DOUBLE: {
+			double v = va_arg(*args, double);
+			return log_put(rec, &v, sizeof(double));
+		}
+		case LOG_CLASS_LDOUBLE: {
+			long double v = va_arg(*args, long double);
+			return log_put(rec, &v, sizeof(long double));
+		}
+		case LOG_CLASS_CHAR: {
+			int32_t v = va_arg(*args, int);
+			return log_put(rec, &v, sizeof(int32_t));
+		}
+		case LOG_CLASS_STR:
+			return log_put_str(rec, va_arg(*args, const char *), precision);
+		case LOG_CLASS_WSTR: {
+			const wchar_t *wstr = va_arg(*args, const wchar_t *);
+			char *str = NULL;
+
+			if (wstr) {
+				// Every character takes at least one byte, so `precision` characters are enough
+				size_t len = 0;
+				while ((precision < 0 || len < (size_t) precision) && wstr[len])
+					len++;
+
+				wchar_t *copy = MTY_Alloc(len + 1, sizeof(wchar_t));
+				memcpy(copy, wstr, len * sizeof(wchar_t));
+
+				str = MTY_WideToMultiD(copy);
+				MTY_Free(copy);
+			}
+
+			bool r = log_put_str(rec, str, precision);
+			MTY_Free(str);
+
+			return r;
+		}
+		case LOG_CLASS_PTR: {
+			void *v = va_arg(*args, void *);
+			return log_put(rec, &v, sizeof(void *));
+		}
+		case LOG_CLASS_COUNT:
+			va_arg(*args, void *);
+			return true;
+		default:
+			break;
+	}
+
+	// The type of an unknown conversion isn't known, so nothing after it can be read
+	return false;
+}
+
+static void log_capture(struct log_record *rec, const char *func, const char *fmt, va_list args)
+{
+	rec->func = func;
+	rec->fmt = fmt;
+	rec->suppressed = 0;
+	rec->size = 0;
+
+	va_list copy;
+	va_copy(copy, args);
+
+	for (const char *p = strchr(fmt, '%'); p; p = strchr(p, '%')) {
+		struct log_spec spec;
+		if (!log_spec(p + 1, &spec))
+			break;
+
+		p += 1 + spec.len;
+
+		if (spec.conv != '%' && !log_capture_arg(rec, &spec, &copy))
+			break;
+	}
+
+	va_end(copy);
+}
+
+
+// Formatting
+
+static size_t log_append(char *out, size_t size, size_t n, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int32_t r = vsnprintf(out + n, size - n, fmt, args);
+	va_end(args);
+
+	return r > 0 ? MTY_MIN(n + r, size - 1) : n;
+}
+
+static bool log_get(const struct log_record *rec, size_t *off, void *data, size_t size)
+{
+	if (*off + size > rec->size)
+		return false;
+
+	memcpy(data, rec->payload + *off, size);
+	*off += size;
+
+	return true;
+}
+
+static bool log_format_arg(const struct log_record *rec, size_t *off, const struct log_spec *spec,
+	char *out, size_t size, size_t *n)
+{
+	char flags[sizeof(spec->flags) + 1];
+	snprintf(flags, sizeof(flags), "%s", spec->flags);
+
+	int32_t width = spec->width;
+	int32_t precision = spec->precision;
+	bool has_precision = spec->precision_arg != LOG_ARG_NONE;
+
+	if (spec->width_arg == LOG_ARG_STAR) {
+		if (!log_get(rec, off, &width, sizeof(int32_t)))
+			return false;
+
+		// A negative width from an argument means left justified
+		if (width < 0) {
+			width = -MTY_MAX(width, -LOG_MSG_MAX);
+			snprintf(flags, sizeof(flags), "-%s", spec->flags);
+		}
+
+		width = MTY_MIN(width, LOG_MSG_MAX);
+	}
+
+	if (spec->precision_arg == LOG_ARG_STAR) {
+		if (!log_get(rec, off, &precision, sizeof(int32_t)))
+			return false;
+
+		has_precision = precision >= 0;
+		precision = MTY_MIN(precision, LOG_MSG_MAX);
+	}
+
+	enum log_class cls = log_class(spec);
+
+	// Integers were widened when captured, so they are all printed as long long
+	const char *length = cls == LOG_CLASS_INT || cls == LOG_CLASS_UINT ? "ll" :
+		cls == LOG_CLASS_LDOUBLE ? "L" : "";
+
+	char fmt[48];
+	size_t len = snprintf(fmt, sizeof(fmt), "%%%s", flags);
+
+	if (spec->width_arg != LOG_ARG_NONE)
+		len += snprintf(fmt + len, sizeof(fmt) - len, "%d", width);
+
+	if (has_precision)
+		len += snprintf(fmt + len, sizeof(fmt) - len, ".%d", precision);
+
+	snprintf(fmt + len, sizeof(fmt) - len, "%s%c", length, spec->conv);
+
+	switch (cls) {
+		case LOG_CLASS_INT: {
+			int64_t v = 0;
+			if (!log_get(rec, off, &v, sizeof(int64_t)))
+				return false;
+
+			*n = log_append(out, size, *n, fmt, (long long) v);
+			break;
+		}
+		case LOG_CLASS_UINT: {
+			uint64_t v = 0;
+			if (!log_get(rec, off, &v, sizeof(uint64_t)))
+				return false;
+
+			*n = log_append(out, size, *n, fmt, (unsigned long long) v);
+			break;
+		}
+		case LOG_CLASS_DOUBLE: {
+			double v = 0;
+			if (!log_get(rec, off, &v, sizeof(double)))
+				return false;
+
+			*n = log_append(out, size, *n, fmt, v);
+			break;
+		}
+		case LOG_CLASS_LDOUBLE: {
+			long double v = 0;
+			if (!log_get(rec, off, &v, sizeof(long double)))
+				return false;
+
+			*n = log_append(out, size, *n, fmt, v);
+			break;
+		}
+		case LOG_CLASS_CHAR: {
+			int32_t v = 0;
+			if (!log_get(rec, off, &v, sizeof(int32_t)))
+				return false;
+
+			*n = log_append(out, size, *n, fmt, v);
+			break;
+		}
+		case LOG_CLASS_STR:
+		case LOG_CLASS_WSTR: {
+			if (*off >= rec->size)
+				return false;
+
+			// Wide strings were converted to UTF-8 when captured
+			const char *str = (const char *) rec->payload + *off;
+			*off += strlen(str) + 1;
+
+			*n = log_append(out, size, *n, fmt, str);
+			break;
+		}
+		case LOG_CLASS_PTR: {
+			void *v = NULL;
+			if (!log_get(rec, off, &v, sizeof(void *)))
+				return false;
+
+			*n = log_append(out, size, *n, fmt, v);
+			break;
+		}
+		case LOG_CLASS_COUNT:
+			break;
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+static void log_format(const struct log_record *rec, char *out, size_t size)
+{
+	size_t n = 0;
+	size_t off = 0;
+
+	if (rec->func)
+		n = log_append(out, size, n, "%s: ", rec->func);
+
+	for (const char *p = rec->fmt; *p;) {
+		const char *pct = strchr(p, '%');
+		size_t lit = pct ? (size_t) (pct - p) : strlen(p);
 
-	char *fmt = MTY_SprintfD("%s: %s", func, msg);
-	char *fmsg = MTY_VsprintfD(fmt, args);
+		lit = MTY_MIN(lit, size - 1 - n);
+		memcpy(out + n, p, lit);
+		n += lit;
 
-	LOG_MSG = mty_tlocal_strcpy(fmsg);
+		if (!pct)
+			break;
 
-	MTY_Free(fmsg);
-	MTY_Free(fmt);
+		struct log_spec spec;
+		if (!log_spec(pct + 1, &spec))
+			break;
+
+		p = pct + 1 + spec.len;
+
+		if (spec.conv == '%') {
+			n = log_append(out, size, n, "%%");
+
+		} else if (!log_format_arg(rec, &off, &spec, out, size, &n)) {
+			n = log_append(out, size, n, "...");
+			break;
+		}
+	}
+
+	out[n] = '\0';
+
+	if (rec->suppressed > 0)
+		log_append(out, size, n, " (%u similar messages suppressed)", rec->suppressed);
+}
+
+
+// Background thread
+
+static void log_deliver(const char *msg)
+{
+	// MTY_SetLogFunc swaps the function and its opaque together under this lock
+	MTY_GlobalLock(&LOG_FUNC_LOCK);
 
 	LOG_PREVENT_RECURSIVE = true;
-	LOG_FUNC(LOG_MSG, LOG_OPAQUE);
+	LOG_FUNC(msg, LOG_OPAQUE);
 	LOG_PREVENT_RECURSIVE = false;
+
+	MTY_GlobalUnlock(&LOG_FUNC_LOCK);
 }
 
-void MTY_LogParams(const char *func, const char *msg, ...)
+static void log_wake(void)
+{
+	if (mty_atomic32_load(&LOG_SLEEPING, MTY_MEMORY_ORDER_SEQ_CST) &&
+		mty_atomic32_exchange(&LOG_SLEEPING, 0, MTY_MEMORY_ORDER_SEQ_CST))
+	{
+		MTY_MutexLock(LOG_MUTEX);
+		MTY_CondSignal(LOG_COND);
+		MTY_MutexUnlock(LOG_MUTEX);
+	}
+}
+
+static void log_enqueue(const struct log_record *rec)
+{
+	struct log_slot *slot = NULL;
+	int64_t pos = mty_atomic64_load(&LOG_TAIL, MTY_MEMORY_ORDER_RELAXED);
+
+	// Bounded MPSC queue, each slot's sequence says whether it is free for this lap
+	while (true) {
+		slot = &LOG_RING[pos & (LOG_SLOTS - 1)];
+		int64_t diff = mty_atomic64_load(&slot->seq, MTY_MEMORY_ORDER_ACQUIRE) - pos;
+
+		if (diff == 0) {
+			if (mty_atomic64_cas(&LOG_TAIL, &pos, pos + 1, MTY_MEMORY_ORDER_RELAXED))
+				break;
+
+		} else if (diff < 0) {
+			mty_atomic64_fetch_add(&LOG_DROPPED, 1, MTY_MEMORY_ORDER_RELAXED);
+			return;
+
+		} else {
+			pos = mty_atomic64_load(&LOG_TAIL, MTY_MEMORY_ORDER_RELAXED);
+		}
+	}
+
+	memcpy(&slot->rec, rec, offsetof(struct log_record, payload) + rec->size);
+
+	// Sequentially consistent so the store can't pass the check of LOG_SLEEPING
+	mty_atomic64_store(&slot->seq, pos + 1, MTY_MEMORY_ORDER_SEQ_CST);
+
+	log_wake();
+}
+
+static void *log_thread(void *opaque)
+{
+	MTY_ThreadSetName("mty-log");
+	LOG_IS_THREAD = true;
+
+	int64_t head = 0;
+	int64_t dropped = 0;
+	char msg[LOG_MSG_MAX];
+
+	while (true) {
+		struct log_slot *slot = &LOG_RING[head & (LOG_SLOTS - 1)];
+
+		if (mty_atomic64_load(&slot->seq, MTY_MEMORY_ORDER_ACQUIRE) == head + 1) {
+			log_format(&slot->rec, msg, LOG_MSG_MAX);
+			mty_atomic64_store(&slot->seq, head + LOG_SLOTS, MTY_MEMORY_ORDER_RELEASE);
+
+			log_deliver(msg);
+			mty_atomic64_store(&LOG_DONE, ++head, MTY_MEMORY_ORDER_RELEASE);
+			continue;
+		}
+
+		int64_t total = mty_atomic64_load(&LOG_DROPPED, MTY_MEMORY_ORDER_RELAXED);
+
+		if (total != dropped) {
+			snprintf(msg, LOG_MSG_MAX, "%s: %lld messages dropped", __FUNCTION__, (long long) (total - dropped));
+			log_deliver(msg);
+			dropped = total;
+			continue;
+		}
+
+		// Announce the sleep before checking the queue a final time, a producer that
+		// publishes after the check sees the flag and signals
+		mty_atomic32_store(&LOG_SLEEPING, 1, MTY_MEMORY_ORDER_SEQ_CST);
+
+		if (mty_atomic64_load(&slot->seq, MTY_MEMORY_ORDER_SEQ_CST) == head + 1) {
+			mty_atomic32_store(&LOG_SLEEPING, 0, MTY_MEMORY_ORDER_RELAXED);
+			continue;
+		}
+
+		MTY_MutexLock(LOG_MUTEX);
+
+		if (mty_atomic32_load(&LOG_SLEEPING, MTY_MEMORY_ORDER_SEQ_CST))
+			MTY_CondWait(LOG_COND, LOG_MUTEX, LOG_WAIT_TIMEOUT);
+
+		mty_atomic32_store(&LOG_SLEEPING, 0, MTY_MEMORY_ORDER_RELAXED);
+
+		MTY_MutexUnlock(LOG_MUTEX);
+	}
+
+	return NULL;
+}
+
+static void log_start(void)
+{
+	int32_t state = LOG_STATE_NONE;
+	if (!mty_atomic32_cas(&LOG_STATE, &state, LOG_STATE_STARTING, MTY_MEMORY_ORDER_ACQUIRE))
+		return;
+
+	for (int64_t x = 0; x < LOG_SLOTS; x++)
+		mty_atomic64_store(&LOG_RING[x].seq, x, MTY_MEMORY_ORDER_RELAXED);
+
+	LOG_MUTEX = MTY_MutexCreate();
+	LOG_COND = MTY_CondCreate();
+
+	MTY_ThreadDetach(log_thread, NULL);
+
+	mty_atomic32_store(&LOG_STATE, LOG_STATE_RUNNING, MTY_MEMORY_ORDER_RELEASE);
+}
+
+
+// Logging
+
+static bool log_allow(MTY_LogSite *site, uint32_t *suppressed)
+{
+	int32_t limit = mty_atomic32_load(&LOG_RATE_LIMIT, MTY_MEMORY_ORDER_RELAXED);
+	if (limit == 0)
+		return true;
+
+	// The site's fields are laid out the same as MTY_Atomic32
+	MTY_Atomic32 *window = (MTY_Atomic32 *) &site->window;
+	MTY_Atomic32 *count = (MTY_Atomic32 *) &site->count;
+	MTY_Atomic32 *rejected = (MTY_Atomic32 *) &site->suppressed;
+
+	// Windows are one second long, racing threads may let a few extra through
+	int32_t now = (int32_t) (MTY_GetTimeNs() / (1000 * 1000 * 1000));
+	int32_t prev = mty_atomic32_load(window, MTY_MEMORY_ORDER_RELAXED);
+
+	if (prev != now && mty_atomic32_cas(window, &prev, now, MTY_MEMORY_ORDER_RELAXED))
+		mty_atomic32_store(count, 0, MTY_MEMORY_ORDER_RELAXED);
+
+	if (mty_atomic32_fetch_add(count, 1, MTY_MEMORY_ORDER_RELAXED) >= limit) {
+		mty_atomic32_fetch_add(rejected, 1, MTY_MEMORY_ORDER_RELAXED);
+		mty_atomic64_fetch_add(&LOG_SUPPRESSED, 1, MTY_MEMORY_ORDER_RELAXED);
+		return false;
+	}
+
+	*suppressed = mty_atomic32_exchange(rejected, 0, MTY_MEMORY_ORDER_RELAXED);
+
+	return true;
+}
+
+static bool log_enabled(MTY_LogLevel level)
 {
+	return !LOG_PREVENT_RECURSIVE && !mty_atomic32_load(&LOG_DISABLED, MTY_MEMORY_ORDER_RELAXED) &&
+		(int32_t) level <= mty_atomic32_load(&LOG_LEVEL, MTY_MEMORY_ORDER_RELAXED);
+}
+
+static void log_internal(const char *func, const char *fmt, uint32_t suppressed, va_list args)
+{
+	struct log_record *rec = &LOG_LAST;
+
+	log_capture(rec, func, fmt, args);
+	rec->suppressed = suppressed;
+
+	LOG_LAST_SET = true;
+	LOG_LAST_FORMATTED = false;
+
+	mty_atomic64_fetch_add(&LOG_LOGGED, 1, MTY_MEMORY_ORDER_RELAXED);
+
+	// Nobody is listening, MTY_GetLog formats the record if it is ever called
+	if (!mty_atomic32_load(&LOG_LISTENING, MTY_MEMORY_ORDER_RELAXED))
+		return;
+
+	if (mty_atomic32_load(&LOG_STATE, MTY_MEMORY_ORDER_ACQUIRE) == LOG_STATE_RUNNING) {
+		log_enqueue(rec);
+
+	} else {
+		log_deliver(MTY_GetLog());
+	}
+}
+
+static void log_internal_params(const char *func, const char *fmt, uint32_t suppressed, ...)
+{
+	va_list args;
+	va_start(args, suppressed);
+	log_internal(func, fmt, suppressed, args);
+	va_end(args);
+}
+
+void MTY_LogSiteParams(MTY_LogSite *site, MTY_LogLevel level, const char *func, const char *msg, ...)
+{
+	if (!log_enabled(level))
+		return;
+
+	uint32_t suppressed = 0;
+	if (site && !log_allow(site, &suppressed))
+		return;
+
 	va_list args;
 	va_start(args, msg);
-	log_internal(func, msg, args);
+	log_internal(func, msg, suppressed, args);
 	va_end(args);
 }
 
-void MTY_LogFatalParams(const char *func, const char *msg, ...)
+void MTY_LogParams(const char *func, const char *msg, ...)
 {
+	if (!log_enabled(MTY_LOG_LEVEL_ERROR))
+		return;
+
+	// Neither string is guaranteed to outlive the call, so the message is formatted now
+	char fmsg[LOG_PAYLOAD];
+	size_t n = log_append(fmsg, LOG_PAYLOAD, 0, "%s: ", func);
+
 	va_list args;
 	va_start(args, msg);
-	log_internal(func, msg, args);
+	int32_t r = vsnprintf(fmsg + n, LOG_PAYLOAD - n, msg, args);
 	va_end(args);
 
+	if (r < 0)
+		fmsg[n] = '\0';
+
+	log_internal_params(NULL, "%s", 0, fmsg);
+}
+
+void MTY_LogFatalParams(const char *func, const char *msg, ...)
+{
+	if (log_enabled(MTY_LOG_LEVEL_FATAL)) {
+		MTY_FlushLog();
+
+		va_list args;
+		va_start(args, msg);
+		log_capture(&LOG_LAST, func, msg, args);
+		va_end(args);
+
+		LOG_LAST_SET = true;
+		LOG_LAST_FORMATTED = false;
+
+		mty_atomic64_fetch_add(&LOG_LOGGED, 1, MTY_MEMORY_ORDER_RELAXED);
+
+		log_deliver(MTY_GetLog());
+	}
+
 	_Exit(EXIT_FAILURE);
 }
 
 void MTY_SetLogFunc(MTY_LogFunc func, void *opaque)
 {
+	if (func)
+		log_start();
+
+	// From inside the log function this thread already holds the lock
+	bool nested = LOG_PREVENT_RECURSIVE;
+
+	if (!nested) {
+		// Messages that are already queued go to the previous function
+		MTY_FlushLog();
+		MTY_GlobalLock(&LOG_FUNC_LOCK);
+	}
+
 	LOG_FUNC = func ? func : log_none;
 	LOG_OPAQUE = opaque;
+	mty_atomic32_store(&LOG_LISTENING, func ? 1 : 0, MTY_MEMORY_ORDER_RELAXED);
+
+	if (!nested)
+		MTY_GlobalUnlock(&LOG_FUNC_LOCK);
 }
 
 void MTY_DisableLog(bool disabled)
@@ -69,7 +832,49 @@ void MTY_DisableLog(bool disabled)
 	MTY_Atomic32Set(&LOG_DISABLED, disabled ? 1 : 0);
 }
 
+void MTY_SetLogLevel(MTY_LogLevel level)
+{
+	mty_atomic32_store(&LOG_LEVEL, level, MTY_MEMORY_ORDER_RELAXED);
+}
+
+void MTY_SetLogRateLimit(uint32_t perSecond)
+{
+	mty_atomic32_store(&LOG_RATE_LIMIT, (int32_t) MTY_MIN(perSecond, INT32_MAX), MTY_MEMORY_ORDER_RELAXED);
+}
+
+void MTY_FlushLog(void)
+{
+	if (LOG_IS_THREAD || mty_atomic32_load(&LOG_STATE, MTY_MEMORY_ORDER_ACQUIRE) != LOG_STATE_RUNNING)
+		return;
+
+	int64_t target = mty_atomic64_load(&LOG_TAIL, MTY_MEMORY_ORDER_ACQUIRE);
+
+	log_wake();
+
+	for (uint32_t x = 0; x < LOG_FLUSH_TIMEOUT; x++) {
+		if (mty_atomic64_load(&LOG_DONE, MTY_MEMORY_ORDER_ACQUIRE) >= target)
+			break;
+
+		MTY_Sleep(1);
+	}
+}
+
+void MTY_GetLogStats(MTY_LogStats *stats)
+{
+	stats->logged = mty_atomic64_load(&LOG_LOGGED, MTY_MEMORY_ORDER_RELAXED);
+	stats->dropped = mty_atomic64_load(&LOG_DROPPED, MTY_MEMORY_ORDER_RELAXED);
+	stats->suppressed = mty_atomic64_load(&LOG_SUPPRESSED, MTY_MEMORY_ORDER_RELAXED);
+}
+
 const char *MTY_GetLog(void)
 {
-	return LOG_MSG ? LOG_MSG : "";
+	if (!LOG_LAST_SET)
+		return "";
+
+	if (!LOG_LAST_FORMATTED) {
+		log_format(&LOG_LAST, LOG_MSG, LOG_MSG_MAX);
+		LOG_LAST_FORMATTED = true;
+	}
+
+	return LOG_MSG;
 }
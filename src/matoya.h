@@ -219,6 +219,8 @@ MTY_CryptoHashFile(MTY_Algorithm algo, const char *path, const void *key, size_t
 	void *output, size_t outputSize);
 
 /// @brief Generate cryptographically strong random bytes.
+/// @details On Linux, bytes are served from a per-thread ChaCha20 generator that is
+///   periodically reseeded from the kernel and reseeds automatically after `fork`.
 /// @param output Output buffer.
 /// @param size Size in bytes of `output`.
 MTY_EXPORT void
@@ -284,6 +286,10 @@ MTY_AESGCMDecrypt(MTY_AESGCM *ctx, const void *nonce, const void *cipherText,
 #define MTY_PATH_MAX 1280 ///< Maximum size of a full path used internally by libmatoya.
 
 typedef struct MTY_LockFile MTY_LockFile;
+typedef struct MTY_FileIO MTY_FileIO;
+typedef struct MTY_DirIter MTY_DirIter;
+typedef struct MTY_FileWriter MTY_FileWriter;
+typedef struct MTY_FileWatch MTY_FileWatch;
 
 /// @brief Special directories on the filesystem.
 typedef enum {
@@ -320,6 +326,138 @@ typedef struct {
 	uint32_t len;        ///< Number of elements in `files`.
 } MTY_FileList;
 
+/// @brief Changes reported by an MTY_FileWatch.
+typedef enum {
+	MTY_FILE_CHANGE_CREATED    = 0x01, ///< The file was created or moved into place.
+	MTY_FILE_CHANGE_MODIFIED   = 0x02, ///< The file's contents were written.
+	MTY_FILE_CHANGE_DELETED    = 0x04, ///< The file was deleted or moved away.
+	MTY_FILE_CHANGE_ATTRIBUTES = 0x08, ///< The file's permissions, timestamps, or other
+	                                   ///<   attributes changed.
+	MTY_FILE_CHANGE_OVERFLOW   = 0x10, ///< Changes were lost because the platform's event
+	                                   ///<   queue overflowed. Reported once for each path
+	                                   ///<   given to MTY_FileWatchAdd, which should be
+	                                   ///<   rescanned since its state is unknown.
+	MTY_FILE_CHANGE_MAKE_32    = INT32_MAX,
+} MTY_FileChange;
+
+/// @brief A change reported by an MTY_FileWatch.
+typedef struct {
+	const char *path;       ///< Path to the file that changed, beginning with the path
+	                        ///<   given to MTY_FileWatchAdd.
+	MTY_FileChange changes; ///< Every MTY_FileChange seen during the debounce period,
+	                        ///<   combined with bitwise OR.
+	bool dir;               ///< The path is a directory.
+} MTY_FileWatchEvent;
+
+/// @brief Function called by MTY_FileWatchPoll for each change.
+/// @param evt The change.
+/// @param opaque Pointer passed to MTY_FileWatchPoll.
+typedef void (*MTY_FileWatchFunc)(const MTY_FileWatchEvent *evt, void *opaque);
+
+/// @brief When an MTY_FileWriter syncs written data to storage.
+typedef enum {
+	MTY_SYNC_POLICY_NEVER    = 0, ///< Only sync when MTY_FileWriterSync is called.
+	MTY_SYNC_POLICY_INTERVAL = 1, ///< Sync once `syncInterval` milliseconds have passed since
+	                              ///<   the previous sync.
+	MTY_SYNC_POLICY_BYTES    = 2, ///< Sync once `syncBytes` have been written since the
+	                              ///<   previous sync.
+	MTY_SYNC_POLICY_MAKE_32  = INT32_MAX,
+} MTY_SyncPolicy;
+
+/// @brief MTY_FileWriter creation options.
+/// @details Intervals are checked as data is written, an idle MTY_FileWriter does not
+///   flush or sync on its own.
+typedef struct {
+	size_t bufferSize;         ///< Size in bytes of the buffer data is collected in before
+	                           ///<   being written to the file, or 0 for 64 KB.
+	uint32_t flushInterval;    ///< Milliseconds data may stay buffered since the previous
+	                           ///<   flush, or 0 to only flush when the buffer is full.
+	MTY_SyncPolicy syncPolicy; ///< When data is synced to storage.
+	uint32_t syncInterval;     ///< Milliseconds between syncs with MTY_SYNC_POLICY_INTERVAL.
+	uint64_t syncBytes;        ///< Bytes between syncs with MTY_SYNC_POLICY_BYTES.
+	bool truncate;             ///< Discard the existing contents of the file rather than
+	                           ///<   appending to them.
+} MTY_FileWriterDesc;
+
+/// @brief Types of entries found in a directory.
+typedef enum {
+	MTY_FILE_TYPE_UNKNOWN = 0, ///< The type could not be determined.
+	MTY_FILE_TYPE_FILE    = 1, ///< A regular file.
+	MTY_FILE_TYPE_DIR     = 2, ///< A directory.
+	MTY_FILE_TYPE_LINK    = 3, ///< A symbolic link, which is never followed.
+	MTY_FILE_TYPE_OTHER   = 4, ///< A device, pipe, socket, or other special file.
+	MTY_FILE_TYPE_MAKE_32 = INT32_MAX,
+} MTY_FileType;
+
+/// @brief Flags controlling how an MTY_DirIter walks a directory.
+typedef enum {
+	MTY_DIR_FLAG_NONE      = 0x0, ///< List only the entries directly inside the directory.
+	MTY_DIR_FLAG_RECURSIVE = 0x1, ///< Descend into subdirectories.
+	MTY_DIR_FLAG_PARALLEL  = 0x2, ///< Walk subdirectories on several threads at once. Only
+	                              ///<   meaningful with MTY_DIR_FLAG_RECURSIVE.
+	MTY_DIR_FLAG_NO_DIRS   = 0x4, ///< Don't return directories themselves. They are still
+	                              ///<   descended into with MTY_DIR_FLAG_RECURSIVE.
+	MTY_DIR_FLAG_MAKE_32   = INT32_MAX,
+} MTY_DirFlag;
+
+/// @brief An entry returned by MTY_DirIterNext.
+typedef struct {
+	const char *path;  ///< Full path to the entry, beginning with the path given to
+	                   ///<   MTY_DirIterCreate.
+	const char *name;  ///< The entry's name, pointing into the end of `path`.
+	MTY_FileType type; ///< The type of the entry.
+	uint32_t depth;    ///< Number of directories below the root, 0 for entries directly
+	                   ///<   inside it.
+} MTY_DirEntry;
+
+/// @brief Function called as MTY_CopyFileEx makes progress.
+/// @param copied Number of bytes of the source file that have been copied so far,
+///   including holes in sparse files that were skipped.
+/// @param total Size in bytes of the source file.
+/// @param opaque Pointer passed to MTY_CopyFileEx.
+/// @returns Return true to continue copying, false to cancel the copy.
+typedef bool (*MTY_CopyProgressFunc)(uint64_t copied, uint64_t total, void *opaque);
+
+/// @brief Memory mapping access modes.
+typedef enum {
+	MTY_MAP_MODE_READ    = 0, ///< Read only access to the file's pages.
+	MTY_MAP_MODE_WRITE   = 1, ///< Read and write access, writes go directly to the file.
+	MTY_MAP_MODE_MAKE_32 = INT32_MAX,
+} MTY_MapMode;
+
+/// @brief Hints about how a mapped file will be accessed.
+typedef enum {
+	MTY_MAP_HINT_NONE       = 0x0, ///< No hint, the system default read-ahead is used.
+	MTY_MAP_HINT_SEQUENTIAL = 0x1, ///< The file will be read from start to end, so pages
+	                               ///<   can be read-ahead aggressively and dropped soon
+	                               ///<   after they are accessed.
+	MTY_MAP_HINT_RANDOM     = 0x2, ///< Pages will be accessed in no particular order, so
+	                               ///<   read-ahead should be avoided.
+	MTY_MAP_HINT_WILLNEED   = 0x4, ///< The whole file will be needed soon, so its pages
+	                               ///<   should start being read in the background.
+	MTY_MAP_HINT_HUGE_PAGES = 0x8, ///< Back the mapping with huge pages where the system
+	                               ///<   and filesystem support it. Linux only.
+	MTY_MAP_HINT_MAKE_32    = INT32_MAX,
+} MTY_MapHint;
+
+/// @brief The outcome of a request made to an MTY_FileIO.
+typedef struct {
+	void *opaque;   ///< The `opaque` pointer passed with the request.
+	int64_t result; ///< Number of bytes transferred, or -1 on failure. Reads return fewer
+	                ///<   bytes than requested when they reach the end of the file.
+} MTY_FileIOResult;
+
+/// @brief Function called by MTY_FileIOPoll for each completed request.
+/// @param result The completed request.
+/// @param opaque Pointer passed to MTY_FileIOPoll.
+typedef void (*MTY_FileIOFunc)(const MTY_FileIOResult *result, void *opaque);
+
+/// @brief A file mapped into memory.
+typedef struct {
+	void *data;  ///< The contents of the file.
+	size_t size; ///< Size in bytes of `data`.
+} MTY_FileView;
+
 /// @brief Read the entire contents of a file.
 /// @param path Path to the file.
 /// @param size On success, the size in bytes of the returned buffer.
@@ -353,6 +491,68 @@ MTY_WriteTextFile(const char *path, const char *fmt, ...);
 MTY_EXPORT bool
 MTY_AppendTextToFile(const char *path, const char *fmt, ...);
 
+/// @brief Replace the contents of a file so it never appears partially written.
+/// @details The data is written to a temporary file in the same directory, synced to
+///   storage, then renamed over `path`. If the process or system fails at any point,
+///   `path` holds either its previous contents or all of `data`. An existing file's
+///   permissions are kept.
+/// @param path Path to the file.
+/// @param data Data to write.
+/// @param size Size in bytes of `data`.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_WriteFileAtomic(const char *path, const void *data, size_t size);
+
+/// @brief Create an MTY_FileWriter for appending to a file many times.
+/// @details Unlike MTY_AppendTextToFile, the file is kept open and writes are collected
+///   in a buffer, so most appends don't make a system call. An MTY_FileWriter is not
+///   thread safe.
+/// @param path Path to the file, which is created if it does not exist.
+/// @param desc Creation options, or NULL for a 64 KB buffer that is only flushed when
+///   full and never synced.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_FileWriter must be destroyed with MTY_FileWriterDestroy.
+MTY_EXPORT MTY_FileWriter *
+MTY_FileWriterCreate(const char *path, const MTY_FileWriterDesc *desc);
+
+/// @brief Destroy an MTY_FileWriter.
+/// @details Buffered data is flushed, and synced unless the sync policy is
+///   MTY_SYNC_POLICY_NEVER, before the file is closed.
+/// @param writer Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_FileWriterDestroy(MTY_FileWriter **writer);
+
+/// @brief Append data to an MTY_FileWriter.
+/// @param ctx An MTY_FileWriter.
+/// @param data Data to append.
+/// @param size Size in bytes of `data`.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileWriterWrite(MTY_FileWriter *ctx, const void *data, size_t size);
+
+/// @brief Append formatted text to an MTY_FileWriter.
+/// @details The text is formatted directly into the buffer when it fits.
+/// @param ctx An MTY_FileWriter.
+/// @param fmt Format string to append.
+/// @param ... Variable arguments as specified by `fmt`.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileWriterPrintf(MTY_FileWriter *ctx, const char *fmt, ...);
+
+/// @brief Write all buffered data to the file.
+/// @details The data is handed to the operating system, but may not have reached
+///   storage. Use MTY_FileWriterSync to wait for that.
+/// @param ctx An MTY_FileWriter.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileWriterFlush(MTY_FileWriter *ctx);
+
+/// @brief Write all buffered data to the file and wait for it to reach storage.
+/// @param ctx An MTY_FileWriter.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileWriterSync(MTY_FileWriter *ctx);
+
 /// @brief Delete a file.
 /// @param path Path to the file.
 /// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
@@ -386,6 +586,22 @@ MTY_JoinPath(const char *path0, const char *path1);
 MTY_EXPORT bool
 MTY_CopyFile(const char *src, const char *dst);
 
+/// @brief Copy a file while reporting progress.
+/// @details The copy is done by the kernel wherever possible. On Linux the
+///   destination is first cloned via a reflink, which turns the copy into a
+///   metadata operation on filesystems like Btrfs and XFS. Otherwise the data is
+///   copied with `copy_file_range` or `sendfile`, falling back to a bounded buffer.
+///   Holes in sparse files are preserved on systems that can report them. On
+///   Windows this function wraps `CopyFileEx`.\n\n
+///   If the copy fails or is canceled, the partially written destination is deleted.
+/// @param src Path to the source file.
+/// @param dst Path to the destination file, which is replaced if it exists.
+/// @param func Function called periodically as the copy progresses. May be NULL.
+/// @param opaque Passed to `func`.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_CopyFileEx(const char *src, const char *dst, MTY_CopyProgressFunc func, void *opaque);
+
 /// @brief Move a file.
 /// @param src Path to the source file.
 /// @param dst Path to the destination file.
@@ -429,6 +645,97 @@ MTY_GetFileList(const char *path, const char *filter);
 MTY_EXPORT void
 MTY_FreeFileList(MTY_FileList **fileList);
 
+/// @brief Create an MTY_DirIter that streams the contents of a directory.
+/// @details Unlike MTY_GetFileList, entries are returned as they are read without
+///   building up a list, so directories of any size can be walked in constant memory.
+///   Entry types come from the directory itself without a `stat` per entry where the
+///   filesystem supports it. The special `.` and `..` entries are never returned.\n\n
+///   Entries within a directory are returned in the order the filesystem stores them,
+///   and with MTY_DIR_FLAG_PARALLEL the order across directories is unspecified.
+/// @param path Path to a directory.
+/// @param filter Pattern each file's name must match to be returned, or NULL for no
+///   filter. A pattern containing `*` or `?` is matched as a glob, otherwise it must
+///   match the end of the name, such as `.png`. Directories are not filtered.
+/// @param flags Combination of MTY_DirFlag values.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_DirIter must be destroyed with MTY_DirIterDestroy.
+MTY_EXPORT MTY_DirIter *
+MTY_DirIterCreate(const char *path, const char *filter, MTY_DirFlag flags);
+
+/// @brief Destroy an MTY_DirIter.
+/// @details The walk may be abandoned at any point.
+/// @param iter Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_DirIterDestroy(MTY_DirIter **iter);
+
+/// @brief Get the next entry from an MTY_DirIter.
+/// @details Subdirectories that can't be opened are skipped.
+/// @param ctx An MTY_DirIter.
+/// @returns The next entry, or NULL once every entry has been returned. The entry and
+///   its strings remain valid until the next call to MTY_DirIterNext or
+///   MTY_DirIterDestroy.
+MTY_EXPORT const MTY_DirEntry *
+MTY_DirIterNext(MTY_DirIter *ctx);
+
+/// @brief Create an MTY_FileWatch that reports changes to files and directories.
+/// @details Changes are delivered by the operating system rather than by polling the
+///   files, currently via inotify on Linux and Android. Bursts of changes to the same
+///   path, such as an editor truncating then writing a file, are combined into a
+///   single event once the path has been quiet for `debounce` milliseconds.\n\n
+///   An MTY_FileWatch is not thread safe.
+/// @param debounce Milliseconds a path must go without changes before its event is
+///   reported, or 0 to report changes as soon as they are read.
+/// @returns On failure or where file watching is unsupported, NULL is returned. Call
+///   MTY_GetLog for details.\n\n
+///   The returned MTY_FileWatch must be destroyed with MTY_FileWatchDestroy.
+MTY_EXPORT MTY_FileWatch *
+MTY_FileWatchCreate(uint32_t debounce);
+
+/// @brief Destroy an MTY_FileWatch.
+/// @details Changes that have not yet been reported are discarded.
+/// @param watch Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_FileWatchDestroy(MTY_FileWatch **watch);
+
+/// @brief Start watching a file or directory.
+/// @details Files are watched through their directory, so a file that is replaced by
+///   renaming another file over it continues to be watched. A watched directory
+///   reports changes to its entries.
+/// @param ctx An MTY_FileWatch.
+/// @param path Path to an existing file or directory.
+/// @param recursive If `path` is a directory, also watch every directory beneath it,
+///   including ones created later.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileWatchAdd(MTY_FileWatch *ctx, const char *path, bool recursive);
+
+/// @brief Stop watching a file or directory.
+/// @param ctx An MTY_FileWatch.
+/// @param path The same path previously passed to MTY_FileWatchAdd.
+MTY_EXPORT void
+MTY_FileWatchRemove(MTY_FileWatch *ctx, const char *path);
+
+/// @brief Get a handle that can be waited on alongside other I/O.
+/// @details On Linux this is a file descriptor that becomes readable when changes are
+///   waiting, suitable for `poll` or `epoll`. When it does, call MTY_FileWatchPoll with
+///   a timeout of 0. With a debounce period, changes may still be pending afterwards,
+///   so the wait should not be longer than the debounce period.
+/// @param ctx An MTY_FileWatch.
+/// @returns The platform handle.
+MTY_EXPORT intptr_t
+MTY_FileWatchGetHandle(MTY_FileWatch *ctx);
+
+/// @brief Wait for changes and call a function for each one.
+/// @param ctx An MTY_FileWatch.
+/// @param timeout Time to wait in milliseconds for at least one change to be reported,
+///   or -1 to wait indefinitely.
+/// @param func Function called on the calling thread for each change.
+/// @param opaque Passed to `func`.
+/// @returns The number of changes reported.
+MTY_EXPORT uint32_t
+MTY_FileWatchPoll(MTY_FileWatch *ctx, int32_t timeout, MTY_FileWatchFunc func,
+	void *opaque);
+
 /// @brief Create an MTY_LockFile for signaling resource ownership across processes.
 /// @details The process that holds the lock will continue to hold the lock unil
 ///   MTY_LockFileDestroy is called or the process terminates.
@@ -446,6 +753,136 @@ MTY_LockFileCreate(const char *path, MTY_FileMode mode);
 MTY_EXPORT void
 MTY_LockFileDestroy(MTY_LockFile **lock);
 
+/// @brief Map a file into memory.
+/// @details Unlike MTY_ReadFile, no copy of the file is made. Pages are read from the
+///   system's file cache as they are touched, so large files that are accessed
+///   sparsely cost little more than the pages actually used.\n\n
+///   Unlike MTY_ReadFile, `data` is not null-terminated.\n\n
+///   If another process truncates the file while it is mapped, touching the pages past
+///   the new end raises SIGBUS on Unix or an access violation on Windows. Prefer
+///   MTY_ReadFile for files that other processes may rewrite.
+/// @param path Path to the file.
+/// @param mode Read only or read and write access. With MTY_MAP_MODE_WRITE, changes
+///   are visible to other processes mapping the same file and are written back to the
+///   file by the system.
+/// @param hints A bitmask of MTY_MapHint values. Hints that are not supported on the
+///   current platform are ignored.
+/// @returns On failure or if the file is empty, NULL is returned. Call MTY_GetLog
+///   for details.\n\n
+///   The returned MTY_FileView must be destroyed with MTY_UnmapFile.
+MTY_EXPORT MTY_FileView *
+MTY_MapFile(const char *path, MTY_MapMode mode, MTY_MapHint hints);
+
+/// @brief Unmap a file mapped with MTY_MapFile.
+/// @param view Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_UnmapFile(MTY_FileView **view);
+
+/// @brief Create an MTY_FileIO for issuing many file reads and writes at once.
+/// @details Requests are queued with MTY_FileIORead and MTY_FileIOWrite, handed off
+///   together with MTY_FileIOSubmit, and collected with MTY_FileIOWait or
+///   MTY_FileIOPoll. On Linux the requests are submitted to an io_uring in a single
+///   system call. Where io_uring is unavailable, such as on older kernels, in
+///   containers that block it, or on other platforms, the requests are serviced by a
+///   small set of threads owned by the MTY_FileIO.\n\n
+///   An MTY_FileIO is not thread safe and should be used from one thread at a time.
+/// @param depth Maximum number of requests that can be in flight at once.
+/// @returns The returned MTY_FileIO must be destroyed with MTY_FileIODestroy.
+MTY_EXPORT MTY_FileIO *
+MTY_FileIOCreate(uint32_t depth);
+
+/// @brief Destroy an MTY_FileIO.
+/// @details Waits for requests still in flight, then closes any open files.
+/// @param fio Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_FileIODestroy(MTY_FileIO **fio);
+
+/// @brief Open a file for use with an MTY_FileIO.
+/// @param ctx An MTY_FileIO.
+/// @param path Path to the file.
+/// @param write Open the file for reading and writing, creating it if it doesn't
+///   exist. Otherwise the file is opened read only.
+/// @returns On success, an identifier for the file greater than 0.\n\n
+///   On failure, 0 is returned. Call MTY_GetLog for details.
+MTY_EXPORT uint32_t
+MTY_FileIOOpen(MTY_FileIO *ctx, const char *path, bool write);
+
+/// @brief Close a file opened with MTY_FileIOOpen.
+/// @details The file must not have any requests in flight.
+/// @param ctx An MTY_FileIO.
+/// @param file Identifier returned by MTY_FileIOOpen.
+MTY_EXPORT void
+MTY_FileIOClose(MTY_FileIO *ctx, uint32_t file);
+
+/// @brief Register buffers that will be used for most requests.
+/// @details With io_uring, registered buffers are pinned once rather than on every
+///   request. Requests whose memory falls within a registered buffer use it
+///   automatically. Registering a new set replaces the previous one, which must not
+///   have requests in flight. Without io_uring this function does nothing.
+/// @param ctx An MTY_FileIO.
+/// @param buffers Array of `count` buffers.
+/// @param sizes Array of `count` buffer sizes in bytes.
+/// @param count Number of buffers.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileIORegisterBuffers(MTY_FileIO *ctx, void **buffers, const size_t *sizes,
+	uint32_t count);
+
+/// @brief Queue a read from a file at an offset.
+/// @details The request is not started until the next MTY_FileIOSubmit.
+/// @param ctx An MTY_FileIO.
+/// @param file Identifier returned by MTY_FileIOOpen.
+/// @param buf Buffer to read into, which must remain valid until the request completes.
+/// @param size Number of bytes to read, up to 1 GB.
+/// @param offset Offset in bytes into the file to begin reading.
+/// @param opaque Returned with the result.
+/// @returns Returns false if `depth` requests are already in flight, or on failure.
+///   Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileIORead(MTY_FileIO *ctx, uint32_t file, void *buf, size_t size, uint64_t offset,
+	void *opaque);
+
+/// @brief Queue a write to a file at an offset.
+/// @details The request is not started until the next MTY_FileIOSubmit.
+/// @param ctx An MTY_FileIO.
+/// @param file Identifier returned by MTY_FileIOOpen.
+/// @param buf Data to write, which must remain valid until the request completes.
+/// @param size Number of bytes to write, up to 1 GB.
+/// @param offset Offset in bytes into the file to begin writing.
+/// @param opaque Returned with the result.
+/// @returns Returns false if `depth` requests are already in flight, or on failure.
+///   Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FileIOWrite(MTY_FileIO *ctx, uint32_t file, const void *buf, size_t size,
+	uint64_t offset, void *opaque);
+
+/// @brief Start every queued request.
+/// @param ctx An MTY_FileIO.
+/// @returns The number of requests started.
+MTY_EXPORT uint32_t
+MTY_FileIOSubmit(MTY_FileIO *ctx);
+
+/// @brief Wait for requests to complete.
+/// @details Any queued requests are submitted first. Returns as soon as at least one
+///   request has completed, or immediately if no requests are in flight.
+/// @param ctx An MTY_FileIO.
+/// @param timeout Time to wait in milliseconds, or -1 to wait indefinitely.
+/// @param results Array that receives up to `max` results.
+/// @param max Number of elements in `results`.
+/// @returns The number of results written, 0 on timeout.
+MTY_EXPORT uint32_t
+MTY_FileIOWait(MTY_FileIO *ctx, int32_t timeout, MTY_FileIOResult *results, uint32_t max);
+
+/// @brief Wait for requests to complete and call a function for each one.
+/// @details Behaves like MTY_FileIOWait, but hands every available result to `func`.
+/// @param ctx An MTY_FileIO.
+/// @param timeout Time to wait in milliseconds, or -1 to wait indefinitely.
+/// @param func Function called on the calling thread for each completed request.
+/// @param opaque Passed to `func`.
+/// @returns The number of completed requests.
+MTY_EXPORT uint32_t
+MTY_FileIOPoll(MTY_FileIO *ctx, int32_t timeout, MTY_FileIOFunc func, void *opaque);
+
 
 //- #module JSON
 //- #mbrief JSON parsing and construction.
@@ -518,6 +955,9 @@ MTY_EXPORT void
 MTY_JSONObjDeleteItem(MTY_JSON *json, const char *key);
 
 /// @brief Get an item from a JSON object.
+/// @details Objects and arrays with many items build a lookup table the first time
+///   they are searched, so reading the same item from multiple threads at once
+///   must be synchronized like any other access.
 /// @returns If the `key` exists, the associated item is returned. This reference is
 ///   valid only as long as the `json` item is also valid.\n\n
 ///   If the `key` does not exist, NULL is returned.
@@ -682,19 +1122,72 @@ MTY_JSONArraySetNull(MTY_JSON *json, uint32_t index);
 //- #module Log
 //- #mbrief Add logs, set logging callback, and log getters.
 
+#if !defined(MTY_LOG_COMPILE_LEVEL)
+	#define MTY_LOG_COMPILE_LEVEL MTY_LOG_LEVEL_DEBUG ///< Least severe MTY_LogLevel compiled
+	                                                  ///<   into the logging macros.
+#endif
+
+#define MTY_LogEx(level, msg, ...) do { \
+	if ((level) <= MTY_LOG_COMPILE_LEVEL) { \
+		static MTY_LogSite _mty_log_site; \
+		MTY_LogSiteParams(&_mty_log_site, level, __FUNCTION__, msg, ##__VA_ARGS__); \
+	} \
+} while (0)
+
 #define MTY_Log(msg, ...) \
-	MTY_LogParams(__FUNCTION__, msg, ##__VA_ARGS__)
+	MTY_LogEx(MTY_LOG_LEVEL_ERROR, msg, ##__VA_ARGS__)
+
+#define MTY_LogWarning(msg, ...) \
+	MTY_LogEx(MTY_LOG_LEVEL_WARNING, msg, ##__VA_ARGS__)
+
+#define MTY_LogInfo(msg, ...) \
+	MTY_LogEx(MTY_LOG_LEVEL_INFO, msg, ##__VA_ARGS__)
+
+#define MTY_LogDebug(msg, ...) \
+	MTY_LogEx(MTY_LOG_LEVEL_DEBUG, msg, ##__VA_ARGS__)
 
 #define MTY_LogFatal(msg, ...) \
 	MTY_LogFatalParams(__FUNCTION__, msg, ##__VA_ARGS__)
 
+/// @brief Severity of a log message.
+typedef enum {
+	MTY_LOG_LEVEL_FATAL   = 0, ///< The process is about to exit.
+	MTY_LOG_LEVEL_ERROR   = 1, ///< An operation failed. Used by `MTY_Log`.
+	MTY_LOG_LEVEL_WARNING = 2, ///< Something unexpected happened but the operation continued.
+	MTY_LOG_LEVEL_INFO    = 3, ///< Noteworthy events.
+	MTY_LOG_LEVEL_DEBUG   = 4, ///< Diagnostics that are too frequent to keep on by default.
+	MTY_LOG_LEVEL_MAKE_32 = INT32_MAX,
+} MTY_LogLevel;
+
+/// @brief Rate limiting state of a logging call site.
+/// @details The logging macros declare a zero initialized `static` instance of this
+///   struct at each call site, it should not be accessed directly.
+typedef struct {
+	volatile int32_t window;     ///< The second the current rate limiting window began.
+	volatile int32_t count;      ///< Messages accepted during the current window.
+	volatile int32_t suppressed; ///< Messages rejected since the last accepted message.
+} MTY_LogSite;
+
+/// @brief Logging counters returned by MTY_GetLogStats.
+typedef struct {
+	uint64_t logged;     ///< Messages accepted for logging.
+	uint64_t dropped;    ///< Messages lost because the log thread fell too far behind.
+	uint64_t suppressed; ///< Messages rejected by the per call site rate limit.
+} MTY_LogStats;
+
 /// @brief Function called when a new log message is available.
 /// @param msg The formatted log message.
 /// @param opaque Pointer set via MTY_SetLogFunc.
 typedef void (*MTY_LogFunc)(const char *msg, void *opaque);
 
 /// @brief Set a function to receive log messages.
-/// @details This function is set globally.
+/// @details This function is set globally. Messages are captured without formatting
+///   by the logging thread and handed to a background thread, which formats them and
+///   calls `func` in the order they were logged. Messages logged via MTY_LogFatal are
+///   delivered on the logging thread after the background thread has caught up.\n\n
+///   Messages already queued are delivered to the previous function first. Once
+///   this returns, the previous function is no longer called, so its `opaque` may be
+///   freed.
 /// @param func Function called when a new log message is available. Set to NULL
 ///   to remove a previously set `func`.
 /// @param opaque Passed to `func` when it is called.
@@ -706,9 +1199,47 @@ MTY_SetLogFunc(MTY_LogFunc func, void *opaque);
 MTY_EXPORT void
 MTY_DisableLog(bool disabled);
 
+/// @brief Set the least severe MTY_LogLevel that is logged.
+/// @details Messages less severe than `level` are discarded before their arguments
+///   are captured. The default is MTY_LOG_LEVEL_INFO.
+/// @param level The least severe level to log.
+MTY_EXPORT void
+MTY_SetLogLevel(MTY_LogLevel level);
+
+/// @brief Limit how many messages each logging call site produces per second.
+/// @details Messages over the limit are discarded, and the next message accepted from
+///   the same call site notes how many were suppressed. The default is 100.
+/// @param perSecond Maximum messages per call site per second, or 0 for no limit.
+MTY_EXPORT void
+MTY_SetLogRateLimit(uint32_t perSecond);
+
+/// @brief Wait until every message logged so far has been delivered.
+/// @details This has no effect when called from the function set via MTY_SetLogFunc.
+MTY_EXPORT void
+MTY_FlushLog(void);
+
+/// @brief Get counters for logged, dropped, and suppressed messages.
+/// @param stats Set to the number of messages in each category since the process began.
+MTY_EXPORT void
+MTY_GetLogStats(MTY_LogStats *stats);
+
+/// @brief Log a message from a call site.
+/// @details This function is intended to be called internally via the logging
+///   macros. The message is only formatted when it is delivered, so `func` and `msg`
+///   must remain valid for the life of the process, which string literals do.
+/// @param site Call site state used for rate limiting, may be NULL.
+/// @param level Severity of the message.
+/// @param func The name of the function that produced the message.
+/// @param msg Format string.
+/// @param ... Variable arguments as specified by `msg`.
+MTY_EXPORT void
+MTY_LogSiteParams(MTY_LogSite *site, MTY_LogLevel level, const char *func,
+	const char *msg, ...);
+
 /// @brief Log a formatted string.
-/// @details This function is intended to be called internally via the
-///   `MTY_Log` macro, but can be used to add to the libmatoya log.
+/// @details This function can be used to add to the libmatoya log. Unlike the
+///   logging macros the message is formatted immediately, so `func` and `msg` can be
+///   temporary, and it is logged at MTY_LOG_LEVEL_ERROR without rate limiting.
 /// @param func The name of the function that produced the message.
 /// @param msg Format string.
 /// @param ... Variable arguments as specified by `msg`.
@@ -740,10 +1271,10 @@ MTY_GetLog(void);
 	((a) > (b) ? (a) : (b))
 
 #define MTY_ALIGN16(v) \
-	((v) + 0xF & ~((uintptr_t) 0xF))
+	(((v) + 0xF) & ~((uintptr_t) 0xF))
 
 #define MTY_ALIGN32(v) \
-	((v) + 0x1F & ~((uintptr_t) 0x1F))
+	(((v) + 0x1F) & ~((uintptr_t) 0x1F))
 
 /// @brief Function called while running MTY_Sort.
 /// @param a An element evaluated during MTY_Sort.
@@ -752,6 +1283,25 @@ MTY_GetLog(void);
 ///   Otherwise, the position is unchanged.
 typedef int32_t (*MTY_CompareFunc)(const void *a, const void *b);
 
+/// @brief Key types understood by MTY_RadixSort.
+typedef enum {
+	MTY_SORT_KEY_UINT32  = 1, ///< Unsigned 32-bit integer.
+	MTY_SORT_KEY_INT32   = 2, ///< Signed 32-bit integer.
+	MTY_SORT_KEY_UINT64  = 3, ///< Unsigned 64-bit integer.
+	MTY_SORT_KEY_INT64   = 4, ///< Signed 64-bit integer.
+	MTY_SORT_KEY_FLOAT   = 5, ///< 32-bit floating point.
+	MTY_SORT_KEY_DOUBLE  = 6, ///< 64-bit floating point.
+	MTY_SORT_KEY_MAKE_32 = INT32_MAX,
+} MTY_SortKey;
+
+/// @brief Usage of the calling thread's scratch stack.
+typedef struct {
+	size_t used;      ///< Bytes currently allocated.
+	size_t highWater; ///< Largest value of `used` since the last reset.
+	size_t capacity;  ///< Bytes reserved by the stack's chunks.
+	uint32_t depth;   ///< Number of open scopes.
+} MTY_ScratchStats;
+
 /// @brief Allocate zeroed memory.
 /// @param nelem Number of elements requested.
 /// @param elsize Size in bytes of each element.
@@ -846,7 +1396,9 @@ MTY_Strcasecmp(const char *s1, const char *s2);
 MTY_EXPORT char *
 MTY_Strtok(char *str, const char *delim, char **saveptr);
 
-/// @brief Stable qsort.
+/// @brief Stable sort.
+/// @details This is an adaptive merge sort that takes advantage of runs of already
+///   ordered elements. Sorting partially sorted data approaches linear time.
 /// @param base The buffer to sort.
 /// @param nElements Number of elements in `base`.
 /// @param size Size in bytes of each element.
@@ -855,6 +1407,30 @@ MTY_Strtok(char *str, const char *delim, char **saveptr);
 MTY_EXPORT void
 MTY_Sort(void *base, size_t nElements, size_t size, MTY_CompareFunc func);
 
+/// @brief Stable sort split across multiple threads.
+/// @details `base` is divided into chunks that are sorted concurrently with MTY_Sort
+///   via MTY_ParallelFor then merged. Small arrays are sorted on the calling thread.
+/// @param base The buffer to sort.
+/// @param nElements Number of elements in `base`.
+/// @param size Size in bytes of each element.
+/// @param func Function called to compare elements as the algorithm processes the
+///   buffer. It must be safe to call from multiple threads.
+/// @param maxThreads Maximum number of threads, including the calling thread.
+MTY_EXPORT void
+MTY_SortParallel(void *base, size_t nElements, size_t size, MTY_CompareFunc func,
+	uint32_t maxThreads);
+
+/// @brief Stable radix sort by a numeric key embedded in each element.
+/// @details No comparison function is needed, making this considerably faster
+///   than MTY_Sort for large arrays with integer or floating point keys.
+/// @param base The buffer to sort.
+/// @param nElements Number of elements in `base`.
+/// @param size Size in bytes of each element.
+/// @param keyOffset Offset in bytes of the key within each element.
+/// @param keyType The type of the key found at `keyOffset`.
+MTY_EXPORT void
+MTY_RadixSort(void *base, size_t nElements, size_t size, size_t keyOffset, MTY_SortKey keyType);
+
 /// @brief Reverse the byte order of 16-bit integer.
 /// @param value Value to swap.
 MTY_EXPORT uint16_t
@@ -930,6 +1506,39 @@ MTY_MultiToWide(const char *src, wchar_t *dst, uint32_t len);
 MTY_EXPORT wchar_t *
 MTY_MultiToWideD(const char *src);
 
+/// @brief Open a scope on the calling thread's scratch stack.
+/// @details Buffers documented as allocated in thread local storage, as well as those
+///   returned by MTY_ScratchAlloc, come from a per-thread scratch stack. Everything
+///   allocated after MTY_ScratchPush stays valid until the matching MTY_ScratchPop,
+///   and the stack grows in chunks as needed.\n\n
+///   Outside of any scope the stack behaves like a ring buffer: when its first chunk
+///   fills up, allocation restarts at the beginning and older buffers are overwritten.
+///   Buffers obtained before a scope is opened are never overwritten while it is open.\n\n
+///   Scopes must be closed in the reverse order they were opened, and must not be
+///   left open across MTY_FiberYield or any call that may yield to another fiber.
+/// @returns A mark to pass to MTY_ScratchPop.
+MTY_EXPORT size_t
+MTY_ScratchPush(void);
+
+/// @brief Close a scope opened with MTY_ScratchPush.
+/// @details Every buffer allocated since the matching MTY_ScratchPush is released.
+/// @param mark The value returned by MTY_ScratchPush.
+MTY_EXPORT void
+MTY_ScratchPop(size_t mark);
+
+/// @brief Allocate zeroed memory from the calling thread's scratch stack.
+/// @param size Size in bytes.
+/// @returns A 16 byte aligned buffer that remains valid until the current scope is
+///   closed. See MTY_ScratchPush.
+MTY_EXPORT void *
+MTY_ScratchAlloc(size_t size);
+
+/// @brief Get the usage of the calling thread's scratch stack.
+/// @param stats Set to the current usage.
+/// @param reset Reset the high water mark to the current usage.
+MTY_EXPORT void
+MTY_ScratchGetStats(MTY_ScratchStats *stats, bool reset);
+
 
 //- #module System
 //- #mbrief Process and OS related functions.
@@ -984,6 +1593,11 @@ MTY_SOUnload(MTY_SO **so);
 MTY_EXPORT const char *
 MTY_GetHostname(void);
 
+/// @brief Get the number of logical processors available to the process.
+/// @returns The number of online processors, at least 1.
+MTY_EXPORT uint32_t
+MTY_GetNumProcessors(void);
+
 /// @brief Get the current platform.
 /// @returns An MTY_OS value bitwise OR'd with the OS's major and minor version numbers.
 ///   The major version has a mask of `0xFF00` and the minor has a mask of `0xFF`. On
@@ -1303,13 +1917,42 @@ MTY_FreeRenderState(MTY_RenderState **state);
 //- #mbrief Simple data structures.
 
 typedef struct MTY_Hash MTY_Hash;
+typedef struct MTY_ConcurrentHash MTY_ConcurrentHash;
 typedef struct MTY_Queue MTY_Queue;
 typedef struct MTY_List MTY_List;
+typedef struct MTY_Cache MTY_Cache;
+typedef struct MTY_RingBuffer MTY_RingBuffer;
 
 /// @brief Function that frees resources you allocated within a data structure.
 /// @param Pointer set via MTY_HashSet et al.
 typedef void (*MTY_FreeFunc)(void *ptr);
 
+/// @brief Function called when an MTY_Cache evicts or replaces a value.
+/// @param key The key the value was stored under.
+/// @param value The evicted value, which should be released by this function.
+/// @param opaque Pointer set via MTY_CacheCreate.
+typedef void (*MTY_CacheEvictFunc)(const char *key, void *value, void *opaque);
+
+/// @brief Eviction policies used by MTY_Cache.
+typedef enum {
+	MTY_CACHE_POLICY_LRU     = 1, ///< Evict the least recently used entry.
+	MTY_CACHE_POLICY_2Q      = 2, ///< Scan resistant 2Q. New entries wait in a probationary
+	                              ///<   queue and are only promoted to the LRU queue if they
+	                              ///<   are requested again after being evicted, so a one-time
+	                              ///<   scan can not flush frequently used entries.
+	MTY_CACHE_POLICY_MAKE_32 = INT32_MAX,
+} MTY_CachePolicy;
+
+/// @brief Counters describing MTY_Cache effectiveness.
+typedef struct {
+	uint64_t hits;       ///< Lookups that found a value.
+	uint64_t misses;     ///< Lookups that did not find a value.
+	uint64_t insertions; ///< New keys added to the cache.
+	uint64_t evictions;  ///< Entries evicted to stay within capacity.
+	uint64_t entries;    ///< Current number of entries.
+	uint64_t bytes;      ///< Current total size of all entries.
+} MTY_CacheStats;
+
 /// @brief Node in a linked list.
 typedef struct MTY_ListNode {
 	struct MTY_ListNode *prev; ///< The previous node in the list.
@@ -1317,6 +1960,28 @@ typedef struct MTY_ListNode {
 	void *value;               ///< The value associated with the node.
 } MTY_ListNode;
 
+/// @brief Link embedded in your own struct to make it a member of an MTY_LinkList.
+/// @details Intrusive lists never allocate: the link lives inside the element, so an
+///   element can only be a member of one list per embedded MTY_Link. Use
+///   MTY_LINK_ENTRY to get back to the containing struct.
+typedef struct MTY_Link {
+	struct MTY_Link *prev; ///< The previous link in the list.
+	struct MTY_Link *next; ///< The next link in the list.
+} MTY_Link;
+
+/// @brief Intrusive doubly linked list. Zero initialize before use.
+typedef struct {
+	MTY_Link *first; ///< The first link in the list, or NULL if empty.
+	MTY_Link *last;  ///< The last link in the list, or NULL if empty.
+} MTY_LinkList;
+
+/// @brief Get the struct containing an MTY_Link.
+/// @param link Pointer to the MTY_Link.
+/// @param type The type of the containing struct.
+/// @param member The name of the MTY_Link member within `type`.
+#define MTY_LINK_ENTRY(link, type, member) \
+	((type *) ((uint8_t *) (link) - offsetof(type, member)))
+
 /// @brief Create an MTY_Hash for fast key/value lookup.
 /// @param numBuckets The number of buckets to use. The more buckets, the larger
 ///   the memory usage but less chance of collision. Specifying 0 chooses a reasonable
@@ -1394,6 +2059,172 @@ MTY_HashGetNextKey(MTY_Hash *ctx, uint64_t *iter, const char **key);
 MTY_EXPORT bool
 MTY_HashGetNextKeyInt(MTY_Hash *ctx, uint64_t *iter, int64_t *key);
 
+/// @brief Create an MTY_ConcurrentHash for key/value lookup shared between threads.
+/// @details Lookups never take a lock and scale with the number of reading threads.
+///   Writers are serialized per key stripe, and the table grows without stopping
+///   readers. Nodes removed or replaced by a resize are freed only after all readers
+///   that could have seen them are finished.\n\n
+///   Values themselves are not reference counted: if one thread pops and frees a
+///   value, other threads that already retrieved it are not protected.
+/// @param numBuckets The initial number of buckets. Specifying 0 chooses a reasonable
+///   default.
+/// @returns The returned MTY_ConcurrentHash must be destroyed with
+///   MTY_ConcurrentHashDestroy.
+MTY_EXPORT MTY_ConcurrentHash *
+MTY_ConcurrentHashCreate(uint32_t numBuckets);
+
+/// @brief Destroy an MTY_ConcurrentHash.
+/// @details No other thread may be accessing the hash during this call.
+/// @param hash Passed by reference and set to NULL after being destroyed.
+/// @param freeFunc Function called on each remaining value in the hash to give you
+///   the opportunity to free resources. This may be NULL if it is unnecessary.
+MTY_EXPORT void
+MTY_ConcurrentHashDestroy(MTY_ConcurrentHash **hash, MTY_FreeFunc freeFunc);
+
+/// @brief Get the number of keys in an MTY_ConcurrentHash.
+/// @param ctx An MTY_ConcurrentHash.
+MTY_EXPORT uint32_t
+MTY_ConcurrentHashGetLength(MTY_ConcurrentHash *ctx);
+
+/// @brief Get a value from a concurrent hash by string key without locking.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key String key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_ConcurrentHashGet(MTY_ConcurrentHash *ctx, const char *key);
+
+/// @brief Get a value from a concurrent hash by integer key without locking.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key Integer key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_ConcurrentHashGetInt(MTY_ConcurrentHash *ctx, int64_t key);
+
+/// @brief Set a value in a concurrent hash by string key.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key String key to set.
+/// @param value Value to set associated with `key`.
+/// @returns If `key` already exists, the value that was replaced, otherwise NULL.
+MTY_EXPORT void *
+MTY_ConcurrentHashSet(MTY_ConcurrentHash *ctx, const char *key, void *value);
+
+/// @brief Set a value in a concurrent hash by integer key.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key Integer key to set.
+/// @param value Value to set associated with `key`.
+/// @returns If `key` already exists, the value that was replaced, otherwise NULL.
+MTY_EXPORT void *
+MTY_ConcurrentHashSetInt(MTY_ConcurrentHash *ctx, int64_t key, void *value);
+
+/// @brief Atomically get an existing value by string key or insert a new one.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key String key to lookup or set.
+/// @param value Value to insert if `key` does not exist.
+/// @returns The value associated with `key` after the call. If this is not `value`,
+///   another value was already present and `value` was not inserted.
+MTY_EXPORT void *
+MTY_ConcurrentHashGetOrSet(MTY_ConcurrentHash *ctx, const char *key, void *value);
+
+/// @brief Atomically get an existing value by integer key or insert a new one.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key Integer key to lookup or set.
+/// @param value Value to insert if `key` does not exist.
+/// @returns The value associated with `key` after the call. If this is not `value`,
+///   another value was already present and `value` was not inserted.
+MTY_EXPORT void *
+MTY_ConcurrentHashGetOrSetInt(MTY_ConcurrentHash *ctx, int64_t key, void *value);
+
+/// @brief Get and remove a value from a concurrent hash by string key.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key String key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_ConcurrentHashPop(MTY_ConcurrentHash *ctx, const char *key);
+
+/// @brief Get and remove a value from a concurrent hash by integer key.
+/// @param ctx An MTY_ConcurrentHash.
+/// @param key Integer key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_ConcurrentHashPopInt(MTY_ConcurrentHash *ctx, int64_t key);
+
+/// @brief Create an MTY_Cache, a bounded key/value store that evicts old entries.
+/// @param policy Eviction policy.
+/// @param maxEntries Maximum number of entries, or 0 for no entry limit.
+/// @param maxBytes Maximum total size of all entries as reported to MTY_CacheSet,
+///   or 0 for no size limit.
+/// @param numShards If 0, the cache is not thread safe. Otherwise the cache is split
+///   into this many independently locked shards, each with an equal share of the
+///   capacity, so threads working on different keys rarely contend. Fewer shards
+///   are used if `maxEntries` or `maxBytes` is smaller than this value.
+/// @param func Function called with each value that is evicted, replaced, or still
+///   present when the cache is destroyed. May be NULL. It is never called with a lock
+///   held.
+/// @param opaque Passed to `func` when it is called.
+/// @returns The returned MTY_Cache must be destroyed with MTY_CacheDestroy.
+MTY_EXPORT MTY_Cache *
+MTY_CacheCreate(MTY_CachePolicy policy, uint32_t maxEntries, size_t maxBytes,
+	uint32_t numShards, MTY_CacheEvictFunc func, void *opaque);
+
+/// @brief Destroy an MTY_Cache, passing every remaining value to its eviction function.
+/// @param cache Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_CacheDestroy(MTY_Cache **cache);
+
+/// @brief Get a value from a cache by string key, marking it as recently used.
+/// @details With a sharded cache, another thread may evict the value as soon as this
+///   function returns, so values shared between threads should be reference counted.
+/// @param ctx An MTY_Cache.
+/// @param key String key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_CacheGet(MTY_Cache *ctx, const char *key);
+
+/// @brief Get a value from a cache by integer key, marking it as recently used.
+/// @param ctx An MTY_Cache.
+/// @param key Integer key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_CacheGetInt(MTY_Cache *ctx, int64_t key);
+
+/// @brief Set a value in a cache by string key, evicting other entries if necessary.
+/// @param ctx An MTY_Cache.
+/// @param key String key to set.
+/// @param value Value to set associated with `key`. If `key` already has a different
+///   value, the old value is passed to the eviction function.
+/// @param size Size in bytes charged against the cache's `maxBytes`.
+MTY_EXPORT void
+MTY_CacheSet(MTY_Cache *ctx, const char *key, void *value, size_t size);
+
+/// @brief Set a value in a cache by integer key, evicting other entries if necessary.
+/// @param ctx An MTY_Cache.
+/// @param key Integer key to set.
+/// @param value Value to set associated with `key`.
+/// @param size Size in bytes charged against the cache's `maxBytes`.
+MTY_EXPORT void
+MTY_CacheSetInt(MTY_Cache *ctx, int64_t key, void *value, size_t size);
+
+/// @brief Remove a value from a cache by string key without calling the eviction function.
+/// @param ctx An MTY_Cache.
+/// @param key String key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_CachePop(MTY_Cache *ctx, const char *key);
+
+/// @brief Remove a value from a cache by integer key without calling the eviction function.
+/// @param ctx An MTY_Cache.
+/// @param key Integer key to lookup.
+/// @returns The value associated with `key`, otherwise NULL.
+MTY_EXPORT void *
+MTY_CachePopInt(MTY_Cache *ctx, int64_t key);
+
+/// @brief Get hit, miss, and eviction counters along with current usage.
+/// @param ctx An MTY_Cache.
+/// @param stats Set to the combined counters of all shards.
+/// @param reset If true, the hit, miss, insertion, and eviction counters are reset to zero.
+MTY_EXPORT void
+MTY_CacheGetStats(MTY_Cache *ctx, MTY_CacheStats *stats, bool reset);
+
 /// @brief Create an MTY_Queue for thread safe serialization.
 /// @param len The length of the queue.
 /// @param bufSize The preallocated size of each buffer in the queue.
@@ -1473,12 +2304,99 @@ MTY_QueuePopPtr(MTY_Queue *ctx, int32_t timeout, void **opaque, size_t *size);
 MTY_EXPORT void
 MTY_QueueFlush(MTY_Queue *ctx, MTY_FreeFunc freeFunc);
 
+/// @brief Create an MTY_RingBuffer, a fixed size byte stream with contiguous spans.
+/// @details The buffer's memory is mapped twice back to back, so the spans returned
+///   by MTY_RingBufferReserve and MTY_RingBufferPeek never wrap around and can be
+///   passed directly to functions that read or write memory. One producer thread and
+///   one consumer thread may use the ring buffer concurrently without a lock.
+/// @param minSize Minimum capacity in bytes, rounded up to a multiple of the system's
+///   page size.
+/// @returns The returned MTY_RingBuffer must be destroyed with MTY_RingBufferDestroy.
+MTY_EXPORT MTY_RingBuffer *
+MTY_RingBufferCreate(size_t minSize);
+
+/// @brief Destroy an MTY_RingBuffer.
+/// @param ring Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_RingBufferDestroy(MTY_RingBuffer **ring);
+
+/// @brief Get the capacity of a ring buffer.
+/// @param ctx An MTY_RingBuffer.
+MTY_EXPORT size_t
+MTY_RingBufferGetSize(MTY_RingBuffer *ctx);
+
+/// @brief Get the number of bytes available to be read from a ring buffer.
+/// @param ctx An MTY_RingBuffer.
+MTY_EXPORT size_t
+MTY_RingBufferGetLength(MTY_RingBuffer *ctx);
+
+/// @brief Get the contiguous free space of a ring buffer for writing. Producer only.
+/// @param ctx An MTY_RingBuffer.
+/// @param size Set to the number of bytes that may be written to the returned span.
+/// @returns Span that may be written to then published with MTY_RingBufferCommit.
+MTY_EXPORT void *
+MTY_RingBufferReserve(MTY_RingBuffer *ctx, size_t *size);
+
+/// @brief Publish bytes written to the span returned by MTY_RingBufferReserve.
+///   Producer only.
+/// @param ctx An MTY_RingBuffer.
+/// @param size Number of bytes written, no larger than the size returned by
+///   MTY_RingBufferReserve.
+MTY_EXPORT void
+MTY_RingBufferCommit(MTY_RingBuffer *ctx, size_t size);
+
+/// @brief Get all readable bytes in a ring buffer as a contiguous span without
+///   consuming them. Consumer only.
+/// @param ctx An MTY_RingBuffer.
+/// @param size Set to the number of bytes that may be read from the returned span.
+/// @returns Span that remains valid until the bytes are consumed with MTY_RingBufferSkip.
+MTY_EXPORT const void *
+MTY_RingBufferPeek(MTY_RingBuffer *ctx, size_t *size);
+
+/// @brief Consume bytes from the front of a ring buffer. Consumer only.
+/// @param ctx An MTY_RingBuffer.
+/// @param size Number of bytes to consume, no larger than the size returned by
+///   MTY_RingBufferPeek.
+MTY_EXPORT void
+MTY_RingBufferSkip(MTY_RingBuffer *ctx, size_t size);
+
+/// @brief Copy bytes into a ring buffer. Producer only.
+/// @param ctx An MTY_RingBuffer.
+/// @param buf Bytes to write.
+/// @param size Size in bytes of `buf`.
+/// @returns Returns true if `buf` was written, or false if there was not enough space.
+MTY_EXPORT bool
+MTY_RingBufferWrite(MTY_RingBuffer *ctx, const void *buf, size_t size);
+
+/// @brief Copy and consume bytes from a ring buffer. Consumer only.
+/// @param ctx An MTY_RingBuffer.
+/// @param buf Output buffer.
+/// @param size Size in bytes of `buf`.
+/// @returns The number of bytes read, which may be less than `size`.
+MTY_EXPORT size_t
+MTY_RingBufferRead(MTY_RingBuffer *ctx, void *buf, size_t size);
+
+/// @brief Consume all readable bytes in a ring buffer. Consumer only.
+/// @param ctx An MTY_RingBuffer.
+MTY_EXPORT void
+MTY_RingBufferClear(MTY_RingBuffer *ctx);
+
 /// @brief Create an MTY_List.
 /// @returns The returned MTY_List must be destroyed with MTY_ListDestroy.\n\n
 ///   Only the first node in the list should be passed to MTY_ListDestroy.
 MTY_EXPORT MTY_List *
 MTY_ListCreate(void);
 
+/// @brief Create an MTY_List that recycles its nodes from a pool.
+/// @details Nodes are allocated in slabs of `slabLen` and returned to the pool on
+///   removal instead of being freed, avoiding an allocation per append. Memory held
+///   by the pool is released when the list is destroyed.
+/// @param slabLen Number of nodes allocated at once when the pool is empty.
+///   Specifying 0 chooses a reasonable default.
+/// @returns The returned MTY_List must be destroyed with MTY_ListDestroy.
+MTY_EXPORT MTY_List *
+MTY_ListCreatePooled(uint32_t slabLen);
+
 /// @brief Destroy an MTY_List.
 /// @param queue Passed by reference and set to NULL after being destroyed.
 /// @param freeFunc Function called on each remaining value in the list to give you
@@ -1505,6 +2423,43 @@ MTY_ListAppend(MTY_List *ctx, void *value);
 MTY_EXPORT void *
 MTY_ListRemove(MTY_List *ctx, MTY_ListNode *node);
 
+/// @brief Insert a link at the front of an intrusive list.
+/// @param list An MTY_LinkList.
+/// @param link Link that is not currently a member of any list.
+MTY_EXPORT void
+MTY_LinkListPrepend(MTY_LinkList *list, MTY_Link *link);
+
+/// @brief Insert a link at the end of an intrusive list.
+/// @param list An MTY_LinkList.
+/// @param link Link that is not currently a member of any list.
+MTY_EXPORT void
+MTY_LinkListAppend(MTY_LinkList *list, MTY_Link *link);
+
+/// @brief Insert a link directly after another link in an intrusive list.
+/// @param list An MTY_LinkList.
+/// @param pos Link already in `list`. If NULL, `link` is prepended.
+/// @param link Link that is not currently a member of any list.
+MTY_EXPORT void
+MTY_LinkListInsertAfter(MTY_LinkList *list, MTY_Link *pos, MTY_Link *link);
+
+/// @brief Remove a link from an intrusive list.
+/// @param list An MTY_LinkList.
+/// @param link Link currently in `list`.
+MTY_EXPORT void
+MTY_LinkListRemove(MTY_LinkList *list, MTY_Link *link);
+
+/// @brief Move a link to the front of an intrusive list.
+/// @param list An MTY_LinkList.
+/// @param link Link currently in `list`.
+MTY_EXPORT void
+MTY_LinkListMoveToFront(MTY_LinkList *list, MTY_Link *link);
+
+/// @brief Move every link from one intrusive list to the end of another in O(1).
+/// @param dst Destination MTY_LinkList.
+/// @param src Source MTY_LinkList, left empty.
+MTY_EXPORT void
+MTY_LinkListSplice(MTY_LinkList *dst, MTY_LinkList *src);
+
 
 //- #module Thread
 //- #mbrief Thread creation and synchronization, atomics.
@@ -1516,6 +2471,7 @@ typedef struct MTY_Cond MTY_Cond;
 typedef struct MTY_RWLock MTY_RWLock;
 typedef struct MTY_Waitable MTY_Waitable;
 typedef struct MTY_ThreadPool MTY_ThreadPool;
+typedef struct MTY_TaskGraph MTY_TaskGraph;
 
 /// @brief Function that takes a single opaque argument.
 typedef void (*MTY_AnonFunc)(void *opaque);
@@ -1524,6 +2480,12 @@ typedef void (*MTY_AnonFunc)(void *opaque);
 /// @returns An opaque pointer that gets returned by MTY_ThreadDestroy.
 typedef void *(*MTY_ThreadFunc)(void *opaque);
 
+/// @brief Function called by MTY_ParallelFor on a range of iterations.
+/// @param begin First iteration of the range.
+/// @param end One past the last iteration of the range.
+/// @param opaque Pointer set via MTY_ParallelFor.
+typedef void (*MTY_ParallelForFunc)(uint64_t begin, uint64_t end, void *opaque);
+
 /// @brief Status of an asynchronous task.
 typedef enum {
 	MTY_ASYNC_OK       = 0, ///< The task has completed and the result is ready.
@@ -1533,6 +2495,15 @@ typedef enum {
 	MTY_ASYNC_MAKE_32  = INT32_MAX,
 } MTY_Async;
 
+#if defined(_MSC_VER)
+	#define MTY_ALIGNED(n) __declspec(align(n))
+	#define MTY_ATOMIC_API MTY_EXPORT
+#else
+	#define MTY_ALIGNED(n) __attribute__((aligned(n)))
+	#define MTY_ATOMIC_API static inline
+	#define MTY_ATOMIC_INLINE
+#endif
+
 /// @brief 32-bit integer used for atomic operations.
 typedef struct {
 	volatile int32_t value; ///< 32-bit value wrapped in a `struct` for alignment.
@@ -1543,12 +2514,106 @@ typedef struct {
 	volatile int64_t value; ///< 64-bit integer wrapped in a `struct` for alignment.
 } MTY_Atomic64;
 
+/// @brief Pointer used for atomic operations.
+typedef struct {
+	void * volatile value; ///< Pointer wrapped in a `struct` for alignment.
+} MTY_AtomicPtr;
+
+/// @brief 128-bit value used for double-width compare and swap.
+/// @details The type is 16-byte aligned. When placed on the heap, the allocation must
+///   be 16-byte aligned as well, which is the case for memory returned by MTY_Alloc
+///   on 64-bit platforms and by MTY_AllocAligned.
+typedef struct MTY_ALIGNED(16) {
+	volatile int64_t value[2]; ///< Low and high 64-bit halves.
+} MTY_Atomic128;
+
+/// @brief MTY_Atomic32 padded to fill a 64-byte cache line.
+/// @details Arrays of these allocated via MTY_AllocAligned with an alignment of 64
+///   keep each value on its own cache line, so threads updating neighboring values
+///   don't contend.
+typedef struct {
+	MTY_Atomic32 atomic; ///< The atomic value.
+	uint8_t pad[60];     ///< Padding to the end of the cache line.
+} MTY_PaddedAtomic32;
+
+/// @brief MTY_Atomic64 padded to fill a 64-byte cache line.
+/// @details See MTY_PaddedAtomic32.
+typedef struct {
+	MTY_Atomic64 atomic; ///< The atomic value.
+	uint8_t pad[56];     ///< Padding to the end of the cache line.
+} MTY_PaddedAtomic64;
+
+/// @brief Memory ordering constraints for atomic operations.
+/// @details These have the same meaning as the C11 `memory_order` values.
+typedef enum {
+	MTY_MEMORY_ORDER_RELAXED = 0, ///< Only the operation itself is atomic.
+	MTY_MEMORY_ORDER_ACQUIRE = 2, ///< Later reads and writes can't move before a load.
+	MTY_MEMORY_ORDER_RELEASE = 3, ///< Earlier reads and writes can't move after a store.
+	MTY_MEMORY_ORDER_ACQ_REL = 4, ///< Both acquire and release, for read-modify-write operations.
+	MTY_MEMORY_ORDER_SEQ_CST = 5, ///< Acquire and release with a single total order, the
+	                              ///<   ordering used by MTY_Atomic32Get et al.
+	MTY_MEMORY_ORDER_MAKE_32 = INT32_MAX,
+} MTY_MemoryOrder;
+
+/// @brief Scheduling priority of a thread.
+typedef enum {
+	MTY_THREAD_PRIORITY_NORMAL   = 0, ///< Default priority.
+	MTY_THREAD_PRIORITY_LOW      = 1, ///< Background work that should yield to everything else.
+	MTY_THREAD_PRIORITY_HIGH     = 2, ///< Latency sensitive work such as rendering.
+	MTY_THREAD_PRIORITY_REALTIME = 3, ///< Work with hard deadlines such as audio. On Linux this
+	                                  ///<   is `SCHED_FIFO`, which usually requires privileges.
+	MTY_THREAD_PRIORITY_MAKE_32  = INT32_MAX,
+} MTY_ThreadPriority;
+
+/// @brief Thread creation options.
+typedef struct {
+	const char *name;            ///< Name shown in debuggers and profilers, may be NULL.
+	                             ///<   Some platforms truncate it to 15 characters.
+	uint64_t affinity;           ///< Bitmask of logical processors the thread may run on,
+	                             ///<   or 0 for no restriction.
+	MTY_ThreadPriority priority; ///< Scheduling priority.
+	size_t stackSize;            ///< Stack size in bytes, or 0 for the system default.
+} MTY_ThreadDesc;
+
 /// @brief Create an MTY_Thread that executes asynchronously.
 /// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
 ///   The returned MTY_Thread must be destroyed with MTY_ThreadDestroy.
 MTY_EXPORT MTY_Thread *
 MTY_ThreadCreate(MTY_ThreadFunc func, void *opaque);
 
+/// @brief Create an MTY_Thread with a name, affinity, priority, and stack size.
+/// @details The name, affinity, and priority are applied by the new thread before
+///   `func` is called. If any of them can not be applied, the failure is logged and
+///   the thread runs anyway.
+/// @param func Function executed on the new thread.
+/// @param opaque Passed to `func`.
+/// @param desc Thread creation options.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned MTY_Thread must be destroyed with MTY_ThreadDestroy.
+MTY_EXPORT MTY_Thread *
+MTY_ThreadCreateEx(MTY_ThreadFunc func, void *opaque, const MTY_ThreadDesc *desc);
+
+/// @brief Set the name of the calling thread.
+/// @param name Name shown in debuggers and profilers.
+/// @returns Returns true on success, false if the name could not be set.
+MTY_EXPORT bool
+MTY_ThreadSetName(const char *name);
+
+/// @brief Restrict the calling thread to a set of logical processors.
+/// @param affinity Bitmask of logical processors the thread may run on. Processors
+///   beyond the first 64 are not addressable.
+/// @returns Returns true on success, false if the platform does not support pinning
+///   threads or the mask is invalid.
+MTY_EXPORT bool
+MTY_ThreadSetAffinity(uint64_t affinity);
+
+/// @brief Set the scheduling priority of the calling thread.
+/// @param priority Scheduling priority.
+/// @returns Returns true on success, false if the priority could not be set, usually
+///   because the process lacks the privileges to raise it.
+MTY_EXPORT bool
+MTY_ThreadSetPriority(MTY_ThreadPriority priority);
+
 /// @brief Wait until an MTY_Thread has finished executing then destroy it.
 MTY_EXPORT void *
 MTY_ThreadDestroy(MTY_Thread **thread);
@@ -1608,6 +2673,9 @@ MTY_EXPORT void
 MTY_CondSignalAll(MTY_Cond *ctx);
 
 /// @brief Create an MTY_RWLock that allows concurrent read access.
+/// @details Read and write locks may be taken recursively by the same thread, and a
+///   thread holding a read lock may request a write lock. Uncontended readers only
+///   touch a counter on their own cache line, so read heavy locks scale across cores.
 /// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
 ///   The returned MTY_RWLock must be destroyed with MTY_RWLockDestroy.
 MTY_EXPORT MTY_RWLock *
@@ -1681,6 +2749,95 @@ MTY_ThreadPoolDetach(MTY_ThreadPool *ctx, uint32_t index, MTY_AnonFunc detach);
 MTY_EXPORT MTY_Async
 MTY_ThreadPoolPoll(MTY_ThreadPool *ctx, uint32_t index, void **opaque);
 
+/// @brief Split a loop into ranges and run them in parallel.
+/// @details Ranges are executed by a set of persistent worker threads shared by the
+///   whole process, sized to the number of processors. The calling thread executes
+///   ranges as well, and runs other queued work while it waits, so MTY_ParallelFor
+///   may be nested or called from within a task.
+/// @param begin First iteration.
+/// @param end One past the last iteration.
+/// @param grain Number of iterations handed out at a time. If 0, a grain is chosen
+///   based on the number of processors.
+/// @param func Function called for each range, possibly concurrently.
+/// @param opaque Passed to `func`.
+MTY_EXPORT void
+MTY_ParallelFor(uint64_t begin, uint64_t end, uint64_t grain, MTY_ParallelForFunc func,
+	void *opaque);
+
+/// @brief Create an MTY_TaskGraph for running tasks with dependencies in parallel.
+/// @returns The returned MTY_TaskGraph must be destroyed with MTY_TaskGraphDestroy.
+MTY_EXPORT MTY_TaskGraph *
+MTY_TaskGraphCreate(void);
+
+/// @brief Destroy an MTY_TaskGraph.
+/// @details A submitted graph must be waited on via MTY_TaskGraphWait first.
+/// @param graph Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_TaskGraphDestroy(MTY_TaskGraph **graph);
+
+/// @brief Add a task to a graph.
+/// @details Tasks can not be added while the graph is running.
+/// @param ctx An MTY_TaskGraph.
+/// @param func Function run by the task.
+/// @param opaque Passed to `func`.
+/// @returns The task's identifier, used with MTY_TaskGraphDepend.
+MTY_EXPORT uint32_t
+MTY_TaskGraphAdd(MTY_TaskGraph *ctx, MTY_AnonFunc func, void *opaque);
+
+/// @brief Make a task wait for another task to finish before it starts.
+/// @details Dependencies must not form a cycle.
+/// @param ctx An MTY_TaskGraph.
+/// @param task Task that waits, returned by MTY_TaskGraphAdd.
+/// @param dependency Task that must run first, returned by MTY_TaskGraphAdd.
+MTY_EXPORT void
+MTY_TaskGraphDepend(MTY_TaskGraph *ctx, uint32_t task, uint32_t dependency);
+
+/// @brief Start running a graph's tasks on the worker threads used by MTY_ParallelFor.
+/// @details A graph may be submitted again after MTY_TaskGraphWait returns.
+/// @param ctx An MTY_TaskGraph.
+MTY_EXPORT void
+MTY_TaskGraphSubmit(MTY_TaskGraph *ctx);
+
+/// @brief Wait for every task in a submitted graph to finish.
+/// @details The calling thread runs queued work while it waits.
+/// @param ctx An MTY_TaskGraph.
+MTY_EXPORT void
+MTY_TaskGraphWait(MTY_TaskGraph *ctx);
+
+/// @brief Start a fiber on the calling thread.
+/// @details Fibers are cooperatively scheduled on the thread that started them and
+///   only execute inside MTY_FiberRun. A fiber that waits on network I/O through the
+///   Net module yields to the other fibers until the socket is ready or the timeout
+///   expires, so blocking style code can serve many connections on a single thread.\n\n
+///   Fibers are not available on the web or on 32-bit Unix architectures.
+/// @param func Function run by the fiber. The fiber ends when it returns.
+/// @param opaque Passed to `func`.
+/// @param stackSize Size of the fiber's stack in bytes. If 0, 256 KB is used.
+/// @returns On success returns true, otherwise false. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_FiberStart(MTY_AnonFunc func, void *opaque, size_t stackSize);
+
+/// @brief Run the calling thread's fibers until all of them have returned.
+/// @details Fibers may start other fibers while running. This function can not be
+///   called from a fiber.
+MTY_EXPORT void
+MTY_FiberRun(void);
+
+/// @brief Let the calling thread's other fibers run before continuing.
+/// @details Does nothing when called outside of a fiber.
+MTY_EXPORT void
+MTY_FiberYield(void);
+
+/// @brief Suspend the current fiber for a period of time.
+/// @details Behaves like MTY_Sleep when called outside of a fiber.
+/// @param timeout Time to sleep in milliseconds.
+MTY_EXPORT void
+MTY_FiberSleep(uint32_t timeout);
+
+/// @brief Check if the calling code is running inside a fiber.
+MTY_EXPORT bool
+MTY_FiberIsActive(void);
+
 /// @brief Set a 32-bit integer atomically.
 MTY_EXPORT void
 MTY_Atomic32Set(MTY_Atomic32 *atomic, int32_t value);
@@ -1717,6 +2874,318 @@ MTY_Atomic32CAS(MTY_Atomic32 *atomic, int32_t oldValue, int32_t newValue);
 MTY_EXPORT bool
 MTY_Atomic64CAS(MTY_Atomic64 *atomic, int64_t oldValue, int64_t newValue);
 
+/// @brief Load a 32-bit integer atomically with an explicit memory order.
+/// @details This and the other atomics taking an MTY_MemoryOrder are inlined on GCC
+///   and Clang, so a constant order selects the exact instruction sequence.
+/// @param atomic An MTY_Atomic32.
+/// @param order One of MTY_MEMORY_ORDER_RELAXED, MTY_MEMORY_ORDER_ACQUIRE, or
+///   MTY_MEMORY_ORDER_SEQ_CST.
+MTY_ATOMIC_API int32_t
+MTY_Atomic32Load(MTY_Atomic32 *atomic, MTY_MemoryOrder order);
+
+/// @brief Store a 32-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic32.
+/// @param value Value to store.
+/// @param order One of MTY_MEMORY_ORDER_RELAXED, MTY_MEMORY_ORDER_RELEASE, or
+///   MTY_MEMORY_ORDER_SEQ_CST.
+MTY_ATOMIC_API void
+MTY_Atomic32Store(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order);
+
+/// @brief Replace a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value New value.
+/// @param order Memory order.
+/// @returns The previous value.
+MTY_ATOMIC_API int32_t
+MTY_Atomic32Exchange(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order);
+
+/// @brief Add to a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value Value to add.
+/// @param order Memory order.
+/// @returns The value before the addition.
+MTY_ATOMIC_API int32_t
+MTY_Atomic32FetchAdd(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order);
+
+/// @brief Bitwise OR a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value Bits to set.
+/// @param order Memory order.
+/// @returns The value before the operation.
+MTY_ATOMIC_API int32_t
+MTY_Atomic32FetchOr(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order);
+
+/// @brief Bitwise AND a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value Mask of bits to keep.
+/// @param order Memory order.
+/// @returns The value before the operation.
+MTY_ATOMIC_API int32_t
+MTY_Atomic32FetchAnd(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order);
+
+/// @brief Bitwise XOR a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value Bits to toggle.
+/// @param order Memory order.
+/// @returns The value before the operation.
+MTY_ATOMIC_API int32_t
+MTY_Atomic32FetchXor(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order);
+
+/// @brief Compare a 32-bit integer with an expected value and if the same,
+///   atomically set it to a new value.
+/// @param atomic An MTY_Atomic32.
+/// @param expected Reference to the expected value. On failure, this is set to the
+///   current value so it can be used in the next attempt.
+/// @param desired Value to set if the comparison succeeds.
+/// @param order Memory order on success. On failure, the load uses the strongest
+///   order valid for a load that is no stronger than `order`.
+/// @returns If the atomic is set to `desired`, returns true, otherwise false.
+MTY_ATOMIC_API bool
+MTY_Atomic32CompareExchange(MTY_Atomic32 *atomic, int32_t *expected, int32_t desired, MTY_MemoryOrder order);
+
+/// @brief Load a 64-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic64.
+/// @param order One of MTY_MEMORY_ORDER_RELAXED, MTY_MEMORY_ORDER_ACQUIRE, or
+///   MTY_MEMORY_ORDER_SEQ_CST.
+MTY_ATOMIC_API int64_t
+MTY_Atomic64Load(MTY_Atomic64 *atomic, MTY_MemoryOrder order);
+
+/// @brief Store a 64-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic64.
+/// @param value Value to store.
+/// @param order One of MTY_MEMORY_ORDER_RELAXED, MTY_MEMORY_ORDER_RELEASE, or
+///   MTY_MEMORY_ORDER_SEQ_CST.
+MTY_ATOMIC_API void
+MTY_Atomic64Store(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order);
+
+/// @brief Replace a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value New value.
+/// @param order Memory order.
+/// @returns The previous value.
+MTY_ATOMIC_API int64_t
+MTY_Atomic64Exchange(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order);
+
+/// @brief Add to a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value Value to add.
+/// @param order Memory order.
+/// @returns The value before the addition.
+MTY_ATOMIC_API int64_t
+MTY_Atomic64FetchAdd(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order);
+
+/// @brief Bitwise OR a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value Bits to set.
+/// @param order Memory order.
+/// @returns The value before the operation.
+MTY_ATOMIC_API int64_t
+MTY_Atomic64FetchOr(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order);
+
+/// @brief Bitwise AND a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value Mask of bits to keep.
+/// @param order Memory order.
+/// @returns The value before the operation.
+MTY_ATOMIC_API int64_t
+MTY_Atomic64FetchAnd(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order);
+
+/// @brief Bitwise XOR a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value Bits to toggle.
+/// @param order Memory order.
+/// @returns The value before the operation.
+MTY_ATOMIC_API int64_t
+MTY_Atomic64FetchXor(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order);
+
+/// @brief Compare a 64-bit integer with an expected value and if the same,
+///   atomically set it to a new value.
+/// @param atomic An MTY_Atomic64.
+/// @param expected Reference to the expected value. On failure, this is set to the
+///   current value so it can be used in the next attempt.
+/// @param desired Value to set if the comparison succeeds.
+/// @param order Memory order on success. On failure, the load uses the strongest
+///   order valid for a load that is no stronger than `order`.
+/// @returns If the atomic is set to `desired`, returns true, otherwise false.
+MTY_ATOMIC_API bool
+MTY_Atomic64CompareExchange(MTY_Atomic64 *atomic, int64_t *expected, int64_t desired, MTY_MemoryOrder order);
+
+/// @brief Load a pointer atomically.
+/// @param atomic An MTY_AtomicPtr.
+/// @param order One of MTY_MEMORY_ORDER_RELAXED, MTY_MEMORY_ORDER_ACQUIRE, or
+///   MTY_MEMORY_ORDER_SEQ_CST.
+MTY_ATOMIC_API void *
+MTY_AtomicPtrLoad(MTY_AtomicPtr *atomic, MTY_MemoryOrder order);
+
+/// @brief Store a pointer atomically.
+/// @param atomic An MTY_AtomicPtr.
+/// @param value Pointer to store.
+/// @param order One of MTY_MEMORY_ORDER_RELAXED, MTY_MEMORY_ORDER_RELEASE, or
+///   MTY_MEMORY_ORDER_SEQ_CST.
+MTY_ATOMIC_API void
+MTY_AtomicPtrStore(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order);
+
+/// @brief Replace a pointer atomically.
+/// @param atomic An MTY_AtomicPtr.
+/// @param value New pointer.
+/// @param order Memory order.
+/// @returns The previous pointer.
+MTY_ATOMIC_API void *
+MTY_AtomicPtrExchange(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order);
+
+/// @brief Compare a pointer with an expected value and if the same, atomically set it
+///   to a new value.
+/// @param atomic An MTY_AtomicPtr.
+/// @param expected Reference to the expected pointer. On failure, this is set to the
+///   current pointer.
+/// @param desired Pointer to set if the comparison succeeds.
+/// @param order Memory order on success.
+/// @returns If the atomic is set to `desired`, returns true, otherwise false.
+MTY_ATOMIC_API bool
+MTY_AtomicPtrCompareExchange(MTY_AtomicPtr *atomic, void **expected, void *desired,
+	MTY_MemoryOrder order);
+
+/// @brief Compare a 128-bit value with an expected value and if the same, atomically
+///   set it to a new value.
+/// @details This is lock free on x86-64 and ARM64, elsewhere it is emulated with a
+///   lock. Because of this, MTY_Atomic128 values should only be modified via this
+///   function. Operations are sequentially consistent.
+/// @param atomic An MTY_Atomic128.
+/// @param expected Reference to the expected value. On failure, this is set to the
+///   current value, which is also the way to read an MTY_Atomic128 consistently.
+/// @param desired Value to set if the comparison succeeds.
+/// @returns If the atomic is set to `desired`, returns true, otherwise false.
+MTY_EXPORT bool
+MTY_Atomic128CompareExchange(MTY_Atomic128 *atomic, MTY_Atomic128 *expected, MTY_Atomic128 desired);
+
+/// @brief Issue a memory fence.
+/// @param order Memory order the fence enforces.
+MTY_ATOMIC_API void
+MTY_AtomicFence(MTY_MemoryOrder order);
+
+#if defined(MTY_ATOMIC_INLINE)
+
+// MTY_MemoryOrder values match the compiler's __ATOMIC_* constants. The failure order
+// of a compare and swap may not be stronger than the success order or include a release
+
+#define MTY_ATOMIC_FAIL_ORDER(order) \
+	((order) == MTY_MEMORY_ORDER_SEQ_CST ? __ATOMIC_SEQ_CST : \
+	(order) == MTY_MEMORY_ORDER_RELAXED || (order) == MTY_MEMORY_ORDER_RELEASE ? __ATOMIC_RELAXED : \
+	__ATOMIC_ACQUIRE)
+
+MTY_ATOMIC_API int32_t MTY_Atomic32Load(MTY_Atomic32 *atomic, MTY_MemoryOrder order)
+{
+	return __atomic_load_n(&atomic->value, order);
+}
+
+MTY_ATOMIC_API void MTY_Atomic32Store(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	__atomic_store_n(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int32_t MTY_Atomic32Exchange(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return __atomic_exchange_n(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int32_t MTY_Atomic32FetchAdd(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_add(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int32_t MTY_Atomic32FetchOr(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_or(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int32_t MTY_Atomic32FetchAnd(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_and(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int32_t MTY_Atomic32FetchXor(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_xor(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API bool MTY_Atomic32CompareExchange(MTY_Atomic32 *atomic, int32_t *expected, int32_t desired,
+	MTY_MemoryOrder order)
+{
+	return __atomic_compare_exchange_n(&atomic->value, expected, desired, false, order,
+		MTY_ATOMIC_FAIL_ORDER(order));
+}
+
+MTY_ATOMIC_API int64_t MTY_Atomic64Load(MTY_Atomic64 *atomic, MTY_MemoryOrder order)
+{
+	return __atomic_load_n(&atomic->value, order);
+}
+
+MTY_ATOMIC_API void MTY_Atomic64Store(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	__atomic_store_n(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int64_t MTY_Atomic64Exchange(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return __atomic_exchange_n(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int64_t MTY_Atomic64FetchAdd(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_add(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int64_t MTY_Atomic64FetchOr(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_or(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int64_t MTY_Atomic64FetchAnd(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_and(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API int64_t MTY_Atomic64FetchXor(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return __atomic_fetch_xor(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API bool MTY_Atomic64CompareExchange(MTY_Atomic64 *atomic, int64_t *expected, int64_t desired,
+	MTY_MemoryOrder order)
+{
+	return __atomic_compare_exchange_n(&atomic->value, expected, desired, false, order,
+		MTY_ATOMIC_FAIL_ORDER(order));
+}
+
+MTY_ATOMIC_API void *MTY_AtomicPtrLoad(MTY_AtomicPtr *atomic, MTY_MemoryOrder order)
+{
+	return __atomic_load_n(&atomic->value, order);
+}
+
+MTY_ATOMIC_API void MTY_AtomicPtrStore(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order)
+{
+	__atomic_store_n(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API void *MTY_AtomicPtrExchange(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order)
+{
+	return __atomic_exchange_n(&atomic->value, value, order);
+}
+
+MTY_ATOMIC_API bool MTY_AtomicPtrCompareExchange(MTY_AtomicPtr *atomic, void **expected, void *desired,
+	MTY_MemoryOrder order)
+{
+	return __atomic_compare_exchange_n(&atomic->value, expected, desired, false, order,
+		MTY_ATOMIC_FAIL_ORDER(order));
+}
+
+MTY_ATOMIC_API void MTY_AtomicFence(MTY_MemoryOrder order)
+{
+	__atomic_thread_fence(order);
+}
+
+#endif
+
 /// @brief Globally lock via an atomic that may be statically initialized to zero.
 MTY_EXPORT void
 MTY_GlobalLock(MTY_Atomic32 *lock);
@@ -1731,6 +3200,13 @@ MTY_GlobalUnlock(MTY_Atomic32 *lock);
 
 typedef int64_t MTY_Time;
 
+typedef struct MTY_TimerWheel MTY_TimerWheel;
+
+/// @brief Function called when a timer started via MTY_TimerWheelStart expires.
+/// @param timer The identifier returned by MTY_TimerWheelStart.
+/// @param opaque Pointer set via MTY_TimerWheelStart.
+typedef void (*MTY_TimerFunc)(uint64_t timer, void *opaque);
+
 /// @brief Get a high precision MTY_Time value.
 /// @details This value has at least microsecond precision.
 MTY_EXPORT MTY_Time
@@ -1743,26 +3219,285 @@ MTY_GetTime(void);
 MTY_EXPORT float
 MTY_TimeDiff(MTY_Time begin, MTY_Time end);
 
+/// @brief Get a monotonic timestamp in nanoseconds.
+/// @details The starting point is arbitrary but fixed for the life of the process, so
+///   differences between values are exact integer nanoseconds that don't lose
+///   precision as the process runs. On x86-64 Linux with an invariant TSC the
+///   counter is read directly after being calibrated against `CLOCK_MONOTONIC`.
+MTY_EXPORT int64_t
+MTY_GetTimeNs(void);
+
 /// @brief Suspend the current thread.
 /// @param timeout The number of milliseconds to sleep.
 //- #support Windows macOS Android Linux
 MTY_EXPORT void
 MTY_Sleep(uint32_t timeout);
 
+/// @brief Suspend the current thread until MTY_GetTimeNs reaches a deadline.
+/// @details The thread sleeps in the OS until shortly before the deadline, then spins
+///   for the remainder. The spin window adapts to how much the OS tends to oversleep
+///   on the calling thread, so wakeups are typically accurate to a few microseconds.
+/// @param deadline A value in the same units as MTY_GetTimeNs. If it has already
+///   passed the function returns immediately.
+//- #support Windows macOS Android Linux
+MTY_EXPORT void
+MTY_SleepUntil(int64_t deadline);
+
 /// @brief Set the sleep precision of all waitable objects.
-/// @details See `timeBeginPeriod` on Windows.
+/// @details See `timeBeginPeriod` on Windows. On Linux this minimizes the calling
+///   thread's timer slack via `PR_SET_TIMERSLACK`, which only affects that thread.
 /// @param res The desired precision in milliseconds. This can not be less than 1.
-//- #support Windows
+//- #support Windows Android Linux
 MTY_EXPORT void
 MTY_SetTimerResolution(uint32_t res);
 
 /// @brief Revert the precision set via MTY_SetTimerResolution.
-/// @details See `timeEndPeriod` on Windows.
+/// @details See `timeEndPeriod` on Windows. On Linux the calling thread's timer slack
+///   is returned to its default.
 /// @param res The value used for the most recent call to MTY_SetTimerResolution.
-//- #support Windows
+//- #support Windows Android Linux
 MTY_EXPORT void
 MTY_RevertTimerResolution(uint32_t res);
 
+/// @brief Create an MTY_TimerWheel for managing large numbers of timeouts.
+/// @details A hierarchical timing wheel: starting, resetting, and canceling a timer
+///   are O(1) regardless of how many timers are active, and expired timers are
+///   processed in batches by MTY_TimerWheelRun. All functions are thread safe.
+/// @param resolution Length of a wheel tick in milliseconds. Timers fire at most one
+///   tick late. Specifying 0 uses 1 millisecond.
+/// @returns The returned MTY_TimerWheel must be destroyed with MTY_TimerWheelDestroy.
+MTY_EXPORT MTY_TimerWheel *
+MTY_TimerWheelCreate(uint32_t resolution);
+
+/// @brief Destroy an MTY_TimerWheel. Pending timers are discarded without firing.
+/// @param wheel Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_TimerWheelDestroy(MTY_TimerWheel **wheel);
+
+/// @brief Start a one-shot timer.
+/// @param ctx An MTY_TimerWheel.
+/// @param timeout Milliseconds until the timer expires.
+/// @param func Function called from MTY_TimerWheelRun once the timer expires.
+/// @param opaque Passed to `func` when it is called.
+/// @returns A non-zero identifier for the timer. Identifiers of expired or canceled
+///   timers are never confused with new timers.
+MTY_EXPORT uint64_t
+MTY_TimerWheelStart(MTY_TimerWheel *ctx, uint32_t timeout, MTY_TimerFunc func, void *opaque);
+
+/// @brief Restart a pending timer with a new timeout, i.e. to push back an idle timeout.
+/// @param ctx An MTY_TimerWheel.
+/// @param timer Identifier returned by MTY_TimerWheelStart.
+/// @param timeout Milliseconds from now until the timer expires.
+/// @returns Returns true if the timer was pending, false if it already expired
+///   or was canceled.
+MTY_EXPORT bool
+MTY_TimerWheelReset(MTY_TimerWheel *ctx, uint64_t timer, uint32_t timeout);
+
+/// @brief Cancel a pending timer.
+/// @param ctx An MTY_TimerWheel.
+/// @param timer Identifier returned by MTY_TimerWheelStart.
+/// @returns Returns true if the timer was canceled before it expired, otherwise false.
+MTY_EXPORT bool
+MTY_TimerWheelCancel(MTY_TimerWheel *ctx, uint64_t timer);
+
+/// @brief Advance the wheel to the current time and fire all expired timers.
+/// @details Callbacks are called on the calling thread without any lock held, so
+///   they may start, reset, or cancel timers.
+/// @param ctx An MTY_TimerWheel.
+/// @returns The number of timers that fired.
+MTY_EXPORT uint32_t
+MTY_TimerWheelRun(MTY_TimerWheel *ctx);
+
+/// @brief Get the time until the next timer expires.
+/// @param ctx An MTY_TimerWheel.
+/// @returns Milliseconds until MTY_TimerWheelRun should next be called, suitable
+///   as a `poll` timeout. Timers far in the future may report an earlier time.
+///   Returns -1 if no timers are pending.
+MTY_EXPORT int32_t
+MTY_TimerWheelGetTimeout(MTY_TimerWheel *ctx);
+
+/// @brief Block until a timer is due, the wheel is woken, or a timeout elapses.
+/// @details Starting or resetting a timer from another thread wakes the waiter so
+///   it can recompute its deadline.
+/// @param ctx An MTY_TimerWheel.
+/// @param timeout Maximum time to wait in milliseconds, or -1 to wait indefinitely.
+/// @returns Returns true if timers are due and MTY_TimerWheelRun should be called.
+MTY_EXPORT bool
+MTY_TimerWheelWait(MTY_TimerWheel *ctx, int32_t timeout);
+
+/// @brief Wake a thread blocked in MTY_TimerWheelWait.
+/// @param ctx An MTY_TimerWheel.
+MTY_EXPORT void
+MTY_TimerWheelWake(MTY_TimerWheel *ctx);
+
+
+//- #module Trace
+//- #mbrief Lightweight instrumentation exported as Chrome trace events.
+
+#if !defined(MTY_NO_TRACE)
+	#define MTY_TraceBegin(name) \
+		MTY_TraceEvent(MTY_TRACE_EVENT_BEGIN, name, 0)
+
+	#define MTY_TraceEnd(name) \
+		MTY_TraceEvent(MTY_TRACE_EVENT_END, name, 0)
+
+	#define MTY_TraceCounter(name, value) \
+		MTY_TraceEvent(MTY_TRACE_EVENT_COUNTER, name, value)
+
+	#define MTY_TraceInstant(name) \
+		MTY_TraceEvent(MTY_TRACE_EVENT_INSTANT, name, 0)
+#else
+	#define MTY_TraceBegin(name)
+	#define MTY_TraceEnd(name)
+	#define MTY_TraceCounter(name, value)
+	#define MTY_TraceInstant(name)
+#endif
+
+/// @brief Kind of event recorded via MTY_TraceEvent.
+typedef enum {
+	MTY_TRACE_EVENT_BEGIN   = 0, ///< Start of a zone on the calling thread.
+	MTY_TRACE_EVENT_END     = 1, ///< End of the most recently begun zone on the calling thread.
+	MTY_TRACE_EVENT_COUNTER = 2, ///< A new value for a named counter.
+	MTY_TRACE_EVENT_INSTANT = 3, ///< A point in time on the calling thread.
+	MTY_TRACE_EVENT_MAKE_32 = INT32_MAX,
+} MTY_TraceEventType;
+
+/// @brief Begin recording trace events.
+/// @details Each thread records into its own buffer, allocated the first time it
+///   records an event, which keeps the most recent `maxEvents` events. Starting a new
+///   trace discards the events of the previous one. libmatoya itself records zones
+///   around rendering, HTTP requests, TLS, audio, and the MTY_AppRun loop.\n\n
+///   Define `MTY_NO_TRACE` before including matoya.h to compile the tracing macros
+///   out of your own code.
+/// @param maxEvents Number of events kept per thread. Specifying 0 uses 16384.
+MTY_EXPORT void
+MTY_TraceStart(uint32_t maxEvents);
+
+/// @brief Stop recording trace events.
+/// @details Recorded events are kept until the next call to MTY_TraceStart.
+MTY_EXPORT void
+MTY_TraceStop(void);
+
+/// @brief Record a trace event on the calling thread.
+/// @details This function is intended to be called via the `MTY_TraceBegin`,
+///   `MTY_TraceEnd`, `MTY_TraceCounter`, and `MTY_TraceInstant` macros. It does
+///   nothing unless a trace has been started, and never locks once the calling thread
+///   has its buffer.
+/// @param type The kind of event.
+/// @param name Name of the zone, counter, or instant. Only the pointer is stored, so
+///   it must remain valid until the trace is serialized. String literals do.
+/// @param value The counter's new value for MTY_TRACE_EVENT_COUNTER, otherwise ignored.
+MTY_EXPORT void
+MTY_TraceEvent(MTY_TraceEventType type, const char *name, double value);
+
+/// @brief Serialize the events of the current or most recent trace.
+/// @details The output is Chrome trace event JSON, which can be opened in
+///   `chrome://tracing` or Perfetto. Timestamps are in microseconds since
+///   MTY_TraceStart. Threads that keep recording while this function runs may have
+///   their newest events omitted, so the trace should normally be stopped first.
+/// @returns A null-terminated JSON string.\n\n
+///   The returned string must be destroyed with MTY_Free.
+MTY_EXPORT char *
+MTY_TraceSerialize(void);
+
+/// @brief Write the events of the current or most recent trace to a file.
+/// @details See MTY_TraceSerialize.
+/// @param path Path to the output file, usually with a `.json` extension.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_TraceExport(const char *path);
+
+
+//- #module Metrics
+//- #mbrief Process wide counters, gauges, and histograms.
+//- #mdetails Metrics live in a single registry for the life of the process and can be
+//-   serialized as JSON or in the Prometheus text exposition format. libmatoya registers
+//-   its own metrics prefixed with `mty_`, covering network traffic, TLS handshakes,
+//-   MTY_Queue depths, audio underruns, and presentation.
+
+typedef struct MTY_Metric MTY_Metric;
+
+/// @brief Kind of value a metric holds.
+typedef enum {
+	MTY_METRIC_TYPE_COUNTER   = 0, ///< A total that only increases until reset.
+	MTY_METRIC_TYPE_GAUGE     = 1, ///< A current value that can go up and down.
+	MTY_METRIC_TYPE_HISTOGRAM = 2, ///< A distribution of recorded values.
+	MTY_METRIC_TYPE_MAKE_32   = INT32_MAX,
+} MTY_MetricType;
+
+/// @brief Metrics serialization formats.
+typedef enum {
+	MTY_METRICS_FORMAT_JSON       = 0, ///< A JSON object keyed by metric name.
+	MTY_METRICS_FORMAT_PROMETHEUS = 1, ///< Prometheus text exposition format.
+	MTY_METRICS_FORMAT_MAKE_32    = INT32_MAX,
+} MTY_MetricsFormat;
+
+/// @brief Get a metric from the registry, creating it if it doesn't exist.
+/// @details Metrics are never destroyed, so the returned handle can be kept and used
+///   from any thread. Looking a metric up takes a lock, updating one does not.
+/// @param name Name of the metric, which must be a valid Prometheus metric name
+///   (`[a-zA-Z_:][a-zA-Z0-9_:]*`) of at most 63 characters.
+/// @param type The kind of metric. Must match the type the metric was created with.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.
+MTY_EXPORT MTY_Metric *
+MTY_MetricGet(const char *name, MTY_MetricType type);
+
+/// @brief Add to a counter or gauge.
+/// @details Counters are split into per-thread shards so that threads incrementing
+///   the same counter do not contend on a single cache line.
+/// @param ctx An MTY_Metric of type MTY_METRIC_TYPE_COUNTER or MTY_METRIC_TYPE_GAUGE.
+/// @param value Amount to add, negative values are only allowed for gauges.
+MTY_EXPORT void
+MTY_MetricAdd(MTY_Metric *ctx, int64_t value);
+
+/// @brief Set the current value of a gauge.
+/// @param ctx An MTY_Metric of type MTY_METRIC_TYPE_GAUGE.
+/// @param value The new value.
+MTY_EXPORT void
+MTY_MetricSet(MTY_Metric *ctx, int64_t value);
+
+/// @brief Record a value in a histogram.
+/// @details Values are counted in logarithmic buckets with 16 linear sub-buckets per
+///   power of two, so percentiles are accurate to within about 6%. Values of 2^41
+///   and above are counted in the highest bucket.
+/// @param ctx An MTY_Metric of type MTY_METRIC_TYPE_HISTOGRAM.
+/// @param value The value to record.
+MTY_EXPORT void
+MTY_MetricRecord(MTY_Metric *ctx, uint64_t value);
+
+/// @brief Get the current value of a metric.
+/// @param ctx An MTY_Metric.
+/// @returns The total for a counter, the current value for a gauge, or the number of
+///   recorded values for a histogram.
+MTY_EXPORT int64_t
+MTY_MetricGetValue(MTY_Metric *ctx);
+
+/// @brief Get a percentile of the values recorded in a histogram.
+/// @param ctx An MTY_Metric of type MTY_METRIC_TYPE_HISTOGRAM.
+/// @param percentile Percentile between 0 and 100.
+/// @returns The highest value that falls into the same bucket as the requested
+///   percentile, or 0 if nothing has been recorded.
+MTY_EXPORT uint64_t
+MTY_MetricGetPercentile(MTY_Metric *ctx, float percentile);
+
+/// @brief Take a snapshot of every metric in the registry.
+/// @details JSON output maps each counter and gauge name to its value and each
+///   histogram name to an object with `count`, `sum`, `max`, `p50`, `p90`, `p99`,
+///   and `p999`. Prometheus output emits histograms with cumulative buckets at each
+///   power of four.
+/// @param format The output format.
+/// @param reset Reset counters and histograms as they are read, so the next snapshot
+///   only covers what happened after this one. Gauges are never reset.
+/// @returns A null-terminated string.\n\n
+///   The returned string must be destroyed with MTY_Free.
+MTY_EXPORT char *
+MTY_MetricsSerialize(MTY_MetricsFormat format, bool reset);
+
+/// @brief Reset every counter and histogram in the registry to zero.
+/// @details Gauges keep their current values.
+MTY_EXPORT void
+MTY_MetricsReset(void);
+
 
 //- #module App
 //- #mbrief Application, window, and input management.
@@ -2691,6 +4426,8 @@ MTY_EXPORT MTY_Async
 MTY_WebSocketRead(MTY_WebSocket *ws, uint32_t timeout, char *msg, size_t size);
 
 /// @brief Write a message to a WebSocket.
+/// @details If the send buffer is full, this waits at most the `timeout` that was
+///   passed to MTY_WebSocketConnect or MTY_WebSocketAccept for it to drain.
 /// @param ws An MTY_WebSocket.
 /// @param msg The string message to send.
 /// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
@@ -122,46 +122,3 @@ wchar_t *MTY_MultiToWideD(const char *src)
 	return dst;
 }
 
-
-// Stable qsort
-
-struct element {
-	MTY_CompareFunc compare;
-	const void *orig;
-};
-
-static int32_t sort_compare(const void *a, const void *b)
-{
-	const struct element *element_a = a;
-	const struct element *element_b = b;
-
-	int32_t r = element_a->compare(element_a->orig, element_b->orig);
-
-	// If zero is returned from original comare, use the memory address as the tie breaker
-	return r != 0 ? r : (int32_t) ((uint8_t *) element_a->orig - (uint8_t *) element_b->orig);
-}
-
-void MTY_Sort(void *base, size_t nElements, size_t size, MTY_CompareFunc func)
-{
-	// Temporary copy of the base array for wrapping
-	uint8_t *tmp = MTY_Alloc(nElements, size);
-	memcpy(tmp, base, nElements * size);
-
-	// Wrap the base array elements in a struct now with 'orig' memory addresses in ascending order
-	struct element *wrapped = MTY_Alloc(nElements, sizeof(struct element));
-
-	for (size_t x = 0; x < nElements; x++) {
-		wrapped[x].compare = func;
-		wrapped[x].orig = tmp + x * size;
-	}
-
-	// Perform qsort using the original compare function, falling back to memory address comparison
-	qsort(wrapped, nElements, sizeof(struct element), sort_compare);
-
-	// Copy the reordered elements back to the base array
-	for (size_t x = 0; x < nElements; x++)
-		memcpy((uint8_t *) base + x * size, wrapped[x].orig, size);
-
-	MTY_Free(tmp);
-	MTY_Free(wrapped);
-}
@@ -0,0 +1,518 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+#include "metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "tlocal.h"
+#include "atomic.h"
+
+// Counters are spread over cache line sized shards, each thread picks one the first
+// time it updates a metric. Histograms count values in log bucketed sub-ranges like
+// HdrHistogram: values below 16 get a bucket each, every power of two above that is
+// split into 16 linear buckets. The bucket counters are shared between threads, but
+// a stream of different values rarely hits the same one, the running sum lives in the
+// shards like a counter.
+
+#define METRIC_NAME_MAX  64
+#define METRIC_SHARDS    8
+#define METRIC_LINE      64
+#define METRIC_SUB_BITS  4
+#define METRIC_SUB       (1 << METRIC_SUB_BITS)
+#define METRIC_MAX_EXP   40
+#define METRIC_BUCKETS   ((METRIC_MAX_EXP - METRIC_SUB_BITS + 2) * METRIC_SUB)
+#define METRIC_MAX_VALUE ((UINT64_C(1) << (METRIC_MAX_EXP + 1)) - 1)
+
+struct metric_shard {
+	MTY_Atomic64 value;
+	uint8_t pad[METRIC_LINE - sizeof(MTY_Atomic64)];
+};
+
+struct MTY_Metric {
+	char name[METRIC_NAME_MAX];
+	MTY_MetricType type;
+
+	struct metric_shard shards[METRIC_SHARDS];
+	MTY_Atomic64 max;
+	MTY_Atomic64 *buckets;
+};
+
+struct metric_snapshot {
+	int64_t value;
+	int64_t sum;
+	int64_t max;
+	int64_t count;
+	int64_t buckets[METRIC_BUCKETS];
+};
+
+struct metric_output {
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+static MTY_Atomic64 METRIC_BUCKETS_TLS_HANDSHAKE[METRIC_BUCKETS];
+static MTY_Atomic64 METRIC_BUCKETS_QUEUE_DEPTH[METRIC_BUCKETS];
+static MTY_Atomic64 METRIC_BUCKETS_PRESENT_INTERVAL[METRIC_BUCKETS];
+
+static struct MTY_Metric METRIC_BUILTIN[METRIC_MAX] = {
+	[METRIC_NET_SENT] = {
+		.name = "mty_net_sent_bytes_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+	[METRIC_NET_RECEIVED] = {
+		.name = "mty_net_received_bytes_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+	[METRIC_NET_CONNECTIONS] = {
+		.name = "mty_net_connections_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+	[METRIC_TLS_HANDSHAKE] = {
+		.name = "mty_tls_handshake_ns",
+		.type = MTY_METRIC_TYPE_HISTOGRAM,
+		.buckets = METRIC_BUCKETS_TLS_HANDSHAKE,
+	},
+	[METRIC_TLS_FAILURES] = {
+		.name = "mty_tls_handshake_failures_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+	[METRIC_QUEUE_DEPTH] = {
+		.name = "mty_queue_depth",
+		.type = MTY_METRIC_TYPE_HISTOGRAM,
+		.buckets = METRIC_BUCKETS_QUEUE_DEPTH,
+	},
+	[METRIC_QUEUE_FULL] = {
+		.name = "mty_queue_full_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+	[METRIC_AUDIO_UNDERRUNS] = {
+		.name = "mty_audio_underruns_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+	[METRIC_AUDIO_OVERFLOWS] = {
+		.name = "mty_audio_overflows_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+	[METRIC_PRESENT_INTERVAL] = {
+		.name = "mty_present_interval_ns",
+		.type = MTY_METRIC_TYPE_HISTOGRAM,
+		.buckets = METRIC_BUCKETS_PRESENT_INTERVAL,
+	},
+	[METRIC_FRAMES_DROPPED] = {
+		.name = "mty_frames_dropped_total",
+		.type = MTY_METRIC_TYPE_COUNTER,
+	},
+};
+
+static MTY_Atomic32 METRIC_LOCK;
+static MTY_Atomic32 METRIC_THREADS;
+static MTY_Metric **METRIC_REGISTRY;
+static uint32_t METRIC_LEN;
+
+static TLOCAL uint32_t METRIC_SHARD;
+
+
+// Buckets
+
+static uint32_t metric_log2(uint64_t value)
+{
+	uint32_t r = 0;
+
+	for (uint32_t shift = 32; shift > 0; shift >>= 1) {
+		if (value >> shift) {
+			value >>= shift;
+			r += shift;
+		}
+	}
+
+	return r;
+}
+
+static uint32_t metric_bucket(uint64_t value)
+{
+	if (value > METRIC_MAX_VALUE)
+		value = METRIC_MAX_VALUE;
+
+	if (value < METRIC_SUB)
+		return (uint32_t) value;
+
+	uint32_t e = metric_log2(value);
+
+	return (e - METRIC_SUB_BITS + 1) * METRIC_SUB +
+		(uint32_t) ((value >> (e - METRIC_SUB_BITS)) & (METRIC_SUB - 1));
+}
+
+static uint64_t metric_bucket_high(uint32_t bucket)
+{
+	if (bucket < METRIC_SUB)
+		return bucket;
+
+	uint32_t shift = bucket / METRIC_SUB - 1;
+	uint64_t low = (uint64_t) (METRIC_SUB + bucket % METRIC_SUB) << shift;
+
+	return low + (UINT64_C(1) << shift) - 1;
+}
+
+
+// Updates
+
+static uint32_t metric_shard(void)
+{
+	if (METRIC_SHARD == 0)
+		METRIC_SHARD = (uint32_t) mty_atomic32_fetch_add(&METRIC_THREADS, 1, MTY_MEMORY_ORDER_RELAXED) % METRIC_SHARDS + 1;
+
+	return METRIC_SHARD - 1;
+}
+
+static void metric_add(MTY_Metric *ctx, int64_t value)
+{
+	uint32_t shard = ctx->type == MTY_METRIC_TYPE_GAUGE ? 0 : metric_shard();
+
+	mty_atomic64_fetch_add(&ctx->shards[shard].value, value, MTY_MEMORY_ORDER_RELAXED);
+}
+
+static void metric_record(MTY_Metric *ctx, uint64_t value)
+{
+	int64_t v = value > INT64_MAX ? INT64_MAX : (int64_t) value;
+
+	mty_atomic64_fetch_add(&ctx->buckets[metric_bucket(value)], 1, MTY_MEMORY_ORDER_RELAXED);
+	mty_atomic64_fetch_add(&ctx->shards[metric_shard()].value, v, MTY_MEMORY_ORDER_RELAXED);
+
+	int64_t max = mty_atomic64_load(&ctx->max, MTY_MEMORY_ORDER_RELAXED);
+
+	while (v > max && !mty_atomic64_cas(&ctx->max, &max, v, MTY_MEMORY_ORDER_RELAXED));
+}
+
+void mty_metric_add(enum metric metric, int64_t value)
+{
+	metric_add(&METRIC_BUILTIN[metric], value);
+}
+
+void mty_metric_record(enum metric metric, uint64_t value)
+{
+	metric_record(&METRIC_BUILTIN[metric], value);
+}
+
+void MTY_MetricAdd(MTY_Metric *ctx, int64_t value)
+{
+	if (ctx->type == MTY_METRIC_TYPE_HISTOGRAM) {
+		MTY_Log("'%s' is a histogram, use MTY_MetricRecord", ctx->name);
+		return;
+	}
+
+	metric_add(ctx, value);
+}
+
+void MTY_MetricSet(MTY_Metric *ctx, int64_t value)
+{
+	if (ctx->type != MTY_METRIC_TYPE_GAUGE) {
+		MTY_Log("'%s' is not a gauge", ctx->name);
+		return;
+	}
+
+	mty_atomic64_store(&ctx->shards[0].value, value, MTY_MEMORY_ORDER_RELAXED);
+}
+
+void MTY_MetricRecord(MTY_Metric *ctx, uint64_t value)
+{
+	if (ctx->type != MTY_METRIC_TYPE_HISTOGRAM) {
+		MTY_Log("'%s' is not a histogram", ctx->name);
+		return;
+	}
+
+	metric_record(ctx, value);
+}
+
+
+// Snapshots
+
+static int64_t metric_read(MTY_Atomic64 *atomic, bool reset)
+{
+	return reset ? mty_atomic64_exchange(atomic, 0, MTY_MEMORY_ORDER_RELAXED) :
+		mty_atomic64_load(atomic, MTY_MEMORY_ORDER_RELAXED);
+}
+
+static void metric_snapshot(MTY_Metric *ctx, struct metric_snapshot *s, bool reset)
+{
+	memset(s, 0, sizeof(struct metric_snapshot));
+
+	// Gauges are a current state rather than an accumulation, so they're never reset
+	if (ctx->type == MTY_METRIC_TYPE_GAUGE) {
+		s->value = metric_read(&ctx->shards[0].value, false);
+		return;
+	}
+
+	for (uint32_t x = 0; x < METRIC_SHARDS; x++)
+		s->value += metric_read(&ctx->shards[x].value, reset);
+
+	if (ctx->type == MTY_METRIC_TYPE_HISTOGRAM) {
+		s->sum = s->value;
+		s->max = metric_read(&ctx->max, reset);
+
+		for (uint32_t x = 0; x < METRIC_BUCKETS; x++) {
+			s->buckets[x] = metric_read(&ctx->buckets[x], reset);
+			s->count += s->buckets[x];
+		}
+
+		s->value = s->count;
+	}
+}
+
+static uint64_t metric_percentile(const struct metric_snapshot *s, double percentile)
+{
+	if (s->count == 0)
+		return 0;
+
+	int64_t target = (int64_t) (percentile / 100.0 * (double) s->count + 0.5);
+	target = MTY_MAX(target, 1);
+
+	int64_t seen = 0;
+
+	for (uint32_t x = 0; x < METRIC_BUCKETS; x++) {
+		seen += s->buckets[x];
+
+		if (seen >= target)
+			return metric_bucket_high(x);
+	}
+
+	return metric_bucket_high(METRIC_BUCKETS - 1);
+}
+
+int64_t MTY_MetricGetValue(MTY_Metric *ctx)
+{
+	struct metric_snapshot *s = MTY_Alloc(1, sizeof(struct metric_snapshot));
+
+	metric_snapshot(ctx, s, false);
+	int64_t value = s->value;
+
+	MTY_Free(s);
+
+	return value;
+}
+
+uint64_t MTY_MetricGetPercentile(MTY_Metric *ctx, float percentile)
+{
+	if (ctx->type != MTY_METRIC_TYPE_HISTOGRAM) {
+		MTY_Log("'%s' is not a histogram", ctx->name);
+		return 0;
+	}
+
+	struct metric_snapshot *s = MTY_Alloc(1, sizeof(struct metric_snapshot));
+
+	metric_snapshot(ctx, s, false);
+	uint64_t value = metric_percentile(s, percentile);
+
+	MTY_Free(s);
+
+	return value;
+}
+
+
+// Registry
+
+static void metric_register(MTY_Metric *ctx)
+{
+	METRIC_REGISTRY = MTY_Realloc(METRIC_REGISTRY, METRIC_LEN + 1, sizeof(MTY_Metric *));
+	METRIC_REGISTRY[METRIC_LEN++] = ctx;
+}
+
+static void metric_registry_init(void)
+{
+	if (METRIC_LEN > 0)
+		return;
+
+	for (uint32_t x = 0; x < METRIC_MAX; x++)
+		metric_register(&METRIC_BUILTIN[x]);
+}
+
+static bool metric_valid_name(const char *name)
+{
+	size_t len = strlen(name);
+
+	if (len == 0 || len >= METRIC_NAME_MAX)
+		return false;
+
+	for (size_t x = 0; x < len; x++) {
+		char c = name[x];
+
+		bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+		bool digit = c >= '0' && c <= '9';
+
+		if (!alpha && (!digit || x == 0))
+			return false;
+	}
+
+	return true;
+}
+
+MTY_Metric *MTY_MetricGet(const char *name, MTY_MetricType type)
+{
+	if (!metric_valid_name(name)) {
+		MTY_Log("'%s' is not a valid metric name", name);
+		return NULL;
+	}
+
+	MTY_Metric *ctx = NULL;
+
+	MTY_GlobalLock(&METRIC_LOCK);
+
+	metric_registry_init();
+
+	for (uint32_t x = 0; x < METRIC_LEN; x++) {
+		if (!strcmp(METRIC_REGISTRY[x]->name, name)) {
+			ctx = METRIC_REGISTRY[x];
+			break;
+		}
+	}
+
+	if (ctx && ctx->type != type) {
+		MTY_Log("Metric '%s' already exists with a different type", name);
+		ctx = NULL;
+
+	} else if (!ctx) {
+		ctx = MTY_Alloc(1, sizeof(MTY_Metric));
+		snprintf(ctx->name, METRIC_NAME_MAX, "%s", name);
+		ctx->type = type;
+
+		if (type == MTY_METRIC_TYPE_HISTOGRAM)
+			ctx->buckets = MTY_Alloc(METRIC_BUCKETS, sizeof(MTY_Atomic64));
+
+		metric_register(ctx);
+	}
+
+	MTY_GlobalUnlock(&METRIC_LOCK);
+
+	return ctx;
+}
+
+void MTY_MetricsReset(void)
+{
+	struct metric_snapshot *s = MTY_Alloc(1, sizeof(struct metric_snapshot));
+
+	MTY_GlobalLock(&METRIC_LOCK);
+
+	metric_registry_init();
+
+	for (uint32_t x = 0; x < METRIC_LEN; x++)
+		metric_snapshot(METRIC_REGISTRY[x], s, true);
+
+	MTY_GlobalUnlock(&METRIC_LOCK);
+
+	MTY_Free(s);
+}
+
+
+// Serialization
+
+static void metric_write(struct metric_output *out, const char *fmt, ...)
+{
+	while (true) {
+		va_list args;
+		va_start(args, fmt);
+		int32_t r = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+		va_end(args);
+
+		if (r < 0)
+			return;
+
+		if (out->len + r < out->size) {
+			out->len += r;
+			return;
+		}
+
+		out->size = MTY_MAX(out->size * 2, out->len + r + 1);
+		out->buf = MTY_Realloc(out->buf, out->size, 1);
+	}
+}
+
+static void metric_write_json(struct metric_output *out, MTY_Metric *ctx, const struct metric_snapshot *s,
+	bool first)
+{
+	metric_write(out, "%s\n\"%s\":", first ? "" : ",", ctx->name);
+
+	if (ctx->type != MTY_METRIC_TYPE_HISTOGRAM) {
+		metric_write(out, "%" PRId64, s->value);
+		return;
+	}
+
+	metric_write(out, "{\"count\":%" PRId64 ",\"sum\":%" PRId64 ",\"max\":%" PRId64, s->count, s->sum, s->max);
+	metric_write(out, ",\"p50\":%" PRIu64 ",\"p90\":%" PRIu64 ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64 "}",
+		metric_percentile(s, 50), metric_percentile(s, 90), metric_percentile(s, 99), metric_percentile(s, 99.9));
+}
+
+static void metric_write_prometheus(struct metric_output *out, MTY_Metric *ctx, const struct metric_snapshot *s)
+{
+	static const char *TYPES[] = {"counter", "gauge", "histogram"};
+
+	metric_write(out, "# TYPE %s %s\n", ctx->name, TYPES[ctx->type]);
+
+	if (ctx->type != MTY_METRIC_TYPE_HISTOGRAM) {
+		metric_write(out, "%s %" PRId64 "\n", ctx->name, s->value);
+		return;
+	}
+
+	// Every power of four lines up with a bucket boundary, values are integers so
+	// the largest value below it is an exact upper bound
+	int64_t cumulative = 0;
+	uint32_t bucket = 0;
+
+	for (uint32_t shift = 0; shift <= METRIC_MAX_EXP; shift += 2) {
+		uint64_t le = (UINT64_C(1) << shift) - 1;
+
+		for (; bucket < METRIC_BUCKETS && metric_bucket_high(bucket) <= le; bucket++)
+			cumulative += s->buckets[bucket];
+
+		metric_write(out, "%s_bucket{le=\"%" PRIu64 "\"} %" PRId64 "\n", ctx->name, le, cumulative);
+	}
+
+	metric_write(out, "%s_bucket{le=\"+Inf\"} %" PRId64 "\n", ctx->name, s->count);
+	metric_write(out, "%s_sum %" PRId64 "\n", ctx->name, s->sum);
+	metric_write(out, "%s_count %" PRId64 "\n", ctx->name, s->count);
+}
+
+char *MTY_MetricsSerialize(MTY_MetricsFormat format, bool reset)
+{
+	struct metric_output out = {0};
+	out.size = 4096;
+	out.buf = MTY_Alloc(out.size, 1);
+
+	struct metric_snapshot *s = MTY_Alloc(1, sizeof(struct metric_snapshot));
+
+	bool json = format == MTY_METRICS_FORMAT_JSON;
+
+	if (json)
+		metric_write(&out, "{");
+
+	MTY_GlobalLock(&METRIC_LOCK);
+
+	metric_registry_init();
+
+	for (uint32_t x = 0; x < METRIC_LEN; x++) {
+		MTY_Metric *ctx = METRIC_REGISTRY[x];
+		metric_snapshot(ctx, s, reset);
+
+		if (json) {
+			metric_write_json(&out, ctx, s, x == 0);
+
+		} else {
+			metric_write_prometheus(&out, ctx, s);
+		}
+	}
+
+	MTY_GlobalUnlock(&METRIC_LOCK);
+
+	if (json)
+		metric_write(&out, "\n}\n");
+
+	MTY_Free(s);
+
+	return out.buf;
+}
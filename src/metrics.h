@@ -0,0 +1,27 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include "matoya.h"
+
+enum metric {
+	METRIC_NET_SENT = 0,
+	METRIC_NET_RECEIVED,
+	METRIC_NET_CONNECTIONS,
+	METRIC_TLS_HANDSHAKE,
+	METRIC_TLS_FAILURES,
+	METRIC_QUEUE_DEPTH,
+	METRIC_QUEUE_FULL,
+	METRIC_AUDIO_UNDERRUNS,
+	METRIC_AUDIO_OVERFLOWS,
+	METRIC_PRESENT_INTERVAL,
+	METRIC_FRAMES_DROPPED,
+	METRIC_MAX,
+};
+
+void mty_metric_add(enum metric metric, int64_t value);
+void mty_metric_record(enum metric metric, uint64_t value);
@@ -293,20 +293,22 @@ struct http_header *mty_http_read_header(struct net *net, uint32_t timeout)
 	return h;
 }
 
-bool mty_http_write_response_header(struct net *net, const char *code, const char *reason, const char *headers)
+bool mty_http_write_response_header(struct net *net, const char *code, const char *reason, const char *headers,
+	uint32_t timeout)
 {
 	char *hstr = http_response(code, reason, headers);
-	bool r = mty_net_write(net, hstr, strlen(hstr));
+	bool r = mty_net_write(net, hstr, strlen(hstr), timeout);
 
 	MTY_Free(hstr);
 
 	return r;
 }
 
-bool mty_http_write_request_header(struct net *net, const char *method, const char *path, const char *headers)
+bool mty_http_write_request_header(struct net *net, const char *method, const char *path, const char *headers,
+	uint32_t timeout)
 {
 	char *hstr = http_request(method, mty_net_get_host(net), path, headers);
-	bool r = mty_net_write(net, hstr, strlen(hstr));
+	bool r = mty_net_write(net, hstr, strlen(hstr), timeout);
 
 	MTY_Free(hstr);
 
@@ -483,7 +485,7 @@ bool mty_http_proxy_connect(struct net *net, uint16_t port, uint32_t timeout)
 	char *h = http_connect(mty_net_get_host(net), port, NULL);
 
 	// Write the header to the HTTP client/server
-	bool r = mty_net_write(net, h, strlen(h));
+	bool r = mty_net_write(net, h, strlen(h), timeout);
 	MTY_Free(h);
 
 	if (!r)
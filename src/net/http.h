@@ -28,8 +28,10 @@ void mty_http_set_header_str(char **header, const char *name, const char *val);
 void mty_http_parse_headers(const char *all, HTTP_PARSE_FUNC func, void *opaque);
 
 struct http_header *mty_http_read_header(struct net *net, uint32_t timeout);
-bool mty_http_write_response_header(struct net *net, const char *code, const char *reason, const char *headers);
-bool mty_http_write_request_header(struct net *net, const char *method, const char *path, const char *headers);
+bool mty_http_write_response_header(struct net *net, const char *code, const char *reason, const char *headers,
+	uint32_t timeout);
+bool mty_http_write_request_header(struct net *net, const char *method, const char *path, const char *headers,
+	uint32_t timeout);
 
 const char *mty_http_get_proxy(void);
 bool mty_http_should_proxy(const char **host, uint16_t *port);
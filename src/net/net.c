@@ -13,6 +13,7 @@
 #include "tcp.h"
 #include "http.h"
 #include "secure.h"
+#include "metrics.h"
 
 struct net {
 	char *host;
@@ -61,8 +62,12 @@ struct net *mty_net_connect(const char *host, uint16_t port, bool secure, uint32
 
 	except:
 
-	if (!r)
+	if (r) {
+		mty_metric_add(METRIC_NET_CONNECTIONS, 1);
+
+	} else {
 		mty_net_destroy(&ctx);
+	}
 
 	return ctx;
 }
@@ -91,6 +96,8 @@ struct net *mty_net_accept(struct net *ctx, uint32_t timeout)
 		child->host = MTY_Strdup(ctx->host);
 		child->tcp = tcp;
 
+		mty_metric_add(METRIC_NET_CONNECTIONS, 1);
+
 		return child;
 	}
 
@@ -118,16 +125,26 @@ MTY_Async mty_net_poll(struct net *ctx, uint32_t timeout)
 	return mty_tcp_poll(ctx->tcp, false, timeout);
 }
 
-bool mty_net_write(struct net *ctx, const void *buf, size_t size)
+bool mty_net_write(struct net *ctx, const void *buf, size_t size, uint32_t timeout)
 {
-	return ctx->sec ? mty_secure_write(ctx->sec, ctx->tcp, buf, size) :
-		mty_tcp_write(ctx->tcp, buf, size);
+	bool r = ctx->sec ? mty_secure_write(ctx->sec, ctx->tcp, buf, size, timeout) :
+		mty_tcp_write(ctx->tcp, buf, size, timeout);
+
+	if (r)
+		mty_metric_add(METRIC_NET_SENT, size);
+
+	return r;
 }
 
 bool mty_net_read(struct net *ctx, void *buf, size_t size, uint32_t timeout)
 {
-	return ctx->sec ? mty_secure_read(ctx->sec, ctx->tcp, buf, size, timeout) :
+	bool r = ctx->sec ? mty_secure_read(ctx->sec, ctx->tcp, buf, size, timeout) :
 		mty_tcp_read(ctx->tcp, buf, size, timeout);
+
+	if (r)
+		mty_metric_add(METRIC_NET_RECEIVED, size);
+
+	return r;
 }
 
 const char *mty_net_get_host(struct net *ctx)
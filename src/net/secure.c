@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "metrics.h"
+
 #define SECURE_PADDING (32 * 1024)
 
 struct secure {
@@ -23,6 +25,11 @@ struct secure {
 	size_t pending;
 };
 
+struct secure_io {
+	struct tcp *tcp;
+	uint32_t timeout;
+};
+
 void mty_secure_destroy(struct secure **secure)
 {
 	if (!secure || !*secure)
@@ -62,11 +69,16 @@ static bool secure_read_message(struct secure *ctx, struct tcp *tcp, uint32_t ti
 
 static bool secure_write_callback(const void *buf, size_t size, void *opaque)
 {
-	return mty_tcp_write((struct tcp *) opaque, buf, size);
+	struct secure_io *io = opaque;
+
+	return mty_tcp_write(io->tcp, buf, size, io->timeout);
 }
 
 struct secure *mty_secure_connect(struct tcp *tcp, const char *host, uint32_t timeout)
 {
+	MTY_TraceBegin("mty_secure_connect");
+
+	int64_t start = MTY_GetTimeNs();
 	bool r = true;
 
 	struct secure *ctx = MTY_Alloc(1, sizeof(struct secure));
@@ -82,7 +94,8 @@ struct secure *mty_secure_connect(struct tcp *tcp, const char *host, uint32_t ti
 	}
 
 	// Handshake part 1 (->Client Hello) -- Initiate with NULL message
-	MTY_Async a = MTY_TLSHandshake(ctx->tls, NULL, 0, secure_write_callback, tcp);
+	struct secure_io io = {tcp, timeout};
+	MTY_Async a = MTY_TLSHandshake(ctx->tls, NULL, 0, secure_write_callback, &io);
 	if (a != MTY_ASYNC_CONTINUE) {
 		r = false;
 		goto except;
@@ -95,20 +108,27 @@ struct secure *mty_secure_connect(struct tcp *tcp, const char *host, uint32_t ti
 		if (!r)
 			break;
 
-		a = MTY_TLSHandshake(ctx->tls, ctx->buf, size, secure_write_callback, tcp);
+		a = MTY_TLSHandshake(ctx->tls, ctx->buf, size, secure_write_callback, &io);
 		if (a == MTY_ASYNC_ERROR)
 			r = false;
 	}
 
 	except:
 
-	if (!r)
+	if (r) {
+		mty_metric_record(METRIC_TLS_HANDSHAKE, MTY_GetTimeNs() - start);
+
+	} else {
+		mty_metric_add(METRIC_TLS_FAILURES, 1);
 		mty_secure_destroy(&ctx);
+	}
+
+	MTY_TraceEnd("mty_secure_connect");
 
 	return ctx;
 }
 
-bool mty_secure_write(struct secure *ctx, struct tcp *tcp, const void *buf, size_t size)
+bool mty_secure_write(struct secure *ctx, struct tcp *tcp, const void *buf, size_t size, uint32_t timeout)
 {
 	// Output buffer will be slightly larger than input
 	if (ctx->buf_size < size + SECURE_PADDING) {
@@ -116,16 +136,19 @@ bool mty_secure_write(struct secure *ctx, struct tcp *tcp, const void *buf, size
 		ctx->buf = MTY_Realloc(ctx->buf, ctx->buf_size, 1);
 	}
 
-	// Encrypt
+	MTY_TraceBegin("mty_secure_write");
+
+	// Encrypt, then write the resulting encrypted message via TCP
 	size_t written = 0;
-	if (!MTY_TLSEncrypt(ctx->tls, buf, size, ctx->buf, ctx->buf_size, &written))
-		return false;
+	bool r = MTY_TLSEncrypt(ctx->tls, buf, size, ctx->buf, ctx->buf_size, &written) &&
+		mty_tcp_write(tcp, ctx->buf, written, timeout);
 
-	// Write resulting encrypted message via TCP
-	return mty_tcp_write(tcp, ctx->buf, written);
+	MTY_TraceEnd("mty_secure_write");
+
+	return r;
 }
 
-bool mty_secure_read(struct secure *ctx, struct tcp *tcp, void *buf, size_t size, uint32_t timeout)
+static bool secure_read(struct secure *ctx, struct tcp *tcp, void *buf, size_t size, uint32_t timeout)
 {
 	while (ctx->pending < size) {
 		// We need more data, read a TLS message from the socket
@@ -156,3 +179,14 @@ bool mty_secure_read(struct secure *ctx, struct tcp *tcp, void *buf, size_t size
 
 	return true;
 }
+
+bool mty_secure_read(struct secure *ctx, struct tcp *tcp, void *buf, size_t size, uint32_t timeout)
+{
+	MTY_TraceBegin("mty_secure_read");
+
+	bool r = secure_read(ctx, tcp, buf, size, timeout);
+
+	MTY_TraceEnd("mty_secure_read");
+
+	return r;
+}
@@ -10,6 +10,7 @@
 #include <string.h>
 
 #include "net/sock.h"
+#include "fiber.h"
 
 struct tcp {
 	SOCKET s;
@@ -197,6 +198,10 @@ void mty_tcp_destroy(struct tcp **tcp)
 
 MTY_Async mty_tcp_poll(struct tcp *ctx, bool out, uint32_t timeout)
 {
+	// Fibers yield to the thread's other fibers instead of blocking it
+	if (MTY_FiberIsActive())
+		return mty_fiber_poll(ctx->s, out, (int32_t) timeout);
+
 	struct pollfd fd = {0};
 	fd.events = out ? POLLOUT : POLLIN;
 	fd.fd = ctx->s;
@@ -206,15 +211,19 @@ MTY_Async mty_tcp_poll(struct tcp *ctx, bool out, uint32_t timeout)
 	return e == 0 ? MTY_ASYNC_CONTINUE : e < 0 ? MTY_ASYNC_ERROR : MTY_ASYNC_OK;
 }
 
-bool mty_tcp_write(struct tcp *ctx, const void *buf, size_t size)
+bool mty_tcp_write(struct tcp *ctx, const void *buf, size_t size, uint32_t timeout)
 {
 	for (size_t total = 0; total < size;) {
 		int32_t n = send(ctx->s, (const char *) buf + total, (int32_t) (size - total), 0);
 
-		if (n <= 0)
-			return false;
+		if (n <= 0) {
+			// The send buffer is full, wait for the peer to drain it
+			if (SOCK_ERROR != SOCK_WOULD_BLOCK || mty_tcp_poll(ctx, true, timeout) != MTY_ASYNC_OK)
+				return false;
 
-		total += n;
+		} else {
+			total += n;
+		}
 	}
 
 	return true;
@@ -26,6 +26,7 @@ struct MTY_WebSocket {
 	struct net *net;
 	bool connected;
 	bool mask;
+	uint32_t timeout;
 
 	MTY_Time last_ping;
 	MTY_Time last_pong;
@@ -92,7 +93,7 @@ static bool ws_connect(MTY_WebSocket *ws, const char *path, const char *headers,
 		mty_http_parse_headers(headers, ws_parse_headers, &req);
 
 	// Write http the header
-	bool r = mty_http_write_request_header(ws->net, "GET", path, req);
+	bool r = mty_http_write_request_header(ws->net, "GET", path, req, timeout);
 	if (!r)
 		goto except;
 
@@ -190,7 +191,7 @@ static bool ws_accept(MTY_WebSocket *ws, const char * const *origins, uint32_t n
 	mty_http_set_header_str(&res, "Connection", "Upgrade");
 
 	// Write the response header
-	r = mty_http_write_response_header(ws->net, "101", "Switching Protocols", res);
+	r = mty_http_write_response_header(ws->net, "101", "Switching Protocols", res, timeout);
 	if (!r)
 		goto except;
 
@@ -253,7 +254,7 @@ static bool ws_write(MTY_WebSocket *ws, const void *buf, size_t size, uint8_t op
 	}
 
 	// Write full network buffer
-	return mty_net_write(ws->net, ws->buf, size + o);;
+	return mty_net_write(ws->net, ws->buf, size + o, ws->timeout);
 }
 
 static bool ws_read(MTY_WebSocket *ws, void *buf, size_t size, uint8_t *opcode, uint32_t timeout, size_t *read)
@@ -321,6 +322,7 @@ MTY_WebSocket *MTY_WebSocketConnect(const char *host, uint16_t port, bool secure
 		goto except;
 
 	ctx->connected = true;
+	ctx->timeout = timeout;
 	ctx->last_ping = ctx->last_pong = MTY_GetTime();
 
 	except:
@@ -356,6 +358,7 @@ MTY_WebSocket *MTY_WebSocketAccept(MTY_WebSocket *ws, const char * const *origin
 
 		if (ws_accept(ws_child, origins, numOrigins, secureOrigin, timeout)) {
 			ws_child->connected = true;
+			ws_child->timeout = timeout;
 			ws_child->last_ping = ws_child->last_pong = MTY_GetTime();
 
 		} else {
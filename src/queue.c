@@ -8,6 +8,9 @@
 
 #include <string.h>
 
+#include "atomic.h"
+#include "metrics.h"
+
 enum {
 	QUEUE_EMPTY = 0,
 	QUEUE_FULL  = 1,
@@ -66,13 +69,14 @@ void *MTY_QueueAcquireBuffer(MTY_Queue *ctx)
 {
 	MTY_MutexLock(ctx->push_mutex);
 
-	int32_t state = MTY_Atomic32Get(&ctx->slots[ctx->push_pos].state);
+	int32_t state = mty_atomic32_load(&ctx->slots[ctx->push_pos].state, MTY_MEMORY_ORDER_ACQUIRE);
 
 	if (state == QUEUE_EMPTY) {
 		return ctx->slots[ctx->push_pos].data;
 
 	} else {
 		MTY_MutexUnlock(ctx->push_mutex);
+		mty_metric_add(METRIC_QUEUE_FULL, 1);
 	}
 
 	return NULL;
@@ -89,15 +93,20 @@ static uint32_t queue_next_pos(MTY_Queue *ctx, uint32_t pos)
 static void queue_push(MTY_Queue *ctx, size_t size, bool ptr)
 {
 	if (size > 0) {
+		// The slot being filled is empty, so the length can't yet wrap around to zero
+		uint32_t depth = MTY_QueueGetLength(ctx) + 1;
+
 		uint32_t lock_pos = ctx->push_pos;
 		ctx->slots[lock_pos].size = size;
 
 		ctx->push_pos = queue_next_pos(ctx, ctx->push_pos);
 
 		ctx->slots[lock_pos].ptr = ptr;
-		MTY_Atomic32Set(&ctx->slots[lock_pos].state, QUEUE_FULL);
+		mty_atomic32_store(&ctx->slots[lock_pos].state, QUEUE_FULL, MTY_MEMORY_ORDER_RELEASE);
 
 		MTY_WaitableSignal(ctx->pop_sync);
+
+		mty_metric_record(METRIC_QUEUE_DEPTH, depth);
 	}
 
 	MTY_MutexUnlock(ctx->push_mutex);
@@ -112,7 +121,7 @@ static bool queue_pop(MTY_Queue *ctx, int32_t timeout, bool last, void **buffer,
 {
 	begin:
 
-	if (MTY_Atomic32Get(&ctx->slots[ctx->pop_pos].state) == QUEUE_FULL) {
+	if (mty_atomic32_load(&ctx->slots[ctx->pop_pos].state, MTY_MEMORY_ORDER_ACQUIRE) == QUEUE_FULL) {
 		*buffer = ctx->slots[ctx->pop_pos].data;
 
 		if (size)
@@ -121,7 +130,7 @@ static bool queue_pop(MTY_Queue *ctx, int32_t timeout, bool last, void **buffer,
 		if (last) {
 			uint32_t next_pos = queue_next_pos(ctx, ctx->pop_pos);
 
-			if (MTY_Atomic32Get(&ctx->slots[next_pos].state) == QUEUE_FULL) {
+			if (mty_atomic32_load(&ctx->slots[next_pos].state, MTY_MEMORY_ORDER_ACQUIRE) == QUEUE_FULL) {
 				MTY_QueueReleaseBuffer(ctx);
 				goto begin;
 			}
@@ -155,7 +164,7 @@ void MTY_QueueReleaseBuffer(MTY_Queue *ctx)
 
 	ctx->pop_pos = queue_next_pos(ctx, ctx->pop_pos);
 
-	MTY_Atomic32Set(&ctx->slots[lock_pos].state, QUEUE_EMPTY);
+	mty_atomic32_store(&ctx->slots[lock_pos].state, QUEUE_EMPTY, MTY_MEMORY_ORDER_RELEASE);
 }
 
 bool MTY_QueuePushPtr(MTY_Queue *ctx, void *opaque, size_t size)
@@ -100,19 +100,27 @@ static bool renderer_begin(MTY_Renderer *ctx, MTY_GFX api, MTY_Context *context,
 bool MTY_RendererDrawQuad(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device, MTY_Context *context,
 	const void *image, const MTY_RenderDesc *desc, MTY_Texture *dest)
 {
-	if (!renderer_begin(ctx, api, context, device))
-		return false;
+	MTY_TraceBegin("MTY_RendererDrawQuad");
+
+	bool r = renderer_begin(ctx, api, context, device) &&
+		GFX_API[api].render(ctx->gfx, device, context, image, desc, dest);
 
-	return GFX_API[api].render(ctx->gfx, device, context, image, desc, dest);
+	MTY_TraceEnd("MTY_RendererDrawQuad");
+
+	return r;
 }
 
 bool MTY_RendererDrawUI(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device,
 	MTY_Context *context, const MTY_DrawData *dd, MTY_Texture *dest)
 {
-	if (!renderer_begin(ctx, api, context, device))
-		return false;
+	MTY_TraceBegin("MTY_RendererDrawUI");
+
+	bool r = renderer_begin(ctx, api, context, device) &&
+		GFX_UI_API[api].render(ctx->gfx_ui, device, context, dd, ctx->textures, dest);
 
-	return GFX_UI_API[api].render(ctx->gfx_ui, device, context, dd, ctx->textures, dest);
+	MTY_TraceEnd("MTY_RendererDrawUI");
+
+	return r;
 }
 
 bool MTY_RendererSetUITexture(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device,
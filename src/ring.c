@@ -0,0 +1,160 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _DEFAULT_SOURCE  // MAP_ANONYMOUS, syscall
+#define _DARWIN_C_SOURCE // MAP_ANON
+
+#include "matoya.h"
+
+#include <string.h>
+
+#include "ringmap.h"
+#include "atomic.h"
+
+// The buffer's pages are mapped twice back to back, so any span of up to `size`
+// bytes starting inside the first view is contiguous in memory. Where the platform
+// can't do that, the second half is a plain copy kept in sync on each commit.
+
+struct MTY_RingBuffer {
+	uint8_t *buf;
+	size_t size;
+	bool mapped;
+
+	// Producer and consumer cursors are on separate cache lines, both only increase
+	MTY_Atomic64 wpos;
+	uint8_t pad0[56];
+	MTY_Atomic64 rpos;
+	uint8_t pad1[56];
+};
+
+MTY_RingBuffer *MTY_RingBufferCreate(size_t minSize)
+{
+	size_t granularity = mty_ringmap_granularity();
+
+	MTY_RingBuffer *ctx = MTY_AllocAligned(sizeof(MTY_RingBuffer), 64);
+	ctx->size = minSize > 0 ? (minSize + granularity - 1) / granularity * granularity : granularity;
+
+	ctx->buf = mty_ringmap_create(ctx->size);
+	ctx->mapped = ctx->buf != NULL;
+
+	if (!ctx->mapped)
+		ctx->buf = MTY_AllocAligned(ctx->size * 2, 64);
+
+	return ctx;
+}
+
+void MTY_RingBufferDestroy(MTY_RingBuffer **ring)
+{
+	if (!ring || !*ring)
+		return;
+
+	MTY_RingBuffer *ctx = *ring;
+
+	if (ctx->mapped) {
+		mty_ringmap_destroy(ctx->buf, ctx->size);
+
+	} else {
+		MTY_FreeAligned(ctx->buf);
+	}
+
+	MTY_FreeAligned(ctx);
+	*ring = NULL;
+}
+
+size_t MTY_RingBufferGetSize(MTY_RingBuffer *ctx)
+{
+	return ctx->size;
+}
+
+size_t MTY_RingBufferGetLength(MTY_RingBuffer *ctx)
+{
+	int64_t r = mty_atomic64_load(&ctx->rpos, MTY_MEMORY_ORDER_ACQUIRE);
+
+	return (size_t) (mty_atomic64_load(&ctx->wpos, MTY_MEMORY_ORDER_ACQUIRE) - r);
+}
+
+void *MTY_RingBufferReserve(MTY_RingBuffer *ctx, size_t *size)
+{
+	int64_t w = mty_atomic64_load(&ctx->wpos, MTY_MEMORY_ORDER_RELAXED);
+	int64_t r = mty_atomic64_load(&ctx->rpos, MTY_MEMORY_ORDER_ACQUIRE);
+
+	*size = ctx->size - (size_t) (w - r);
+
+	return ctx->buf + (uint64_t) w % ctx->size;
+}
+
+void MTY_RingBufferCommit(MTY_RingBuffer *ctx, size_t size)
+{
+	int64_t w = mty_atomic64_load(&ctx->wpos, MTY_MEMORY_ORDER_RELAXED);
+
+	if (!ctx->mapped) {
+		size_t off = (uint64_t) w % ctx->size;
+		size_t end = off + size;
+
+		// Copy whatever landed in one half over to the other
+		if (end <= ctx->size) {
+			memcpy(ctx->buf + ctx->size + off, ctx->buf + off, size);
+
+		} else {
+			memcpy(ctx->buf + ctx->size + off, ctx->buf + off, ctx->size - off);
+			memcpy(ctx->buf, ctx->buf + ctx->size, end - ctx->size);
+		}
+	}
+
+	// Publishing the cursor makes the data visible to the consumer
+	mty_atomic64_store(&ctx->wpos, w + size, MTY_MEMORY_ORDER_RELEASE);
+}
+
+const void *MTY_RingBufferPeek(MTY_RingBuffer *ctx, size_t *size)
+{
+	int64_t r = mty_atomic64_load(&ctx->rpos, MTY_MEMORY_ORDER_RELAXED);
+	int64_t w = mty_atomic64_load(&ctx->wpos, MTY_MEMORY_ORDER_ACQUIRE);
+
+	*size = (size_t) (w - r);
+
+	return ctx->buf + (uint64_t) r % ctx->size;
+}
+
+void MTY_RingBufferSkip(MTY_RingBuffer *ctx, size_t size)
+{
+	int64_t r = mty_atomic64_load(&ctx->rpos, MTY_MEMORY_ORDER_RELAXED);
+
+	// Releasing the bytes hands the space back to the producer
+	mty_atomic64_store(&ctx->rpos, r + size, MTY_MEMORY_ORDER_RELEASE);
+}
+
+bool MTY_RingBufferWrite(MTY_RingBuffer *ctx, const void *buf, size_t size)
+{
+	size_t avail = 0;
+	void *dst = MTY_RingBufferReserve(ctx, &avail);
+
+	if (avail < size)
+		return false;
+
+	memcpy(dst, buf, size);
+	MTY_RingBufferCommit(ctx, size);
+
+	return true;
+}
+
+size_t MTY_RingBufferRead(MTY_RingBuffer *ctx, void *buf, size_t size)
+{
+	size_t avail = 0;
+	const void *src = MTY_RingBufferPeek(ctx, &avail);
+
+	size = MTY_MIN(size, avail);
+
+	memcpy(buf, src, size);
+	MTY_RingBufferSkip(ctx, size);
+
+	return size;
+}
+
+void MTY_RingBufferClear(MTY_RingBuffer *ctx)
+{
+	mty_atomic64_store(&ctx->rpos, mty_atomic64_load(&ctx->wpos, MTY_MEMORY_ORDER_ACQUIRE),
+		MTY_MEMORY_ORDER_RELEASE);
+}
@@ -0,0 +1,514 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+#define SORT_MIN_MERGE    32
+#define SORT_STACK_MAX    85
+#define SORT_PARALLEL_MIN (16 * 1024)
+
+#define SORT_EL(ctx, i) \
+	((ctx)->base + (i) * (ctx)->size)
+
+
+// Adaptive merge sort (timsort-style)
+
+struct sort_run {
+	size_t base;
+	size_t len;
+};
+
+struct sort {
+	uint8_t *base;
+	size_t size;
+	MTY_CompareFunc func;
+
+	uint8_t *tmp;
+	size_t tmp_len;
+	uint8_t *pivot;
+
+	struct sort_run runs[SORT_STACK_MAX];
+	uint32_t n;
+};
+
+static void sort_init(struct sort *ctx, void *base, size_t size, MTY_CompareFunc func)
+{
+	memset(ctx, 0, sizeof(struct sort));
+
+	ctx->base = base;
+	ctx->size = size;
+	ctx->func = func;
+	ctx->pivot = MTY_Alloc(1, size);
+}
+
+static void sort_destroy(struct sort *ctx)
+{
+	MTY_Free(ctx->pivot);
+	MTY_Free(ctx->tmp);
+}
+
+static uint8_t *sort_tmp(struct sort *ctx, size_t len)
+{
+	if (len > ctx->tmp_len) {
+		MTY_Free(ctx->tmp);
+
+		ctx->tmp_len = len;
+		ctx->tmp = MTY_Alloc(len, ctx->size);
+	}
+
+	return ctx->tmp;
+}
+
+static void sort_reverse(struct sort *ctx, size_t lo, size_t hi)
+{
+	for (hi--; lo < hi; lo++, hi--) {
+		memcpy(ctx->pivot, SORT_EL(ctx, lo), ctx->size);
+		memcpy(SORT_EL(ctx, lo), SORT_EL(ctx, hi), ctx->size);
+		memcpy(SORT_EL(ctx, hi), ctx->pivot, ctx->size);
+	}
+}
+
+static size_t sort_count_run(struct sort *ctx, size_t lo, size_t hi)
+{
+	size_t x = lo + 1;
+
+	if (x == hi)
+		return 1;
+
+	// Only strictly descending runs are reversed to keep the sort stable
+	if (ctx->func(SORT_EL(ctx, x), SORT_EL(ctx, lo)) < 0) {
+		for (x++; x < hi && ctx->func(SORT_EL(ctx, x), SORT_EL(ctx, x - 1)) < 0; x++);
+		sort_reverse(ctx, lo, x);
+
+	} else {
+		for (x++; x < hi && ctx->func(SORT_EL(ctx, x), SORT_EL(ctx, x - 1)) >= 0; x++);
+	}
+
+	return x - lo;
+}
+
+static void sort_binary_insertion(struct sort *ctx, size_t lo, size_t hi, size_t start)
+{
+	for (size_t x = start; x < hi; x++) {
+		memcpy(ctx->pivot, SORT_EL(ctx, x), ctx->size);
+
+		size_t left = lo;
+		size_t right = x;
+
+		while (left < right) {
+			size_t mid = left + (right - left) / 2;
+
+			if (ctx->func(ctx->pivot, SORT_EL(ctx, mid)) < 0) {
+				right = mid;
+
+			} else {
+				left = mid + 1;
+			}
+		}
+
+		memmove(SORT_EL(ctx, left + 1), SORT_EL(ctx, left), (x - left) * ctx->size);
+		memcpy(SORT_EL(ctx, left), ctx->pivot, ctx->size);
+	}
+}
+
+static size_t sort_min_run(size_t n)
+{
+	size_t r = 0;
+
+	while (n >= SORT_MIN_MERGE) {
+		r |= n & 1;
+		n >>= 1;
+	}
+
+	return n + r;
+}
+
+static size_t sort_upper_bound(struct sort *ctx, const void *key, size_t lo, size_t hi)
+{
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ctx->func(key, SORT_EL(ctx, mid)) < 0) {
+			hi = mid;
+
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo;
+}
+
+static size_t sort_lower_bound(struct sort *ctx, const void *key, size_t lo, size_t hi)
+{
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ctx->func(SORT_EL(ctx, mid), key) < 0) {
+			lo = mid + 1;
+
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static void sort_merge_lo(struct sort *ctx, size_t a, size_t na, size_t nb)
+{
+	uint8_t *tmp = sort_tmp(ctx, na);
+	memcpy(tmp, SORT_EL(ctx, a), na * ctx->size);
+
+	size_t i = 0;
+	size_t j = a + na;
+	size_t end = j + nb;
+	size_t dst = a;
+
+	while (i < na && j < end) {
+		if (ctx->func(SORT_EL(ctx, j), tmp + i * ctx->size) < 0) {
+			memcpy(SORT_EL(ctx, dst++), SORT_EL(ctx, j++), ctx->size);
+
+		} else {
+			memcpy(SORT_EL(ctx, dst++), tmp + i++ * ctx->size, ctx->size);
+		}
+	}
+
+	memcpy(SORT_EL(ctx, dst), tmp + i * ctx->size, (na - i) * ctx->size);
+}
+
+static void sort_merge_hi(struct sort *ctx, size_t a, size_t na, size_t nb)
+{
+	uint8_t *tmp = sort_tmp(ctx, nb);
+	memcpy(tmp, SORT_EL(ctx, a + na), nb * ctx->size);
+
+	size_t i = a + na;
+	size_t j = nb;
+	size_t dst = a + na + nb;
+
+	// Walking backwards, ties take from the right run to preserve order
+	while (i > a && j > 0) {
+		if (ctx->func(tmp + (j - 1) * ctx->size, SORT_EL(ctx, i - 1)) < 0) {
+			memcpy(SORT_EL(ctx, --dst), SORT_EL(ctx, --i), ctx->size);
+
+		} else {
+			memcpy(SORT_EL(ctx, --dst), tmp + --j * ctx->size, ctx->size);
+		}
+	}
+
+	memcpy(SORT_EL(ctx, a), tmp, j * ctx->size);
+}
+
+static void sort_merge(struct sort *ctx, size_t a, size_t na, size_t nb)
+{
+	size_t b = a + na;
+
+	// Elements of the left run already <= the head of the right run stay in place
+	size_t k = sort_upper_bound(ctx, SORT_EL(ctx, b), a, b);
+	na -= k - a;
+	a = k;
+
+	if (na == 0)
+		return;
+
+	// Elements of the right run already >= the tail of the left run stay in place
+	nb = sort_lower_bound(ctx, SORT_EL(ctx, b - 1), b, b + nb) - b;
+
+	if (nb == 0)
+		return;
+
+	if (na <= nb) {
+		sort_merge_lo(ctx, a, na, nb);
+
+	} else {
+		sort_merge_hi(ctx, a, na, nb);
+	}
+}
+
+static void sort_merge_at(struct sort *ctx, uint32_t i)
+{
+	struct sort_run *r = ctx->runs;
+
+	sort_merge(ctx, r[i].base, r[i].len, r[i + 1].len);
+
+	r[i].len += r[i + 1].len;
+
+	if (i == ctx->n - 3)
+		r[i + 1] = r[i + 2];
+
+	ctx->n--;
+}
+
+static void sort_merge_collapse(struct sort *ctx)
+{
+	struct sort_run *r = ctx->runs;
+
+	while (ctx->n > 1) {
+		uint32_t m = ctx->n - 2;
+
+		if ((m > 0 && r[m - 1].len <= r[m].len + r[m + 1].len) ||
+			(m > 1 && r[m - 2].len <= r[m - 1].len + r[m].len))
+		{
+			if (r[m - 1].len < r[m + 1].len)
+				m--;
+
+		} else if (r[m].len > r[m + 1].len) {
+			break;
+		}
+
+		sort_merge_at(ctx, m);
+	}
+}
+
+static void sort_merge_force(struct sort *ctx)
+{
+	struct sort_run *r = ctx->runs;
+
+	while (ctx->n > 1) {
+		uint32_t m = ctx->n - 2;
+
+		if (m > 0 && r[m - 1].len < r[m + 1].len)
+			m--;
+
+		sort_merge_at(ctx, m);
+	}
+}
+
+static void sort_run(struct sort *ctx, size_t n)
+{
+	if (n < 2)
+		return;
+
+	if (n < SORT_MIN_MERGE) {
+		sort_binary_insertion(ctx, 0, n, sort_count_run(ctx, 0, n));
+		return;
+	}
+
+	size_t min_run = sort_min_run(n);
+
+	for (size_t lo = 0; lo < n;) {
+		size_t len = sort_count_run(ctx, lo, n);
+
+		// Extend short natural runs to min_run with insertion sort
+		if (len < min_run) {
+			size_t force = MTY_MIN(min_run, n - lo);
+			sort_binary_insertion(ctx, lo, lo + force, lo + len);
+			len = force;
+		}
+
+		ctx->runs[ctx->n].base = lo;
+		ctx->runs[ctx->n].len = len;
+		ctx->n++;
+
+		sort_merge_collapse(ctx);
+
+		lo += len;
+	}
+
+	sort_merge_force(ctx);
+}
+
+void MTY_Sort(void *base, size_t nElements, size_t size, MTY_CompareFunc func)
+{
+	if (nElements < 2 || size == 0)
+		return;
+
+	struct sort ctx;
+	sort_init(&ctx, base, size, func);
+
+	sort_run(&ctx, nElements);
+
+	sort_destroy(&ctx);
+}
+
+
+// Parallel
+
+struct sort_task {
+	uint8_t *base;
+	size_t size;
+	MTY_CompareFunc func;
+	size_t lo;
+	size_t mid;
+	size_t hi;
+};
+
+static void sort_task_sort(uint64_t begin, uint64_t end, void *opaque)
+{
+	for (uint64_t x = begin; x < end; x++) {
+		struct sort_task *t = (struct sort_task *) opaque + x;
+
+		MTY_Sort(t->base + t->lo * t->size, t->hi - t->lo, t->size, t->func);
+	}
+}
+
+static void sort_task_merge(uint64_t begin, uint64_t end, void *opaque)
+{
+	for (uint64_t x = begin; x < end; x++) {
+		struct sort_task *t = (struct sort_task *) opaque + x;
+
+		struct sort ctx;
+		sort_init(&ctx, t->base, t->size, t->func);
+
+		sort_merge(&ctx, t->lo, t->mid - t->lo, t->hi - t->mid);
+
+		sort_destroy(&ctx);
+	}
+}
+
+void MTY_SortParallel(void *base, size_t nElements, size_t size, MTY_CompareFunc func,
+	uint32_t maxThreads)
+{
+	uint32_t n = maxThreads;
+
+	if (nElements / SORT_PARALLEL_MIN < n)
+		n = (uint32_t) (nElements / SORT_PARALLEL_MIN);
+
+	if (n < 2) {
+		MTY_Sort(base, nElements, size, func);
+		return;
+	}
+
+	struct sort_task *tasks = MTY_Alloc(n, sizeof(struct sort_task));
+	size_t *bounds = MTY_Alloc(n + 1, sizeof(size_t));
+
+	for (uint32_t x = 0; x <= n; x++)
+		bounds[x] = nElements * x / n;
+
+	for (uint32_t x = 0; x < n; x++) {
+		tasks[x].base = base;
+		tasks[x].size = size;
+		tasks[x].func = func;
+		tasks[x].lo = bounds[x];
+		tasks[x].hi = bounds[x + 1];
+	}
+
+	MTY_ParallelFor(0, n, 1, sort_task_sort, tasks);
+
+	// Merge neighboring chunks pairwise, left to right so equal elements keep their order
+	for (uint32_t width = 1; width < n; width *= 2) {
+		uint32_t merges = 0;
+
+		for (uint32_t x = 0; x + width < n; x += width * 2) {
+			struct sort_task *t = &tasks[merges++];
+			t->lo = bounds[x];
+			t->mid = bounds[x + width];
+			t->hi = bounds[MTY_MIN(x + width * 2, n)];
+		}
+
+		MTY_ParallelFor(0, merges, 1, sort_task_merge, tasks);
+	}
+
+	MTY_Free(bounds);
+	MTY_Free(tasks);
+}
+
+
+// Radix
+
+struct sort_key {
+	uint64_t key;
+	size_t index;
+};
+
+static uint64_t sort_key_get(const uint8_t *el, MTY_SortKey type)
+{
+	switch (type) {
+		case MTY_SORT_KEY_UINT32: {
+			uint32_t v = 0;
+			memcpy(&v, el, sizeof(uint32_t));
+			return v;
+		}
+		case MTY_SORT_KEY_INT32: {
+			uint32_t v = 0;
+			memcpy(&v, el, sizeof(uint32_t));
+			return v ^ 0x80000000;
+		}
+		case MTY_SORT_KEY_UINT64: {
+			uint64_t v = 0;
+			memcpy(&v, el, sizeof(uint64_t));
+			return v;
+		}
+		case MTY_SORT_KEY_INT64: {
+			uint64_t v = 0;
+			memcpy(&v, el, sizeof(uint64_t));
+			return v ^ 0x8000000000000000;
+		}
+		case MTY_SORT_KEY_FLOAT: {
+			// Negative floats have all bits flipped, positive floats just the sign bit
+			uint32_t v = 0;
+			memcpy(&v, el, sizeof(uint32_t));
+			return (v & 0x80000000) ? ~v : v ^ 0x80000000;
+		}
+		case MTY_SORT_KEY_DOUBLE: {
+			uint64_t v = 0;
+			memcpy(&v, el, sizeof(uint64_t));
+			return (v & 0x8000000000000000) ? ~v : v ^ 0x8000000000000000;
+		}
+	}
+
+	return 0;
+}
+
+void MTY_RadixSort(void *base, size_t nElements, size_t size, size_t keyOffset, MTY_SortKey keyType)
+{
+	if (nElements < 2 || size == 0)
+		return;
+
+	uint8_t *el = base;
+	uint8_t digits = keyType == MTY_SORT_KEY_UINT32 || keyType == MTY_SORT_KEY_INT32 ||
+		keyType == MTY_SORT_KEY_FLOAT ? 4 : 8;
+
+	struct sort_key *keys = MTY_Alloc(nElements, sizeof(struct sort_key));
+	struct sort_key *scratch = MTY_Alloc(nElements, sizeof(struct sort_key));
+	size_t (*hist)[256] = MTY_Alloc(digits, sizeof(size_t[256]));
+
+	// Build every histogram in a single pass
+	for (size_t x = 0; x < nElements; x++) {
+		keys[x].key = sort_key_get(el + x * size + keyOffset, keyType);
+		keys[x].index = x;
+
+		for (uint8_t d = 0; d < digits; d++)
+			hist[d][(keys[x].key >> (d * 8)) & 0xFF]++;
+	}
+
+	// LSD passes, skipping digits where every key falls in the same bucket
+	for (uint8_t d = 0; d < digits; d++) {
+		size_t *h = hist[d];
+
+		if (h[(keys[0].key >> (d * 8)) & 0xFF] == nElements)
+			continue;
+
+		size_t offset = 0;
+		for (uint32_t x = 0; x < 256; x++) {
+			size_t count = h[x];
+			h[x] = offset;
+			offset += count;
+		}
+
+		for (size_t x = 0; x < nElements; x++)
+			scratch[h[(keys[x].key >> (d * 8)) & 0xFF]++] = keys[x];
+
+		struct sort_key *swap = keys;
+		keys = scratch;
+		scratch = swap;
+	}
+
+	// Permute the elements into their sorted order
+	uint8_t *out = MTY_Alloc(nElements, size);
+
+	for (size_t x = 0; x < nElements; x++)
+		memcpy(out + x * size, el + keys[x].index * size, size);
+
+	memcpy(base, out, nElements * size);
+
+	MTY_Free(out);
+	MTY_Free(hist);
+	MTY_Free(scratch);
+	MTY_Free(keys);
+}
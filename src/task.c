@@ -0,0 +1,360 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+#include "atomic.h"
+
+// A single process wide FIFO of jobs serviced by persistent worker threads. Threads
+// waiting on parallel work pop jobs from the same queue instead of blocking, so nested
+// MTY_ParallelFor calls and tasks that wait on other work can't starve the workers.
+
+#define TASK_CHUNKS_PER_THREAD 4
+
+struct task_job {
+	MTY_AnonFunc func;
+	void *opaque;
+};
+
+struct task_sched {
+	MTY_Mutex *mutex;
+	MTY_Cond *work;
+	MTY_Cond *idle;
+
+	uint32_t num_workers;
+	uint32_t waiters;
+
+	struct task_job *jobs;
+	uint32_t len;
+	uint32_t head;
+	uint32_t count;
+};
+
+struct task_for {
+	MTY_ParallelForFunc func;
+	void *opaque;
+
+	uint64_t begin;
+	uint64_t end;
+	uint64_t grain;
+
+	MTY_Atomic64 next;
+	MTY_Atomic32 pending;
+};
+
+struct task_node {
+	MTY_TaskGraph *graph;
+	MTY_AnonFunc func;
+	void *opaque;
+
+	uint32_t *dependents;
+	uint32_t num_dependents;
+	uint32_t num_dependencies;
+
+	MTY_Atomic32 pending;
+};
+
+struct MTY_TaskGraph {
+	struct task_node *nodes;
+	uint32_t len;
+	uint32_t num;
+
+	MTY_Atomic32 remaining;
+};
+
+static MTY_Atomic32 TASK_LOCK;
+static struct task_sched *TASK_SCHED;
+
+
+// Scheduler
+
+static bool task_pop(struct task_sched *s, struct task_job *job)
+{
+	if (s->count == 0)
+		return false;
+
+	*job = s->jobs[s->head];
+	s->head = (s->head + 1) % s->len;
+	s->count--;
+
+	return true;
+}
+
+static void *task_worker(void *opaque)
+{
+	struct task_sched *s = opaque;
+
+	MTY_ThreadSetName("mty-task");
+
+	MTY_MutexLock(s->mutex);
+
+	while (true) {
+		struct task_job job;
+
+		if (!task_pop(s, &job)) {
+			MTY_CondWait(s->work, s->mutex, -1);
+			continue;
+		}
+
+		MTY_MutexUnlock(s->mutex);
+		job.func(job.opaque);
+		MTY_MutexLock(s->mutex);
+	}
+
+	return NULL;
+}
+
+static struct task_sched *task_sched(void)
+{
+	MTY_GlobalLock(&TASK_LOCK);
+
+	if (!TASK_SCHED) {
+		struct task_sched *s = MTY_Alloc(1, sizeof(struct task_sched));
+		s->mutex = MTY_MutexCreate();
+		s->work = MTY_CondCreate();
+		s->idle = MTY_CondCreate();
+
+		// The calling thread always takes part, so one worker fewer than processors
+		s->num_workers = MTY_MAX(MTY_GetNumProcessors(), 2) - 1;
+
+		for (uint32_t x = 0; x < s->num_workers; x++)
+			MTY_ThreadDetach(task_worker, s);
+
+		TASK_SCHED = s;
+	}
+
+	MTY_GlobalUnlock(&TASK_LOCK);
+
+	return TASK_SCHED;
+}
+
+static void task_push(struct task_sched *s, MTY_AnonFunc func, void *opaque)
+{
+	MTY_MutexLock(s->mutex);
+
+	if (s->count == s->len) {
+		uint32_t len = s->len > 0 ? s->len * 2 : 64;
+		s->jobs = MTY_Realloc(s->jobs, len, sizeof(struct task_job));
+
+		// The queue is full, so the jobs stored before the head move to just past the old end
+		for (uint32_t x = 0; x < s->head; x++)
+			s->jobs[s->len + x] = s->jobs[x];
+
+		s->len = len;
+	}
+
+	struct task_job *job = &s->jobs[(s->head + s->count) % s->len];
+	job->func = func;
+	job->opaque = opaque;
+	s->count++;
+
+	MTY_CondSignal(s->work);
+
+	if (s->waiters > 0)
+		MTY_CondSignalAll(s->idle);
+
+	MTY_MutexUnlock(s->mutex);
+}
+
+static void task_done(struct task_sched *s, MTY_Atomic32 *pending)
+{
+	// The counter may live on the stack of the waiting thread, so it is not touched again
+	if (mty_atomic32_fetch_add(pending, -1, MTY_MEMORY_ORDER_ACQ_REL) == 1) {
+		MTY_MutexLock(s->mutex);
+		MTY_CondSignalAll(s->idle);
+		MTY_MutexUnlock(s->mutex);
+	}
+}
+
+static void task_wait(struct task_sched *s, MTY_Atomic32 *pending)
+{
+	MTY_MutexLock(s->mutex);
+
+	while (mty_atomic32_load(pending, MTY_MEMORY_ORDER_ACQUIRE) > 0) {
+		struct task_job job;
+
+		if (!task_pop(s, &job)) {
+			s->waiters++;
+			MTY_CondWait(s->idle, s->mutex, -1);
+			s->waiters--;
+			continue;
+		}
+
+		MTY_MutexUnlock(s->mutex);
+		job.func(job.opaque);
+		MTY_MutexLock(s->mutex);
+	}
+
+	MTY_MutexUnlock(s->mutex);
+}
+
+
+// ParallelFor
+
+static void task_for_run(struct task_for *f)
+{
+	while (true) {
+		uint64_t chunk = mty_atomic64_fetch_add(&f->next, 1, MTY_MEMORY_ORDER_RELAXED);
+		uint64_t begin = f->begin + chunk * f->grain;
+
+		if (begin >= f->end)
+			break;
+
+		f->func(begin, f->end - begin > f->grain ? begin + f->grain : f->end, f->opaque);
+	}
+}
+
+static void task_for_helper(void *opaque)
+{
+	struct task_for *f = opaque;
+
+	task_for_run(f);
+	task_done(TASK_SCHED, &f->pending);
+}
+
+void MTY_ParallelFor(uint64_t begin, uint64_t end, uint64_t grain, MTY_ParallelForFunc func,
+	void *opaque)
+{
+	if (begin >= end)
+		return;
+
+	struct task_sched *s = task_sched();
+
+	uint64_t n = end - begin;
+	uint64_t threads = s->num_workers + 1;
+
+	if (grain == 0)
+		grain = MTY_MAX(n / (threads * TASK_CHUNKS_PER_THREAD), 1);
+
+	uint64_t chunks = (n + grain - 1) / grain;
+
+	if (chunks == 1) {
+		func(begin, end, opaque);
+		return;
+	}
+
+	struct task_for f = {0};
+	f.func = func;
+	f.opaque = opaque;
+	f.begin = begin;
+	f.end = end;
+	f.grain = grain;
+
+	// Helpers that start after every chunk has been claimed return immediately
+	uint32_t helpers = (uint32_t) MTY_MIN(chunks - 1, s->num_workers);
+	mty_atomic32_store(&f.pending, helpers, MTY_MEMORY_ORDER_RELAXED);
+
+	for (uint32_t x = 0; x < helpers; x++)
+		task_push(s, task_for_helper, &f);
+
+	task_for_run(&f);
+	task_wait(s, &f.pending);
+}
+
+
+// TaskGraph
+
+static void task_node_run(void *opaque)
+{
+	struct task_node *node = opaque;
+	MTY_TaskGraph *ctx = node->graph;
+
+	node->func(node->opaque);
+
+	for (uint32_t x = 0; x < node->num_dependents; x++) {
+		struct task_node *dep = &ctx->nodes[node->dependents[x]];
+
+		if (mty_atomic32_fetch_add(&dep->pending, -1, MTY_MEMORY_ORDER_ACQ_REL) == 1)
+			task_push(TASK_SCHED, task_node_run, dep);
+	}
+
+	task_done(TASK_SCHED, &ctx->remaining);
+}
+
+MTY_TaskGraph *MTY_TaskGraphCreate(void)
+{
+	return MTY_Alloc(1, sizeof(MTY_TaskGraph));
+}
+
+void MTY_TaskGraphDestroy(MTY_TaskGraph **graph)
+{
+	if (!graph || !*graph)
+		return;
+
+	MTY_TaskGraph *ctx = *graph;
+
+	for (uint32_t x = 0; x < ctx->num; x++)
+		MTY_Free(ctx->nodes[x].dependents);
+
+	MTY_Free(ctx->nodes);
+
+	MTY_Free(ctx);
+	*graph = NULL;
+}
+
+uint32_t MTY_TaskGraphAdd(MTY_TaskGraph *ctx, MTY_AnonFunc func, void *opaque)
+{
+	if (ctx->num == ctx->len) {
+		ctx->len = ctx->len > 0 ? ctx->len * 2 : 16;
+		ctx->nodes = MTY_Realloc(ctx->nodes, ctx->len, sizeof(struct task_node));
+	}
+
+	struct task_node *node = &ctx->nodes[ctx->num];
+	memset(node, 0, sizeof(struct task_node));
+
+	node->graph = ctx;
+	node->func = func;
+	node->opaque = opaque;
+
+	return ctx->num++;
+}
+
+void MTY_TaskGraphDepend(MTY_TaskGraph *ctx, uint32_t task, uint32_t dependency)
+{
+	if (task >= ctx->num || dependency >= ctx->num || task == dependency) {
+		MTY_Log("Invalid dependency %u -> %u", dependency, task);
+		return;
+	}
+
+	struct task_node *dep = &ctx->nodes[dependency];
+
+	dep->dependents = MTY_Realloc(dep->dependents, dep->num_dependents + 1, sizeof(uint32_t));
+	dep->dependents[dep->num_dependents++] = task;
+
+	ctx->nodes[task].num_dependencies++;
+}
+
+void MTY_TaskGraphSubmit(MTY_TaskGraph *ctx)
+{
+	if (mty_atomic32_load(&ctx->remaining, MTY_MEMORY_ORDER_ACQUIRE) > 0) {
+		MTY_Log("Task graph is already running");
+		return;
+	}
+
+	if (ctx->num == 0)
+		return;
+
+	struct task_sched *s = task_sched();
+
+	for (uint32_t x = 0; x < ctx->num; x++)
+		mty_atomic32_store(&ctx->nodes[x].pending, ctx->nodes[x].num_dependencies, MTY_MEMORY_ORDER_RELAXED);
+
+	mty_atomic32_store(&ctx->remaining, ctx->num, MTY_MEMORY_ORDER_RELAXED);
+
+	for (uint32_t x = 0; x < ctx->num; x++)
+		if (ctx->nodes[x].num_dependencies == 0)
+			task_push(s, task_node_run, &ctx->nodes[x]);
+}
+
+void MTY_TaskGraphWait(MTY_TaskGraph *ctx)
+{
+	if (mty_atomic32_load(&ctx->remaining, MTY_MEMORY_ORDER_ACQUIRE) == 0)
+		return;
+
+	task_wait(TASK_SCHED, &ctx->remaining);
+}
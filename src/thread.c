@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "rwlock.h"
+#include "atomic.h"
 #include "tlocal.h"
 
 struct MTY_Waitable {
@@ -207,42 +208,207 @@ void MTY_ThreadPoolDestroy(MTY_ThreadPool **pool, MTY_AnonFunc detach)
 
 // RWLock
 
-static TLOCAL struct thread_rwlock {
-	uint16_t taken;
-	bool read;
-	bool write;
-} RWLOCK_STATE[UINT8_MAX];
+// Reader-biased lock (BRAVO). While the bias is set, readers only increment a
+// counter on their own cache line instead of touching the shared rwlock. A writer
+// revokes the bias and parks until those counters drain, then keeps the bias off
+// for a multiple of what the revocation cost so write heavy locks stay on the
+// underlying rwlock.
+
+#define RWLOCK_STRIPES  16
+#define RWLOCK_HELD     16
+#define RWLOCK_INHIBIT  9
+
+struct rwlock_stripe {
+	MTY_Atomic32 readers;
+	uint8_t pad[60];
+};
 
 struct MTY_RWLock {
+	struct rwlock_stripe stripes[RWLOCK_STRIPES];
+
 	mty_rwlock rwlock;
-	MTY_Atomic32 yield;
-	uint8_t index;
+	MTY_Mutex *gate;
+	MTY_Waitable *drain;
+	MTY_Atomic32 bias;
+	MTY_Atomic32 writers;
+	MTY_Time inhibit;
 };
 
-static MTY_Atomic32 RWLOCK_INIT[UINT8_MAX];
+struct rwlock_held {
+	MTY_RWLock *lock;
+	uint16_t taken;
+	bool read;
+	bool fast;
+	bool write;
+};
+
+// Recursion is tracked per thread for only the locks it currently holds. Threads
+// holding many locks at once spill onto the heap, which is freed once they are released.
+static TLOCAL struct rwlock_held RWLOCK_HELD_LOCAL[RWLOCK_HELD];
+static TLOCAL struct rwlock_held *RWLOCK_HELD_EXTRA;
+static TLOCAL uint32_t RWLOCK_HELD_EXTRA_LEN;
+static TLOCAL uint32_t RWLOCK_HELD_TOP;
+
+static TLOCAL uint32_t RWLOCK_STRIPE;
+static MTY_Atomic32 RWLOCK_STRIPE_NEXT;
+
+static struct rwlock_held *thread_rwlock_held_at(uint32_t index)
+{
+	return index < RWLOCK_HELD ? &RWLOCK_HELD_LOCAL[index] : &RWLOCK_HELD_EXTRA[index - RWLOCK_HELD];
+}
+
+static struct rwlock_held *thread_rwlock_held(MTY_RWLock *ctx)
+{
+	struct rwlock_held *empty = NULL;
+
+	for (uint32_t x = 0; x < RWLOCK_HELD_TOP; x++) {
+		struct rwlock_held *held = thread_rwlock_held_at(x);
+
+		if (held->lock == ctx)
+			return held;
+
+		if (!empty && !held->lock)
+			empty = held;
+	}
+
+	if (!empty) {
+		if (RWLOCK_HELD_TOP >= RWLOCK_HELD + RWLOCK_HELD_EXTRA_LEN) {
+			RWLOCK_HELD_EXTRA_LEN = RWLOCK_HELD_EXTRA_LEN > 0 ? RWLOCK_HELD_EXTRA_LEN * 2 : RWLOCK_HELD;
+			RWLOCK_HELD_EXTRA = MTY_Realloc(RWLOCK_HELD_EXTRA, RWLOCK_HELD_EXTRA_LEN, sizeof(struct rwlock_held));
+		}
+
+		empty = thread_rwlock_held_at(RWLOCK_HELD_TOP++);
+		memset(empty, 0, sizeof(struct rwlock_held));
+	}
+
+	empty->lock = ctx;
+
+	return empty;
+}
+
+static void thread_rwlock_release_held(struct rwlock_held *held)
+{
+	memset(held, 0, sizeof(struct rwlock_held));
+
+	while (RWLOCK_HELD_TOP > 0 && !thread_rwlock_held_at(RWLOCK_HELD_TOP - 1)->lock)
+		RWLOCK_HELD_TOP--;
+
+	if (RWLOCK_HELD_TOP <= RWLOCK_HELD && RWLOCK_HELD_EXTRA) {
+		MTY_Free(RWLOCK_HELD_EXTRA);
+		RWLOCK_HELD_EXTRA = NULL;
+		RWLOCK_HELD_EXTRA_LEN = 0;
+	}
+}
+
+static struct rwlock_stripe *thread_rwlock_stripe(MTY_RWLock *ctx)
+{
+	// Threads are spread over the stripes round robin
+	if (RWLOCK_STRIPE == 0)
+		RWLOCK_STRIPE = MTY_Atomic32Add(&RWLOCK_STRIPE_NEXT, 1);
+
+	return &ctx->stripes[RWLOCK_STRIPE % RWLOCK_STRIPES];
+}
+
+static void thread_rwlock_stripe_release(MTY_RWLock *ctx, struct rwlock_stripe *stripe)
+{
+	MTY_Atomic32Add(&stripe->readers, -1);
+
+	// A writer is revoking the bias and may be waiting on this stripe
+	if (MTY_Atomic32Get(&ctx->bias) == 0)
+		MTY_WaitableSignal(ctx->drain);
+}
 
-static uint8_t thread_rwlock_index(void)
+static bool thread_rwlock_read_fast(MTY_RWLock *ctx, struct rwlock_held *held)
 {
-	for (uint8_t x = 0; x < UINT8_MAX; x++)
-		if (MTY_Atomic32CAS(&RWLOCK_INIT[x], 0, 1))
-			return x;
+	if (MTY_Atomic32Get(&ctx->bias) == 0)
+		return false;
+
+	struct rwlock_stripe *stripe = thread_rwlock_stripe(ctx);
+	MTY_Atomic32Add(&stripe->readers, 1);
 
-	MTY_LogFatal("Could not find a free rwlock slot, maximum is %u", UINT8_MAX);
+	// Either the writer sees this reader, or this reader sees the revoked bias
+	if (MTY_Atomic32Get(&ctx->bias) == 0) {
+		thread_rwlock_stripe_release(ctx, stripe);
+		return false;
+	}
+
+	held->read = true;
+	held->fast = true;
 
-	return 0;
+	return true;
 }
 
-static void thread_rwlock_yield(MTY_RWLock *ctx)
+static bool thread_rwlock_read_slow(MTY_RWLock *ctx, struct rwlock_held *held, bool try_lock)
 {
-	// Ensure that readers will yield to writers in a tight loop
-	while (MTY_Atomic32Get(&ctx->yield) > 0)
-		MTY_Sleep(0);
+	// Park behind writers waiting for the lock rather than starving them
+	if (MTY_Atomic32Get(&ctx->writers) > 0) {
+		if (try_lock)
+			return false;
+
+		MTY_MutexLock(ctx->gate);
+		MTY_MutexUnlock(ctx->gate);
+	}
+
+	if (try_lock) {
+		if (!mty_rwlock_try_reader(&ctx->rwlock))
+			return false;
+
+	} else {
+		mty_rwlock_reader(&ctx->rwlock);
+	}
+
+	// Writers are excluded here, so `inhibit` is stable
+	if (MTY_Atomic32Get(&ctx->bias) == 0 && MTY_TimeDiff(ctx->inhibit, MTY_GetTime()) >= 0.0f)
+		MTY_Atomic32Set(&ctx->bias, 1);
+
+	held->read = true;
+
+	return true;
+}
+
+static void thread_rwlock_read_release(MTY_RWLock *ctx, struct rwlock_held *held)
+{
+	if (held->fast) {
+		thread_rwlock_stripe_release(ctx, thread_rwlock_stripe(ctx));
+
+	} else {
+		mty_rwlock_unlock_reader(&ctx->rwlock);
+	}
+
+	held->read = false;
+	held->fast = false;
+}
+
+static void thread_rwlock_write(MTY_RWLock *ctx)
+{
+	MTY_Atomic32Add(&ctx->writers, 1);
+	MTY_MutexLock(ctx->gate);
+
+	mty_rwlock_writer(&ctx->rwlock);
+
+	MTY_MutexUnlock(ctx->gate);
+	MTY_Atomic32Add(&ctx->writers, -1);
+
+	if (MTY_Atomic32Get(&ctx->bias) == 0)
+		return;
+
+	MTY_Time start = MTY_GetTime();
+	MTY_Atomic32Set(&ctx->bias, 0);
+
+	for (uint32_t x = 0; x < RWLOCK_STRIPES; x++)
+		while (MTY_Atomic32Get(&ctx->stripes[x].readers) > 0)
+			MTY_WaitableWait(ctx->drain, -1);
+
+	MTY_Time now = MTY_GetTime();
+	ctx->inhibit = now + (now - start) * RWLOCK_INHIBIT;
 }
 
 MTY_RWLock *MTY_RWLockCreate(void)
 {
-	MTY_RWLock *ctx = MTY_Alloc(1, sizeof(MTY_RWLock));
-	ctx->index = thread_rwlock_index();
+	MTY_RWLock *ctx = MTY_AllocAligned(sizeof(MTY_RWLock), 64);
+	ctx->gate = MTY_MutexCreate();
+	ctx->drain = MTY_WaitableCreate();
+	ctx->bias = (MTY_Atomic32) {1};
 
 	mty_rwlock_create(&ctx->rwlock);
 
@@ -251,31 +417,27 @@ MTY_RWLock *MTY_RWLockCreate(void)
 
 void MTY_RWLockReader(MTY_RWLock *ctx)
 {
-	struct thread_rwlock *rw = &RWLOCK_STATE[ctx->index];
+	struct rwlock_held *held = thread_rwlock_held(ctx);
 
-	if (rw->taken == 0) {
-		thread_rwlock_yield(ctx);
-		mty_rwlock_reader(&ctx->rwlock);
-		rw->read = true;
-	}
+	if (held->taken == 0 && !thread_rwlock_read_fast(ctx, held))
+		thread_rwlock_read_slow(ctx, held, false);
 
-	rw->taken++;
+	held->taken++;
 }
 
 bool MTY_RWTryLockReader(MTY_RWLock *ctx)
 {
-	struct thread_rwlock *rw = &RWLOCK_STATE[ctx->index];
+	struct rwlock_held *held = thread_rwlock_held(ctx);
 
-	bool r = true;
+	bool r = held->taken > 0 || thread_rwlock_read_fast(ctx, held) ||
+		thread_rwlock_read_slow(ctx, held, true);
 
-	if (rw->taken == 0) {
-		thread_rwlock_yield(ctx);
-		r = mty_rwlock_try_reader(&ctx->rwlock);
-		rw->read = true;
-	}
+	if (r) {
+		held->taken++;
 
-	if (r)
-		rw->taken++;
+	} else {
+		thread_rwlock_release_held(held);
+	}
 
 	return r;
 }
@@ -283,37 +445,34 @@ bool MTY_RWTryLockReader(MTY_RWLock *ctx)
 void MTY_RWLockWriter(MTY_RWLock *ctx)
 {
 	bool relock = false;
-	struct thread_rwlock *rw = &RWLOCK_STATE[ctx->index];
+	struct rwlock_held *held = thread_rwlock_held(ctx);
 
-	if (rw->read) {
-		mty_rwlock_unlock_reader(&ctx->rwlock);
-		rw->read = false;
+	if (held->read) {
+		thread_rwlock_read_release(ctx, held);
 		relock = true;
 	}
 
-	if (rw->taken == 0 || relock) {
-		MTY_Atomic32Add(&ctx->yield, 1);
-		mty_rwlock_writer(&ctx->rwlock);
-		MTY_Atomic32Add(&ctx->yield, -1);
-		rw->write = true;
+	if (held->taken == 0 || relock) {
+		thread_rwlock_write(ctx);
+		held->write = true;
 	}
 
-	rw->taken++;
+	held->taken++;
 }
 
 void MTY_RWLockUnlock(MTY_RWLock *ctx)
 {
-	struct thread_rwlock *rw = &RWLOCK_STATE[ctx->index];
+	struct rwlock_held *held = thread_rwlock_held(ctx);
 
-	if (--rw->taken == 0) {
-		if (rw->read) {
-			mty_rwlock_unlock_reader(&ctx->rwlock);
-			rw->read = false;
+	if (--held->taken == 0) {
+		if (held->read) {
+			thread_rwlock_read_release(ctx, held);
 
-		} else if (rw->write) {
+		} else if (held->write) {
 			mty_rwlock_unlock_writer(&ctx->rwlock);
-			rw->write = false;
 		}
+
+		thread_rwlock_release_held(held);
 	}
 }
 
@@ -325,14 +484,164 @@ void MTY_RWLockDestroy(MTY_RWLock **rwlock)
 	MTY_RWLock *ctx = *rwlock;
 
 	mty_rwlock_destroy(&ctx->rwlock);
-	memset(&RWLOCK_STATE[ctx->index], 0, sizeof(struct thread_rwlock));
-	MTY_Atomic32Set(&RWLOCK_INIT[ctx->index], 0);
+	MTY_WaitableDestroy(&ctx->drain);
+	MTY_MutexDestroy(&ctx->gate);
 
-	MTY_Free(ctx);
+	MTY_FreeAligned(ctx);
 	*rwlock = NULL;
 }
 
 
+// Atomic
+
+#if !defined(MTY_ATOMIC_INLINE)
+
+int32_t MTY_Atomic32Load(MTY_Atomic32 *atomic, MTY_MemoryOrder order)
+{
+	return mty_atomic32_load(atomic, order);
+}
+
+void MTY_Atomic32Store(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	mty_atomic32_store(atomic, value, order);
+}
+
+int32_t MTY_Atomic32Exchange(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic32_exchange(atomic, value, order);
+}
+
+int32_t MTY_Atomic32FetchAdd(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic32_fetch_add(atomic, value, order);
+}
+
+int32_t MTY_Atomic32FetchOr(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic32_fetch_or(atomic, value, order);
+}
+
+int32_t MTY_Atomic32FetchAnd(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic32_fetch_and(atomic, value, order);
+}
+
+int32_t MTY_Atomic32FetchXor(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic32_fetch_xor(atomic, value, order);
+}
+
+bool MTY_Atomic32CompareExchange(MTY_Atomic32 *atomic, int32_t *expected, int32_t desired, MTY_MemoryOrder order)
+{
+	return mty_atomic32_cas(atomic, expected, desired, order);
+}
+
+int64_t MTY_Atomic64Load(MTY_Atomic64 *atomic, MTY_MemoryOrder order)
+{
+	return mty_atomic64_load(atomic, order);
+}
+
+void MTY_Atomic64Store(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	mty_atomic64_store(atomic, value, order);
+}
+
+int64_t MTY_Atomic64Exchange(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic64_exchange(atomic, value, order);
+}
+
+int64_t MTY_Atomic64FetchAdd(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic64_fetch_add(atomic, value, order);
+}
+
+int64_t MTY_Atomic64FetchOr(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic64_fetch_or(atomic, value, order);
+}
+
+int64_t MTY_Atomic64FetchAnd(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic64_fetch_and(atomic, value, order);
+}
+
+int64_t MTY_Atomic64FetchXor(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return mty_atomic64_fetch_xor(atomic, value, order);
+}
+
+bool MTY_Atomic64CompareExchange(MTY_Atomic64 *atomic, int64_t *expected, int64_t desired, MTY_MemoryOrder order)
+{
+	return mty_atomic64_cas(atomic, expected, desired, order);
+}
+
+void *MTY_AtomicPtrLoad(MTY_AtomicPtr *atomic, MTY_MemoryOrder order)
+{
+	return mty_atomic_ptr_load(atomic, order);
+}
+
+void MTY_AtomicPtrStore(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order)
+{
+	mty_atomic_ptr_store(atomic, value, order);
+}
+
+void *MTY_AtomicPtrExchange(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order)
+{
+	return mty_atomic_ptr_exchange(atomic, value, order);
+}
+
+bool MTY_AtomicPtrCompareExchange(MTY_AtomicPtr *atomic, void **expected, void *desired,
+	MTY_MemoryOrder order)
+{
+	return mty_atomic_ptr_cas(atomic, expected, desired, order);
+}
+
+void MTY_AtomicFence(MTY_MemoryOrder order)
+{
+	mty_atomic_fence(order);
+}
+
+#endif
+
+#if !defined(ATOMIC_128_NATIVE)
+
+// Striped spinlocks keyed by address stand in for a double-width CAS
+#define ATOMIC_128_LOCKS 64
+
+static MTY_Atomic32 ATOMIC_128_LOCK[ATOMIC_128_LOCKS];
+
+#endif
+
+bool MTY_Atomic128CompareExchange(MTY_Atomic128 *atomic, MTY_Atomic128 *expected, MTY_Atomic128 desired)
+{
+	#if defined(ATOMIC_128_NATIVE)
+		return mty_atomic128_cas(atomic, expected, desired);
+
+	#else
+		MTY_Atomic32 *lock = &ATOMIC_128_LOCK[((uintptr_t) atomic >> 4) % ATOMIC_128_LOCKS];
+
+		for (int32_t unlocked = 0; !mty_atomic32_cas(lock, &unlocked, 1, MTY_MEMORY_ORDER_ACQUIRE); unlocked = 0)
+			MTY_Sleep(0);
+
+		bool r = atomic->value[0] == expected->value[0] && atomic->value[1] == expected->value[1];
+
+		if (r) {
+			atomic->value[0] = desired.value[0];
+			atomic->value[1] = desired.value[1];
+
+		} else {
+			expected->value[0] = atomic->value[0];
+			expected->value[1] = atomic->value[1];
+		}
+
+		mty_atomic32_store(lock, 0, MTY_MEMORY_ORDER_RELEASE);
+
+		return r;
+	#endif
+}
+
+
 // Global locks
 
 static MTY_Atomic32 THREAD_GINDEX = {1};
@@ -0,0 +1,383 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+// Hierarchical timing wheel with cascading levels. Level 0 holds timers due in
+// the next 64 ticks, each higher level covers 64 times the span of the one below.
+// Timers in higher levels are redistributed downward as the wheel turns, so
+// insert and cancel are O(1) and each tick only touches a single slot.
+
+#define TIMER_LEVELS     4
+#define TIMER_SLOT_BITS  6
+#define TIMER_SLOTS      (1 << TIMER_SLOT_BITS)
+#define TIMER_SLOT_MASK  (TIMER_SLOTS - 1)
+#define TIMER_MAX_DELTA  (((uint64_t) 1 << (TIMER_LEVELS * TIMER_SLOT_BITS)) - 1)
+#define TIMER_CHUNK_BITS 8
+#define TIMER_CHUNK      (1 << TIMER_CHUNK_BITS)
+
+struct timer_node {
+	MTY_Link link;
+	MTY_LinkList *list;
+
+	uint64_t expires;
+	uint32_t index;
+	uint32_t gen;
+
+	MTY_TimerFunc func;
+	void *opaque;
+};
+
+struct timer_fire {
+	uint64_t id;
+	MTY_TimerFunc func;
+	void *opaque;
+};
+
+struct MTY_TimerWheel {
+	MTY_Mutex *mutex;
+	MTY_Waitable *waitable;
+
+	uint32_t resolution;
+	int64_t base;
+	uint64_t tick;
+	uint32_t active;
+
+	MTY_LinkList slots[TIMER_LEVELS][TIMER_SLOTS];
+	MTY_LinkList free;
+
+	struct timer_node **chunks;
+	uint32_t num_chunks;
+
+	struct timer_fire *fired;
+	uint32_t fired_len;
+	uint32_t num_fired;
+};
+
+#define TIMER_NODE(ptr) \
+	MTY_LINK_ENTRY(ptr, struct timer_node, link)
+
+#define TIMER_ID(node) \
+	(((uint64_t) (node)->gen << 32) | ((uint64_t) (node)->index + 1))
+
+
+// Nodes
+
+static struct timer_node *timer_node_alloc(MTY_TimerWheel *ctx)
+{
+	if (!ctx->free.first) {
+		ctx->chunks = MTY_Realloc(ctx->chunks, ctx->num_chunks + 1, sizeof(struct timer_node *));
+
+		struct timer_node *chunk = MTY_Alloc(TIMER_CHUNK, sizeof(struct timer_node));
+		ctx->chunks[ctx->num_chunks] = chunk;
+
+		for (uint32_t x = 0; x < TIMER_CHUNK; x++) {
+			chunk[x].index = ctx->num_chunks * TIMER_CHUNK + x;
+			chunk[x].gen = 1;
+			MTY_LinkListAppend(&ctx->free, &chunk[x].link);
+		}
+
+		ctx->num_chunks++;
+	}
+
+	struct timer_node *node = TIMER_NODE(ctx->free.first);
+	MTY_LinkListRemove(&ctx->free, &node->link);
+
+	return node;
+}
+
+static void timer_node_free(MTY_TimerWheel *ctx, struct timer_node *node)
+{
+	// Bumping the generation invalidates any outstanding id for this node
+	node->gen++;
+	node->list = NULL;
+	node->func = NULL;
+	node->opaque = NULL;
+
+	MTY_LinkListPrepend(&ctx->free, &node->link);
+}
+
+static struct timer_node *timer_node_lookup(MTY_TimerWheel *ctx, uint64_t id)
+{
+	uint32_t index = (uint32_t) id - 1;
+	uint32_t chunk = index >> TIMER_CHUNK_BITS;
+
+	if (id == 0 || chunk >= ctx->num_chunks)
+		return NULL;
+
+	struct timer_node *node = &ctx->chunks[chunk][index & (TIMER_CHUNK - 1)];
+
+	return node->list && node->gen == (uint32_t) (id >> 32) ? node : NULL;
+}
+
+
+// Wheel
+
+static uint64_t timer_now(MTY_TimerWheel *ctx)
+{
+	int64_t diff = MTY_GetTimeNs() - ctx->base;
+
+	return diff > 0 ? (uint64_t) diff / (ctx->resolution * (uint64_t) 1000000) : 0;
+}
+
+static void timer_schedule(MTY_TimerWheel *ctx, struct timer_node *node, uint32_t timeout)
+{
+	node->expires = timer_now(ctx) + (timeout + ctx->resolution - 1) / ctx->resolution;
+
+	// The current tick's slot has already run
+	if (node->expires <= ctx->tick)
+		node->expires = ctx->tick + 1;
+}
+
+static void timer_place(MTY_TimerWheel *ctx, struct timer_node *node)
+{
+	uint64_t delta = node->expires > ctx->tick ? node->expires - ctx->tick : 0;
+
+	// Timers beyond the wheel's span park in the top level and are re-placed
+	// by each cascade until they are in range, `expires` is left untouched
+	if (delta > TIMER_MAX_DELTA)
+		delta = TIMER_MAX_DELTA;
+
+	uint8_t level = 0;
+	while (level < TIMER_LEVELS - 1 && delta >= (uint64_t) 1 << ((level + 1) * TIMER_SLOT_BITS))
+		level++;
+
+	// Timers cascaded down exactly on their expiry tick land in the slot about to run
+	uint64_t expires = delta > 0 ? ctx->tick + delta : ctx->tick;
+	uint32_t slot = (expires >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK;
+
+	node->list = &ctx->slots[level][slot];
+	MTY_LinkListAppend(node->list, &node->link);
+}
+
+static void timer_cascade(MTY_TimerWheel *ctx, uint8_t level, uint32_t slot)
+{
+	MTY_LinkList list = {0};
+	MTY_LinkListSplice(&list, &ctx->slots[level][slot]);
+
+	for (MTY_Link *l = list.first; l;) {
+		MTY_Link *next = l->next;
+		timer_place(ctx, TIMER_NODE(l));
+		l = next;
+	}
+}
+
+static void timer_fire(MTY_TimerWheel *ctx, struct timer_node *node)
+{
+	if (ctx->num_fired == ctx->fired_len) {
+		ctx->fired_len = ctx->fired_len ? ctx->fired_len * 2 : 64;
+		ctx->fired = MTY_Realloc(ctx->fired, ctx->fired_len, sizeof(struct timer_fire));
+	}
+
+	struct timer_fire *f = &ctx->fired[ctx->num_fired++];
+	f->id = TIMER_ID(node);
+	f->func = node->func;
+	f->opaque = node->opaque;
+
+	MTY_LinkListRemove(node->list, &node->link);
+	timer_node_free(ctx, node);
+	ctx->active--;
+}
+
+static void timer_advance(MTY_TimerWheel *ctx, uint64_t target)
+{
+	while (ctx->tick < target) {
+		// Nothing to expire, skip straight to the target tick
+		if (ctx->active == 0) {
+			ctx->tick = target;
+			break;
+		}
+
+		ctx->tick++;
+
+		for (uint8_t level = 1; level < TIMER_LEVELS; level++) {
+			if ((ctx->tick & (((uint64_t) 1 << (level * TIMER_SLOT_BITS)) - 1)) != 0)
+				break;
+
+			timer_cascade(ctx, level, (ctx->tick >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK);
+		}
+
+		MTY_LinkList *slot = &ctx->slots[0][ctx->tick & TIMER_SLOT_MASK];
+
+		while (slot->first)
+			timer_fire(ctx, TIMER_NODE(slot->first));
+	}
+}
+
+static int32_t timer_next_timeout(MTY_TimerWheel *ctx, uint64_t now)
+{
+	if (ctx->active == 0)
+		return -1;
+
+	// Exact for level 0, for higher levels the next cascade is a safe lower bound
+	for (uint8_t level = 0; level < TIMER_LEVELS; level++) {
+		uint8_t shift = level * TIMER_SLOT_BITS;
+
+		for (uint32_t x = 1; x <= TIMER_SLOTS; x++) {
+			uint64_t tick = ((ctx->tick >> shift) + x) << shift;
+
+			if (ctx->slots[level][(tick >> shift) & TIMER_SLOT_MASK].first) {
+				if (level == 0)
+					tick = ctx->tick + x;
+
+				return tick > now ? (int32_t) MTY_MIN((tick - now) * ctx->resolution, INT32_MAX) : 0;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+// Public
+
+MTY_TimerWheel *MTY_TimerWheelCreate(uint32_t resolution)
+{
+	MTY_TimerWheel *ctx = MTY_Alloc(1, sizeof(MTY_TimerWheel));
+	ctx->resolution = resolution > 0 ? resolution : 1;
+	ctx->base = MTY_GetTimeNs();
+
+	ctx->mutex = MTY_MutexCreate();
+	ctx->waitable = MTY_WaitableCreate();
+
+	return ctx;
+}
+
+void MTY_TimerWheelDestroy(MTY_TimerWheel **wheel)
+{
+	if (!wheel || !*wheel)
+		return;
+
+	MTY_TimerWheel *ctx = *wheel;
+
+	for (uint32_t x = 0; x < ctx->num_chunks; x++)
+		MTY_Free(ctx->chunks[x]);
+
+	MTY_Free(ctx->chunks);
+	MTY_Free(ctx->fired);
+
+	MTY_WaitableDestroy(&ctx->waitable);
+	MTY_MutexDestroy(&ctx->mutex);
+
+	MTY_Free(ctx);
+	*wheel = NULL;
+}
+
+uint64_t MTY_TimerWheelStart(MTY_TimerWheel *ctx, uint32_t timeout, MTY_TimerFunc func, void *opaque)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	struct timer_node *node = timer_node_alloc(ctx);
+	node->func = func;
+	node->opaque = opaque;
+	timer_schedule(ctx, node, timeout);
+	timer_place(ctx, node);
+	ctx->active++;
+
+	uint64_t id = TIMER_ID(node);
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	// A thread in MTY_TimerWheelWait may need to wake earlier than planned
+	MTY_WaitableSignal(ctx->waitable);
+
+	return id;
+}
+
+bool MTY_TimerWheelReset(MTY_TimerWheel *ctx, uint64_t timer, uint32_t timeout)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	struct timer_node *node = timer_node_lookup(ctx, timer);
+
+	if (node) {
+		MTY_LinkListRemove(node->list, &node->link);
+
+		timer_schedule(ctx, node, timeout);
+		timer_place(ctx, node);
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	if (node)
+		MTY_WaitableSignal(ctx->waitable);
+
+	return node != NULL;
+}
+
+bool MTY_TimerWheelCancel(MTY_TimerWheel *ctx, uint64_t timer)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	struct timer_node *node = timer_node_lookup(ctx, timer);
+
+	if (node) {
+		MTY_LinkListRemove(node->list, &node->link);
+		timer_node_free(ctx, node);
+		ctx->active--;
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return node != NULL;
+}
+
+uint32_t MTY_TimerWheelRun(MTY_TimerWheel *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	timer_advance(ctx, timer_now(ctx));
+
+	// Callbacks run outside the lock so they may start or cancel timers
+	uint32_t n = ctx->num_fired;
+	struct timer_fire *fired = ctx->fired;
+
+	ctx->fired = NULL;
+	ctx->fired_len = 0;
+	ctx->num_fired = 0;
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	for (uint32_t x = 0; x < n; x++)
+		fired[x].func(fired[x].id, fired[x].opaque);
+
+	MTY_Free(fired);
+
+	return n;
+}
+
+int32_t MTY_TimerWheelGetTimeout(MTY_TimerWheel *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	int32_t timeout = timer_next_timeout(ctx, timer_now(ctx));
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return timeout;
+}
+
+bool MTY_TimerWheelWait(MTY_TimerWheel *ctx, int32_t timeout)
+{
+	int32_t next = MTY_TimerWheelGetTimeout(ctx);
+
+	if (next >= 0 && (timeout < 0 || next < timeout))
+		timeout = next;
+
+	if (timeout == 0)
+		return true;
+
+	MTY_WaitableWait(ctx->waitable, timeout);
+
+	return MTY_TimerWheelGetTimeout(ctx) == 0;
+}
+
+void MTY_TimerWheelWake(MTY_TimerWheel *ctx)
+{
+	MTY_WaitableSignal(ctx->waitable);
+}
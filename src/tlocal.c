@@ -8,33 +8,130 @@
 #include "tlocal.h"
 
 #include <string.h>
-#include <stdio.h>
 
-#define TLOCAL_MAX (8 * 1024)
+// Per-thread scratch stack. The first chunk is static thread local storage, further
+// chunks are heap allocated when an allocation doesn't fit and freed once the scope
+// that needed them is popped. Positions ("marks") are counted across all chunks, each
+// chunk starts at the position the previous one had reached when it was added.
+
+#define TLOCAL_MAX   (8 * 1024)
+#define TLOCAL_ALIGN 16
+
+struct tlocal_chunk {
+	struct tlocal_chunk *prev;
+	uint8_t *data;
+	size_t size;
+	size_t base;
+	size_t offset;
+};
+
+struct tlocal_stack {
+	struct tlocal_chunk first;
+	struct tlocal_chunk *top;
+
+	uint32_t depth;
+	size_t capacity;
+	size_t high;
+};
 
 static TLOCAL uint8_t TLOCAL_HEAP[TLOCAL_MAX];
-static TLOCAL size_t TLOCAL_OFFSET;
+static TLOCAL struct tlocal_stack TLOCAL_STACK;
 
-void *mty_tlocal(size_t size)
+
+// Stack
+
+static struct tlocal_stack *tlocal_stack(void)
+{
+	struct tlocal_stack *s = &TLOCAL_STACK;
+
+	if (!s->top) {
+		s->first.data = TLOCAL_HEAP;
+		s->first.size = TLOCAL_MAX;
+		s->capacity = TLOCAL_MAX;
+		s->top = &s->first;
+	}
+
+	return s;
+}
+
+static size_t tlocal_position(struct tlocal_stack *s)
+{
+	return s->top->base + s->top->offset;
+}
+
+static void tlocal_pop(struct tlocal_stack *s, size_t mark)
 {
-	if (TLOCAL_OFFSET + size > TLOCAL_MAX)
-		TLOCAL_OFFSET = 0;
+	while (s->top != &s->first && s->top->base >= mark) {
+		struct tlocal_chunk *chunk = s->top;
+		s->top = chunk->prev;
+		s->capacity -= chunk->size;
+
+		MTY_Free(chunk);
+	}
+
+	if (mark < tlocal_position(s))
+		s->top->offset = mark - s->top->base;
+}
+
+static void *tlocal_fit(struct tlocal_chunk *chunk, size_t size)
+{
+	uintptr_t start = (uintptr_t) chunk->data + chunk->offset;
+	size_t pad = MTY_ALIGN16(start) - start;
+
+	if (chunk->offset + pad + size > chunk->size)
+		return NULL;
+
+	chunk->offset += pad + size;
+
+	return (void *) (start + pad);
+}
+
+static void *tlocal_alloc(size_t size)
+{
+	struct tlocal_stack *s = tlocal_stack();
+
+	void *ptr = tlocal_fit(s->top, size);
+
+	// Outside of any scope the first chunk is reused from the beginning
+	if (!ptr && s->depth == 0) {
+		tlocal_pop(s, 0);
+		ptr = tlocal_fit(s->top, size);
+	}
+
+	if (!ptr) {
+		size_t chunk_size = MTY_MAX(TLOCAL_MAX, size + TLOCAL_ALIGN);
+
+		struct tlocal_chunk *chunk = MTY_Alloc(1, sizeof(struct tlocal_chunk) + chunk_size);
+		chunk->prev = s->top;
+		chunk->data = (uint8_t *) (chunk + 1);
+		chunk->size = chunk_size;
+		chunk->base = tlocal_position(s);
 
-	void *ptr = TLOCAL_HEAP + TLOCAL_OFFSET;
-	TLOCAL_OFFSET += size;
+		s->top = chunk;
+		s->capacity += chunk_size;
+
+		ptr = tlocal_fit(chunk, size);
+	}
+
+	s->high = MTY_MAX(s->high, tlocal_position(s));
 
 	return ptr;
 }
 
+
+// Internal
+
+void *mty_tlocal(size_t size)
+{
+	return tlocal_alloc(size);
+}
+
 char *mty_tlocal_strcpy(const char *str)
 {
 	size_t len = strlen(str) + 1;
 
-	if (len > TLOCAL_MAX)
-		len = TLOCAL_MAX;
-
 	char *local = mty_tlocal(len);
-	snprintf(local, len, "%s", str);
+	memcpy(local, str, len);
 
 	return local;
 }
@@ -48,3 +145,48 @@ char *mty_tlocal_strcpyw(wchar_t *wstr)
 
 	return local;
 }
+
+
+// Public
+
+size_t MTY_ScratchPush(void)
+{
+	struct tlocal_stack *s = tlocal_stack();
+	s->depth++;
+
+	return tlocal_position(s);
+}
+
+void MTY_ScratchPop(size_t mark)
+{
+	struct tlocal_stack *s = tlocal_stack();
+
+	if (s->depth == 0) {
+		MTY_Log("Scratch scope popped without a matching push");
+		return;
+	}
+
+	tlocal_pop(s, mark);
+	s->depth--;
+}
+
+void *MTY_ScratchAlloc(size_t size)
+{
+	void *ptr = tlocal_alloc(size);
+	memset(ptr, 0, size);
+
+	return ptr;
+}
+
+void MTY_ScratchGetStats(MTY_ScratchStats *stats, bool reset)
+{
+	struct tlocal_stack *s = tlocal_stack();
+
+	stats->used = tlocal_position(s);
+	stats->highWater = s->high;
+	stats->capacity = s->capacity;
+	stats->depth = s->depth;
+
+	if (reset)
+		s->high = stats->used;
+}
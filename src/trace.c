@@ -0,0 +1,271 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+#include "tlocal.h"
+#include "atomic.h"
+
+// Every thread that records an event gets a ring of events that only it writes to,
+// publishing each one by bumping the ring's count. A new trace generation tells each
+// thread to reset its ring the next time it records. When an MTY_Thread exits its ring
+// is returned to a pool, keeping its events so they can still be serialized. Pooled
+// rings release their events when the next trace starts and are handed to new threads.
+// Rings of threads not created via MTY_Thread are kept for the life of the process.
+
+#define TRACE_DEFAULT_EVENTS (16 * 1024)
+
+struct trace_event {
+	int64_t ts;
+	const char *name;
+	double value;
+	MTY_TraceEventType type;
+};
+
+struct trace_buffer {
+	struct trace_buffer *next;
+	struct trace_event *events;
+	uint32_t len;
+	uint32_t gen;
+	uint32_t tid;
+	bool pooled;
+
+	MTY_Atomic64 count;
+};
+
+struct trace_output {
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+static MTY_Atomic32 TRACE_LOCK;
+static MTY_Atomic32 TRACE_ACTIVE;
+static MTY_Atomic32 TRACE_GEN;
+static uint32_t TRACE_MAX_EVENTS;
+static uint32_t TRACE_THREADS;
+static int64_t TRACE_START;
+static struct trace_buffer *TRACE_BUFFERS;
+
+static TLOCAL struct trace_buffer *TRACE_BUFFER;
+
+
+// Recording
+
+static struct trace_buffer *trace_buffer(void)
+{
+	struct trace_buffer *b = TRACE_BUFFER;
+
+	if (b && b->gen == (uint32_t) mty_atomic32_load(&TRACE_GEN, MTY_MEMORY_ORDER_ACQUIRE))
+		return b;
+
+	MTY_GlobalLock(&TRACE_LOCK);
+
+	uint32_t gen = mty_atomic32_load(&TRACE_GEN, MTY_MEMORY_ORDER_RELAXED);
+
+	if (!b) {
+		// A pooled ring can be taken once its events are from an older trace
+		for (struct trace_buffer *p = TRACE_BUFFERS; p && !b; p = p->next)
+			if (p->pooled && p->gen != gen)
+				b = p;
+
+		if (!b) {
+			b = MTY_Alloc(1, sizeof(struct trace_buffer));
+			b->next = TRACE_BUFFERS;
+			TRACE_BUFFERS = b;
+		}
+
+		b->pooled = false;
+		b->tid = ++TRACE_THREADS;
+		TRACE_BUFFER = b;
+	}
+
+	if (b->len != TRACE_MAX_EVENTS) {
+		MTY_Free(b->events);
+		b->events = MTY_Alloc(TRACE_MAX_EVENTS, sizeof(struct trace_event));
+		b->len = TRACE_MAX_EVENTS;
+	}
+
+	b->gen = gen;
+	mty_atomic64_store(&b->count, 0, MTY_MEMORY_ORDER_RELAXED);
+
+	MTY_GlobalUnlock(&TRACE_LOCK);
+
+	return b;
+}
+
+void MTY_TraceEvent(MTY_TraceEventType type, const char *name, double value)
+{
+	if (!mty_atomic32_load(&TRACE_ACTIVE, MTY_MEMORY_ORDER_RELAXED))
+		return;
+
+	struct trace_buffer *b = trace_buffer();
+
+	int64_t n = mty_atomic64_load(&b->count, MTY_MEMORY_ORDER_RELAXED);
+
+	struct trace_event *e = &b->events[n % b->len];
+	e->ts = MTY_GetTimeNs();
+	e->name = name;
+	e->value = value;
+	e->type = type;
+
+	mty_atomic64_store(&b->count, n + 1, MTY_MEMORY_ORDER_RELEASE);
+}
+
+void MTY_TraceStart(uint32_t maxEvents)
+{
+	MTY_GlobalLock(&TRACE_LOCK);
+
+	TRACE_MAX_EVENTS = maxEvents > 0 ? maxEvents : TRACE_DEFAULT_EVENTS;
+	TRACE_START = MTY_GetTimeNs();
+
+	// Events of exited threads are only serialized until a new trace starts
+	for (struct trace_buffer *b = TRACE_BUFFERS; b; b = b->next) {
+		if (b->pooled) {
+			MTY_Free(b->events);
+			b->events = NULL;
+			b->len = 0;
+		}
+	}
+
+	mty_atomic32_fetch_add(&TRACE_GEN, 1, MTY_MEMORY_ORDER_RELEASE);
+	mty_atomic32_store(&TRACE_ACTIVE, 1, MTY_MEMORY_ORDER_RELEASE);
+
+	MTY_GlobalUnlock(&TRACE_LOCK);
+}
+
+void MTY_TraceStop(void)
+{
+	mty_atomic32_store(&TRACE_ACTIVE, 0, MTY_MEMORY_ORDER_RELEASE);
+}
+
+
+// Internal
+
+void mty_trace_thread_exit(void)
+{
+	struct trace_buffer *b = TRACE_BUFFER;
+
+	if (!b)
+		return;
+
+	MTY_GlobalLock(&TRACE_LOCK);
+	b->pooled = true;
+	MTY_GlobalUnlock(&TRACE_LOCK);
+
+	TRACE_BUFFER = NULL;
+}
+
+
+// Serialization
+
+static void trace_write(struct trace_output *out, const char *fmt, ...)
+{
+	while (true) {
+		va_list args;
+		va_start(args, fmt);
+		int32_t r = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+		va_end(args);
+
+		if (r < 0)
+			return;
+
+		if (out->len + r < out->size) {
+			out->len += r;
+			return;
+		}
+
+		out->size = MTY_MAX(out->size * 2, out->len + r + 1);
+		out->buf = MTY_Realloc(out->buf, out->size, 1);
+	}
+}
+
+static void trace_write_name(struct trace_output *out, const char *name)
+{
+	trace_write(out, "\"");
+
+	for (const char *c = name ? name : ""; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			trace_write(out, "\\%c", *c);
+
+		} else if ((uint8_t) *c < 0x20) {
+			trace_write(out, "\\u%04x", (uint8_t) *c);
+
+		} else {
+			trace_write(out, "%c", *c);
+		}
+	}
+
+	trace_write(out, "\"");
+}
+
+static void trace_write_event(struct trace_output *out, const struct trace_event *e, uint32_t tid, bool first)
+{
+	static const char *PHASES[] = {"B", "E", "C", "i"};
+
+	trace_write(out, "%s\n{\"name\":", first ? "" : ",");
+	trace_write_name(out, e->name);
+	trace_write(out, ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u", PHASES[e->type & 3],
+		(double) (e->ts - TRACE_START) / 1000.0, tid);
+
+	if (e->type == MTY_TRACE_EVENT_COUNTER) {
+		trace_write(out, ",\"args\":{\"value\":%.17g}", e->value);
+
+	} else if (e->type == MTY_TRACE_EVENT_INSTANT) {
+		trace_write(out, ",\"s\":\"t\"");
+	}
+
+	trace_write(out, "}");
+}
+
+char *MTY_TraceSerialize(void)
+{
+	struct trace_output out = {0};
+	out.size = 4096;
+	out.buf = MTY_Alloc(out.size, 1);
+
+	trace_write(&out, "{\"traceEvents\":[");
+
+	MTY_GlobalLock(&TRACE_LOCK);
+
+	uint32_t gen = mty_atomic32_load(&TRACE_GEN, MTY_MEMORY_ORDER_RELAXED);
+	bool first = true;
+
+	for (struct trace_buffer *b = TRACE_BUFFERS; b; b = b->next) {
+		if (gen == 0 || b->gen != gen)
+			continue;
+
+		// Once the ring has wrapped only the newest events are left
+		int64_t count = mty_atomic64_load(&b->count, MTY_MEMORY_ORDER_ACQUIRE);
+		int64_t begin = count > b->len ? count - b->len : 0;
+
+		for (int64_t x = begin; x < count; x++) {
+			trace_write_event(&out, &b->events[x % b->len], b->tid, first);
+			first = false;
+		}
+	}
+
+	MTY_GlobalUnlock(&TRACE_LOCK);
+
+	trace_write(&out, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+	return out.buf;
+}
+
+bool MTY_TraceExport(const char *path)
+{
+	char *json = MTY_TraceSerialize();
+
+	bool r = MTY_WriteFile(path, json, strlen(json));
+
+	MTY_Free(json);
+
+	return r;
+}
@@ -8,6 +8,8 @@
 
 #include <AudioToolbox/AudioToolbox.h>
 
+#include "metrics.h"
+
 #define AUDIO_CHANNELS    2
 #define AUDIO_SAMPLE_SIZE sizeof(int16_t)
 
@@ -114,12 +116,17 @@ void MTY_AudioReset(MTY_Audio *ctx)
 
 void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 {
+	MTY_TraceBegin("MTY_AudioQueue");
+
 	size_t size = count * AUDIO_CHANNELS * AUDIO_SAMPLE_SIZE;
 	uint32_t queued = audio_get_queued_frames(ctx);
+	MTY_TraceCounter("MTY_AudioQueue:queued", queued);
 
 	// Stop playing and flush if we've exceeded the maximum buffer or underrun
-	if (ctx->playing && (queued > ctx->max_buffer || queued == 0))
+	if (ctx->playing && (queued > ctx->max_buffer || queued == 0)) {
+		mty_metric_add(queued == 0 ? METRIC_AUDIO_UNDERRUNS : METRIC_AUDIO_OVERFLOWS, 1);
 		MTY_AudioReset(ctx);
+	}
 
 	if (size <= AUDIO_BUF_SIZE) {
 		for (uint8_t x = 0; x < AUDIO_BUFS; x++) {
@@ -145,6 +152,8 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 		if (!ctx->playing && queued + count >= ctx->min_buffer)
 			audio_play(ctx);
 	}
+
+	MTY_TraceEnd("MTY_AudioQueue");
 }
 
 void MTY_AudioDestroy(MTY_Audio **audio)
@@ -0,0 +1,83 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <errno.h>
+#include <dirent.h>
+
+#include <sys/stat.h>
+
+#define DIRREAD_DELIM '/'
+
+struct dirread {
+	DIR *dir;
+};
+
+static struct dirread *mty_dirread_open(const char *path)
+{
+	DIR *dir = opendir(path);
+	if (!dir) {
+		MTY_Log("'opendir' failed with errno %d", errno);
+		return NULL;
+	}
+
+	struct dirread *ctx = MTY_Alloc(1, sizeof(struct dirread));
+	ctx->dir = dir;
+
+	return ctx;
+}
+
+static void mty_dirread_close(struct dirread **dirread)
+{
+	if (!dirread || !*dirread)
+		return;
+
+	struct dirread *ctx = *dirread;
+
+	closedir(ctx->dir);
+
+	MTY_Free(ctx);
+	*dirread = NULL;
+}
+
+static MTY_FileType dirread_type(struct dirread *ctx, const char *name, uint8_t type)
+{
+	// Some filesystems don't store the type in the directory
+	if (type == DT_UNKNOWN) {
+		struct stat st;
+		if (fstatat(dirfd(ctx->dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+			return MTY_FILE_TYPE_UNKNOWN;
+
+		type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR :
+			S_ISLNK(st.st_mode) ? DT_LNK : DT_FIFO;
+	}
+
+	switch (type) {
+		case DT_REG: return MTY_FILE_TYPE_FILE;
+		case DT_DIR: return MTY_FILE_TYPE_DIR;
+		case DT_LNK: return MTY_FILE_TYPE_LINK;
+	}
+
+	return MTY_FILE_TYPE_OTHER;
+}
+
+static const char *mty_dirread_next(struct dirread *ctx, MTY_FileType *type)
+{
+	errno = 0;
+
+	struct dirent *ent = readdir(ctx->dir);
+	if (!ent) {
+		if (errno != 0)
+			MTY_Log("'readdir' failed with errno %d", errno);
+
+		return NULL;
+	}
+
+	*type = dirread_type(ctx, ent->d_name, ent->d_type);
+
+	return ent->d_name;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/event.h>
+
+#define FIBERPOLL_EVENTS 64
+
+struct fiberpoll {
+	int32_t kq;
+};
+
+static struct fiberpoll *mty_fiberpoll_create(void)
+{
+	int32_t kq = kqueue();
+	if (kq == -1) {
+		MTY_Log("'kqueue' failed with errno %d", errno);
+		return NULL;
+	}
+
+	struct fiberpoll *ctx = MTY_Alloc(1, sizeof(struct fiberpoll));
+	ctx->kq = kq;
+
+	return ctx;
+}
+
+static void mty_fiberpoll_destroy(struct fiberpoll **fiberpoll)
+{
+	if (!fiberpoll || !*fiberpoll)
+		return;
+
+	struct fiberpoll *ctx = *fiberpoll;
+
+	close(ctx->kq);
+
+	MTY_Free(ctx);
+	*fiberpoll = NULL;
+}
+
+static bool mty_fiberpoll_add(struct fiberpoll *ctx, intptr_t fd, bool out, void *opaque)
+{
+	// One-shot events are deleted by the kernel when they fire
+	struct kevent ev;
+	EV_SET(&ev, fd, out ? EVFILT_WRITE : EVFILT_READ, EV_ADD | EV_ONESHOT, 0, 0, opaque);
+
+	if (kevent(ctx->kq, &ev, 1, NULL, 0, NULL) != 0) {
+		MTY_Log("'kevent' failed with errno %d", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static void mty_fiberpoll_remove(struct fiberpoll *ctx, intptr_t fd, bool out)
+{
+	struct kevent ev;
+	EV_SET(&ev, fd, out ? EVFILT_WRITE : EVFILT_READ, EV_DELETE, 0, 0, NULL);
+
+	if (kevent(ctx->kq, &ev, 1, NULL, 0, NULL) != 0)
+		MTY_Log("'kevent' failed with errno %d", errno);
+}
+
+static uint32_t mty_fiberpoll_wait(struct fiberpoll *ctx, int32_t timeout, void **ready, uint32_t max)
+{
+	struct kevent evs[FIBERPOLL_EVENTS];
+
+	struct timespec ts = {0};
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000 * 1000;
+
+	int32_t n = kevent(ctx->kq, NULL, 0, evs, MTY_MIN(max, FIBERPOLL_EVENTS), timeout < 0 ? NULL : &ts);
+	if (n < 0) {
+		if (errno != EINTR)
+			MTY_Log("'kevent' failed with errno %d", errno);
+
+		return 0;
+	}
+
+	for (int32_t x = 0; x < n; x++)
+		ready[x] = evs[x].udata;
+
+	return n;
+}
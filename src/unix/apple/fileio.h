@@ -0,0 +1,115 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+
+// Files
+
+static intptr_t mty_fileio_open(const char *path, bool write)
+{
+	int32_t fd = open(path, write ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0664);
+	if (fd == -1) {
+		MTY_Log("'open' failed with errno %d", errno);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void mty_fileio_close(intptr_t fd)
+{
+	close(fd);
+}
+
+static int64_t mty_fileio_read(intptr_t fd, void *buf, size_t size, uint64_t offset)
+{
+	size_t total = 0;
+
+	while (total < size) {
+		ssize_t n = pread(fd, (uint8_t *) buf + total, size - total, offset + total);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			MTY_Log("'pread' failed with errno %d", errno);
+			return -1;
+		}
+
+		if (n == 0)
+			break;
+
+		total += n;
+	}
+
+	return total;
+}
+
+static int64_t mty_fileio_write(intptr_t fd, const void *buf, size_t size, uint64_t offset)
+{
+	size_t total = 0;
+
+	while (total < size) {
+		ssize_t n = pwrite(fd, (const uint8_t *) buf + total, size - total, offset + total);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			MTY_Log("'pwrite' failed with errno %d", errno);
+			return -1;
+		}
+
+		total += n;
+	}
+
+	return total;
+}
+
+
+// No io_uring, requests are serviced by threads
+
+struct fileio_ring;
+
+static struct fileio_ring *mty_fileio_ring_create(uint32_t depth)
+{
+	return NULL;
+}
+
+static void mty_fileio_ring_destroy(struct fileio_ring **ring)
+{
+}
+
+static uint32_t mty_fileio_ring_entries(struct fileio_ring *ctx)
+{
+	return 0;
+}
+
+static bool mty_fileio_ring_register(struct fileio_ring *ctx, void **buffers, const size_t *sizes, uint32_t count)
+{
+	return false;
+}
+
+static void mty_fileio_ring_push(struct fileio_ring *ctx, intptr_t fd, bool write, void *buf,
+	size_t size, uint64_t offset, int32_t buf_index, void *opaque)
+{
+}
+
+static uint32_t mty_fileio_ring_submit(struct fileio_ring *ctx)
+{
+	return 0;
+}
+
+static uint32_t mty_fileio_ring_wait(struct fileio_ring *ctx, int32_t timeout, MTY_FileIOResult *results,
+	uint32_t max)
+{
+	return 0;
+}
@@ -37,7 +37,7 @@ struct gfx_ui *mty_metal_ui_create(MTY_Device *device)
 	id<MTLLibrary> library = [_device newLibraryWithSource:[NSString stringWithUTF8String:MTL_LIBRARY] options:nil error:&error];
 	if (error) {
 		r = false;
-		MTY_Log([[error localizedDescription] UTF8String]);
+		MTY_Log("%s", [[error localizedDescription] UTF8String]);
 		goto except;
 	}
 
@@ -68,7 +68,7 @@ struct gfx_ui *mty_metal_ui_create(MTY_Device *device)
 	ctx->rps = [_device newRenderPipelineStateWithDescriptor:pdesc error:&error];
 	if (error) {
 		r = false;
-		MTY_Log([[error localizedDescription] UTF8String]);
+		MTY_Log("%s", [[error localizedDescription] UTF8String]);
 		goto except;
 	}
 
@@ -63,7 +63,7 @@ struct gfx *mty_metal_create(MTY_Device *device)
 	ctx->library = [_device newLibraryWithSource:[NSString stringWithUTF8String:MTL_LIBRARY] options:nil error:&nse];
 	if (nse) {
 		r = false;
-		MTY_Log([[nse localizedDescription] UTF8String]);
+		MTY_Log("%s", [[nse localizedDescription] UTF8String]);
 		goto except;
 	}
 
@@ -107,7 +107,7 @@ struct gfx *mty_metal_create(MTY_Device *device)
 	ctx->pipeline = [_device newRenderPipelineStateWithDescriptor:pdesc error:&nse];
 	if (nse) {
 		r = false;
-		MTY_Log([[nse localizedDescription] UTF8String]);
+		MTY_Log("%s", [[nse localizedDescription] UTF8String]);
 		goto except;
 	}
 
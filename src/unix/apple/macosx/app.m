@@ -188,10 +188,16 @@ static void app_fix_mouse_buttons(App *ctx)
 
 	- (void)appFunc:(NSTimer *)timer
 	{
+		MTY_TraceBegin("MTY_AppRun");
+
 		app_poll_clipboard(self);
 		app_fix_mouse_buttons(self);
 
+		MTY_TraceBegin("MTY_AppFunc");
 		self.cont = self.app_func(self.opaque);
+		MTY_TraceEnd("MTY_AppFunc");
+
+		MTY_TraceEnd("MTY_AppRun");
 
 		if (!self.cont) {
 			// Post a dummy event to spin the event loop
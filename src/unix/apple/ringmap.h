@@ -0,0 +1,75 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+
+static size_t mty_ringmap_granularity(void)
+{
+	long page = sysconf(_SC_PAGESIZE);
+
+	return page > 0 ? page : 4096;
+}
+
+static void *mty_ringmap_create(size_t size)
+{
+	uint64_t id = 0;
+	MTY_GetRandomBytes(&id, sizeof(uint64_t));
+
+	char name[32];
+	snprintf(name, 32, "/mty-%016llx", (unsigned long long) id);
+
+	int32_t fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd == -1) {
+		MTY_Log("'shm_open' failed with errno %d", errno);
+		return NULL;
+	}
+
+	// The object only needs to live as long as its mappings
+	shm_unlink(name);
+
+	uint8_t *base = NULL;
+
+	if (ftruncate(fd, size) != 0) {
+		MTY_Log("'ftruncate' failed with errno %d", errno);
+		goto except;
+	}
+
+	// Reserve the whole range first so the two views are guaranteed to be adjacent
+	base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (base == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		base = NULL;
+		goto except;
+	}
+
+	for (uint8_t x = 0; x < 2; x++) {
+		if (mmap(base + x * size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			MTY_Log("'mmap' failed with errno %d", errno);
+			munmap(base, size * 2);
+			base = NULL;
+			break;
+		}
+	}
+
+	except:
+
+	close(fd);
+
+	return base;
+}
+
+static void mty_ringmap_destroy(void *base, size_t size)
+{
+	if (munmap(base, size * 2) != 0)
+		MTY_Log("'munmap' failed with errno %d", errno);
+}
@@ -0,0 +1,59 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <pthread/qos.h>
+
+static bool mty_threadattr_set_name(const char *name)
+{
+	int32_t e = pthread_setname_np(name);
+	if (e != 0) {
+		MTY_Log("'pthread_setname_np' failed with error %d", e);
+		return false;
+	}
+
+	return true;
+}
+
+static bool mty_threadattr_set_affinity(uint64_t affinity)
+{
+	// The Mach affinity policy is only a grouping hint, threads can not be pinned
+	MTY_Log("Thread affinity is not supported on Apple platforms");
+
+	return false;
+}
+
+static bool mty_threadattr_set_priority(MTY_ThreadPriority priority)
+{
+	if (priority == MTY_THREAD_PRIORITY_REALTIME) {
+		struct sched_param param = {0};
+		param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+
+		int32_t e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (e != 0) {
+			MTY_Log("'pthread_setschedparam' failed with error %d", e);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Apple schedules normal threads by quality of service class
+	qos_class_t qos = priority == MTY_THREAD_PRIORITY_HIGH ? QOS_CLASS_USER_INTERACTIVE :
+		priority == MTY_THREAD_PRIORITY_LOW ? QOS_CLASS_UTILITY : QOS_CLASS_DEFAULT;
+
+	int32_t e = pthread_set_qos_class_self_np(qos, 0);
+	if (e != 0) {
+		MTY_Log("'pthread_set_qos_class_self_np' failed with error %d", e);
+		return false;
+	}
+
+	return true;
+}
@@ -22,3 +22,19 @@ static float mty_frequency(void)
 
 	return timebase.numer / timebase.denom / 1000000.0f;
 }
+
+static int64_t mty_timestamp_ns(void)
+{
+	static mach_timebase_info_data_t timebase;
+
+	if (timebase.denom == 0) {
+		kern_return_t e = mach_timebase_info(&timebase);
+		if (e != KERN_SUCCESS)
+			MTY_LogFatal("'mach_timebase_info' failed with error %d", e);
+	}
+
+	// Split so the multiplication can't overflow for long running processes
+	uint64_t t = mach_absolute_time();
+
+	return (t / timebase.denom) * timebase.numer + (t % timebase.denom) * timebase.numer / timebase.denom;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <string.h>
+
+// matoya.h inlines the explicit memory order atomics with the __atomic builtins
+
+#define mty_atomic32_load       MTY_Atomic32Load
+#define mty_atomic32_store      MTY_Atomic32Store
+#define mty_atomic32_exchange   MTY_Atomic32Exchange
+#define mty_atomic32_fetch_add  MTY_Atomic32FetchAdd
+#define mty_atomic32_fetch_or   MTY_Atomic32FetchOr
+#define mty_atomic32_fetch_and  MTY_Atomic32FetchAnd
+#define mty_atomic32_fetch_xor  MTY_Atomic32FetchXor
+#define mty_atomic32_cas        MTY_Atomic32CompareExchange
+
+#define mty_atomic64_load       MTY_Atomic64Load
+#define mty_atomic64_store      MTY_Atomic64Store
+#define mty_atomic64_exchange   MTY_Atomic64Exchange
+#define mty_atomic64_fetch_add  MTY_Atomic64FetchAdd
+#define mty_atomic64_fetch_or   MTY_Atomic64FetchOr
+#define mty_atomic64_fetch_and  MTY_Atomic64FetchAnd
+#define mty_atomic64_fetch_xor  MTY_Atomic64FetchXor
+#define mty_atomic64_cas        MTY_Atomic64CompareExchange
+
+#define mty_atomic_ptr_load     MTY_AtomicPtrLoad
+#define mty_atomic_ptr_store    MTY_AtomicPtrStore
+#define mty_atomic_ptr_exchange MTY_AtomicPtrExchange
+#define mty_atomic_ptr_cas      MTY_AtomicPtrCompareExchange
+
+#define mty_atomic_fence        MTY_AtomicFence
+
+#if defined(__x86_64__) || defined(__aarch64__)
+	#define ATOMIC_128_NATIVE
+#endif
+
+#if defined(ATOMIC_128_NATIVE)
+
+static inline bool mty_atomic128_cas(MTY_Atomic128 *atomic, MTY_Atomic128 *expected, MTY_Atomic128 desired)
+{
+	#if defined(__x86_64__)
+		// GCC only emits cmpxchg16b with -mcx16, otherwise it calls into libatomic
+		int64_t lo = expected->value[0];
+		int64_t hi = expected->value[1];
+		bool r;
+
+		__asm__ __volatile__ (
+			"lock cmpxchg16b %1\n\t"
+			"sete %0"
+			: "=q" (r), "+m" (*atomic), "+a" (lo), "+d" (hi)
+			: "b" (desired.value[0]), "c" (desired.value[1])
+			: "memory", "cc"
+		);
+
+		expected->value[0] = lo;
+		expected->value[1] = hi;
+
+		return r;
+
+	#else
+		// The __sync builtin is expanded inline on ARM64 by both GCC and Clang, GCC
+		// would route a 16-byte __atomic builtin through libatomic
+		unsigned __int128 cmp, val;
+		memcpy(&cmp, (void *) expected->value, sizeof(cmp));
+		memcpy(&val, (void *) desired.value, sizeof(val));
+
+		unsigned __int128 prev = __sync_val_compare_and_swap((unsigned __int128 *) atomic->value, cmp, val);
+
+		memcpy((void *) expected->value, &prev, sizeof(prev));
+
+		return prev == cmp;
+	#endif
+}
+
+#endif
@@ -0,0 +1,204 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS)
+	#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+// A suspended fiber keeps its callee saved registers on its own stack, so a switch
+// only has to push them, swap stack pointers and pop the other fiber's. ucontext
+// is avoided since it is deprecated on Apple, missing on Android and makes a
+// signal mask syscall on every switch.
+
+#if defined(__APPLE__)
+	#define FIBERCTX_SYM(name) "_" #name
+	#define FIBERCTX_DECL(name) ".private_extern " FIBERCTX_SYM(name) "\n"
+#else
+	#define FIBERCTX_SYM(name) #name
+	#define FIBERCTX_DECL(name) ".hidden " #name "\n.type " #name ", %function\n"
+#endif
+
+#if defined(__x86_64__)
+
+#define FIBERCTX_NATIVE
+#define FIBERCTX_FRAME 9
+
+__asm__(
+	".text\n"
+	".globl " FIBERCTX_SYM(mty_fiberctx_swap) "\n"
+	FIBERCTX_DECL(mty_fiberctx_swap)
+	".p2align 4\n"
+	FIBERCTX_SYM(mty_fiberctx_swap) ":\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+);
+
+static void *mty_fiberctx_frame(uint64_t *top, void (*entry)(void))
+{
+	// Return address slot so the entry sees the stack alignment of a normal call
+	uint64_t *sp = top - FIBERCTX_FRAME;
+	sp[8] = 0;
+	sp[7] = (uint64_t) entry;
+
+	// Default MXCSR and x87 control word
+	sp[0] = 0x1F80 | ((uint64_t) 0x037F << 32);
+
+	return sp;
+}
+
+#elif defined(__aarch64__)
+
+#define FIBERCTX_NATIVE
+#define FIBERCTX_FRAME 22
+
+__asm__(
+	".text\n"
+	".globl " FIBERCTX_SYM(mty_fiberctx_swap) "\n"
+	FIBERCTX_DECL(mty_fiberctx_swap)
+	".p2align 4\n"
+	FIBERCTX_SYM(mty_fiberctx_swap) ":\n"
+	"	sub sp, sp, #176\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mov x2, sp\n"
+	"	str x2, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	add sp, sp, #176\n"
+	"	ret\n"
+);
+
+static void *mty_fiberctx_frame(uint64_t *top, void (*entry)(void))
+{
+	// The restored link register (x30) is where the first switch returns to
+	uint64_t *sp = top - FIBERCTX_FRAME;
+	sp[11] = (uint64_t) entry;
+
+	return sp;
+}
+
+#endif
+
+struct fiberctx {
+	void *sp;
+	uint8_t *stack;
+	size_t size;
+};
+
+#if defined(FIBERCTX_NATIVE)
+
+void mty_fiberctx_swap(void **from, void *to);
+
+static struct fiberctx *mty_fiberctx_create(size_t stack_size, void (*entry)(void))
+{
+	struct fiberctx *ctx = MTY_Alloc(1, sizeof(struct fiberctx));
+
+	// The calling thread's own stack is used when there is no entry point
+	if (!entry)
+		return ctx;
+
+	long page = sysconf(_SC_PAGESIZE);
+	if (page <= 0)
+		page = 4096;
+
+	// One extra page at the bottom is left inaccessible to catch overflows
+	ctx->size = (stack_size + page - 1) / page * page + page;
+
+	ctx->stack = mmap(NULL, ctx->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ctx->stack == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		MTY_Free(ctx);
+		return NULL;
+	}
+
+	if (mprotect(ctx->stack, page, PROT_NONE) != 0)
+		MTY_Log("'mprotect' failed with errno %d", errno);
+
+	ctx->sp = mty_fiberctx_frame((uint64_t *) (ctx->stack + ctx->size), entry);
+
+	return ctx;
+}
+
+static void mty_fiberctx_destroy(struct fiberctx **fiberctx)
+{
+	if (!fiberctx || !*fiberctx)
+		return;
+
+	struct fiberctx *ctx = *fiberctx;
+
+	if (ctx->stack && munmap(ctx->stack, ctx->size) != 0)
+		MTY_Log("'munmap' failed with errno %d", errno);
+
+	MTY_Free(ctx);
+	*fiberctx = NULL;
+}
+
+static void mty_fiberctx_switch(struct fiberctx *from, struct fiberctx *to)
+{
+	mty_fiberctx_swap(&from->sp, to->sp);
+}
+
+#else
+
+static struct fiberctx *mty_fiberctx_create(size_t stack_size, void (*entry)(void))
+{
+	MTY_Log("Fibers are not supported on this architecture");
+
+	return NULL;
+}
+
+static void mty_fiberctx_destroy(struct fiberctx **fiberctx)
+{
+}
+
+static void mty_fiberctx_switch(struct fiberctx *from, struct fiberctx *to)
+{
+}
+
+#endif
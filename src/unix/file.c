@@ -4,7 +4,7 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
-#define _DEFAULT_SOURCE  // DT_DIR
+#define _GNU_SOURCE      // DT_DIR, SEEK_DATA
 #define _DARWIN_C_SOURCE // flock, DT_DIR
 
 #include "matoya.h"
@@ -19,11 +19,26 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <dirent.h>
 
+#if defined(__linux__)
+	#include <sys/ioctl.h>
+	#include <sys/sendfile.h>
+	#include <sys/syscall.h>
+	#include <linux/fs.h>
+#endif
+
 #include "fspwd.h"
 #include "tlocal.h"
 
+#define FILE_COPY_BUF  (1024 * 1024)
+#define FILE_COPY_STEP (64 * 1024 * 1024)
+
+#if defined(__linux__) && !defined(FICLONE)
+	#define FICLONE _IOW(0x94, 9, int)
+#endif
+
 bool MTY_DeleteFile(const char *path)
 {
 	if (remove(path) != 0) {
@@ -66,20 +81,231 @@ bool MTY_Mkdir(const char *path)
 	return true;
 }
 
-bool MTY_CopyFile(const char *src, const char *dst)
+enum file_copy_method {
+	FILE_COPY_RANGE    = 0,
+	FILE_COPY_SENDFILE = 1,
+	FILE_COPY_BUFFER   = 2,
+};
+
+struct file_copy {
+	int32_t in;
+	int32_t out;
+	off_t size;
+	uint8_t *buf;
+	enum file_copy_method method;
+
+	MTY_CopyProgressFunc func;
+	void *opaque;
+};
+
+static bool file_copy_unsupported(ssize_t n)
+{
+	// Some kernels report 0 bytes rather than an error when they can't copy between
+	// two filesystems, the caller only asks for data it knows is there
+	return n == 0 || errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+		errno == EOPNOTSUPP || errno == ENOTSUP || errno == EPERM;
+}
+
+static ssize_t file_copy_buffer(struct file_copy *ctx, off_t offset, size_t len)
+{
+	if (!ctx->buf)
+		ctx->buf = MTY_Alloc(FILE_COPY_BUF, 1);
+
+	ssize_t n = pread(ctx->in, ctx->buf, MTY_MIN(len, FILE_COPY_BUF), offset);
+
+	for (ssize_t w = 0; w < n;) {
+		ssize_t r = pwrite(ctx->out, ctx->buf + w, n - w, offset + w);
+
+		if (r < 0 && errno != EINTR)
+			return -1;
+
+		if (r > 0)
+			w += r;
+	}
+
+	return n;
+}
+
+static ssize_t file_copy_step(struct file_copy *ctx, off_t offset, size_t len)
+{
+	#if defined(__linux__)
+		if (ctx->method == FILE_COPY_RANGE) {
+			#if defined(SYS_copy_file_range)
+				loff_t in_off = offset;
+				loff_t out_off = offset;
+
+				ssize_t n = syscall(SYS_copy_file_range, ctx->in, &in_off, ctx->out, &out_off, len, 0);
+				if (n > 0 || !file_copy_unsupported(n))
+					return n;
+			#endif
+
+			ctx->method = FILE_COPY_SENDFILE;
+		}
+
+		if (ctx->method == FILE_COPY_SENDFILE) {
+			// sendfile writes at the output's file position
+			if (lseek(ctx->out, offset, SEEK_SET) == -1)
+				return -1;
+
+			off_t in_off = offset;
+
+			ssize_t n = sendfile(ctx->out, ctx->in, &in_off, len);
+			if (n > 0 || !file_copy_unsupported(n))
+				return n;
+
+			ctx->method = FILE_COPY_BUFFER;
+		}
+	#endif
+
+	return file_copy_buffer(ctx, offset, len);
+}
+
+static bool file_copy_progress(struct file_copy *ctx, off_t copied)
+{
+	if (ctx->func && !ctx->func(copied, ctx->size, ctx->opaque)) {
+		MTY_Log("Copy was canceled");
+		return false;
+	}
+
+	return true;
+}
+
+static bool file_copy_data(struct file_copy *ctx)
+{
+	off_t offset = 0;
+
+	while (offset < ctx->size) {
+		off_t data = offset;
+		off_t hole = ctx->size;
+
+		// Only the data segments of sparse files are copied, the holes are recreated by
+		// writing at the next segment's offset and truncating to the final size
+		#if defined(SEEK_DATA)
+			data = lseek(ctx->in, offset, SEEK_DATA);
+
+			if (data == -1) {
+				if (errno == ENXIO)
+					break;
+
+				data = offset;
+
+			} else {
+				hole = lseek(ctx->in, data, SEEK_HOLE);
+
+				if (hole == -1 || hole > ctx->size)
+					hole = ctx->size;
+			}
+		#endif
+
+		for (offset = data; offset < hole;) {
+			ssize_t n = file_copy_step(ctx, offset, MTY_MIN(hole - offset, FILE_COPY_STEP));
+
+			if (n < 0 && errno == EINTR)
+				continue;
+
+			if (n < 0) {
+				MTY_Log("Copy failed with errno %d", errno);
+				return false;
+			}
+
+			if (n == 0) {
+				MTY_Log("Source file was truncated during the copy");
+				return false;
+			}
+
+			offset += n;
+
+			if (!file_copy_progress(ctx, offset))
+				return false;
+		}
+	}
+
+	if (ftruncate(ctx->out, ctx->size) != 0) {
+		MTY_Log("'ftruncate' failed with errno %d", errno);
+		return false;
+	}
+
+	return offset >= ctx->size || file_copy_progress(ctx, ctx->size);
+}
+
+bool MTY_CopyFileEx(const char *src, const char *dst, MTY_CopyProgressFunc func, void *opaque)
 {
+	struct file_copy ctx = {0};
+	ctx.in = -1;
+	ctx.out = -1;
+	ctx.func = func;
+	ctx.opaque = opaque;
+
 	bool r = false;
-	size_t size = 0;
-	void *data = MTY_ReadFile(src, &size);
+	bool created = false;
+
+	ctx.in = open(src, O_RDONLY);
+	if (ctx.in == -1) {
+		MTY_Log("'open' failed to open '%s' with errno %d", MTY_GetFileName(src, true), errno);
+		goto except;
+	}
+
+	struct stat in_st;
+	if (fstat(ctx.in, &in_st) != 0) {
+		MTY_Log("'fstat' failed with errno %d", errno);
+		goto except;
+	}
+
+	ctx.size = in_st.st_size;
+
+	ctx.out = open(dst, O_WRONLY | O_CREAT, in_st.st_mode & 0777);
+	if (ctx.out == -1) {
+		MTY_Log("'open' failed to open '%s' with errno %d", MTY_GetFileName(dst, true), errno);
+		goto except;
+	}
+
+	// Truncating the destination when it is the source would destroy the data
+	struct stat out_st;
+	if (fstat(ctx.out, &out_st) == 0 && out_st.st_dev == in_st.st_dev && out_st.st_ino == in_st.st_ino) {
+		r = true;
+		goto except;
+	}
+
+	created = true;
+
+	if (ftruncate(ctx.out, 0) != 0) {
+		MTY_Log("'ftruncate' failed with errno %d", errno);
+		goto except;
+	}
+
+	#if defined(__linux__)
+		// A reflink shares the source's extents until either file is modified
+		if (ctx.size > 0 && ioctl(ctx.out, FICLONE, ctx.in) == 0) {
+			r = file_copy_progress(&ctx, ctx.size);
+			goto except;
+		}
+	#endif
+
+	r = file_copy_data(&ctx);
 
-	if (data) {
-		r = MTY_WriteFile(dst, data, size);
-		MTY_Free(data);
+	except:
+
+	if (ctx.out != -1 && close(ctx.out) != 0) {
+		MTY_Log("'close' failed with errno %d", errno);
+		r = false;
 	}
 
+	if (ctx.in != -1 && close(ctx.in) != 0)
+		MTY_Log("'close' failed with errno %d", errno);
+
+	if (!r && created && unlink(dst) != 0)
+		MTY_Log("'unlink' failed with errno %d", errno);
+
+	MTY_Free(ctx.buf);
+
 	return r;
 }
 
+bool MTY_CopyFile(const char *src, const char *dst)
+{
+	return MTY_CopyFileEx(src, dst, NULL, NULL);
+}
+
 bool MTY_MoveFile(const char *src, const char *dst)
 {
 	if (rename(src, dst) != 0) {
@@ -172,6 +398,83 @@ void MTY_LockFileDestroy(MTY_LockFile **lock)
 	*lock = NULL;
 }
 
+static void file_map_advise(MTY_FileView *view, MTY_MapHint hints)
+{
+	int32_t advice = (hints & MTY_MAP_HINT_SEQUENTIAL) ? MADV_SEQUENTIAL :
+		(hints & MTY_MAP_HINT_RANDOM) ? MADV_RANDOM : MADV_NORMAL;
+
+	if (advice != MADV_NORMAL && madvise(view->data, view->size, advice) != 0)
+		MTY_Log("'madvise' failed with errno %d", errno);
+
+	if ((hints & MTY_MAP_HINT_WILLNEED) && madvise(view->data, view->size, MADV_WILLNEED) != 0)
+		MTY_Log("'madvise' failed with errno %d", errno);
+
+	// Kernels without transparent huge pages for this filesystem return EINVAL,
+	// the mapping simply stays on regular pages
+	#if defined(MADV_HUGEPAGE)
+		if (hints & MTY_MAP_HINT_HUGE_PAGES)
+			madvise(view->data, view->size, MADV_HUGEPAGE);
+	#endif
+}
+
+MTY_FileView *MTY_MapFile(const char *path, MTY_MapMode mode, MTY_MapHint hints)
+{
+	bool write = mode == MTY_MAP_MODE_WRITE;
+	MTY_FileView *view = NULL;
+
+	int32_t f = open(path, write ? O_RDWR : O_RDONLY);
+	if (f == -1) {
+		MTY_Log("'open' failed to open '%s' with errno %d", MTY_GetFileName(path, true), errno);
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(f, &st) != 0) {
+		MTY_Log("'fstat' failed with errno %d", errno);
+		goto except;
+	}
+
+	// A zero length mapping is an error, so empty files are treated like MTY_ReadFile does
+	if (st.st_size <= 0)
+		goto except;
+
+	// The mapping holds its own reference to the file, the descriptor can be closed
+	int32_t prot = write ? PROT_READ | PROT_WRITE : PROT_READ;
+	void *data = mmap(NULL, st.st_size, prot, write ? MAP_SHARED : MAP_PRIVATE, f, 0);
+
+	if (data == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		goto except;
+	}
+
+	view = MTY_Alloc(1, sizeof(MTY_FileView));
+	view->data = data;
+	view->size = st.st_size;
+
+	file_map_advise(view, hints);
+
+	except:
+
+	if (close(f) != 0)
+		MTY_Log("'close' failed with errno %d", errno);
+
+	return view;
+}
+
+void MTY_UnmapFile(MTY_FileView **view)
+{
+	if (!view || !*view)
+		return;
+
+	MTY_FileView *ctx = *view;
+
+	if (munmap(ctx->data, ctx->size) != 0)
+		MTY_Log("'munmap' failed with errno %d", errno);
+
+	MTY_Free(ctx);
+	*view = NULL;
+}
+
 static int32_t file_compare(const void *p1, const void *p2)
 {
 	MTY_FileDesc *fi1 = (MTY_FileDesc *) p1;
@@ -196,12 +499,12 @@ static int32_t file_compare(const void *p1, const void *p2)
 MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 {
 	MTY_FileList *fl = MTY_Alloc(1, sizeof(MTY_FileList));
-	char *pathd = MTY_Strdup(path);
+	uint32_t size = 0;
 
 	bool ok = false;
 
 	struct dirent *ent = NULL;
-	DIR *dir = opendir(pathd);
+	DIR *dir = opendir(path);
 	if (dir) {
 		ent = readdir(dir);
 		ok = ent;
@@ -212,11 +515,15 @@ MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 		bool is_dir = ent->d_type == DT_DIR;
 
 		if (is_dir || strstr(name, filter ? filter : "")) {
-			fl->files = MTY_Realloc(fl->files, fl->len + 1, sizeof(MTY_FileDesc));
+			if (fl->len == size) {
+				size = size > 0 ? size * 2 : 64;
+				fl->files = MTY_Realloc(fl->files, size, sizeof(MTY_FileDesc));
+			}
 
 			fl->files[fl->len].dir = is_dir;
 			fl->files[fl->len].name = MTY_Strdup(name);
-			fl->files[fl->len].path = MTY_Strdup(MTY_JoinPath(pathd, name));
+			fl->files[fl->len].path = MTY_SprintfD("%s/%s", path, name);
+
 			fl->len++;
 		}
 
@@ -227,8 +534,6 @@ MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 		}
 	}
 
-	MTY_Free(pathd);
-
 	if (fl->len > 0)
 		MTY_Sort(fl->files, fl->len, sizeof(MTY_FileDesc), file_compare);
 
@@ -8,8 +8,11 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 
+#include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 
 #define FSUTIL_DELIM '/'
@@ -40,3 +43,50 @@ static size_t fsutil_size(const char *path)
 
 	return st.st_size;
 }
+
+static bool fsutil_sync(FILE *f)
+{
+	if (fflush(f) != 0) {
+		MTY_Log("'fflush' failed with errno %d", errno);
+		return false;
+	}
+
+	if (fsync(fileno(f)) != 0) {
+		MTY_Log("'fsync' failed with errno %d", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static void fsutil_copy_mode(FILE *f, const char *path)
+{
+	// A replacement keeps the permissions of the file it replaces
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return;
+
+	if (fchmod(fileno(f), st.st_mode & 07777) != 0)
+		MTY_Log("'fchmod' failed with errno %d", errno);
+}
+
+static void fsutil_sync_dir(const char *path)
+{
+	// A rename is only durable once the directory holding it has been synced
+	const char *dir = strchr(path, FSUTIL_DELIM) ? MTY_GetPathPrefix(path) : ".";
+
+	// Files directly under the root have an empty prefix
+	if (dir[0] == '\0')
+		dir = "/";
+
+	int32_t fd = open(dir, O_RDONLY);
+	if (fd == -1) {
+		MTY_Log("'open' failed with errno %d", errno);
+		return;
+	}
+
+	if (fsync(fd) != 0)
+		MTY_Log("'fsync' failed with errno %d", errno);
+
+	close(fd);
+}
@@ -773,6 +773,8 @@ static void app_kb_to_hotkey(MTY_App *app, MTY_Event *evt)
 void MTY_AppRun(MTY_App *ctx)
 {
 	for (bool cont = true, was_ready = false; cont;) {
+		MTY_TraceBegin("MTY_AppRun");
+
 		for (MTY_Event *evt; MTY_QueuePop(ctx->events, 0, (void **) &evt, NULL);) {
 			if (evt->type == MTY_EVENT_KEY)
 				app_kb_to_hotkey(ctx, evt);
@@ -789,7 +791,11 @@ void MTY_AppRun(MTY_App *ctx)
 		if (ctx->check_scroller)
 			mty_jni_void(MTY_GetJNIEnv(), ctx->obj, "checkScroller", "()V");
 
+		MTY_TraceBegin("MTY_AppFunc");
 		cont = ctx->app_func(ctx->opaque);
+		MTY_TraceEnd("MTY_AppFunc");
+
+		MTY_TraceEnd("MTY_AppRun");
 
 		if (ctx->timeout > 0)
 			MTY_Sleep(ctx->timeout);
@@ -12,6 +12,8 @@
 
 #include <aaudio/AAudio.h>
 
+#include "metrics.h"
+
 #define AUDIO_CHANNELS 2
 #define AUDIO_BUF_SIZE (48000 * AUDIO_CHANNELS * 2)
 
@@ -121,16 +123,23 @@ static void audio_start(MTY_Audio *ctx)
 
 void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 {
+	MTY_TraceBegin("MTY_AudioQueue");
+
 	size_t data_size = count * AUDIO_CHANNELS * 2;
 
 	audio_start(ctx);
 
 	MTY_MutexLock(ctx->mutex);
 
-	if (ctx->size + data_size >= ctx->max_buffer)
+	if (!ctx->flushing && ctx->size + data_size >= ctx->max_buffer) {
+		mty_metric_add(METRIC_AUDIO_OVERFLOWS, 1);
 		ctx->flushing = true;
+	}
 
 	if (ctx->size == 0) {
+		if (ctx->playing && !ctx->flushing)
+			mty_metric_add(METRIC_AUDIO_UNDERRUNS, 1);
+
 		ctx->playing = false;
 		ctx->flushing = false;
 	}
@@ -144,6 +153,8 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 		ctx->playing = true;
 
 	MTY_MutexUnlock(ctx->mutex);
+
+	MTY_TraceEnd("MTY_AudioQueue");
 }
 
 void MTY_AudioDestroy(MTY_Audio **audio)
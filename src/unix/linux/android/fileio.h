@@ -0,0 +1 @@
+../../apple/fileio.h
\ No newline at end of file
@@ -0,0 +1,108 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// getdents64 fills a large buffer per system call where readdir is limited to 32 KB,
+// called via syscall since older libcs don't wrap it
+
+#define DIRREAD_BUF   (64 * 1024)
+#define DIRREAD_DELIM '/'
+
+struct dirread_ent {
+	uint64_t ino;
+	int64_t off;
+	uint16_t reclen;
+	uint8_t type;
+	char name[];
+};
+
+struct dirread {
+	int32_t fd;
+	size_t pos;
+	size_t len;
+	uint8_t buf[DIRREAD_BUF];
+};
+
+static struct dirread *mty_dirread_open(const char *path)
+{
+	int32_t fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1) {
+		MTY_Log("'open' failed with errno %d", errno);
+		return NULL;
+	}
+
+	struct dirread *ctx = MTY_Alloc(1, sizeof(struct dirread));
+	ctx->fd = fd;
+
+	return ctx;
+}
+
+static void mty_dirread_close(struct dirread **dirread)
+{
+	if (!dirread || !*dirread)
+		return;
+
+	struct dirread *ctx = *dirread;
+
+	close(ctx->fd);
+
+	MTY_Free(ctx);
+	*dirread = NULL;
+}
+
+static MTY_FileType dirread_type(struct dirread *ctx, const char *name, uint8_t type)
+{
+	// Some filesystems don't store the type in the directory
+	if (type == DT_UNKNOWN) {
+		struct stat st;
+		if (fstatat(ctx->fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+			return MTY_FILE_TYPE_UNKNOWN;
+
+		type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR :
+			S_ISLNK(st.st_mode) ? DT_LNK : DT_FIFO;
+	}
+
+	switch (type) {
+		case DT_REG: return MTY_FILE_TYPE_FILE;
+		case DT_DIR: return MTY_FILE_TYPE_DIR;
+		case DT_LNK: return MTY_FILE_TYPE_LINK;
+	}
+
+	return MTY_FILE_TYPE_OTHER;
+}
+
+static const char *mty_dirread_next(struct dirread *ctx, MTY_FileType *type)
+{
+	if (ctx->pos >= ctx->len) {
+		long n = syscall(SYS_getdents64, ctx->fd, ctx->buf, DIRREAD_BUF);
+
+		if (n <= 0) {
+			if (n < 0)
+				MTY_Log("'getdents64' failed with errno %d", errno);
+
+			return NULL;
+		}
+
+		ctx->pos = 0;
+		ctx->len = n;
+	}
+
+	struct dirread_ent *ent = (struct dirread_ent *) (ctx->buf + ctx->pos);
+	ctx->pos += ent->reclen;
+
+	*type = dirread_type(ctx, ent->name, ent->type);
+
+	return ent->name;
+}
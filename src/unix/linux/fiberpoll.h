@@ -0,0 +1,168 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/epoll.h>
+
+#define FIBERPOLL_EVENTS 64
+
+// epoll keeps a single registration per fd, so a reader and a writer waiting on
+// the same fd share one record and their events are combined and split here
+
+struct fiberpoll_fd {
+	int32_t fd;
+	void *in;
+	void *out;
+};
+
+struct fiberpoll {
+	int32_t fd;
+	MTY_Hash *fds;
+};
+
+static struct fiberpoll *mty_fiberpoll_create(void)
+{
+	int32_t fd = epoll_create1(EPOLL_CLOEXEC);
+	if (fd == -1) {
+		MTY_Log("'epoll_create1' failed with errno %d", errno);
+		return NULL;
+	}
+
+	struct fiberpoll *ctx = MTY_Alloc(1, sizeof(struct fiberpoll));
+	ctx->fd = fd;
+	ctx->fds = MTY_HashCreate(0);
+
+	return ctx;
+}
+
+static void mty_fiberpoll_destroy(struct fiberpoll **fiberpoll)
+{
+	if (!fiberpoll || !*fiberpoll)
+		return;
+
+	struct fiberpoll *ctx = *fiberpoll;
+
+	close(ctx->fd);
+	MTY_HashDestroy(&ctx->fds, MTY_Free);
+
+	MTY_Free(ctx);
+	*fiberpoll = NULL;
+}
+
+static bool fiberpoll_arm(struct fiberpoll *ctx, struct fiberpoll_fd *rec, bool exists)
+{
+	struct epoll_event ev = {0};
+	ev.events = (rec->in ? EPOLLIN : 0) | (rec->out ? EPOLLOUT : 0) | EPOLLONESHOT;
+	ev.data.ptr = rec;
+
+	// A one-shot registration that already fired stays in the set disabled and is
+	// re-armed, the kernel drops it on its own once the fd is closed
+	int32_t e = epoll_ctl(ctx->fd, exists ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, rec->fd, &ev);
+	if (e != 0 && errno == (exists ? ENOENT : EEXIST))
+		e = epoll_ctl(ctx->fd, exists ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, rec->fd, &ev);
+
+	if (e != 0) {
+		MTY_Log("'epoll_ctl' failed with errno %d", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static bool mty_fiberpoll_add(struct fiberpoll *ctx, intptr_t fd, bool out, void *opaque)
+{
+	struct fiberpoll_fd *rec = MTY_HashGetInt(ctx->fds, fd);
+	bool exists = rec != NULL;
+
+	if (!rec) {
+		rec = MTY_Alloc(1, sizeof(struct fiberpoll_fd));
+		rec->fd = (int32_t) fd;
+		MTY_HashSetInt(ctx->fds, fd, rec);
+	}
+
+	void **waiter = out ? &rec->out : &rec->in;
+
+	if (*waiter) {
+		MTY_Log("Another fiber is already waiting on this fd");
+		return false;
+	}
+
+	*waiter = opaque;
+
+	if (!fiberpoll_arm(ctx, rec, exists)) {
+		*waiter = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static void mty_fiberpoll_remove(struct fiberpoll *ctx, intptr_t fd, bool out)
+{
+	struct fiberpoll_fd *rec = MTY_HashGetInt(ctx->fds, fd);
+	if (!rec)
+		return;
+
+	if (out) {
+		rec->out = NULL;
+
+	} else {
+		rec->in = NULL;
+	}
+
+	// The waiter in the other direction keeps its interest
+	if (rec->in || rec->out) {
+		fiberpoll_arm(ctx, rec, true);
+
+	} else {
+		if (epoll_ctl(ctx->fd, EPOLL_CTL_DEL, rec->fd, NULL) != 0 && errno != ENOENT)
+			MTY_Log("'epoll_ctl' failed with errno %d", errno);
+
+		MTY_Free(MTY_HashPopInt(ctx->fds, fd));
+	}
+}
+
+static uint32_t mty_fiberpoll_wait(struct fiberpoll *ctx, int32_t timeout, void **ready, uint32_t max)
+{
+	struct epoll_event evs[FIBERPOLL_EVENTS];
+
+	// Each event can wake both a reader and a writer
+	int32_t n = epoll_wait(ctx->fd, evs, MTY_MIN(max / 2, FIBERPOLL_EVENTS), timeout);
+	if (n < 0) {
+		if (errno != EINTR)
+			MTY_Log("'epoll_wait' failed with errno %d", errno);
+
+		return 0;
+	}
+
+	uint32_t count = 0;
+
+	for (int32_t x = 0; x < n; x++) {
+		struct fiberpoll_fd *rec = evs[x].data.ptr;
+		uint32_t events = evs[x].events;
+
+		// Errors and hangups wake both directions so the fiber sees the failure
+		if (rec->in && (events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+			ready[count++] = rec->in;
+			rec->in = NULL;
+		}
+
+		if (rec->out && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+			ready[count++] = rec->out;
+			rec->out = NULL;
+		}
+
+		// One-shot disabled the whole registration, re-arm for a remaining waiter
+		if (rec->in || rec->out)
+			fiberpoll_arm(ctx, rec, true);
+	}
+
+	return count;
+}
@@ -0,0 +1,358 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#define FSWATCH_BUF  (64 * 1024)
+#define FSWATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | \
+	IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+typedef void (*FSWATCH_FUNC)(const char *path, MTY_FileChange change, bool dir, void *opaque);
+
+// Every watched path is backed by a watch on a directory. Files are watched through
+// their parent so they survive being replaced by a rename, with `names` limiting which
+// entries of the directory are reported.
+
+struct fswatch_dir {
+	int32_t wd;
+	char *path;
+	bool all;
+	bool recursive;
+	MTY_Hash *names;
+};
+
+struct fswatch {
+	int32_t fd;
+	MTY_Hash *wds;
+	MTY_Hash *paths;
+	uint8_t buf[FSWATCH_BUF];
+};
+
+static struct fswatch *mty_fswatch_create(void)
+{
+	int32_t fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) {
+		MTY_Log("'inotify_init1' failed with errno %d", errno);
+		return NULL;
+	}
+
+	struct fswatch *ctx = MTY_Alloc(1, sizeof(struct fswatch));
+	ctx->fd = fd;
+	ctx->wds = MTY_HashCreate(0);
+	ctx->paths = MTY_HashCreate(0);
+
+	return ctx;
+}
+
+static void fswatch_dir_free(void *opaque)
+{
+	struct fswatch_dir *dir = opaque;
+
+	MTY_HashDestroy(&dir->names, NULL);
+	MTY_Free(dir->path);
+	MTY_Free(dir);
+}
+
+static void mty_fswatch_destroy(struct fswatch **fswatch)
+{
+	if (!fswatch || !*fswatch)
+		return;
+
+	struct fswatch *ctx = *fswatch;
+
+	// Directories are owned by `wds`, `paths` only refers to them
+	MTY_HashDestroy(&ctx->paths, NULL);
+	MTY_HashDestroy(&ctx->wds, fswatch_dir_free);
+
+	close(ctx->fd);
+
+	MTY_Free(ctx);
+	*fswatch = NULL;
+}
+
+static void fswatch_forget(struct fswatch *ctx, struct fswatch_dir *dir)
+{
+	MTY_HashPopInt(ctx->wds, dir->wd);
+
+	if (MTY_HashGet(ctx->paths, dir->path) == dir)
+		MTY_HashPop(ctx->paths, dir->path);
+
+	fswatch_dir_free(dir);
+}
+
+static struct fswatch_dir *fswatch_add_dir(struct fswatch *ctx, const char *path, bool all, bool recursive)
+{
+	int32_t wd = inotify_add_watch(ctx->fd, path, FSWATCH_MASK);
+	if (wd == -1) {
+		MTY_Log("'inotify_add_watch' failed with errno %d", errno);
+		return NULL;
+	}
+
+	// The same directory reached through a different path shares a watch
+	struct fswatch_dir *dir = MTY_HashGetInt(ctx->wds, wd);
+
+	if (!dir) {
+		dir = MTY_Alloc(1, sizeof(struct fswatch_dir));
+		dir->wd = wd;
+		dir->path = MTY_Strdup(path);
+		dir->names = MTY_HashCreate(0);
+
+		MTY_HashSetInt(ctx->wds, wd, dir);
+		MTY_HashSet(ctx->paths, dir->path, dir);
+	}
+
+	dir->all |= all;
+	dir->recursive |= recursive;
+
+	return dir;
+}
+
+static void fswatch_add_tree(struct fswatch *ctx, const char *path, FSWATCH_FUNC func, void *opaque)
+{
+	MTY_DirIter *iter = MTY_DirIterCreate(path, NULL, MTY_DIR_FLAG_RECURSIVE);
+	if (!iter)
+		return;
+
+	for (const MTY_DirEntry *e = MTY_DirIterNext(iter); e; e = MTY_DirIterNext(iter)) {
+		if (e->type == MTY_FILE_TYPE_DIR)
+			fswatch_add_dir(ctx, e->path, true, true);
+
+		// Entries that appeared before the watch was in place would otherwise be missed
+		if (func)
+			func(e->path, MTY_FILE_CHANGE_CREATED, e->type == MTY_FILE_TYPE_DIR, opaque);
+	}
+
+	MTY_DirIterDestroy(&iter);
+}
+
+static bool mty_fswatch_add(struct fswatch *ctx, const char *path, bool recursive)
+{
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		MTY_Log("'stat' failed with errno %d", errno);
+		return false;
+	}
+
+	if (S_ISDIR(st.st_mode)) {
+		if (!fswatch_add_dir(ctx, path, true, recursive))
+			return false;
+
+		if (recursive)
+			fswatch_add_tree(ctx, path, NULL, NULL);
+
+		return true;
+	}
+
+	const char *slash = strrchr(path, '/');
+	char *parent = slash ? MTY_Strdup(path) : MTY_Strdup(".");
+
+	if (slash)
+		parent[slash - path] = '\0';
+
+	struct fswatch_dir *dir = fswatch_add_dir(ctx, parent, false, false);
+
+	MTY_Free(parent);
+
+	if (!dir)
+		return false;
+
+	MTY_HashSet(dir->names, slash ? slash + 1 : path, (void *) 1);
+
+	return true;
+}
+
+static void mty_fswatch_remove(struct fswatch *ctx, const char *path)
+{
+	struct fswatch_dir *dir = MTY_HashGet(ctx->paths, path);
+
+	if (dir) {
+		// Watches below a recursive directory go with it
+		if (dir->recursive) {
+			size_t len = strlen(path);
+			const char *key = NULL;
+			uint64_t iter = 0;
+
+			for (bool more = MTY_HashGetNextKey(ctx->paths, &iter, &key); more;) {
+				struct fswatch_dir *child = MTY_HashGet(ctx->paths, key);
+				more = MTY_HashGetNextKey(ctx->paths, &iter, &key);
+
+				if (child != dir && !strncmp(child->path, path, len) && child->path[len] == '/') {
+					inotify_rm_watch(ctx->fd, child->wd);
+					fswatch_forget(ctx, child);
+				}
+			}
+		}
+
+		dir->all = false;
+		dir->recursive = false;
+
+	} else {
+		const char *slash = strrchr(path, '/');
+		char *parent = slash ? MTY_Strdup(path) : MTY_Strdup(".");
+
+		if (slash)
+			parent[slash - path] = '\0';
+
+		dir = MTY_HashGet(ctx->paths, parent);
+
+		MTY_Free(parent);
+
+		if (!dir)
+			return;
+
+		MTY_HashPop(dir->names, slash ? slash + 1 : path);
+	}
+
+	uint64_t iter = 0;
+	const char *key = NULL;
+
+	if (!dir->all && !MTY_HashGetNextKey(dir->names, &iter, &key)) {
+		inotify_rm_watch(ctx->fd, dir->wd);
+		fswatch_forget(ctx, dir);
+	}
+}
+
+static intptr_t mty_fswatch_handle(struct fswatch *ctx)
+{
+	return ctx->fd;
+}
+
+static void mty_fswatch_wait(struct fswatch *ctx, int32_t timeout)
+{
+	struct pollfd fd = {0};
+	fd.fd = ctx->fd;
+	fd.events = POLLIN;
+
+	if (poll(&fd, 1, timeout) == -1 && errno != EINTR)
+		MTY_Log("'poll' failed with errno %d", errno);
+}
+
+static MTY_FileChange fswatch_change(uint32_t mask)
+{
+	if (mask & (IN_CREATE | IN_MOVED_TO))
+		return MTY_FILE_CHANGE_CREATED;
+
+	if (mask & (IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF))
+		return MTY_FILE_CHANGE_DELETED;
+
+	if (mask & (IN_MODIFY | IN_CLOSE_WRITE))
+		return MTY_FILE_CHANGE_MODIFIED;
+
+	return MTY_FILE_CHANGE_ATTRIBUTES;
+}
+
+static void fswatch_overflow(struct fswatch *ctx, FSWATCH_FUNC func, void *opaque)
+{
+	uint64_t iter = 0;
+	const char *key = NULL;
+
+	// Report each path given to mty_fswatch_add, directories below a recursive watch
+	// are covered by their ancestor
+	while (MTY_HashGetNextKey(ctx->paths, &iter, &key)) {
+		struct fswatch_dir *dir = MTY_HashGet(ctx->paths, key);
+
+		if (dir->all) {
+			const char *slash = strrchr(dir->path, '/');
+			struct fswatch_dir *parent = NULL;
+
+			if (slash) {
+				char *ppath = MTY_Strdup(dir->path);
+				ppath[slash - dir->path] = '\0';
+
+				parent = MTY_HashGet(ctx->paths, ppath);
+
+				MTY_Free(ppath);
+			}
+
+			if (!parent || !parent->recursive)
+				func(dir->path, MTY_FILE_CHANGE_OVERFLOW, true, opaque);
+		}
+
+		uint64_t niter = 0;
+		const char *name = NULL;
+
+		while (MTY_HashGetNextKey(dir->names, &niter, &name)) {
+			char path[MTY_PATH_MAX];
+			snprintf(path, MTY_PATH_MAX, "%s/%s", dir->path, name);
+
+			func(path, MTY_FILE_CHANGE_OVERFLOW, false, opaque);
+		}
+	}
+}
+
+static void fswatch_event(struct fswatch *ctx, const struct inotify_event *ev, FSWATCH_FUNC func, void *opaque)
+{
+	// The kernel dropped events, the caller must rescan what it watches
+	if (ev->mask & IN_Q_OVERFLOW) {
+		MTY_Log("inotify queue overflowed, changes were lost");
+		fswatch_overflow(ctx, func, opaque);
+		return;
+	}
+
+	struct fswatch_dir *dir = MTY_HashGetInt(ctx->wds, ev->wd);
+	if (!dir)
+		return;
+
+	// The directory is gone or was removed with inotify_rm_watch
+	if (ev->mask & IN_IGNORED) {
+		fswatch_forget(ctx, dir);
+		return;
+	}
+
+	bool is_dir = ev->len == 0 || (ev->mask & IN_ISDIR);
+	MTY_FileChange change = fswatch_change(ev->mask);
+
+	if (ev->len == 0) {
+		if (dir->all)
+			func(dir->path, change, true, opaque);
+
+		return;
+	}
+
+	if (!dir->all && !MTY_HashGet(dir->names, ev->name))
+		return;
+
+	char path[MTY_PATH_MAX];
+	snprintf(path, MTY_PATH_MAX, "%s/%s", dir->path, ev->name);
+
+	func(path, change, is_dir, opaque);
+
+	if (is_dir && change == MTY_FILE_CHANGE_CREATED && dir->recursive && fswatch_add_dir(ctx, path, true, true))
+		fswatch_add_tree(ctx, path, func, opaque);
+}
+
+static void mty_fswatch_read(struct fswatch *ctx, FSWATCH_FUNC func, void *opaque)
+{
+	while (true) {
+		ssize_t n = read(ctx->fd, ctx->buf, FSWATCH_BUF);
+
+		if (n <= 0) {
+			if (n == -1 && errno == EINTR)
+				continue;
+
+			if (n == -1 && errno != EAGAIN)
+				MTY_Log("'read' failed with errno %d", errno);
+
+			break;
+		}
+
+		for (ssize_t x = 0; x < n;) {
+			const struct inotify_event *ev = (const struct inotify_event *) (ctx->buf + x);
+			fswatch_event(ctx, ev, func, opaque);
+
+			x += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+}
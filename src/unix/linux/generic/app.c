@@ -842,6 +842,8 @@ static void app_suspend_ss(MTY_App *ctx)
 void MTY_AppRun(MTY_App *ctx)
 {
 	for (bool cont = true; cont;) {
+		MTY_TraceBegin("MTY_AppRun");
+
 		// Grab / mouse state evaluation
 		if (ctx->state != ctx->prev_state) {
 			struct window *win = app_get_active_window(ctx);
@@ -868,12 +870,16 @@ void MTY_AppRun(MTY_App *ctx)
 			mty_evdev_poll(ctx->evdev, app_evdev_report);
 
 		// Fire app func after all events have been processed
+		MTY_TraceBegin("MTY_AppFunc");
 		cont = ctx->app_func(ctx->opaque);
+		MTY_TraceEnd("MTY_AppFunc");
 
 		// Keep screensaver from turning on
 		if (ctx->suspend_ss)
 			app_suspend_ss(ctx);
 
+		MTY_TraceEnd("MTY_AppRun");
+
 		if (ctx->timeout > 0)
 			MTY_Sleep(ctx->timeout);
 	}
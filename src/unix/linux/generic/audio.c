@@ -10,6 +10,7 @@
 #include <math.h>
 
 #include "dl/libasound.h"
+#include "metrics.h"
 
 #define AUDIO_CHANNELS    2
 #define AUDIO_SAMPLE_SIZE sizeof(int16_t)
@@ -22,8 +23,7 @@ struct MTY_Audio {
 	uint32_t sample_rate;
 	uint32_t min_buffer;
 	uint32_t max_buffer;
-	uint8_t *buf;
-	size_t pos;
+	MTY_RingBuffer *ring;
 };
 
 MTY_Audio *MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t maxBuffer)
@@ -58,7 +58,7 @@ MTY_Audio *MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t max
 	snd_pcm_hw_params(ctx->pcm, params);
 	snd_pcm_nonblock(ctx->pcm, 1);
 
-	ctx->buf = MTY_Alloc(AUDIO_BUF_SIZE, 1);
+	ctx->ring = MTY_RingBufferCreate(AUDIO_BUF_SIZE);
 
 	except:
 
@@ -70,7 +70,7 @@ MTY_Audio *MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t max
 
 static uint32_t audio_get_queued_frames(MTY_Audio *ctx)
 {
-	uint32_t queued = ctx->pos / 4;
+	uint32_t queued = MTY_RingBufferGetLength(ctx->ring) / 4;
 
 	if (ctx->playing) {
 		snd_pcm_status_t *status = NULL;
@@ -104,38 +104,47 @@ static void audio_play(MTY_Audio *ctx)
 void MTY_AudioReset(MTY_Audio *ctx)
 {
 	ctx->playing = false;
-	ctx->pos = 0;
+	MTY_RingBufferClear(ctx->ring);
 }
 
 void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *samples, uint32_t count)
 {
+	MTY_TraceBegin("MTY_AudioQueue");
+
 	size_t size = count * 4;
 
 	uint32_t queued = audio_get_queued_frames(ctx);
+	MTY_TraceCounter("MTY_AudioQueue:queued", queued);
 
 	// Stop playing and flush if we've exceeded the maximum buffer or underrun
-	if (ctx->playing && (queued > ctx->max_buffer || queued == 0))
+	if (ctx->playing && (queued > ctx->max_buffer || queued == 0)) {
+		mty_metric_add(queued == 0 ? METRIC_AUDIO_UNDERRUNS : METRIC_AUDIO_OVERFLOWS, 1);
 		MTY_AudioReset(ctx);
-
-	if (ctx->pos + size <= AUDIO_BUF_SIZE) {
-		memcpy(ctx->buf + ctx->pos, samples, count * 4);
-		ctx->pos += size;
 	}
 
+	MTY_RingBufferWrite(ctx->ring, samples, size);
+
 	// Begin playing again when the minimum buffer has been reached
 	if (!ctx->playing && queued + count >= ctx->min_buffer)
 		audio_play(ctx);
 
 	if (ctx->playing) {
-		int32_t e = snd_pcm_writei(ctx->pcm, ctx->buf, ctx->pos / 4);
+		size_t len = 0;
+		const void *buf = MTY_RingBufferPeek(ctx->ring, &len);
 
+		int32_t e = snd_pcm_writei(ctx->pcm, buf, len / 4);
+
+		// Frames ALSA didn't accept stay queued for the next call
 		if (e >= 0) {
-			ctx->pos = 0;
+			MTY_RingBufferSkip(ctx->ring, e * 4);
 
 		} else if (e == -EPIPE) {
+			mty_metric_add(METRIC_AUDIO_UNDERRUNS, 1);
 			MTY_AudioReset(ctx);
 		}
 	}
+
+	MTY_TraceEnd("MTY_AudioQueue");
 }
 
 void MTY_AudioDestroy(MTY_Audio **audio)
@@ -148,7 +157,7 @@ void MTY_AudioDestroy(MTY_Audio **audio)
 	if (ctx->pcm)
 		snd_pcm_close(ctx->pcm);
 
-	MTY_Free(ctx->buf);
+	MTY_RingBufferDestroy(&ctx->ring);
 	MTY_Free(ctx);
 	*audio = NULL;
 }
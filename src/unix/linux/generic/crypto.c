@@ -6,6 +6,12 @@
 
 #include "matoya.h"
 
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/random.h>
+
+#include "tlocal.h"
 #include "dl/libcrypto.h"
 
 
@@ -58,12 +64,162 @@ void MTY_CryptoHash(MTY_Algorithm algo, const void *input, size_t inputSize, con
 
 // Random
 
+// Per-thread ChaCha20 DRBG seeded from the kernel via getrandom. Output is generated
+// in blocks with fast key erasure: the first 32 bytes of each refill become the next
+// key, so previously served bytes can not be recovered from the state. A generation
+// counter bumped in the child after fork forces every thread state to reseed.
+
+#define RANDOM_KEY_SIZE 32
+#define RANDOM_BUF_SIZE (8 * 64)
+#define RANDOM_RESEED   (1024 * 1024)
+
+#define RANDOM_ROTL(v, n) \
+	(((v) << (n)) | ((v) >> (32 - (n))))
+
+#define RANDOM_QR(a, b, c, d)                            \
+	a += b; d ^= a; d = RANDOM_ROTL(d, 16);              \
+	c += d; b ^= c; b = RANDOM_ROTL(b, 12);              \
+	a += b; d ^= a; d = RANDOM_ROTL(d, 8);               \
+	c += d; b ^= c; b = RANDOM_ROTL(b, 7)
+
+struct random_state {
+	bool init;
+	uint32_t gen;
+	uint32_t key[8];
+	uint64_t counter;
+	size_t generated;
+	size_t pos;
+	uint8_t buf[RANDOM_BUF_SIZE];
+};
+
+static pthread_once_t RANDOM_ONCE = PTHREAD_ONCE_INIT;
+static MTY_Atomic32 RANDOM_GEN;
+static TLOCAL struct random_state RANDOM;
+
+static void random_fork_child(void)
+{
+	MTY_Atomic32Add(&RANDOM_GEN, 1);
+}
+
+static void random_register_fork(void)
+{
+	int32_t e = pthread_atfork(NULL, NULL, random_fork_child);
+	if (e != 0)
+		MTY_Log("'pthread_atfork' failed with error %d", e);
+}
+
+static void random_chacha20_block(const uint32_t *key, uint64_t counter, uint8_t *out)
+{
+	uint32_t in[16] = {
+		0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+		key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+		(uint32_t) counter, (uint32_t) (counter >> 32), 0, 0,
+	};
+
+	uint32_t x[16];
+	memcpy(x, in, sizeof(x));
+
+	for (uint8_t i = 0; i < 10; i++) {
+		RANDOM_QR(x[0], x[4], x[8],  x[12]);
+		RANDOM_QR(x[1], x[5], x[9],  x[13]);
+		RANDOM_QR(x[2], x[6], x[10], x[14]);
+		RANDOM_QR(x[3], x[7], x[11], x[15]);
+		RANDOM_QR(x[0], x[5], x[10], x[15]);
+		RANDOM_QR(x[1], x[6], x[11], x[12]);
+		RANDOM_QR(x[2], x[7], x[8],  x[13]);
+		RANDOM_QR(x[3], x[4], x[9],  x[14]);
+	}
+
+	for (uint8_t i = 0; i < 16; i++) {
+		uint32_t v = x[i] + in[i];
+		out[i * 4 + 0] = (uint8_t) v;
+		out[i * 4 + 1] = (uint8_t) (v >> 8);
+		out[i * 4 + 2] = (uint8_t) (v >> 16);
+		out[i * 4 + 3] = (uint8_t) (v >> 24);
+	}
+}
+
+static bool random_seed(void *seed, size_t size)
+{
+	for (size_t offset = 0; offset < size;) {
+		ssize_t n = getrandom((uint8_t *) seed + offset, size - offset, 0);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			// Kernels older than 3.17 lack getrandom, fall back to libcrypto
+			if (errno == ENOSYS && libcrypto_global_init() && RAND_bytes((uint8_t *) seed + offset,
+				(int32_t) (size - offset)) == 1)
+				return true;
+
+			MTY_Log("'getrandom' failed with errno %d", errno);
+			return false;
+		}
+
+		offset += n;
+	}
+
+	return true;
+}
+
+static void random_refill(struct random_state *ctx)
+{
+	for (size_t x = 0; x < RANDOM_BUF_SIZE; x += 64)
+		random_chacha20_block(ctx->key, ctx->counter++, ctx->buf + x);
+
+	// Fast key erasure
+	memcpy(ctx->key, ctx->buf, RANDOM_KEY_SIZE);
+	memset(ctx->buf, 0, RANDOM_KEY_SIZE);
+
+	ctx->pos = RANDOM_KEY_SIZE;
+}
+
+static bool random_reseed(struct random_state *ctx)
+{
+	uint32_t seed[8];
+	if (!random_seed(seed, sizeof(seed)))
+		return false;
+
+	// Mix the fresh seed into the existing key rather than replacing it outright
+	for (uint8_t x = 0; x < 8; x++)
+		ctx->key[x] ^= seed[x];
+
+	memset(seed, 0, sizeof(seed));
+
+	ctx->generated = 0;
+	ctx->init = true;
+
+	random_refill(ctx);
+
+	return true;
+}
+
 void MTY_GetRandomBytes(void *output, size_t size)
 {
-	if (!libcrypto_global_init())
-		return;
+	pthread_once(&RANDOM_ONCE, random_register_fork);
+
+	struct random_state *ctx = &RANDOM;
+	uint32_t gen = MTY_Atomic32Get(&RANDOM_GEN);
+
+	if (!ctx->init || ctx->gen != gen || ctx->generated >= RANDOM_RESEED) {
+		if (!random_reseed(ctx))
+			return;
+
+		ctx->gen = gen;
+	}
+
+	for (size_t offset = 0; offset < size;) {
+		if (ctx->pos == RANDOM_BUF_SIZE)
+			random_refill(ctx);
+
+		size_t n = MTY_MIN(size - offset, RANDOM_BUF_SIZE - ctx->pos);
+		memcpy((uint8_t *) output + offset, ctx->buf + ctx->pos, n);
+		memset(ctx->buf + ctx->pos, 0, n);
+
+		ctx->pos += n;
+		offset += n;
+	}
 
-	int32_t e = RAND_bytes(output, size);
-	if (e != 1)
-		MTY_Log("'RAND_bytes' failed with error %d", e);
+	ctx->generated += size;
 }
@@ -0,0 +1,460 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+
+#include <linux/time_types.h>
+#include <linux/io_uring.h>
+
+
+// Files
+
+static intptr_t mty_fileio_open(const char *path, bool write)
+{
+	int32_t fd = open(path, write ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0664);
+	if (fd == -1) {
+		MTY_Log("'open' failed with errno %d", errno);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void mty_fileio_close(intptr_t fd)
+{
+	close(fd);
+}
+
+static int64_t mty_fileio_read(intptr_t fd, void *buf, size_t size, uint64_t offset)
+{
+	size_t total = 0;
+
+	while (total < size) {
+		ssize_t n = pread(fd, (uint8_t *) buf + total, size - total, offset + total);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			MTY_Log("'pread' failed with errno %d", errno);
+			return -1;
+		}
+
+		if (n == 0)
+			break;
+
+		total += n;
+	}
+
+	return total;
+}
+
+static int64_t mty_fileio_write(intptr_t fd, const void *buf, size_t size, uint64_t offset)
+{
+	size_t total = 0;
+
+	while (total < size) {
+		ssize_t n = pwrite(fd, (const uint8_t *) buf + total, size - total, offset + total);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			MTY_Log("'pwrite' failed with errno %d", errno);
+			return -1;
+		}
+
+		total += n;
+	}
+
+	return total;
+}
+
+
+// io_uring, called via syscall to avoid a dependency on liburing. A read or write can
+// complete with fewer bytes than asked for, the remainder is resubmitted so results
+// match the threaded fallback, which loops until the request is done or hits EOF.
+
+struct fileio_ring_req {
+	void *opaque;
+	intptr_t fd;
+	bool write;
+	uint8_t *buf;
+	size_t size;
+	uint64_t offset;
+	int32_t buf_index;
+	size_t done;
+};
+
+struct fileio_ring {
+	int32_t fd;
+	uint32_t entries;
+	uint32_t tail;
+	uint32_t inflight;
+	bool registered;
+
+	struct fileio_ring_req *reqs;
+	uint32_t *free;
+	uint32_t nfree;
+
+	void *rings;
+	size_t rings_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	uint32_t *sq_head;
+	uint32_t *sq_tail;
+	uint32_t *sq_mask;
+	uint32_t *sq_array;
+	uint32_t *cq_head;
+	uint32_t *cq_tail;
+	uint32_t *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+static void fileio_ring_drain(struct fileio_ring *ctx);
+
+static void mty_fileio_ring_destroy(struct fileio_ring **ring)
+{
+	if (!ring || !*ring)
+		return;
+
+	struct fileio_ring *ctx = *ring;
+
+	// Requests the kernel accepted must land before the buffers they refer to go away,
+	// entries that never made it into the kernel are simply dropped
+	if (ctx->inflight > 0)
+		fileio_ring_drain(ctx);
+
+	if (ctx->sqes)
+		munmap(ctx->sqes, ctx->sqes_size);
+
+	if (ctx->rings)
+		munmap(ctx->rings, ctx->rings_size);
+
+	if (ctx->fd != -1)
+		close(ctx->fd);
+
+	MTY_Free(ctx->reqs);
+	MTY_Free(ctx->free);
+
+	MTY_Free(ctx);
+	*ring = NULL;
+}
+
+static struct fileio_ring *mty_fileio_ring_create(uint32_t depth)
+{
+	struct io_uring_params p = {0};
+	p.flags = IORING_SETUP_CLAMP;
+
+	int32_t fd = syscall(__NR_io_uring_setup, depth, &p);
+	if (fd == -1) {
+		MTY_LogDebug("'io_uring_setup' failed with errno %d", errno);
+		return NULL;
+	}
+
+	struct fileio_ring *ctx = MTY_Alloc(1, sizeof(struct fileio_ring));
+	ctx->fd = fd;
+	ctx->entries = p.sq_entries;
+
+	// Timed waits need IORING_FEAT_EXT_ARG (5.11), older kernels use the fallback
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG)) {
+		MTY_LogDebug("io_uring is missing required features 0x%X", p.features);
+		goto except;
+	}
+
+	size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+	size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+	ctx->rings_size = MTY_MAX(sq_size, cq_size);
+	ctx->rings = mmap(NULL, ctx->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, IORING_OFF_SQ_RING);
+	if (ctx->rings == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		ctx->rings = NULL;
+		goto except;
+	}
+
+	ctx->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	ctx->sqes = mmap(NULL, ctx->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, IORING_OFF_SQES);
+	if (ctx->sqes == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		ctx->sqes = NULL;
+		goto except;
+	}
+
+	uint8_t *rings = ctx->rings;
+	ctx->sq_head = (uint32_t *) (rings + p.sq_off.head);
+	ctx->sq_tail = (uint32_t *) (rings + p.sq_off.tail);
+	ctx->sq_mask = (uint32_t *) (rings + p.sq_off.ring_mask);
+	ctx->sq_array = (uint32_t *) (rings + p.sq_off.array);
+	ctx->cq_head = (uint32_t *) (rings + p.cq_off.head);
+	ctx->cq_tail = (uint32_t *) (rings + p.cq_off.tail);
+	ctx->cq_mask = (uint32_t *) (rings + p.cq_off.ring_mask);
+	ctx->cqes = (struct io_uring_cqe *) (rings + p.cq_off.cqes);
+
+	ctx->tail = *ctx->sq_tail;
+
+	ctx->reqs = MTY_Alloc(ctx->entries, sizeof(struct fileio_ring_req));
+	ctx->free = MTY_Alloc(ctx->entries, sizeof(uint32_t));
+
+	for (uint32_t x = 0; x < ctx->entries; x++)
+		ctx->free[ctx->nfree++] = ctx->entries - x - 1;
+
+	return ctx;
+
+	except:
+
+	mty_fileio_ring_destroy(&ctx);
+
+	return NULL;
+}
+
+static uint32_t mty_fileio_ring_entries(struct fileio_ring *ctx)
+{
+	return ctx->entries;
+}
+
+static bool mty_fileio_ring_register(struct fileio_ring *ctx, void **buffers, const size_t *sizes, uint32_t count)
+{
+	if (ctx->registered) {
+		syscall(__NR_io_uring_register, ctx->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+		ctx->registered = false;
+	}
+
+	if (count == 0)
+		return true;
+
+	struct iovec *iov = MTY_Alloc(count, sizeof(struct iovec));
+
+	for (uint32_t x = 0; x < count; x++) {
+		iov[x].iov_base = buffers[x];
+		iov[x].iov_len = sizes[x];
+	}
+
+	int32_t e = syscall(__NR_io_uring_register, ctx->fd, IORING_REGISTER_BUFFERS, iov, count);
+
+	MTY_Free(iov);
+
+	if (e == -1) {
+		MTY_Log("'io_uring_register' failed with errno %d", errno);
+		return false;
+	}
+
+	ctx->registered = true;
+
+	return true;
+}
+
+static void fileio_ring_prep(struct fileio_ring *ctx, uint32_t slot)
+{
+	const struct fileio_ring_req *req = &ctx->reqs[slot];
+	uint32_t index = ctx->tail & *ctx->sq_mask;
+
+	struct io_uring_sqe *sqe = &ctx->sqes[index];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+	if (req->buf_index >= 0) {
+		sqe->opcode = req->write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe->buf_index = req->buf_index;
+
+	} else {
+		sqe->opcode = req->write ? IORING_OP_WRITE : IORING_OP_READ;
+	}
+
+	sqe->fd = req->fd;
+	sqe->addr = (uintptr_t) (req->buf + req->done);
+	sqe->len = req->size - req->done;
+	sqe->off = req->offset + req->done;
+	sqe->user_data = slot;
+
+	ctx->sq_array[index] = index;
+	ctx->tail++;
+}
+
+static void mty_fileio_ring_push(struct fileio_ring *ctx, intptr_t fd, bool write, void *buf,
+	size_t size, uint64_t offset, int32_t buf_index, void *opaque)
+{
+	// The caller never has more than `entries` requests outstanding
+	uint32_t slot = ctx->free[--ctx->nfree];
+
+	struct fileio_ring_req *req = &ctx->reqs[slot];
+	req->opaque = opaque;
+	req->fd = fd;
+	req->write = write;
+	req->buf = buf;
+	req->size = size;
+	req->offset = offset;
+	req->buf_index = buf_index;
+	req->done = 0;
+
+	fileio_ring_prep(ctx, slot);
+}
+
+static uint32_t mty_fileio_ring_submit(struct fileio_ring *ctx)
+{
+	__atomic_store_n(ctx->sq_tail, ctx->tail, __ATOMIC_RELEASE);
+
+	// Entries left behind by an earlier failed submission are picked up here as well
+	uint32_t count = ctx->tail - __atomic_load_n(ctx->sq_head, __ATOMIC_ACQUIRE);
+	uint32_t submitted = 0;
+
+	while (submitted < count) {
+		int32_t n = syscall(__NR_io_uring_enter, ctx->fd, count - submitted, 0, 0, NULL, 0);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			MTY_Log("'io_uring_enter' failed with errno %d", errno);
+			break;
+		}
+
+		submitted += n;
+	}
+
+	ctx->inflight += submitted;
+
+	return submitted;
+}
+
+static void fileio_ring_enter_wait(struct fileio_ring *ctx, int32_t timeout)
+{
+	struct __kernel_timespec ts = {0};
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000 * 1000;
+
+	struct io_uring_getevents_arg arg = {0};
+	arg.ts = timeout > 0 ? (uintptr_t) &ts : 0;
+
+	int32_t e = syscall(__NR_io_uring_enter, ctx->fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+		&arg, sizeof(struct io_uring_getevents_arg));
+
+	if (e == -1 && errno != ETIME && errno != EINTR)
+		MTY_Log("'io_uring_enter' failed with errno %d", errno);
+}
+
+static uint32_t fileio_ring_reap(struct fileio_ring *ctx, MTY_FileIOResult *results, uint32_t max,
+	bool resubmit)
+{
+	uint32_t head = *ctx->cq_head;
+	uint32_t tail = __atomic_load_n(ctx->cq_tail, __ATOMIC_ACQUIRE);
+	uint32_t n = 0;
+	bool resubmitted = false;
+
+	for (; head != tail && n < max; head++) {
+		struct io_uring_cqe *cqe = &ctx->cqes[head & *ctx->cq_mask];
+		uint32_t slot = (uint32_t) cqe->user_data;
+		struct fileio_ring_req *req = &ctx->reqs[slot];
+
+		ctx->inflight--;
+
+		if (cqe->res > 0) {
+			req->done += cqe->res;
+
+			if (resubmit && req->done < req->size) {
+				fileio_ring_prep(ctx, slot);
+				resubmitted = true;
+				continue;
+			}
+		}
+
+		results[n].opaque = req->opaque;
+		results[n].result = req->done;
+
+		if (cqe->res < 0) {
+			MTY_Log("io_uring request failed with errno %d", -cqe->res);
+			results[n].result = -1;
+		}
+
+		ctx->free[ctx->nfree++] = slot;
+		n++;
+	}
+
+	__atomic_store_n(ctx->cq_head, head, __ATOMIC_RELEASE);
+
+	if (resubmitted)
+		mty_fileio_ring_submit(ctx);
+
+	return n;
+}
+
+static void fileio_ring_drain(struct fileio_ring *ctx)
+{
+	MTY_FileIOResult results[64];
+
+	while (ctx->inflight > 0)
+		if (fileio_ring_reap(ctx, results, 64, false) == 0)
+			fileio_ring_enter_wait(ctx, -1);
+}
+
+static uint32_t fileio_ring_fail(struct fileio_ring *ctx, MTY_FileIOResult *results, uint32_t max)
+{
+	uint32_t head = __atomic_load_n(ctx->sq_head, __ATOMIC_ACQUIRE);
+	uint32_t n = 0;
+
+	// The kernel hasn't looked at anything past its head, so entries can be taken back
+	// from the tail
+	for (; ctx->tail != head && n < max; n++) {
+		ctx->tail--;
+
+		struct io_uring_sqe *sqe = &ctx->sqes[ctx->sq_array[ctx->tail & *ctx->sq_mask]];
+		uint32_t slot = (uint32_t) sqe->user_data;
+
+		results[n].opaque = ctx->reqs[slot].opaque;
+		results[n].result = -1;
+
+		ctx->free[ctx->nfree++] = slot;
+	}
+
+	__atomic_store_n(ctx->sq_tail, ctx->tail, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+static uint32_t mty_fileio_ring_wait(struct fileio_ring *ctx, int32_t timeout, MTY_FileIOResult *results,
+	uint32_t max)
+{
+	int64_t deadline = MTY_GetTimeNs() + (int64_t) timeout * 1000 * 1000;
+
+	while (true) {
+		uint32_t n = fileio_ring_reap(ctx, results, max, true);
+
+		// Entries the kernel refused earlier are retried now that completions have been
+		// reaped. If it still won't take them and nothing else is in flight, they can
+		// never complete and are failed so the caller isn't left waiting on them.
+		if (n == 0 && ctx->tail != __atomic_load_n(ctx->sq_head, __ATOMIC_ACQUIRE)) {
+			mty_fileio_ring_submit(ctx);
+
+			if (ctx->inflight == 0)
+				return fileio_ring_fail(ctx, results, max);
+		}
+
+		// Completions that were only partial have been resubmitted and don't count
+		if (n > 0 || timeout == 0 || ctx->inflight == 0)
+			return n;
+
+		int32_t remaining = -1;
+
+		if (timeout > 0) {
+			int64_t now = MTY_GetTimeNs();
+			if (now >= deadline)
+				return 0;
+
+			remaining = (int32_t) ((deadline - now + 999999) / (1000 * 1000));
+		}
+
+		fileio_ring_enter_wait(ctx, remaining);
+	}
+}
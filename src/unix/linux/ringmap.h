@@ -0,0 +1,71 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if !defined(MFD_CLOEXEC)
+	#define MFD_CLOEXEC 0x0001U
+#endif
+
+static size_t mty_ringmap_granularity(void)
+{
+	long page = sysconf(_SC_PAGESIZE);
+
+	return page > 0 ? page : 4096;
+}
+
+static void *mty_ringmap_create(size_t size)
+{
+	// Called via syscall since older libcs don't wrap memfd_create
+	int32_t fd = syscall(SYS_memfd_create, "mty-ring", MFD_CLOEXEC);
+	if (fd == -1) {
+		MTY_Log("'memfd_create' failed with errno %d", errno);
+		return NULL;
+	}
+
+	uint8_t *base = NULL;
+
+	if (ftruncate(fd, size) != 0) {
+		MTY_Log("'ftruncate' failed with errno %d", errno);
+		goto except;
+	}
+
+	// Reserve the whole range first so the two views are guaranteed to be adjacent
+	base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		base = NULL;
+		goto except;
+	}
+
+	for (uint8_t x = 0; x < 2; x++) {
+		if (mmap(base + x * size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			MTY_Log("'mmap' failed with errno %d", errno);
+			munmap(base, size * 2);
+			base = NULL;
+			break;
+		}
+	}
+
+	except:
+
+	// The mappings keep the memory alive
+	close(fd);
+
+	return base;
+}
+
+static void mty_ringmap_destroy(void *base, size_t size)
+{
+	if (munmap(base, size * 2) != 0)
+		MTY_Log("'munmap' failed with errno %d", errno);
+}
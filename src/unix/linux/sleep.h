@@ -9,6 +9,10 @@
 #include <time.h>
 #include <errno.h>
 
+#if defined(__linux__)
+	#include <sys/prctl.h>
+#endif
+
 static void mty_sleep(uint32_t timeout)
 {
 	struct timespec ts = {0};
@@ -18,3 +22,22 @@ static void mty_sleep(uint32_t timeout)
 	if (nanosleep(&ts, NULL) != 0)
 		MTY_Log("'nanosleep' failed with errno %d", errno);
 }
+
+static void mty_sleep_ns(int64_t ns)
+{
+	struct timespec ts = {0};
+	ts.tv_sec = ns / (1000 * 1000 * 1000);
+	ts.tv_nsec = ns % (1000 * 1000 * 1000);
+
+	if (nanosleep(&ts, NULL) != 0 && errno != EINTR)
+		MTY_Log("'nanosleep' failed with errno %d", errno);
+}
+
+static void mty_set_timer_slack(bool minimal)
+{
+	#if defined(__linux__)
+		// A slack of 0 restores the thread's default
+		if (prctl(PR_SET_TIMERSLACK, minimal ? 1 : 0, 0, 0, 0) != 0)
+			MTY_Log("'prctl' failed with errno %d", errno);
+	#endif
+}
@@ -0,0 +1,70 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+static bool mty_threadattr_set_name(const char *name)
+{
+	// The kernel truncates names to 15 characters
+	if (prctl(PR_SET_NAME, name, 0, 0, 0) != 0) {
+		MTY_Log("'prctl' failed with errno %d", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static bool mty_threadattr_set_affinity(uint64_t affinity)
+{
+	// The raw syscall takes an array of longs which matches a little endian uint64_t
+	if (syscall(SYS_sched_setaffinity, 0, sizeof(uint64_t), &affinity) != 0) {
+		MTY_Log("'sched_setaffinity' failed with errno %d", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static bool mty_threadattr_set_priority(MTY_ThreadPriority priority)
+{
+	struct sched_param param = {0};
+	int32_t policy = SCHED_OTHER;
+
+	if (priority == MTY_THREAD_PRIORITY_REALTIME) {
+		policy = SCHED_FIFO;
+
+		// Leave the top of the range to the kernel and system services
+		param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+	}
+
+	int32_t e = pthread_setschedparam(pthread_self(), policy, &param);
+	if (e != 0) {
+		MTY_Log("'pthread_setschedparam' failed with error %d", e);
+		return false;
+	}
+
+	if (priority == MTY_THREAD_PRIORITY_REALTIME)
+		return true;
+
+	// SCHED_OTHER threads are only differentiated by their nice value, which Linux
+	// tracks per thread
+	int32_t nice = priority == MTY_THREAD_PRIORITY_HIGH ? -10 : priority == MTY_THREAD_PRIORITY_LOW ? 10 : 0;
+
+	if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice) != 0) {
+		MTY_Log("'setpriority' failed with errno %d", errno);
+		return false;
+	}
+
+	return true;
+}
@@ -27,3 +27,121 @@ static float mty_frequency(void)
 {
 	return 0.001f;
 }
+
+static int64_t timestamp_monotonic_ns(void)
+{
+	struct timespec ts = {0};
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+		MTY_Log("'clock_gettime' failed with errno %d", errno);
+
+	return (int64_t) ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+#if defined(__x86_64__)
+
+#include <stdio.h>
+#include <string.h>
+#include <cpuid.h>
+#include <x86intrin.h>
+
+#include "atomic.h"
+
+// The TSC is only used when the CPU reports it as invariant and the kernel itself
+// chose it as the clocksource, which means it passed the kernel's cross core
+// synchronization checks. Until enough time has passed to measure its rate against
+// CLOCK_MONOTONIC, timestamps come from clock_gettime.
+
+#define TIMESTAMP_CALIBRATE_NS (50 * 1000 * 1000)
+
+enum {
+	TIMESTAMP_TSC_UNKNOWN     = 0,
+	TIMESTAMP_TSC_CALIBRATING = 1,
+	TIMESTAMP_TSC_READY       = 2,
+	TIMESTAMP_TSC_UNAVAILABLE = 3,
+};
+
+static MTY_Atomic32 TIMESTAMP_TSC;
+static MTY_Atomic32 TIMESTAMP_BUSY;
+static uint64_t TIMESTAMP_TSC0;
+static int64_t TIMESTAMP_NS0;
+static uint64_t TIMESTAMP_MULT;
+
+static bool timestamp_tsc_usable(void)
+{
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+		return false;
+
+	FILE *f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+	if (!f)
+		return false;
+
+	char name[16] = {0};
+	bool r = fgets(name, sizeof(name), f) && !strncmp(name, "tsc", 3);
+
+	fclose(f);
+
+	return r;
+}
+
+static void timestamp_tsc_calibrate(int32_t state)
+{
+	// Threads that lose the race keep using clock_gettime for this call
+	int32_t busy = 0;
+	if (!mty_atomic32_cas(&TIMESTAMP_BUSY, &busy, 1, MTY_MEMORY_ORDER_ACQUIRE))
+		return;
+
+	if (state == TIMESTAMP_TSC_UNKNOWN && mty_atomic32_load(&TIMESTAMP_TSC, MTY_MEMORY_ORDER_RELAXED) == state) {
+		if (timestamp_tsc_usable()) {
+			TIMESTAMP_TSC0 = __rdtsc();
+			TIMESTAMP_NS0 = timestamp_monotonic_ns();
+			state = TIMESTAMP_TSC_CALIBRATING;
+
+		} else {
+			state = TIMESTAMP_TSC_UNAVAILABLE;
+		}
+
+		mty_atomic32_store(&TIMESTAMP_TSC, state, MTY_MEMORY_ORDER_RELAXED);
+
+	} else if (state == TIMESTAMP_TSC_CALIBRATING) {
+		uint64_t tsc = __rdtsc();
+		int64_t ns = timestamp_monotonic_ns();
+
+		if (ns - TIMESTAMP_NS0 >= TIMESTAMP_CALIBRATE_NS && tsc > TIMESTAMP_TSC0) {
+			// Nanoseconds per tick as 32.32 fixed point, the new base keeps the first
+			// TSC derived timestamps continuous with the clock_gettime ones before them
+			TIMESTAMP_MULT = ((uint64_t) (ns - TIMESTAMP_NS0) << 32) / (tsc - TIMESTAMP_TSC0);
+			TIMESTAMP_TSC0 = tsc;
+			TIMESTAMP_NS0 = ns;
+
+			mty_atomic32_store(&TIMESTAMP_TSC, TIMESTAMP_TSC_READY, MTY_MEMORY_ORDER_RELEASE);
+		}
+	}
+
+	mty_atomic32_store(&TIMESTAMP_BUSY, 0, MTY_MEMORY_ORDER_RELEASE);
+}
+
+static int64_t mty_timestamp_ns(void)
+{
+	int32_t state = mty_atomic32_load(&TIMESTAMP_TSC, MTY_MEMORY_ORDER_ACQUIRE);
+
+	if (state == TIMESTAMP_TSC_READY) {
+		unsigned __int128 delta = (unsigned __int128) (__rdtsc() - TIMESTAMP_TSC0) * TIMESTAMP_MULT;
+
+		return TIMESTAMP_NS0 + (int64_t) (delta >> 32);
+	}
+
+	if (state != TIMESTAMP_TSC_UNAVAILABLE)
+		timestamp_tsc_calibrate(state);
+
+	return timestamp_monotonic_ns();
+}
+
+#else
+
+static int64_t mty_timestamp_ns(void)
+{
+	return timestamp_monotonic_ns();
+}
+
+#endif
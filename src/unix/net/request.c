@@ -80,6 +80,8 @@ bool MTY_HttpRequest(const char *host, bool secure, const char *method, const ch
 	const char *headers, const void *body, size_t bodySize, uint32_t timeout,
 	void **response, size_t *responseSize, uint16_t *status)
 {
+	MTY_TraceBegin("MTY_HttpRequest");
+
 	*responseSize = 0;
 	*response = NULL;
 
@@ -110,13 +112,13 @@ bool MTY_HttpRequest(const char *host, bool secure, const char *method, const ch
 		mty_http_set_header_int(&req, "Content-Length", bodySize);
 
 	// Send the request header
-	r = mty_http_write_request_header(net, method, path, req);
+	r = mty_http_write_request_header(net, method, path, req, timeout);
 	if (!r)
 		goto except;
 
 	// Send the request body
 	if (body && bodySize > 0) {
-		r = mty_net_write(net, body, bodySize);
+		r = mty_net_write(net, body, bodySize, timeout);
 		if (!r)
 			goto except;
 	}
@@ -176,5 +178,7 @@ bool MTY_HttpRequest(const char *host, bool secure, const char *method, const ch
 		*response = NULL;
 	}
 
+	MTY_TraceEnd("MTY_HttpRequest");
+
 	return r;
 }
@@ -79,6 +79,17 @@ const char *MTY_GetHostname(void)
 	return mty_tlocal_strcpy(tmp);
 }
 
+uint32_t MTY_GetNumProcessors(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1) {
+		MTY_Log("'sysconf' failed with errno %d", errno);
+		return 1;
+	}
+
+	return (uint32_t) n;
+}
+
 static void system_signal_handler(int32_t sig)
 {
 	if (SYSTEM_CRASH_FUNC)
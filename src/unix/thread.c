@@ -4,6 +4,8 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
+#define _DEFAULT_SOURCE // syscall
+
 #include "matoya.h"
 
 #include <stdlib.h>
@@ -12,7 +14,9 @@
 #include <time.h>
 
 #include "thread.h"
+#include "threadattr.h"
 #include "gettime.h"
+#include "trace.h"
 
 
 // Thread
@@ -23,32 +27,71 @@ struct MTY_Thread {
 	MTY_ThreadFunc func;
 	void *opaque;
 	void *ret;
+
+	char *name;
+	uint64_t affinity;
+	MTY_ThreadPriority priority;
 };
 
 static void *thread_func(void *opaque)
 {
 	MTY_Thread *ctx = (MTY_Thread *) opaque;
 
+	if (ctx->name)
+		mty_threadattr_set_name(ctx->name);
+
+	if (ctx->affinity != 0)
+		mty_threadattr_set_affinity(ctx->affinity);
+
+	if (ctx->priority != MTY_THREAD_PRIORITY_NORMAL)
+		mty_threadattr_set_priority(ctx->priority);
+
 	ctx->ret = ctx->func(ctx->opaque);
 
+	mty_trace_thread_exit();
+
 	if (ctx->detach)
 		MTY_Free(ctx);
 
 	return NULL;
 }
 
-static MTY_Thread *thread_create(MTY_ThreadFunc func, void *opaque, bool detach)
+static MTY_Thread *thread_create(MTY_ThreadFunc func, void *opaque, bool detach, const MTY_ThreadDesc *desc)
 {
 	MTY_Thread *ctx = MTY_Alloc(1, sizeof(MTY_Thread));
 	ctx->func = func;
 	ctx->opaque = opaque;
 	ctx->detach = detach;
 
-	int32_t e = pthread_create(&ctx->thread, NULL, thread_func, ctx);
+	pthread_attr_t attr;
+	pthread_attr_t *pattr = NULL;
+
+	if (desc) {
+		ctx->name = desc->name ? MTY_Strdup(desc->name) : NULL;
+		ctx->affinity = desc->affinity;
+		ctx->priority = desc->priority;
+
+		if (desc->stackSize > 0) {
+			int32_t e = pthread_attr_init(&attr);
+			if (e != 0)
+				MTY_LogFatal("'pthread_attr_init' failed with error %d", e);
+
+			e = pthread_attr_setstacksize(&attr, desc->stackSize);
+			if (e != 0)
+				MTY_Log("'pthread_attr_setstacksize' failed with error %d", e);
+
+			pattr = &attr;
+		}
+	}
+
+	int32_t e = pthread_create(&ctx->thread, pattr, thread_func, ctx);
 
 	if (e != 0)
 		MTY_LogFatal("'pthread_create' failed with error %d", e);
 
+	if (pattr)
+		pthread_attr_destroy(pattr);
+
 	if (ctx->detach) {
 		e = pthread_detach(ctx->thread);
 		if (e != 0)
@@ -63,12 +106,32 @@ static MTY_Thread *thread_create(MTY_ThreadFunc func, void *opaque, bool detach)
 
 MTY_Thread *MTY_ThreadCreate(MTY_ThreadFunc func, void *opaque)
 {
-	return thread_create(func, opaque, false);
+	return thread_create(func, opaque, false, NULL);
+}
+
+MTY_Thread *MTY_ThreadCreateEx(MTY_ThreadFunc func, void *opaque, const MTY_ThreadDesc *desc)
+{
+	return thread_create(func, opaque, false, desc);
 }
 
 void MTY_ThreadDetach(MTY_ThreadFunc func, void *opaque)
 {
-	thread_create(func, opaque, true);
+	thread_create(func, opaque, true, NULL);
+}
+
+bool MTY_ThreadSetName(const char *name)
+{
+	return mty_threadattr_set_name(name);
+}
+
+bool MTY_ThreadSetAffinity(uint64_t affinity)
+{
+	return mty_threadattr_set_affinity(affinity);
+}
+
+bool MTY_ThreadSetPriority(MTY_ThreadPriority priority)
+{
+	return mty_threadattr_set_priority(priority);
 }
 
 int64_t MTY_ThreadGetID(MTY_Thread *ctx)
@@ -91,6 +154,7 @@ void *MTY_ThreadDestroy(MTY_Thread **thread)
 
 	void *ret = ctx->ret;
 
+	MTY_Free(ctx->name);
 	MTY_Free(ctx);
 	*thread = NULL;
 
@@ -10,8 +10,21 @@
 #include "sleep.h"
 #include "timestamp.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+	#define time_cpu_relax() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+	#define time_cpu_relax() __asm__ __volatile__("yield")
+#else
+	#define time_cpu_relax()
+#endif
+
+#define TIME_SPIN_MIN_NS (50 * 1000)
+#define TIME_SPIN_MAX_NS (2 * 1000 * 1000)
+
 static TLOCAL bool TIME_FREQ_INIT;
 static TLOCAL float TIME_FREQUENCY;
+static TLOCAL int64_t TIME_OVERSLEEP;
 
 MTY_Time MTY_GetTime(void)
 {
@@ -28,15 +41,45 @@ float MTY_TimeDiff(MTY_Time begin, MTY_Time end)
 	return (float) (end - begin) * TIME_FREQUENCY;
 }
 
+int64_t MTY_GetTimeNs(void)
+{
+	return mty_timestamp_ns();
+}
+
 void MTY_Sleep(uint32_t timeout)
 {
 	mty_sleep(timeout);
 }
 
+void MTY_SleepUntil(int64_t deadline)
+{
+	// Keep a margin of twice the average oversleep seen on this thread for spinning
+	int64_t margin = MTY_MIN(MTY_MAX(TIME_OVERSLEEP * 2, TIME_SPIN_MIN_NS), TIME_SPIN_MAX_NS);
+	int64_t now = MTY_GetTimeNs();
+
+	if (deadline - now > margin) {
+		int64_t request = deadline - now - margin;
+		mty_sleep_ns(request);
+
+		int64_t after = MTY_GetTimeNs();
+		int64_t over = MTY_MAX(after - now - request, 0);
+		TIME_OVERSLEEP += (over - TIME_OVERSLEEP) / 8;
+
+		now = after;
+	}
+
+	while (now < deadline) {
+		time_cpu_relax();
+		now = MTY_GetTimeNs();
+	}
+}
+
 void MTY_SetTimerResolution(uint32_t res)
 {
+	mty_set_timer_slack(true);
 }
 
 void MTY_RevertTimerResolution(uint32_t res)
 {
+	mty_set_timer_slack(false);
 }
@@ -0,0 +1 @@
+../apple/dirread.h
\ No newline at end of file
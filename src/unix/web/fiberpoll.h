@@ -0,0 +1,34 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+// WASM can't switch stacks, so fibers never start and sockets are never polled
+
+struct fiberpoll;
+
+static struct fiberpoll *mty_fiberpoll_create(void)
+{
+	return NULL;
+}
+
+static void mty_fiberpoll_destroy(struct fiberpoll **fiberpoll)
+{
+}
+
+static bool mty_fiberpoll_add(struct fiberpoll *ctx, intptr_t fd, bool out, void *opaque)
+{
+	return false;
+}
+
+static void mty_fiberpoll_remove(struct fiberpoll *ctx, intptr_t fd, bool out)
+{
+}
+
+static uint32_t mty_fiberpoll_wait(struct fiberpoll *ctx, int32_t timeout, void **ready, uint32_t max)
+{
+	return 0;
+}
@@ -0,0 +1 @@
+../apple/fswatch.h
\ No newline at end of file
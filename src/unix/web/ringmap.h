@@ -0,0 +1,24 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+// WASM has a single linear memory that can't be remapped, MTY_RingBuffer
+// falls back to mirroring writes in software
+
+static size_t mty_ringmap_granularity(void)
+{
+	return 4096;
+}
+
+static void *mty_ringmap_create(size_t size)
+{
+	return NULL;
+}
+
+static void mty_ringmap_destroy(void *base, size_t size)
+{
+}
@@ -7,3 +7,5 @@
 #pragma once
 
 #define mty_sleep(timeout)
+#define mty_sleep_ns(ns)
+#define mty_set_timer_slack(minimal)
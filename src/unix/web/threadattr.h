@@ -0,0 +1,24 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+// Threads on the web are workers scheduled by the browser
+
+static bool mty_threadattr_set_name(const char *name)
+{
+	return false;
+}
+
+static bool mty_threadattr_set_affinity(uint64_t affinity)
+{
+	return false;
+}
+
+static bool mty_threadattr_set_priority(MTY_ThreadPriority priority)
+{
+	return false;
+}
@@ -1413,6 +1413,8 @@ void MTY_AppRun(MTY_App *app)
 		if (!window)
 			break;
 
+		MTY_TraceBegin("MTY_AppRun");
+
 		bool focus = MTY_AppIsActive(app);
 
 		// Keyboard, mouse state changes
@@ -1441,7 +1443,11 @@ void MTY_AppRun(MTY_App *app)
 		// Mouse button state reconciliation
 		app_fix_mouse_buttons(app);
 
+		MTY_TraceBegin("MTY_AppFunc");
 		cont = app->app_func(app->opaque);
+		MTY_TraceEnd("MTY_AppFunc");
+
+		MTY_TraceEnd("MTY_AppRun");
 
 		if (app->timeout > 0)
 			MTY_Sleep(app->timeout);
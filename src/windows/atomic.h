@@ -0,0 +1,231 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <windows.h>
+#include <intrin.h>
+
+// Interlocked functions are full barriers. On x86/x64 plain loads and stores
+// already have acquire and release semantics, so only a compiler barrier is
+// needed for anything weaker than sequential consistency.
+
+#if defined(_M_IX86) || defined(_M_X64)
+	#define ATOMIC_TSO
+#endif
+
+#if defined(_M_X64) || defined(_M_ARM64)
+	#define ATOMIC_128_NATIVE
+#endif
+
+
+// 32-bit
+
+static __inline int32_t mty_atomic32_load(MTY_Atomic32 *atomic, MTY_MemoryOrder order)
+{
+	#if defined(ATOMIC_TSO)
+		if (order != MTY_MEMORY_ORDER_SEQ_CST) {
+			int32_t value = atomic->value;
+			_ReadWriteBarrier();
+
+			return value;
+		}
+	#endif
+
+	return InterlockedOr((volatile LONG *) &atomic->value, 0);
+}
+
+static __inline void mty_atomic32_store(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	#if defined(ATOMIC_TSO)
+		if (order != MTY_MEMORY_ORDER_SEQ_CST) {
+			_ReadWriteBarrier();
+			atomic->value = value;
+
+			return;
+		}
+	#endif
+
+	InterlockedExchange((volatile LONG *) &atomic->value, value);
+}
+
+static __inline int32_t mty_atomic32_exchange(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return InterlockedExchange((volatile LONG *) &atomic->value, value);
+}
+
+static __inline int32_t mty_atomic32_fetch_add(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return InterlockedExchangeAdd((volatile LONG *) &atomic->value, value);
+}
+
+static __inline int32_t mty_atomic32_fetch_or(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return InterlockedOr((volatile LONG *) &atomic->value, value);
+}
+
+static __inline int32_t mty_atomic32_fetch_and(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return InterlockedAnd((volatile LONG *) &atomic->value, value);
+}
+
+static __inline int32_t mty_atomic32_fetch_xor(MTY_Atomic32 *atomic, int32_t value, MTY_MemoryOrder order)
+{
+	return InterlockedXor((volatile LONG *) &atomic->value, value);
+}
+
+static __inline bool mty_atomic32_cas(MTY_Atomic32 *atomic, int32_t *expected, int32_t desired, MTY_MemoryOrder order)
+{
+	int32_t prev = InterlockedCompareExchange((volatile LONG *) &atomic->value, desired, *expected);
+
+	if (prev == *expected)
+		return true;
+
+	*expected = prev;
+
+	return false;
+}
+
+
+// 64-bit
+
+static __inline int64_t mty_atomic64_load(MTY_Atomic64 *atomic, MTY_MemoryOrder order)
+{
+	#if defined(_M_X64)
+		if (order != MTY_MEMORY_ORDER_SEQ_CST) {
+			int64_t value = atomic->value;
+			_ReadWriteBarrier();
+
+			return value;
+		}
+	#endif
+
+	return InterlockedOr64(&atomic->value, 0);
+}
+
+static __inline void mty_atomic64_store(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	#if defined(_M_X64)
+		if (order != MTY_MEMORY_ORDER_SEQ_CST) {
+			_ReadWriteBarrier();
+			atomic->value = value;
+
+			return;
+		}
+	#endif
+
+	InterlockedExchange64(&atomic->value, value);
+}
+
+static __inline int64_t mty_atomic64_exchange(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return InterlockedExchange64(&atomic->value, value);
+}
+
+static __inline int64_t mty_atomic64_fetch_add(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return InterlockedExchangeAdd64(&atomic->value, value);
+}
+
+static __inline int64_t mty_atomic64_fetch_or(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return InterlockedOr64(&atomic->value, value);
+}
+
+static __inline int64_t mty_atomic64_fetch_and(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return InterlockedAnd64(&atomic->value, value);
+}
+
+static __inline int64_t mty_atomic64_fetch_xor(MTY_Atomic64 *atomic, int64_t value, MTY_MemoryOrder order)
+{
+	return InterlockedXor64(&atomic->value, value);
+}
+
+static __inline bool mty_atomic64_cas(MTY_Atomic64 *atomic, int64_t *expected, int64_t desired, MTY_MemoryOrder order)
+{
+	int64_t prev = InterlockedCompareExchange64(&atomic->value, desired, *expected);
+
+	if (prev == *expected)
+		return true;
+
+	*expected = prev;
+
+	return false;
+}
+
+
+// Pointer
+
+static __inline void *mty_atomic_ptr_load(MTY_AtomicPtr *atomic, MTY_MemoryOrder order)
+{
+	#if defined(ATOMIC_TSO)
+		if (order != MTY_MEMORY_ORDER_SEQ_CST) {
+			void *value = atomic->value;
+			_ReadWriteBarrier();
+
+			return value;
+		}
+	#endif
+
+	return InterlockedCompareExchangePointer((void * volatile *) &atomic->value, NULL, NULL);
+}
+
+static __inline void mty_atomic_ptr_store(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order)
+{
+	#if defined(ATOMIC_TSO)
+		if (order != MTY_MEMORY_ORDER_SEQ_CST) {
+			_ReadWriteBarrier();
+			atomic->value = value;
+
+			return;
+		}
+	#endif
+
+	InterlockedExchangePointer((void * volatile *) &atomic->value, value);
+}
+
+static __inline void *mty_atomic_ptr_exchange(MTY_AtomicPtr *atomic, void *value, MTY_MemoryOrder order)
+{
+	return InterlockedExchangePointer((void * volatile *) &atomic->value, value);
+}
+
+static __inline bool mty_atomic_ptr_cas(MTY_AtomicPtr *atomic, void **expected, void *desired, MTY_MemoryOrder order)
+{
+	void *prev = InterlockedCompareExchangePointer((void * volatile *) &atomic->value, desired, *expected);
+
+	if (prev == *expected)
+		return true;
+
+	*expected = prev;
+
+	return false;
+}
+
+
+// Misc
+
+static __inline void mty_atomic_fence(MTY_MemoryOrder order)
+{
+	#if defined(ATOMIC_TSO)
+		if (order != MTY_MEMORY_ORDER_SEQ_CST) {
+			_ReadWriteBarrier();
+			return;
+		}
+	#endif
+
+	MemoryBarrier();
+}
+
+#if defined(ATOMIC_128_NATIVE)
+
+static __inline bool mty_atomic128_cas(MTY_Atomic128 *atomic, MTY_Atomic128 *expected, MTY_Atomic128 desired)
+{
+	return InterlockedCompareExchange128(atomic->value, desired.value[1], desired.value[0],
+		(LONG64 *) expected->value);
+}
+
+#endif
@@ -21,6 +21,8 @@ DEFINE_GUID(IID_IMMNotificationClient, 0x7991eec9, 0x7e89, 0x4d85, 0x83, 0x90, 0
 #include <mmdeviceapi.h>
 #include <audioclient.h>
 
+#include "metrics.h"
+
 #define AUDIO_CHANNELS 2
 #define AUDIO_SAMPLE_SIZE sizeof(int16_t)
 #define AUDIO_BUFFER_SIZE ((1 * 1000 * 1000 * 1000) / 100) // 1 second
@@ -304,11 +306,16 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 	if (!audio_handle_device_change(ctx))
 		return;
 
+	MTY_TraceBegin("MTY_AudioQueue");
+
 	uint32_t queued = audio_get_queued_frames(ctx);
+	MTY_TraceCounter("MTY_AudioQueue:queued", queued);
 
 	// Stop playing and flush if we've exceeded the maximum buffer or underrun
-	if (ctx->playing && (queued > ctx->max_buffer || queued == 0))
+	if (ctx->playing && (queued > ctx->max_buffer || queued == 0)) {
+		mty_metric_add(queued == 0 ? METRIC_AUDIO_UNDERRUNS : METRIC_AUDIO_OVERFLOWS, 1);
 		MTY_AudioReset(ctx);
+	}
 
 	if (ctx->buffer_size - queued >= count) {
 		BYTE *buffer = NULL;
@@ -323,6 +330,8 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 		if (!ctx->playing && queued + count >= ctx->min_buffer)
 			audio_play(ctx);
 	}
+
+	MTY_TraceEnd("MTY_AudioQueue");
 }
 
 void MTY_AudioDestroy(MTY_Audio **audio)
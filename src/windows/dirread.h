@@ -0,0 +1,81 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <windows.h>
+
+// FindExInfoBasic skips the short names and FIND_FIRST_EX_LARGE_FETCH asks for bigger
+// batches per call into the filesystem
+
+#define DIRREAD_DELIM '\\'
+
+struct dirread {
+	HANDLE find;
+	bool first;
+	WIN32_FIND_DATA ent;
+	char name[MTY_PATH_MAX];
+};
+
+static struct dirread *mty_dirread_open(const char *path)
+{
+	size_t mark = MTY_ScratchPush();
+	wchar_t *pathw = MTY_MultiToWideD(MTY_JoinPath(path, "*"));
+	MTY_ScratchPop(mark);
+
+	struct dirread *ctx = MTY_Alloc(1, sizeof(struct dirread));
+
+	ctx->find = FindFirstFileEx(pathw, FindExInfoBasic, &ctx->ent, FindExSearchNameMatch, NULL,
+		FIND_FIRST_EX_LARGE_FETCH);
+
+	MTY_Free(pathw);
+
+	if (ctx->find == INVALID_HANDLE_VALUE) {
+		MTY_Log("'FindFirstFileEx' failed with error 0x%X", GetLastError());
+		MTY_Free(ctx);
+		return NULL;
+	}
+
+	ctx->first = true;
+
+	return ctx;
+}
+
+static void mty_dirread_close(struct dirread **dirread)
+{
+	if (!dirread || !*dirread)
+		return;
+
+	struct dirread *ctx = *dirread;
+
+	FindClose(ctx->find);
+
+	MTY_Free(ctx);
+	*dirread = NULL;
+}
+
+static const char *mty_dirread_next(struct dirread *ctx, MTY_FileType *type)
+{
+	if (!ctx->first && !FindNextFile(ctx->find, &ctx->ent)) {
+		DWORD e = GetLastError();
+		if (e != ERROR_NO_MORE_FILES)
+			MTY_Log("'FindNextFile' failed with error 0x%X", e);
+
+		return NULL;
+	}
+
+	ctx->first = false;
+
+	DWORD attrs = ctx->ent.dwFileAttributes;
+
+	*type = (attrs & FILE_ATTRIBUTE_REPARSE_POINT) ? MTY_FILE_TYPE_LINK :
+		(attrs & FILE_ATTRIBUTE_DIRECTORY) ? MTY_FILE_TYPE_DIR :
+		(attrs & FILE_ATTRIBUTE_DEVICE) ? MTY_FILE_TYPE_OTHER : MTY_FILE_TYPE_FILE;
+
+	MTY_WideToMulti(ctx->ent.cFileName, ctx->name, MTY_PATH_MAX);
+
+	return ctx->name;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <windows.h>
+
+struct fiberctx {
+	void *fiber;
+	void (*entry)(void);
+	bool converted;
+};
+
+static VOID WINAPI mty_fiberctx_entry(LPVOID lpParameter)
+{
+	struct fiberctx *ctx = lpParameter;
+
+	ctx->entry();
+}
+
+static struct fiberctx *mty_fiberctx_create(size_t stack_size, void (*entry)(void))
+{
+	struct fiberctx *ctx = MTY_Alloc(1, sizeof(struct fiberctx));
+	ctx->entry = entry;
+
+	// The calling thread must itself be a fiber before it can switch to one
+	if (!entry) {
+		ctx->fiber = ConvertThreadToFiberEx(NULL, FIBER_FLAG_FLOAT_SWITCH);
+
+		if (ctx->fiber) {
+			ctx->converted = true;
+
+		} else if (GetLastError() == ERROR_ALREADY_FIBER) {
+			ctx->fiber = GetCurrentFiber();
+
+		} else {
+			MTY_Log("'ConvertThreadToFiberEx' failed with error 0x%X", GetLastError());
+			MTY_Free(ctx);
+			return NULL;
+		}
+
+		return ctx;
+	}
+
+	ctx->fiber = CreateFiberEx(stack_size, stack_size, FIBER_FLAG_FLOAT_SWITCH, mty_fiberctx_entry, ctx);
+	if (!ctx->fiber) {
+		MTY_Log("'CreateFiberEx' failed with error 0x%X", GetLastError());
+		MTY_Free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+static void mty_fiberctx_destroy(struct fiberctx **fiberctx)
+{
+	if (!fiberctx || !*fiberctx)
+		return;
+
+	struct fiberctx *ctx = *fiberctx;
+
+	if (ctx->entry) {
+		DeleteFiber(ctx->fiber);
+
+	} else if (ctx->converted) {
+		if (!ConvertFiberToThread())
+			MTY_Log("'ConvertFiberToThread' failed with error 0x%X", GetLastError());
+	}
+
+	MTY_Free(ctx);
+	*fiberctx = NULL;
+}
+
+static void mty_fiberctx_switch(struct fiberctx *from, struct fiberctx *to)
+{
+	SwitchToFiber(to->fiber);
+}
@@ -0,0 +1,104 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <winsock2.h>
+
+// WSAPoll takes the full set every call, registrations are kept in parallel arrays
+// and compacted as they fire or are removed
+
+struct fiberpoll {
+	WSAPOLLFD *fds;
+	void **opaques;
+	uint32_t len;
+	uint32_t num;
+};
+
+static struct fiberpoll *mty_fiberpoll_create(void)
+{
+	return MTY_Alloc(1, sizeof(struct fiberpoll));
+}
+
+static void mty_fiberpoll_destroy(struct fiberpoll **fiberpoll)
+{
+	if (!fiberpoll || !*fiberpoll)
+		return;
+
+	struct fiberpoll *ctx = *fiberpoll;
+
+	MTY_Free(ctx->fds);
+	MTY_Free(ctx->opaques);
+
+	MTY_Free(ctx);
+	*fiberpoll = NULL;
+}
+
+static bool mty_fiberpoll_add(struct fiberpoll *ctx, intptr_t fd, bool out, void *opaque)
+{
+	if (ctx->num == ctx->len) {
+		ctx->len = ctx->len > 0 ? ctx->len * 2 : 64;
+		ctx->fds = MTY_Realloc(ctx->fds, ctx->len, sizeof(WSAPOLLFD));
+		ctx->opaques = MTY_Realloc(ctx->opaques, ctx->len, sizeof(void *));
+	}
+
+	WSAPOLLFD *pfd = &ctx->fds[ctx->num];
+	pfd->fd = (SOCKET) fd;
+	pfd->events = out ? POLLOUT : POLLIN;
+	pfd->revents = 0;
+
+	ctx->opaques[ctx->num++] = opaque;
+
+	return true;
+}
+
+static void mty_fiberpoll_drop(struct fiberpoll *ctx, uint32_t index)
+{
+	ctx->num--;
+	ctx->fds[index] = ctx->fds[ctx->num];
+	ctx->opaques[index] = ctx->opaques[ctx->num];
+}
+
+static void mty_fiberpoll_remove(struct fiberpoll *ctx, intptr_t fd, bool out)
+{
+	SHORT events = out ? POLLOUT : POLLIN;
+
+	for (uint32_t x = 0; x < ctx->num; x++) {
+		if (ctx->fds[x].fd == (SOCKET) fd && ctx->fds[x].events == events) {
+			mty_fiberpoll_drop(ctx, x);
+			break;
+		}
+	}
+}
+
+static uint32_t mty_fiberpoll_wait(struct fiberpoll *ctx, int32_t timeout, void **ready, uint32_t max)
+{
+	// WSAPoll rejects an empty set
+	if (ctx->num == 0) {
+		Sleep(timeout < 0 ? INFINITE : timeout);
+		return 0;
+	}
+
+	int32_t e = WSAPoll(ctx->fds, ctx->num, timeout);
+	if (e == SOCKET_ERROR) {
+		MTY_Log("'WSAPoll' failed with error 0x%X", WSAGetLastError());
+		return 0;
+	}
+
+	uint32_t n = 0;
+
+	for (uint32_t x = 0; x < ctx->num && n < max;) {
+		if (ctx->fds[x].revents != 0) {
+			ready[n++] = ctx->opaques[x];
+			mty_fiberpoll_drop(ctx, x);
+
+		} else {
+			x++;
+		}
+	}
+
+	return n;
+}
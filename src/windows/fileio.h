@@ -0,0 +1,126 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <windows.h>
+
+
+// Files
+
+static intptr_t mty_fileio_open(const char *path, bool write)
+{
+	wchar_t *wpath = MTY_MultiToWideD(path);
+
+	HANDLE f = CreateFile(wpath, write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, write ? OPEN_ALWAYS : OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+
+	MTY_Free(wpath);
+
+	if (f == INVALID_HANDLE_VALUE) {
+		MTY_Log("'CreateFile' failed with error 0x%X", GetLastError());
+		return -1;
+	}
+
+	return (intptr_t) f;
+}
+
+static void mty_fileio_close(intptr_t fd)
+{
+	CloseHandle((HANDLE) fd);
+}
+
+// The OVERLAPPED offset is honored by synchronous handles, making these equivalent to pread/pwrite
+
+static int64_t mty_fileio_read(intptr_t fd, void *buf, size_t size, uint64_t offset)
+{
+	size_t total = 0;
+
+	while (total < size) {
+		OVERLAPPED ov = {0};
+		ov.Offset = (DWORD) (offset + total);
+		ov.OffsetHigh = (DWORD) ((offset + total) >> 32);
+
+		DWORD n = 0;
+		if (!ReadFile((HANDLE) fd, (uint8_t *) buf + total, (DWORD) (size - total), &n, &ov)) {
+			DWORD e = GetLastError();
+			if (e == ERROR_HANDLE_EOF)
+				break;
+
+			MTY_Log("'ReadFile' failed with error 0x%X", e);
+			return -1;
+		}
+
+		if (n == 0)
+			break;
+
+		total += n;
+	}
+
+	return total;
+}
+
+static int64_t mty_fileio_write(intptr_t fd, const void *buf, size_t size, uint64_t offset)
+{
+	size_t total = 0;
+
+	while (total < size) {
+		OVERLAPPED ov = {0};
+		ov.Offset = (DWORD) (offset + total);
+		ov.OffsetHigh = (DWORD) ((offset + total) >> 32);
+
+		DWORD n = 0;
+		if (!WriteFile((HANDLE) fd, (const uint8_t *) buf + total, (DWORD) (size - total), &n, &ov)) {
+			MTY_Log("'WriteFile' failed with error 0x%X", GetLastError());
+			return -1;
+		}
+
+		total += n;
+	}
+
+	return total;
+}
+
+
+// No io_uring, requests are serviced by threads
+
+struct fileio_ring;
+
+static struct fileio_ring *mty_fileio_ring_create(uint32_t depth)
+{
+	return NULL;
+}
+
+static void mty_fileio_ring_destroy(struct fileio_ring **ring)
+{
+}
+
+static uint32_t mty_fileio_ring_entries(struct fileio_ring *ctx)
+{
+	return 0;
+}
+
+static bool mty_fileio_ring_register(struct fileio_ring *ctx, void **buffers, const size_t *sizes, uint32_t count)
+{
+	return false;
+}
+
+static void mty_fileio_ring_push(struct fileio_ring *ctx, intptr_t fd, bool write, void *buf,
+	size_t size, uint64_t offset, int32_t buf_index, void *opaque)
+{
+}
+
+static uint32_t mty_fileio_ring_submit(struct fileio_ring *ctx)
+{
+	return 0;
+}
+
+static uint32_t mty_fileio_ring_wait(struct fileio_ring *ctx, int32_t timeout, MTY_FileIOResult *results,
+	uint32_t max)
+{
+	return 0;
+}
@@ -63,14 +63,34 @@ bool MTY_Mkdir(const char *path)
 	return true;
 }
 
-bool MTY_CopyFile(const char *src, const char *dst)
+struct file_copy {
+	MTY_CopyProgressFunc func;
+	void *opaque;
+};
+
+static DWORD CALLBACK file_copy_progress(LARGE_INTEGER total, LARGE_INTEGER transferred,
+	LARGE_INTEGER stream_size, LARGE_INTEGER stream_transferred, DWORD stream, DWORD reason,
+	HANDLE src, HANDLE dst, LPVOID data)
+{
+	struct file_copy *ctx = data;
+
+	return ctx->func(transferred.QuadPart, total.QuadPart, ctx->opaque) ? PROGRESS_CONTINUE : PROGRESS_CANCEL;
+}
+
+bool MTY_CopyFileEx(const char *src, const char *dst, MTY_CopyProgressFunc func, void *opaque)
 {
 	bool r = true;
 	wchar_t *srcw = MTY_MultiToWideD(src);
 	wchar_t *dstw = MTY_MultiToWideD(dst);
 
-	if (!CopyFile(srcw, dstw, FALSE)) {
-		MTY_Log("'CopyFile' failed with error 0x%X", GetLastError());
+	struct file_copy ctx = {0};
+	ctx.func = func;
+	ctx.opaque = opaque;
+
+	// CopyFileEx offloads to the storage stack (ODX, block cloning) on its own and
+	// deletes the destination when a copy is canceled
+	if (!CopyFileEx(srcw, dstw, func ? file_copy_progress : NULL, &ctx, NULL, 0)) {
+		MTY_Log("'CopyFileEx' failed with error 0x%X", GetLastError());
 		r = false;
 	}
 
@@ -80,6 +100,11 @@ bool MTY_CopyFile(const char *src, const char *dst)
 	return r;
 }
 
+bool MTY_CopyFile(const char *src, const char *dst)
+{
+	return MTY_CopyFileEx(src, dst, NULL, NULL);
+}
+
 bool MTY_MoveFile(const char *src, const char *dst)
 {
 	bool r = true;
@@ -194,6 +219,98 @@ void MTY_LockFileDestroy(MTY_LockFile **lock)
 	*lock = NULL;
 }
 
+static void file_map_advise(MTY_FileView *view, MTY_MapHint hints)
+{
+	if (hints & MTY_MAP_HINT_WILLNEED) {
+		WIN32_MEMORY_RANGE_ENTRY range = {0};
+		range.VirtualAddress = view->data;
+		range.NumberOfBytes = view->size;
+
+		if (!PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0))
+			MTY_Log("'PrefetchVirtualMemory' failed with error 0x%X", GetLastError());
+	}
+}
+
+MTY_FileView *MTY_MapFile(const char *path, MTY_MapMode mode, MTY_MapHint hints)
+{
+	bool write = mode == MTY_MAP_MODE_WRITE;
+	MTY_FileView *view = NULL;
+	HANDLE mapping = NULL;
+
+	// Read-ahead hints are given to the cache manager, which also serves mapped views.
+	// Large pages are only available for pagefile backed sections, not files.
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+
+	if (hints & MTY_MAP_HINT_SEQUENTIAL) {
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+
+	} else if (hints & MTY_MAP_HINT_RANDOM) {
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+	}
+
+	wchar_t *pathw = MTY_MultiToWideD(path);
+	HANDLE f = CreateFile(pathw, write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, flags, NULL);
+	MTY_Free(pathw);
+
+	if (f == INVALID_HANDLE_VALUE) {
+		MTY_Log("'CreateFile' failed with error 0x%X", GetLastError());
+		return NULL;
+	}
+
+	LARGE_INTEGER size = {0};
+	if (!GetFileSizeEx(f, &size)) {
+		MTY_Log("'GetFileSizeEx' failed with error 0x%X", GetLastError());
+		goto except;
+	}
+
+	// A zero length mapping is an error, so empty files are treated like MTY_ReadFile does
+	if (size.QuadPart <= 0)
+		goto except;
+
+	mapping = CreateFileMapping(f, NULL, write ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		MTY_Log("'CreateFileMapping' failed with error 0x%X", GetLastError());
+		goto except;
+	}
+
+	// The view holds its own references to the mapping and file, the handles can be closed
+	void *data = MapViewOfFile(mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		MTY_Log("'MapViewOfFile' failed with error 0x%X", GetLastError());
+		goto except;
+	}
+
+	view = MTY_Alloc(1, sizeof(MTY_FileView));
+	view->data = data;
+	view->size = (size_t) size.QuadPart;
+
+	file_map_advise(view, hints);
+
+	except:
+
+	if (mapping)
+		CloseHandle(mapping);
+
+	CloseHandle(f);
+
+	return view;
+}
+
+void MTY_UnmapFile(MTY_FileView **view)
+{
+	if (!view || !*view)
+		return;
+
+	MTY_FileView *ctx = *view;
+
+	if (!UnmapViewOfFile(ctx->data))
+		MTY_Log("'UnmapViewOfFile' failed with error 0x%X", GetLastError());
+
+	MTY_Free(ctx);
+	*view = NULL;
+}
+
 static int32_t file_compare(const void *p1, const void *p2)
 {
 	MTY_FileDesc *fi1 = (MTY_FileDesc *) p1;
@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <io.h>
 
 #include <sys/stat.h>
 
@@ -51,3 +52,28 @@ static size_t fsutil_size(const char *path)
 
 	return (size_t) st.st_size;
 }
+
+static bool fsutil_sync(FILE *f)
+{
+	if (fflush(f) != 0) {
+		MTY_Log("'fflush' failed with errno %d", errno);
+		return false;
+	}
+
+	if (_commit(_fileno(f)) != 0) {
+		MTY_Log("'_commit' failed with errno %d", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static void fsutil_copy_mode(FILE *f, const char *path)
+{
+	// The temporary file inherits the directory's ACL like the file it replaces
+}
+
+static void fsutil_sync_dir(const char *path)
+{
+	// MoveFileEx with MOVEFILE_WRITE_THROUGH doesn't return until the rename is on disk
+}
@@ -0,0 +1,46 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+// File watching is not yet implemented on this platform
+
+typedef void (*FSWATCH_FUNC)(const char *path, MTY_FileChange change, bool dir, void *opaque);
+
+struct fswatch;
+
+static struct fswatch *mty_fswatch_create(void)
+{
+	MTY_Log("File watching is not supported on this platform");
+
+	return NULL;
+}
+
+static void mty_fswatch_destroy(struct fswatch **fswatch)
+{
+}
+
+static bool mty_fswatch_add(struct fswatch *ctx, const char *path, bool recursive)
+{
+	return false;
+}
+
+static void mty_fswatch_remove(struct fswatch *ctx, const char *path)
+{
+}
+
+static intptr_t mty_fswatch_handle(struct fswatch *ctx)
+{
+	return -1;
+}
+
+static void mty_fswatch_wait(struct fswatch *ctx, int32_t timeout)
+{
+}
+
+static void mty_fswatch_read(struct fswatch *ctx, FSWATCH_FUNC func, void *opaque)
+{
+}
@@ -41,6 +41,8 @@ bool MTY_HttpRequest(const char *_host, bool secure, const char *_method, const
 	const char *_headers, const void *body, size_t bodySize, uint32_t timeout,
 	void **response, size_t *responseSize, uint16_t *status)
 {
+	MTY_TraceBegin("MTY_HttpRequest");
+
 	*responseSize = 0;
 	*response = NULL;
 
@@ -193,5 +195,7 @@ bool MTY_HttpRequest(const char *_host, bool secure, const char *_method, const
 		*response = NULL;
 	}
 
+	MTY_TraceEnd("MTY_HttpRequest");
+
 	return r;
 }
@@ -0,0 +1,67 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <windows.h>
+
+static size_t mty_ringmap_granularity(void)
+{
+	SYSTEM_INFO si = {0};
+	GetSystemInfo(&si);
+
+	// Views must be placed on allocation granularity boundaries
+	return si.dwAllocationGranularity;
+}
+
+static void *mty_ringmap_create(size_t size)
+{
+	HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		(DWORD) ((uint64_t) size >> 32), (DWORD) size, NULL);
+
+	if (!mapping) {
+		MTY_Log("'CreateFileMapping' failed with error 0x%X", GetLastError());
+		return NULL;
+	}
+
+	uint8_t *base = NULL;
+
+	// Another thread can claim the address range between it being released and
+	// mapped, so a few attempts are made
+	for (uint8_t x = 0; x < 8 && !base; x++) {
+		uint8_t *addr = VirtualAlloc(NULL, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+		if (!addr) {
+			MTY_Log("'VirtualAlloc' failed with error 0x%X", GetLastError());
+			break;
+		}
+
+		VirtualFree(addr, 0, MEM_RELEASE);
+
+		uint8_t *lo = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, addr);
+		uint8_t *hi = lo ? MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, addr + size) : NULL;
+
+		if (hi) {
+			base = lo;
+
+		} else if (lo) {
+			UnmapViewOfFile(lo);
+		}
+	}
+
+	if (!base)
+		MTY_Log("Failed to map mirrored views");
+
+	// The views keep the mapping alive
+	CloseHandle(mapping);
+
+	return base;
+}
+
+static void mty_ringmap_destroy(void *base, size_t size)
+{
+	UnmapViewOfFile(base);
+	UnmapViewOfFile((uint8_t *) base + size);
+}
@@ -66,6 +66,14 @@ const char *MTY_GetHostname(void)
 	return mty_tlocal_strcpyw(tmp);
 }
 
+uint32_t MTY_GetNumProcessors(void)
+{
+	SYSTEM_INFO si = {0};
+	GetSystemInfo(&si);
+
+	return si.dwNumberOfProcessors > 0 ? si.dwNumberOfProcessors : 1;
+}
+
 void MTY_HandleProtocol(const char *uri, void *token)
 {
 	VOID *env = NULL;
@@ -10,6 +10,8 @@
 
 #include <windows.h>
 
+#include "trace.h"
+
 
 // Thread
 
@@ -19,28 +21,53 @@ struct MTY_Thread {
 	MTY_ThreadFunc func;
 	void *opaque;
 	void *ret;
+
+	char *name;
+	uint64_t affinity;
+	MTY_ThreadPriority priority;
 };
 
 static DWORD WINAPI thread_func(LPVOID *lpParameter)
 {
 	MTY_Thread *ctx = (MTY_Thread *) lpParameter;
 
+	if (ctx->name)
+		MTY_ThreadSetName(ctx->name);
+
+	if (ctx->affinity != 0)
+		MTY_ThreadSetAffinity(ctx->affinity);
+
+	if (ctx->priority != MTY_THREAD_PRIORITY_NORMAL)
+		MTY_ThreadSetPriority(ctx->priority);
+
 	ctx->ret = ctx->func(ctx->opaque);
 
+	mty_trace_thread_exit();
+
 	if (ctx->detach)
 		MTY_Free(ctx);
 
 	return 0;
 }
 
-static MTY_Thread *thread_create(MTY_ThreadFunc func, void *opaque, bool detach)
+static MTY_Thread *thread_create(MTY_ThreadFunc func, void *opaque, bool detach, const MTY_ThreadDesc *desc)
 {
 	MTY_Thread *ctx = MTY_Alloc(1, sizeof(MTY_Thread));
 	ctx->func = func;
 	ctx->opaque = opaque;
 	ctx->detach = detach;
 
-	ctx->thread = CreateThread(NULL, 0, thread_func, ctx, 0, NULL);
+	SIZE_T stack_size = 0;
+
+	if (desc) {
+		ctx->name = desc->name ? MTY_Strdup(desc->name) : NULL;
+		ctx->affinity = desc->affinity;
+		ctx->priority = desc->priority;
+		stack_size = desc->stackSize;
+	}
+
+	ctx->thread = CreateThread(NULL, stack_size, thread_func, ctx,
+		stack_size > 0 ? STACK_SIZE_PARAM_IS_A_RESERVATION : 0, NULL);
 
 	if (!ctx->thread)
 		MTY_LogFatal("'CreateThread' failed with error 0x%X", GetLastError());
@@ -58,12 +85,67 @@ static MTY_Thread *thread_create(MTY_ThreadFunc func, void *opaque, bool detach)
 
 MTY_Thread *MTY_ThreadCreate(MTY_ThreadFunc func, void *opaque)
 {
-	return thread_create(func, opaque, false);
+	return thread_create(func, opaque, false, NULL);
+}
+
+MTY_Thread *MTY_ThreadCreateEx(MTY_ThreadFunc func, void *opaque, const MTY_ThreadDesc *desc)
+{
+	return thread_create(func, opaque, false, desc);
 }
 
 void MTY_ThreadDetach(MTY_ThreadFunc func, void *opaque)
 {
-	thread_create(func, opaque, true);
+	thread_create(func, opaque, true, NULL);
+}
+
+bool MTY_ThreadSetName(const char *name)
+{
+	// SetThreadDescription is only available on Windows 10 1607+
+	HRESULT (WINAPI *_SetThreadDescription)(HANDLE hThread, PCWSTR lpThreadDescription) =
+		(void *) GetProcAddress(GetModuleHandle(L"kernel32.dll"), "SetThreadDescription");
+
+	if (!_SetThreadDescription)
+		return false;
+
+	wchar_t wname[64];
+	if (!MTY_MultiToWide(name, wname, 64))
+		return false;
+
+	HRESULT e = _SetThreadDescription(GetCurrentThread(), wname);
+	if (e != S_OK) {
+		MTY_Log("'SetThreadDescription' failed with HRESULT 0x%X", e);
+		return false;
+	}
+
+	return true;
+}
+
+bool MTY_ThreadSetAffinity(uint64_t affinity)
+{
+	if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) affinity) == 0) {
+		MTY_Log("'SetThreadAffinityMask' failed with error 0x%X", GetLastError());
+		return false;
+	}
+
+	return true;
+}
+
+bool MTY_ThreadSetPriority(MTY_ThreadPriority priority)
+{
+	int32_t level = THREAD_PRIORITY_NORMAL;
+
+	switch (priority) {
+		case MTY_THREAD_PRIORITY_LOW:      level = THREAD_PRIORITY_BELOW_NORMAL;  break;
+		case MTY_THREAD_PRIORITY_HIGH:     level = THREAD_PRIORITY_HIGHEST;       break;
+		case MTY_THREAD_PRIORITY_REALTIME: level = THREAD_PRIORITY_TIME_CRITICAL; break;
+	}
+
+	if (!SetThreadPriority(GetCurrentThread(), level)) {
+		MTY_Log("'SetThreadPriority' failed with error 0x%X", GetLastError());
+		return false;
+	}
+
+	return true;
 }
 
 int64_t MTY_ThreadIDGet(MTY_Thread *ctx)
@@ -88,6 +170,7 @@ void *MTY_ThreadDestroy(MTY_Thread **thread)
 
 	void *ret = ctx->ret;
 
+	MTY_Free(ctx->name);
 	MTY_Free(ctx);
 	*thread = NULL;
 
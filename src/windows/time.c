@@ -11,8 +11,16 @@
 
 #include "tlocal.h"
 
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+	#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+#define TIME_SPIN_MIN_NS (50 * 1000)
+#define TIME_SPIN_MAX_NS (2 * 1000 * 1000)
+
 static TLOCAL bool TIME_FREQ_INIT;
 static TLOCAL float TIME_FREQUENCY;
+static TLOCAL int64_t TIME_OVERSLEEP;
 
 MTY_Time MTY_GetTime(void)
 {
@@ -34,19 +42,41 @@ float MTY_TimeDiff(MTY_Time begin, MTY_Time end)
 	return (float) (end - begin) / TIME_FREQUENCY;
 }
 
-void MTY_Sleep(uint32_t timeout)
+int64_t MTY_GetTimeNs(void)
+{
+	static int64_t frequency;
+
+	if (frequency == 0) {
+		LARGE_INTEGER f;
+		QueryPerformanceFrequency(&f);
+		frequency = f.QuadPart;
+	}
+
+	LARGE_INTEGER ts;
+	QueryPerformanceCounter(&ts);
+
+	// Split so the multiplication can't overflow for long running processes
+	return ts.QuadPart / frequency * 1000000000 + ts.QuadPart % frequency * 1000000000 / frequency;
+}
+
+static void time_wait(int64_t ns)
 {
 	// There is evidence that CreateWaitableTimer will produce higher resolution
-	// waiting over Sleep
+	// waiting over Sleep, the high resolution flag is only known to Windows 10 1803+
+
+	HANDLE timer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_MANUAL_RESET |
+		CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+	if (!timer)
+		timer = CreateWaitableTimer(NULL, TRUE, NULL);
 
-	HANDLE timer = CreateWaitableTimer(NULL, TRUE, NULL);
 	if (!timer) {
 		MTY_Log("'CreateWaitableTimer' faled with error 0x%X", GetLastError());
 		return;
 	}
 
 	LARGE_INTEGER ft;
-	ft.QuadPart = -10000 * (int32_t) timeout;
+	ft.QuadPart = -(ns / 100);
 
 	if (SetWaitableTimer(timer, &ft, 0, NULL, NULL, FALSE)) {
 		DWORD e = WaitForSingleObject(timer, INFINITE);
@@ -61,6 +91,34 @@ void MTY_Sleep(uint32_t timeout)
 		MTY_Log("'CloseHandle' failed with error 0x%X", GetLastError());
 }
 
+void MTY_Sleep(uint32_t timeout)
+{
+	time_wait((int64_t) timeout * 1000 * 1000);
+}
+
+void MTY_SleepUntil(int64_t deadline)
+{
+	// Keep a margin of twice the average oversleep seen on this thread for spinning
+	int64_t margin = MTY_MIN(MTY_MAX(TIME_OVERSLEEP * 2, TIME_SPIN_MIN_NS), TIME_SPIN_MAX_NS);
+	int64_t now = MTY_GetTimeNs();
+
+	if (deadline - now > margin) {
+		int64_t request = deadline - now - margin;
+		time_wait(request);
+
+		int64_t after = MTY_GetTimeNs();
+		int64_t over = MTY_MAX(after - now - request, 0);
+		TIME_OVERSLEEP += (over - TIME_OVERSLEEP) / 8;
+
+		now = after;
+	}
+
+	while (now < deadline) {
+		YieldProcessor();
+		now = MTY_GetTimeNs();
+	}
+}
+
 void MTY_SetTimerResolution(uint32_t res)
 {
 	MMRESULT e = timeBeginPeriod(res);
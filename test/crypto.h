@@ -0,0 +1,34 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+static bool crypto_main(void)
+{
+	uint8_t a[1000] = {0};
+	uint8_t b[1000] = {0};
+
+	MTY_GetRandomBytes(a, sizeof(a));
+	MTY_GetRandomBytes(b, sizeof(b));
+	test_cmp("MTY_GetRandomBytes", memcmp(a, b, sizeof(a)));
+
+	uint32_t hist[4] = {0};
+	bool in_range = true;
+
+	for (uint32_t x = 0; x < 4000; x++) {
+		uint32_t v = MTY_GetRandomUInt(10, 13);
+
+		if (v < 10 || v > 13) {
+			in_range = false;
+			break;
+		}
+
+		hist[v - 10]++;
+	}
+
+	test_cmp("MTY_GetRandomUInt", in_range);
+	test_cmp("MTY_GetRandomUInt", hist[0] && hist[1] && hist[2] && hist[3]);
+
+	return true;
+}
@@ -5,6 +5,98 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #define TEST_FILE MTY_JoinPath(".", "test.file")
+#define TEST_COPY MTY_JoinPath(".", "test.copy")
+#define TEST_DIR  MTY_JoinPath(".", "test.dir")
+#define TEST_MANY 600
+#define TEST_WATCH MTY_JoinPath(".", "test.watch")
+#define TEST_WATCH_CFG MTY_JoinPath(".", "test.watch.cfg")
+
+struct file_watch_events {
+	uint32_t count;
+	char path[8][MTY_PATH_MAX];
+	MTY_FileChange changes[8];
+	bool dir[8];
+};
+
+static bool file_copy_progress(uint64_t copied, uint64_t total, void *opaque)
+{
+	uint64_t *progress = opaque;
+
+	// Progress never goes backwards
+	if (copied < progress[0])
+		return false;
+
+	progress[0] = copied;
+	progress[1] = total;
+
+	return true;
+}
+
+static bool file_copy_cancel(uint64_t copied, uint64_t total, void *opaque)
+{
+	return false;
+}
+
+static void file_io_poll(const MTY_FileIOResult *result, void *opaque)
+{
+	int64_t *sizes = opaque;
+
+	sizes[(uintptr_t) result->opaque] = result->result;
+}
+
+static uint32_t file_dir_count(const char *filter, MTY_DirFlag flags, uint32_t *dirs, uint32_t *depth)
+{
+	MTY_DirIter *iter = MTY_DirIterCreate(TEST_DIR, filter, flags);
+	if (!iter)
+		return 0;
+
+	uint32_t count = 0;
+	*dirs = *depth = 0;
+
+	for (const MTY_DirEntry *e = MTY_DirIterNext(iter); e; e = MTY_DirIterNext(iter)) {
+		if (e->type == MTY_FILE_TYPE_DIR)
+			(*dirs)++;
+
+		if (e->depth > *depth)
+			*depth = e->depth;
+
+		if (strncmp(e->path, TEST_DIR, strlen(TEST_DIR)) || strcmp(MTY_GetFileName(e->path, true), e->name))
+			return 0;
+
+		count++;
+	}
+
+	MTY_DirIterDestroy(&iter);
+
+	return count;
+}
+
+static void file_watch_event(const MTY_FileWatchEvent *evt, void *opaque)
+{
+	struct file_watch_events *events = opaque;
+
+	if (events->count < 8) {
+		snprintf(events->path[events->count], MTY_PATH_MAX, "%s", evt->path);
+		events->changes[events->count] = evt->changes;
+		events->dir[events->count] = evt->dir;
+	}
+
+	events->count++;
+}
+
+static struct file_watch_events *file_watch_poll(MTY_FileWatch *watch, uint32_t expected)
+{
+	static struct file_watch_events events;
+	memset(&events, 0, sizeof(struct file_watch_events));
+
+	for (uint32_t x = 0; x < 20 && events.count < expected; x++)
+		MTY_FileWatchPoll(watch, 100, file_watch_event, &events);
+
+	// Anything extra would arrive shortly after
+	MTY_FileWatchPoll(watch, 150, file_watch_event, &events);
+
+	return &events;
+}
 
 static bool file_main(void)
 {
@@ -22,6 +114,320 @@ static bool file_main(void)
 	test_cmp("MTY_ReadFile", !strcmp(rdata, data));
 	MTY_Free(rdata);
 
+	MTY_FileView *view = MTY_MapFile(TEST_FILE, MTY_MAP_MODE_READ, MTY_MAP_HINT_SEQUENTIAL | MTY_MAP_HINT_WILLNEED);
+	test_cmp("MTY_MapFile", view && view->size == strlen(data));
+	test_cmp("MTY_MapFile", !memcmp(view->data, data, view->size));
+	MTY_UnmapFile(&view);
+	test_cmp("MTY_UnmapFile", view == NULL);
+
+	// Writes through a shared mapping land in the file
+	view = MTY_MapFile(TEST_FILE, MTY_MAP_MODE_WRITE, MTY_MAP_HINT_RANDOM | MTY_MAP_HINT_HUGE_PAGES);
+	test_cmp("MTY_MapFile", view != NULL);
+	memcpy(view->data, "THIS", 4);
+	MTY_UnmapFile(&view);
+
+	rdata = MTY_ReadFile(TEST_FILE, NULL);
+	test_cmp("MTY_MapFile", rdata && !strcmp(rdata, "THIS is arbitrary data."));
+	MTY_Free(rdata);
+
+	r = MTY_WriteFile(TEST_FILE, "{\"key\": 7} ", 11);
+	MTY_JSON *json = MTY_JSONReadFile(TEST_FILE);
+
+	int32_t val = 0;
+	r = r && MTY_JSONObjGetInt(json, "key", &val);
+	test_cmp("MTY_JSONReadFile", r && val == 7);
+	MTY_JSONDestroy(&json);
+
+	r = MTY_WriteFile(TEST_FILE, NULL, 0);
+	view = MTY_MapFile(TEST_FILE, MTY_MAP_MODE_READ, MTY_MAP_HINT_NONE);
+	test_cmp("MTY_MapFile", r && view == NULL);
+
+	// Larger than the buffer used when the kernel can't copy on its own
+	size_t big_size = 8 * 1024 * 1024;
+	uint8_t *big = MTY_Alloc(big_size, 1);
+
+	for (size_t x = 0; x < 1024 * 1024; x++) {
+		big[x] = (uint8_t) x;
+		big[big_size - x - 1] = (uint8_t) (x * 7);
+	}
+
+	r = MTY_WriteFile(TEST_FILE, big, big_size);
+
+	uint64_t progress[2] = {0};
+	r = r && MTY_CopyFileEx(TEST_FILE, TEST_COPY, file_copy_progress, progress);
+	test_cmp("MTY_CopyFileEx", r && progress[0] == big_size && progress[1] == big_size);
+
+	rdata = MTY_ReadFile(TEST_COPY, &size);
+	test_cmp("MTY_CopyFileEx", rdata && size == big_size && !memcmp(rdata, big, big_size));
+	MTY_Free(rdata);
+
+	// Canceling removes the partial copy
+	progress[1] = 0;
+	r = MTY_DeleteFile(TEST_COPY) && !MTY_CopyFileEx(TEST_FILE, TEST_COPY, file_copy_cancel, progress);
+	test_cmp("MTY_CopyFileEx", r && !MTY_FileExists(TEST_COPY));
+
+	// Copying a file onto itself leaves it intact
+	r = MTY_CopyFile(TEST_FILE, TEST_FILE);
+	rdata = MTY_ReadFile(TEST_FILE, &size);
+	test_cmp("MTY_CopyFile", r && rdata && size == big_size && !memcmp(rdata, big, big_size));
+	MTY_Free(rdata);
+	MTY_Free(big);
+
+	r = MTY_WriteFile(TEST_FILE, NULL, 0) && MTY_CopyFile(TEST_FILE, TEST_COPY);
+	test_cmp("MTY_CopyFile", r && MTY_FileExists(TEST_COPY));
+
+	r = MTY_DeleteFile(TEST_COPY);
+	test_cmp("MTY_DeleteFile", r);
+
+	// Batched reads and writes
+	MTY_FileIO *fio = MTY_FileIOCreate(8);
+	uint32_t file = fio ? MTY_FileIOOpen(fio, TEST_COPY, true) : 0;
+	test_cmp("MTY_FileIOOpen", file > 0);
+
+	uint8_t *chunks = MTY_Alloc(8, 4096);
+
+	for (uint32_t x = 0; x < 8 * 4096; x++)
+		chunks[x] = (uint8_t) (x * 13);
+
+	for (uint32_t x = 0; x < 8; x++) {
+		r = MTY_FileIOWrite(fio, file, chunks + x * 4096, 4096, x * 4096, (void *) (uintptr_t) x);
+		test_cmp("MTY_FileIOWrite", r);
+	}
+
+	r = MTY_FileIOWrite(fio, file, chunks, 4096, 0, NULL);
+	test_cmp("MTY_FileIOWrite", !r);
+
+	MTY_FileIOResult results[8] = {0};
+	uint32_t completed = 0;
+	bool ok = true;
+
+	for (uint32_t n = 1; n > 0; completed += n) {
+		n = MTY_FileIOWait(fio, -1, results, 8);
+
+		for (uint32_t x = 0; x < n; x++)
+			ok = ok && results[x].result == 4096;
+	}
+
+	test_cmp("MTY_FileIOWait", ok && completed == 8);
+
+	// Read back in reverse into a registered buffer
+	uint8_t *rbuf = MTY_Alloc(8, 4096);
+	void *rbufs[1] = {rbuf};
+	size_t rsizes[1] = {8 * 4096};
+
+	r = MTY_FileIORegisterBuffers(fio, rbufs, rsizes, 1);
+	test_cmp("MTY_FileIORegisterBuffers", r);
+
+	for (uint32_t x = 0; x < 8; x++) {
+		uint32_t i = 7 - x;
+
+		r = MTY_FileIORead(fio, file, rbuf + i * 4096, 4096, i * 4096, (void *) (uintptr_t) i);
+		test_cmp("MTY_FileIORead", r);
+	}
+
+	uint32_t submitted = MTY_FileIOSubmit(fio);
+	test_cmp("MTY_FileIOSubmit", submitted == 8);
+
+	int64_t rresults[8] = {0};
+
+	for (completed = 0; completed < 8;)
+		completed += MTY_FileIOPoll(fio, 1000, file_io_poll, rresults);
+
+	ok = !memcmp(rbuf, chunks, 8 * 4096);
+
+	for (uint32_t x = 0; x < 8; x++)
+		ok = ok && rresults[x] == 4096;
+
+	test_cmp("MTY_FileIOPoll", ok);
+
+	// Reads past the end come back short
+	r = MTY_FileIORead(fio, file, rbuf, 4096, 7 * 4096 + 100, NULL);
+	completed = MTY_FileIOWait(fio, 1000, results, 8);
+	test_cmp("MTY_FileIORead", r && completed == 1 && results[0].result == 4096 - 100);
+
+	completed = MTY_FileIOWait(fio, 0, results, 8);
+	test_cmp("MTY_FileIOWait", completed == 0);
+
+	MTY_FileIOClose(fio, file);
+	r = MTY_FileIORead(fio, file, rbuf, 4096, 0, NULL);
+	test_cmp("MTY_FileIOClose", !r);
+
+	MTY_FileIODestroy(&fio);
+	test_cmp("MTY_FileIODestroy", fio == NULL);
+
+	MTY_Free(rbuf);
+	MTY_Free(chunks);
+
+	r = MTY_DeleteFile(TEST_COPY);
+	test_cmp("MTY_DeleteFile", r);
+
+	// Buffered writer
+	MTY_FileWriterDesc wdesc = {0};
+	wdesc.bufferSize = 64;
+	wdesc.syncPolicy = MTY_SYNC_POLICY_BYTES;
+	wdesc.syncBytes = 1000;
+	wdesc.truncate = true;
+
+	MTY_FileWriter *writer = MTY_FileWriterCreate(TEST_COPY, &wdesc);
+	r = writer != NULL;
+	test_cmp("MTY_FileWriterCreate", r);
+
+	for (uint32_t x = 0; x < 1000 && r; x++)
+		r = MTY_FileWriterPrintf(writer, "line %04u\n", x);
+
+	char longstr[200] = {0};
+	memset(longstr, 'z', 199);
+
+	r = r && MTY_FileWriterWrite(writer, "raw", 3);
+	r = r && MTY_FileWriterPrintf(writer, "%s", longstr);
+	test_cmp("MTY_FileWriterPrintf", r);
+
+	MTY_FileWriterDestroy(&writer);
+	test_cmp("MTY_FileWriterDestroy", writer == NULL);
+
+	rdata = MTY_ReadFile(TEST_COPY, &size);
+	ok = rdata && size == 10000 + 3 + 199 && !memcmp(rdata + 5000, "line 0500\n", 10) &&
+		!memcmp(rdata + 10000, "rawz", 4) && rdata[size - 1] == 'z';
+	test_cmp("MTY_FileWriterWrite", ok);
+	MTY_Free(rdata);
+
+	writer = MTY_FileWriterCreate(TEST_COPY, NULL);
+	r = writer && MTY_FileWriterWrite(writer, "!", 1) && MTY_FileWriterFlush(writer);
+	rdata = MTY_ReadFile(TEST_COPY, &size);
+	test_cmp("MTY_FileWriterFlush", r && rdata && size == 10203 && rdata[10202] == '!');
+	MTY_Free(rdata);
+
+	r = MTY_FileWriterSync(writer);
+	test_cmp("MTY_FileWriterSync", r);
+	MTY_FileWriterDestroy(&writer);
+
+	r = MTY_WriteFileAtomic(TEST_COPY, "atomic", 6);
+	rdata = MTY_ReadFile(TEST_COPY, &size);
+	test_cmp("MTY_WriteFileAtomic", r && rdata && size == 6 && !memcmp(rdata, "atomic", 6));
+	MTY_Free(rdata);
+
+	r = MTY_DeleteFile(TEST_COPY);
+	test_cmp("MTY_DeleteFile", r);
+
+	// Directory iteration
+	char *sub = MTY_Strdup(MTY_JoinPath(TEST_DIR, "sub"));
+	char *deep = MTY_Strdup(MTY_JoinPath(sub, "deep"));
+
+	r = MTY_Mkdir(TEST_DIR) && MTY_Mkdir(sub) && MTY_Mkdir(deep);
+	r = r && MTY_WriteFile(MTY_JoinPath(TEST_DIR, "a.png"), "a", 1);
+	r = r && MTY_WriteFile(MTY_JoinPath(TEST_DIR, "b.txt"), "b", 1);
+	r = r && MTY_WriteFile(MTY_JoinPath(sub, "c.png"), "c", 1);
+	r = r && MTY_WriteFile(MTY_JoinPath(deep, "d.png.txt"), "d", 1);
+
+	char name[32];
+
+	for (uint32_t x = 0; x < TEST_MANY && r; x++) {
+		snprintf(name, 32, "many%u.bin", x);
+		r = MTY_WriteFile(MTY_JoinPath(deep, name), "x", 1);
+	}
+
+	test_cmp("MTY_Mkdir", r);
+
+	uint32_t dirs = 0;
+	uint32_t depth = 0;
+	uint32_t count = file_dir_count(NULL, MTY_DIR_FLAG_NONE, &dirs, &depth);
+	test_cmp("MTY_DirIterNext", count == 3 && dirs == 1 && depth == 0);
+
+	count = file_dir_count(NULL, MTY_DIR_FLAG_RECURSIVE, &dirs, &depth);
+	test_cmp("MTY_DirIterNext", count == 6 + TEST_MANY && dirs == 2 && depth == 2);
+
+	count = file_dir_count(NULL, MTY_DIR_FLAG_RECURSIVE | MTY_DIR_FLAG_PARALLEL, &dirs, &depth);
+	test_cmp("MTY_DirIterNext", count == 6 + TEST_MANY && dirs == 2 && depth == 2);
+
+	count = file_dir_count(".png", MTY_DIR_FLAG_RECURSIVE | MTY_DIR_FLAG_NO_DIRS, &dirs, &depth);
+	test_cmp("MTY_DirIterNext", count == 2 && dirs == 0);
+
+	count = file_dir_count("*.png*", MTY_DIR_FLAG_RECURSIVE | MTY_DIR_FLAG_NO_DIRS, &dirs, &depth);
+	test_cmp("MTY_DirIterNext", count == 3);
+
+	count = file_dir_count("many?.bin", MTY_DIR_FLAG_RECURSIVE | MTY_DIR_FLAG_PARALLEL | MTY_DIR_FLAG_NO_DIRS, &dirs, &depth);
+	test_cmp("MTY_DirIterNext", count == 10 && depth == 2);
+
+	// Abandoning a parallel walk part way through
+	MTY_DirIter *iter = MTY_DirIterCreate(TEST_DIR, NULL, MTY_DIR_FLAG_RECURSIVE | MTY_DIR_FLAG_PARALLEL);
+	const MTY_DirEntry *entry = MTY_DirIterNext(iter);
+	MTY_DirIterDestroy(&iter);
+	test_cmp("MTY_DirIterDestroy", entry && !iter);
+
+	iter = MTY_DirIterCreate(MTY_JoinPath(TEST_DIR, "missing"), NULL, MTY_DIR_FLAG_NONE);
+	test_cmp("MTY_DirIterCreate", !iter);
+
+	for (uint32_t x = 0; x < TEST_MANY; x++) {
+		snprintf(name, 32, "many%u.bin", x);
+		MTY_DeleteFile(MTY_JoinPath(deep, name));
+	}
+
+	r = MTY_DeleteFile(MTY_JoinPath(deep, "d.png.txt")) && MTY_DeleteFile(deep);
+	r = r && MTY_DeleteFile(MTY_JoinPath(sub, "c.png")) && MTY_DeleteFile(sub);
+	r = r && MTY_DeleteFile(MTY_JoinPath(TEST_DIR, "a.png")) && MTY_DeleteFile(MTY_JoinPath(TEST_DIR, "b.txt"));
+	r = r && MTY_DeleteFile(TEST_DIR);
+	test_cmp("MTY_DeleteFile", r);
+
+	MTY_Free(deep);
+	MTY_Free(sub);
+
+	// File watching
+	MTY_FileWatch *watch = MTY_FileWatchCreate(50);
+
+	if (watch) {
+		r = MTY_Mkdir(TEST_WATCH) && MTY_WriteFile(TEST_WATCH_CFG, "a", 1);
+		r = r && MTY_FileWatchAdd(watch, TEST_WATCH, true) && MTY_FileWatchAdd(watch, TEST_WATCH_CFG, false);
+		test_cmp("MTY_FileWatchAdd", r && MTY_FileWatchGetHandle(watch) >= 0);
+
+		// Repeated writes to one file are reported once
+		for (uint32_t x = 0; x < 5; x++)
+			MTY_AppendTextToFile(TEST_WATCH_CFG, "b");
+
+		struct file_watch_events *events = file_watch_poll(watch, 1);
+		test_cmp("MTY_FileWatchPoll", events->count == 1 && !strcmp(events->path[0], TEST_WATCH_CFG) &&
+			(events->changes[0] & MTY_FILE_CHANGE_MODIFIED));
+
+		// Other files next to a watched file are ignored, replacing it is reported
+		r = MTY_WriteFile(TEST_FILE, "c", 1) && MTY_WriteFileAtomic(TEST_WATCH_CFG, "d", 1);
+		events = file_watch_poll(watch, 1);
+		test_cmp("MTY_FileWatchPoll", r && events->count == 1 && (events->changes[0] & MTY_FILE_CHANGE_CREATED));
+
+		// New directories are watched as they appear
+		char *wsub = MTY_Strdup(MTY_JoinPath(TEST_WATCH, "sub"));
+		r = MTY_Mkdir(wsub);
+		events = file_watch_poll(watch, 1);
+		test_cmp("MTY_FileWatchPoll", r && events->count == 1 && events->dir[0] &&
+			!strcmp(events->path[0], wsub));
+
+		char *wfile = MTY_Strdup(MTY_JoinPath(wsub, "file"));
+		r = MTY_WriteFile(wfile, "e", 1);
+		events = file_watch_poll(watch, 1);
+		test_cmp("MTY_FileWatchPoll", r && events->count == 1 && !strcmp(events->path[0], wfile) &&
+			(events->changes[0] & MTY_FILE_CHANGE_CREATED) && !events->dir[0]);
+
+		r = MTY_DeleteFile(wfile);
+		events = file_watch_poll(watch, 1);
+		test_cmp("MTY_FileWatchPoll", r && events->count == 1 && events->changes[0] == MTY_FILE_CHANGE_DELETED);
+
+		// Nothing is reported once removed
+		MTY_FileWatchRemove(watch, TEST_WATCH);
+		MTY_FileWatchRemove(watch, TEST_WATCH_CFG);
+
+		r = MTY_WriteFile(TEST_WATCH_CFG, "f", 1) && MTY_WriteFile(wfile, "g", 1);
+		events = file_watch_poll(watch, 0);
+		test_cmp("MTY_FileWatchRemove", r && events->count == 0);
+
+		MTY_FileWatchDestroy(&watch);
+		test_cmp("MTY_FileWatchDestroy", watch == NULL);
+
+		r = MTY_DeleteFile(wfile) && MTY_DeleteFile(wsub) && MTY_DeleteFile(TEST_WATCH);
+		r = r && MTY_DeleteFile(TEST_WATCH_CFG);
+		test_cmp("MTY_DeleteFile", r);
+
+		MTY_Free(wfile);
+		MTY_Free(wsub);
+	}
+
 	r = MTY_DeleteFile(TEST_FILE);
 	test_cmp("MTY_DeleteFile", r);
 
@@ -0,0 +1,95 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+struct log_test {
+	uint32_t count;
+	char last[128];
+};
+
+static void log_test_func(const char *msg, void *opaque)
+{
+	struct log_test *lt = opaque;
+
+	lt->count++;
+	snprintf(lt->last, sizeof(lt->last), "%s", msg);
+}
+
+static bool log_main(void)
+{
+	MTY_Log("%d %s %5.2f %-4u| %lld %zu %c %x %%", -42, "str", 3.14159, 7u, (long long) -1, (size_t) 9, 'z', 255u);
+	const char *msg = MTY_GetLog();
+	test_cmp("MTY_GetLog", !strcmp(msg, "log_main: -42 str  3.14 7   | -1 9 z ff %"));
+
+	MTY_Log("%*d|%-*d|%.*s|%s", 4, 1, 4, 2, 3, "abcdef", (char *) NULL);
+	msg = MTY_GetLog();
+	test_cmp("MTY_GetLog", !strcmp(msg, "log_main:    1|2   |abc|(null)"));
+
+	// A precision means the string does not need to be terminated
+	char unterminated[4] = {'w', 'x', 'y', 'z'};
+	MTY_Log("%.*s|%.2s", 4, unterminated, unterminated);
+	msg = MTY_GetLog();
+	test_cmp("MTY_GetLog", !strcmp(msg, "log_main: wxyz|wx"));
+
+	char *big = MTY_Alloc(2000, 1);
+	memset(big, 'a', 1999);
+
+	MTY_Log("%s", big);
+	msg = MTY_GetLog();
+	size_t len = strlen(msg);
+	test_cmp("MTY_GetLog", len > 400 && len < 1024 && msg[len - 1] == 'a');
+
+	MTY_Free(big);
+
+	MTY_SetLogLevel(MTY_LOG_LEVEL_WARNING);
+	MTY_LogInfo("info");
+	msg = MTY_GetLog();
+	test_cmp("MTY_SetLogLevel", strcmp(msg, "log_main: info"));
+
+	MTY_LogWarning("warning");
+	msg = MTY_GetLog();
+	test_cmp("MTY_SetLogLevel", !strcmp(msg, "log_main: warning"));
+
+	MTY_SetLogLevel(MTY_LOG_LEVEL_INFO);
+
+	MTY_LogStats before = {0};
+	MTY_GetLogStats(&before);
+
+	struct log_test lt = {0};
+	MTY_SetLogFunc(log_test_func, &lt);
+
+	for (int32_t x = 0; x < 10; x++)
+		MTY_LogInfo("message %d", x);
+
+	MTY_FlushLog();
+	test_cmp("MTY_SetLogFunc", lt.count == 10 && !strcmp(lt.last, "log_main: message 9"));
+
+	MTY_SetLogRateLimit(5);
+
+	for (int32_t x = 0; x < 20; x++)
+		MTY_LogInfo("limited %d", x);
+
+	MTY_FlushLog();
+
+	MTY_LogStats after = {0};
+	MTY_GetLogStats(&after);
+
+	uint64_t suppressed = after.suppressed - before.suppressed;
+	test_cmpi64("MTY_SetLogRateLimit", suppressed >= 10 && lt.count + suppressed == 30, (int64_t) suppressed);
+	test_cmpi64("MTY_GetLogStats", after.dropped == 0, (int64_t) after.dropped);
+
+	MTY_SetLogRateLimit(100);
+
+	// Queued messages reach the previous function before it is replaced
+	uint32_t count = lt.count;
+
+	for (int32_t x = 0; x < 5; x++)
+		MTY_LogInfo("pending %d", x);
+
+	MTY_SetLogFunc(NULL, NULL);
+	test_cmp("MTY_SetLogFunc", lt.count == count + 5);
+
+	return true;
+}
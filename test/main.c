@@ -18,6 +18,13 @@
 #include "version.h"
 #include "time.h"
 #include "file.h"
+#include "crypto.h"
+#include "memory.h"
+#include "struct.h"
+#include "thread.h"
+#include "log.h"
+#include "trace.h"
+#include "metrics.h"
 
 int32_t main(int32_t argc, char **argv)
 {
@@ -30,5 +37,26 @@ int32_t main(int32_t argc, char **argv)
 	if (!file_main())
 		return 1;
 
+	if (!crypto_main())
+		return 1;
+
+	if (!memory_main())
+		return 1;
+
+	if (!struct_main())
+		return 1;
+
+	if (!thread_main())
+		return 1;
+
+	if (!log_main())
+		return 1;
+
+	if (!trace_main())
+		return 1;
+
+	if (!metrics_main())
+		return 1;
+
 	return 0;
 }
@@ -0,0 +1,101 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define MEMORY_SORT_LEN (100 * 1000)
+
+struct memory_sort {
+	int32_t key;
+	uint32_t order;
+};
+
+static int32_t memory_sort_compare(const void *a, const void *b)
+{
+	const struct memory_sort *sa = a;
+	const struct memory_sort *sb = b;
+
+	return sa->key < sb->key ? -1 : sa->key > sb->key ? 1 : 0;
+}
+
+static bool memory_sort_check(const struct memory_sort *s, size_t len)
+{
+	for (size_t x = 1; x < len; x++) {
+		if (s[x - 1].key > s[x].key)
+			return false;
+
+		// Equal keys must keep their original order
+		if (s[x - 1].key == s[x].key && s[x - 1].order > s[x].order)
+			return false;
+	}
+
+	return true;
+}
+
+static void memory_sort_fill(struct memory_sort *s, size_t len, bool runs)
+{
+	for (size_t x = 0; x < len; x++) {
+		s[x].key = runs && (x / 1000) % 2 ? (int32_t) (len - x) : (int32_t) MTY_GetRandomUInt(0, 1000) - 500;
+		s[x].order = (uint32_t) x;
+	}
+}
+
+static bool memory_main(void)
+{
+	struct memory_sort *s = MTY_Alloc(MEMORY_SORT_LEN, sizeof(struct memory_sort));
+
+	memory_sort_fill(s, MEMORY_SORT_LEN, false);
+	MTY_Sort(s, MEMORY_SORT_LEN, sizeof(struct memory_sort), memory_sort_compare);
+	test_cmp("MTY_Sort", memory_sort_check(s, MEMORY_SORT_LEN));
+
+	memory_sort_fill(s, MEMORY_SORT_LEN, true);
+	MTY_Sort(s, MEMORY_SORT_LEN, sizeof(struct memory_sort), memory_sort_compare);
+	test_cmp("MTY_Sort", memory_sort_check(s, MEMORY_SORT_LEN));
+
+	memory_sort_fill(s, MEMORY_SORT_LEN, false);
+	MTY_SortParallel(s, MEMORY_SORT_LEN, sizeof(struct memory_sort), memory_sort_compare, 4);
+	test_cmp("MTY_SortParallel", memory_sort_check(s, MEMORY_SORT_LEN));
+
+	memory_sort_fill(s, MEMORY_SORT_LEN, true);
+	MTY_RadixSort(s, MEMORY_SORT_LEN, sizeof(struct memory_sort), 0, MTY_SORT_KEY_INT32);
+	test_cmp("MTY_RadixSort", memory_sort_check(s, MEMORY_SORT_LEN));
+
+	float f[6] = {3.5f, -1.0f, 0.0f, -7.25f, 2.0f, -0.5f};
+	MTY_RadixSort(f, 6, sizeof(float), 0, MTY_SORT_KEY_FLOAT);
+	test_cmp("MTY_RadixSort", f[0] == -7.25f && f[1] == -1.0f && f[2] == -0.5f && f[5] == 3.5f);
+
+	MTY_Free(s);
+
+	// Scratch stack
+	const char *outer = MTY_JoinPath("outer", "path");
+
+	size_t mark = MTY_ScratchPush();
+	const char *first = MTY_JoinPath("scratch", "0");
+
+	for (uint32_t x = 0; x < 2000; x++)
+		MTY_JoinPath("scratch", "a-long-enough-file-name-to-fill-several-chunks");
+
+	MTY_ScratchStats stats = {0};
+	MTY_ScratchGetStats(&stats, false);
+	test_cmp("MTY_ScratchGetStats", stats.depth == 1 && stats.used > 64 * 1024 && stats.capacity >= stats.used);
+
+	// "scratch" and "outer" joined with the platform's path delimiter
+	bool intact = strlen(first) == 9 && !strncmp(first, "scratch", 7) && first[8] == '0' &&
+		strlen(outer) == 10 && !strncmp(outer, "outer", 5) && !strcmp(outer + 6, "path");
+	test_cmp("MTY_ScratchPush", intact);
+
+	uint8_t *buf = MTY_ScratchAlloc(100);
+	bool zeroed = ((uintptr_t) buf & 0xF) == 0 && buf[0] == 0 && buf[99] == 0;
+	test_cmp("MTY_ScratchAlloc", zeroed);
+
+	MTY_ScratchPop(mark);
+	MTY_ScratchGetStats(&stats, true);
+	test_cmp("MTY_ScratchPop", stats.depth == 0 && stats.used == mark && stats.capacity < 64 * 1024);
+	test_cmp("MTY_ScratchGetStats", stats.highWater > 64 * 1024);
+
+	MTY_ScratchGetStats(&stats, false);
+	test_cmp("MTY_ScratchGetStats", stats.highWater == stats.used);
+
+	return true;
+}
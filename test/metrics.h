@@ -0,0 +1,118 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+static void *metrics_thread(void *opaque)
+{
+	MTY_Metric *counter = opaque;
+
+	for (uint32_t x = 0; x < 10000; x++)
+		MTY_MetricAdd(counter, 1);
+
+	return NULL;
+}
+
+static bool metrics_main(void)
+{
+	MTY_Metric *counter = MTY_MetricGet("test_counter_total", MTY_METRIC_TYPE_COUNTER);
+	MTY_Metric *gauge = MTY_MetricGet("test_gauge", MTY_METRIC_TYPE_GAUGE);
+	MTY_Metric *hist = MTY_MetricGet("test_latency_ns", MTY_METRIC_TYPE_HISTOGRAM);
+	test_cmp("MTY_MetricGet", counter && gauge && hist);
+
+	MTY_Metric *again = MTY_MetricGet("test_counter_total", MTY_METRIC_TYPE_COUNTER);
+	test_cmp("MTY_MetricGet", again == counter);
+
+	again = MTY_MetricGet("test_counter_total", MTY_METRIC_TYPE_GAUGE);
+	test_cmp("MTY_MetricGet", again == NULL);
+
+	again = MTY_MetricGet("0invalid-name", MTY_METRIC_TYPE_COUNTER);
+	test_cmp("MTY_MetricGet", again == NULL);
+
+	// Built in metrics can be looked up like any other
+	again = MTY_MetricGet("mty_net_sent_bytes_total", MTY_METRIC_TYPE_COUNTER);
+	test_cmp("MTY_MetricGet", again != NULL);
+
+	// Counters
+	MTY_Thread *threads[4] = {0};
+
+	for (uint32_t x = 0; x < 4; x++)
+		threads[x] = MTY_ThreadCreate(metrics_thread, counter);
+
+	for (uint32_t x = 0; x < 4; x++)
+		MTY_ThreadDestroy(&threads[x]);
+
+	int64_t value = MTY_MetricGetValue(counter);
+	test_cmp("MTY_MetricAdd", value == 40000);
+
+	// Gauges
+	MTY_MetricSet(gauge, 10);
+	MTY_MetricAdd(gauge, -3);
+	value = MTY_MetricGetValue(gauge);
+	test_cmp("MTY_MetricSet", value == 7);
+
+	// Histograms
+	for (uint64_t x = 1; x <= 1000; x++)
+		MTY_MetricRecord(hist, x * 1000);
+
+	value = MTY_MetricGetValue(hist);
+	test_cmp("MTY_MetricRecord", value == 1000);
+
+	uint64_t p50 = MTY_MetricGetPercentile(hist, 50);
+	test_cmp("MTY_MetricGetPercentile", p50 >= 500000 && p50 <= 500000 + 500000 / 16);
+
+	uint64_t p99 = MTY_MetricGetPercentile(hist, 99);
+	test_cmp("MTY_MetricGetPercentile", p99 >= 990000 && p99 <= 990000 + 990000 / 16);
+
+	uint64_t p0 = MTY_MetricGetPercentile(hist, 0);
+	test_cmp("MTY_MetricGetPercentile", p0 >= 1000 && p0 <= 1000 + 1000 / 16);
+
+	// Serialization
+	char *str = MTY_MetricsSerialize(MTY_METRICS_FORMAT_JSON, false);
+	MTY_JSON *json = MTY_JSONParse(str);
+	test_cmp("MTY_MetricsSerialize", json != NULL);
+
+	float fvalue = 0;
+	bool r = MTY_JSONObjGetFloat(json, "test_counter_total", &fvalue);
+	test_cmp("MTY_MetricsSerialize", r && fvalue == 40000.0f);
+
+	uint32_t count = 0;
+	r = MTY_JSONObjGetUInt(MTY_JSONObjGetItem(json, "test_latency_ns"), "count", &count);
+	test_cmp("MTY_MetricsSerialize", r && count == 1000);
+
+	MTY_JSONDestroy(&json);
+	MTY_Free(str);
+
+	str = MTY_MetricsSerialize(MTY_METRICS_FORMAT_PROMETHEUS, true);
+	test_cmp("MTY_MetricsSerialize", strstr(str, "# TYPE test_counter_total counter\ntest_counter_total 40000\n"));
+	test_cmp("MTY_MetricsSerialize", strstr(str, "test_latency_ns_bucket{le=\"1048575\"} 1000\n"));
+	test_cmp("MTY_MetricsSerialize", strstr(str, "test_latency_ns_bucket{le=\"+Inf\"} 1000\n"));
+	test_cmp("MTY_MetricsSerialize", strstr(str, "test_latency_ns_sum 500500000\n"));
+	MTY_Free(str);
+
+	// Counters and histograms were reset by the last snapshot, gauges keep their value
+	value = MTY_MetricGetValue(counter);
+	test_cmp("MTY_MetricsReset", value == 0);
+
+	value = MTY_MetricGetValue(hist);
+	test_cmp("MTY_MetricsReset", value == 0);
+
+	value = MTY_MetricGetValue(gauge);
+	test_cmp("MTY_MetricsReset", value == 7);
+
+	// Queue depth is recorded on every push
+	MTY_Metric *depth = MTY_MetricGet("mty_queue_depth", MTY_METRIC_TYPE_HISTOGRAM);
+	MTY_Queue *q = MTY_QueueCreate(4, 0);
+
+	for (uint32_t x = 0; x < 3; x++)
+		MTY_QueuePushPtr(q, NULL, 1);
+
+	value = MTY_MetricGetValue(depth);
+	uint64_t max = MTY_MetricGetPercentile(depth, 100);
+	test_cmp("MTY_QueuePush", value == 3 && max == 3);
+
+	MTY_QueueDestroy(&q);
+
+	return true;
+}
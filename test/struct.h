@@ -0,0 +1,536 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+struct struct_item {
+	int32_t value;
+	MTY_Link link;
+};
+
+static bool struct_link_check(MTY_LinkList *list, const int32_t *expected, size_t len)
+{
+	size_t x = 0;
+
+	for (MTY_Link *l = list->first; l; l = l->next, x++) {
+		if (x >= len || MTY_LINK_ENTRY(l, struct struct_item, link)->value != expected[x])
+			return false;
+
+		if (l->next && l->next->prev != l)
+			return false;
+	}
+
+	return x == len && (len == 0 || MTY_LINK_ENTRY(list->last, struct struct_item, link)->value == expected[len - 1]);
+}
+
+#define STRUCT_CHASH_KEYS 10000
+#define STRUCT_CHASH_OPS  400000
+
+struct struct_chash_thread {
+	MTY_ConcurrentHash *hash;
+	uint32_t seed;
+	bool writer;
+	bool ok;
+};
+
+static void *struct_chash_thread(void *opaque)
+{
+	struct struct_chash_thread *t = opaque;
+	t->ok = true;
+
+	for (uint32_t x = 0; x < STRUCT_CHASH_OPS; x++) {
+		int64_t key = (t->seed + x * 7919) % STRUCT_CHASH_KEYS;
+
+		// Writers churn a key range that readers never look at
+		if (t->writer) {
+			int64_t wkey = STRUCT_CHASH_KEYS + key;
+			MTY_ConcurrentHashGetOrSetInt(t->hash, wkey, (void *) (intptr_t) (wkey + 1));
+			MTY_ConcurrentHashPopInt(t->hash, wkey);
+
+		} else if (MTY_ConcurrentHashGetInt(t->hash, key) != (void *) (intptr_t) (key + 1)) {
+			t->ok = false;
+		}
+	}
+
+	return NULL;
+}
+
+static bool struct_chash_run(MTY_ConcurrentHash *hash, uint32_t readers, uint32_t writers, float *ms)
+{
+	struct struct_chash_thread t[16] = {0};
+	MTY_Thread *threads[16] = {0};
+
+	MTY_Time ts = MTY_GetTime();
+
+	for (uint32_t x = 0; x < readers + writers; x++) {
+		t[x].hash = hash;
+		t[x].seed = x * 104729;
+		t[x].writer = x >= readers;
+		threads[x] = MTY_ThreadCreate(struct_chash_thread, &t[x]);
+	}
+
+	bool ok = true;
+
+	for (uint32_t x = 0; x < readers + writers; x++) {
+		MTY_ThreadDestroy(&threads[x]);
+		ok = ok && t[x].ok;
+	}
+
+	*ms = MTY_TimeDiff(ts, MTY_GetTime());
+
+	return ok;
+}
+
+static void struct_cache_evict(const char *key, void *value, void *opaque)
+{
+	(*(uint32_t *) opaque)++;
+}
+
+static uint32_t struct_cache_scan(MTY_CachePolicy policy)
+{
+	MTY_Cache *cache = MTY_CacheCreate(policy, 8, 0, 0, NULL, NULL);
+
+	// Hot keys are seen twice, with enough traffic in between to age them out once
+	for (int64_t x = 0; x < 4; x++)
+		MTY_CacheSetInt(cache, x, (void *) (intptr_t) (x + 1), 1);
+
+	for (int64_t x = 100; x < 108; x++)
+		MTY_CacheSetInt(cache, x, (void *) (intptr_t) (x + 1), 1);
+
+	for (int64_t x = 0; x < 4; x++)
+		MTY_CacheSetInt(cache, x, (void *) (intptr_t) (x + 1), 1);
+
+	// A long one-time scan
+	for (int64_t x = 1000; x < 2000; x++)
+		MTY_CacheSetInt(cache, x, (void *) (intptr_t) (x + 1), 1);
+
+	uint32_t hot = 0;
+	for (int64_t x = 0; x < 4; x++)
+		hot += MTY_CacheGetInt(cache, x) ? 1 : 0;
+
+	MTY_CacheDestroy(&cache);
+
+	return hot;
+}
+
+#define STRUCT_RING_BYTES (8 * 1024 * 1024)
+
+static void *struct_ring_thread(void *opaque)
+{
+	MTY_RingBuffer *ring = opaque;
+
+	for (uint32_t x = 0; x < STRUCT_RING_BYTES;) {
+		size_t avail = 0;
+		uint8_t *dst = MTY_RingBufferReserve(ring, &avail);
+		avail = MTY_MIN(avail, STRUCT_RING_BYTES - x);
+
+		if (avail == 0)
+			MTY_Sleep(0);
+
+		for (size_t y = 0; y < avail; y++)
+			dst[y] = (uint8_t) (x + y);
+
+		MTY_RingBufferCommit(ring, avail);
+		x += avail;
+	}
+
+	return NULL;
+}
+
+#define STRUCT_JSON_ITEMS 100000
+#define STRUCT_JSON_KEYS  10000
+
+static bool struct_main(void)
+{
+	// Pooled MTY_List
+	MTY_List *list = MTY_ListCreatePooled(4);
+
+	for (intptr_t x = 0; x < 10; x++)
+		MTY_ListAppend(list, (void *) x);
+
+	MTY_ListNode *first = MTY_ListGetFirst(list);
+	void *v = MTY_ListRemove(list, first);
+	test_cmp("MTY_ListRemove", v == (void *) 0);
+
+	MTY_ListAppend(list, (void *) 10);
+	test_cmp("MTY_ListCreatePooled", MTY_ListGetFirst(list)->value == (void *) 1);
+
+	MTY_ListDestroy(&list, NULL);
+	test_cmp("MTY_ListDestroy", !list);
+
+	// Intrusive MTY_LinkList
+	struct struct_item items[5] = {{0}};
+	MTY_LinkList a = {0};
+	MTY_LinkList b = {0};
+
+	for (int32_t x = 0; x < 5; x++)
+		items[x].value = x;
+
+	MTY_LinkListAppend(&a, &items[1].link);
+	MTY_LinkListPrepend(&a, &items[0].link);
+	MTY_LinkListInsertAfter(&a, &items[1].link, &items[2].link);
+	test_cmp("MTY_LinkListInsertAfter", struct_link_check(&a, (int32_t[]) {0, 1, 2}, 3));
+
+	MTY_LinkListMoveToFront(&a, &items[2].link);
+	test_cmp("MTY_LinkListMoveToFront", struct_link_check(&a, (int32_t[]) {2, 0, 1}, 3));
+
+	MTY_LinkListRemove(&a, &items[0].link);
+	test_cmp("MTY_LinkListRemove", struct_link_check(&a, (int32_t[]) {2, 1}, 2));
+
+	MTY_LinkListAppend(&b, &items[3].link);
+	MTY_LinkListAppend(&b, &items[4].link);
+	MTY_LinkListSplice(&a, &b);
+	test_cmp("MTY_LinkListSplice", struct_link_check(&a, (int32_t[]) {2, 1, 3, 4}, 4));
+	test_cmp("MTY_LinkListSplice", !b.first && !b.last);
+
+	// MTY_ConcurrentHash, starting small to force resizes under load
+	MTY_ConcurrentHash *chash = MTY_ConcurrentHashCreate(16);
+
+	for (int64_t x = 0; x < STRUCT_CHASH_KEYS; x++)
+		MTY_ConcurrentHashSetInt(chash, x, (void *) (intptr_t) (x + 1));
+
+	test_cmp("MTY_ConcurrentHashSet", MTY_ConcurrentHashGetLength(chash) == STRUCT_CHASH_KEYS);
+
+	void *existing = MTY_ConcurrentHashGetOrSetInt(chash, 5, (void *) 1000);
+	test_cmp("MTY_ConcurrentHashGetOrSet", existing == (void *) 6);
+
+	// Read scaling from 1 to 8 threads
+	for (uint32_t x = 1; x <= 8; x *= 2) {
+		float ms = 0;
+		bool ok = struct_chash_run(chash, x, 0, &ms);
+		test_cmpf("MTY_ConcurrentHashGet", ok, x * STRUCT_CHASH_OPS / ms / 1000.0f);
+	}
+
+	float ms = 0;
+	bool ok = struct_chash_run(chash, 4, 2, &ms);
+	test_cmp("MTY_ConcurrentHashPop", ok && MTY_ConcurrentHashGetLength(chash) == STRUCT_CHASH_KEYS);
+
+	MTY_ConcurrentHashDestroy(&chash, NULL);
+	test_cmp("MTY_ConcurrentHashDestroy", !chash);
+
+	// MTY_RingBuffer spans crossing the end of the buffer stay contiguous
+	MTY_RingBuffer *ring = MTY_RingBufferCreate(1000);
+	size_t ring_size = MTY_RingBufferGetSize(ring);
+	test_cmp("MTY_RingBufferCreate", ring_size >= 1000 && ring_size % 1024 == 0);
+
+	uint8_t *chunk = MTY_Alloc(ring_size, 1);
+	for (size_t x = 0; x < ring_size; x++)
+		chunk[x] = (uint8_t) x;
+
+	bool wrote = MTY_RingBufferWrite(ring, chunk, ring_size - 16);
+	size_t read = MTY_RingBufferRead(ring, chunk, ring_size - 16);
+	test_cmp("MTY_RingBufferRead", wrote && read == ring_size - 16);
+
+	for (size_t x = 0; x < ring_size; x++)
+		chunk[x] = (uint8_t) (x * 7);
+
+	wrote = MTY_RingBufferWrite(ring, chunk, ring_size);
+	test_cmp("MTY_RingBufferWrite", wrote && MTY_RingBufferGetLength(ring) == ring_size);
+
+	wrote = MTY_RingBufferWrite(ring, chunk, 1);
+	test_cmp("MTY_RingBufferWrite", !wrote);
+
+	size_t peek_size = 0;
+	const void *peek = MTY_RingBufferPeek(ring, &peek_size);
+	test_cmp("MTY_RingBufferPeek", peek_size == ring_size && !memcmp(peek, chunk, ring_size));
+
+	MTY_RingBufferSkip(ring, 100);
+	peek = MTY_RingBufferPeek(ring, &peek_size);
+	test_cmp("MTY_RingBufferSkip", peek_size == ring_size - 100 && !memcmp(peek, chunk + 100, peek_size));
+
+	MTY_RingBufferClear(ring);
+	test_cmp("MTY_RingBufferClear", MTY_RingBufferGetLength(ring) == 0);
+
+	MTY_RingBufferDestroy(&ring);
+	MTY_Free(chunk);
+
+	// Producer and consumer on separate threads
+	ring = MTY_RingBufferCreate(64 * 1024);
+	MTY_Thread *producer = MTY_ThreadCreate(struct_ring_thread, ring);
+
+	bool ring_ok = true;
+	MTY_Time ring_start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < STRUCT_RING_BYTES;) {
+		const uint8_t *src = MTY_RingBufferPeek(ring, &peek_size);
+
+		if (peek_size == 0)
+			MTY_Sleep(0);
+
+		for (size_t y = 0; y < peek_size; y++)
+			ring_ok = ring_ok && src[y] == (uint8_t) (x + y);
+
+		MTY_RingBufferSkip(ring, peek_size);
+		x += peek_size;
+	}
+
+	float ring_ms = MTY_TimeDiff(ring_start, MTY_GetTime());
+	MTY_ThreadDestroy(&producer);
+
+	test_cmpf("MTY_RingBufferPeek", ring_ok, STRUCT_RING_BYTES / 1024.0f / 1024.0f / (ring_ms / 1000.0f));
+
+	MTY_RingBufferDestroy(&ring);
+	test_cmp("MTY_RingBufferDestroy", !ring);
+
+	// MTY_Cache LRU order
+	uint32_t evicted = 0;
+	MTY_Cache *cache = MTY_CacheCreate(MTY_CACHE_POLICY_LRU, 3, 0, 0, struct_cache_evict, &evicted);
+
+	for (int64_t x = 1; x <= 3; x++)
+		MTY_CacheSetInt(cache, x, (void *) (intptr_t) x, 1);
+
+	void *value = MTY_CacheGetInt(cache, 1);
+	test_cmp("MTY_CacheGet", value == (void *) 1);
+
+	MTY_CacheSetInt(cache, 4, (void *) 4, 1);
+	value = MTY_CacheGetInt(cache, 2);
+	test_cmp("MTY_CacheSet", !value && evicted == 1);
+
+	value = MTY_CacheGetInt(cache, 1);
+	test_cmp("MTY_CacheSet", value == (void *) 1);
+
+	value = MTY_CachePopInt(cache, 3);
+	test_cmp("MTY_CachePop", value == (void *) 3 && evicted == 1);
+
+	MTY_CacheStats stats = {0};
+	MTY_CacheGetStats(cache, &stats, true);
+	test_cmp("MTY_CacheGetStats", stats.hits == 2 && stats.misses == 1 && stats.insertions == 4);
+	test_cmp("MTY_CacheGetStats", stats.evictions == 1 && stats.entries == 2 && stats.bytes == 2);
+
+	MTY_CacheGetStats(cache, &stats, false);
+	test_cmp("MTY_CacheGetStats", stats.hits == 0 && stats.entries == 2);
+
+	MTY_CacheDestroy(&cache);
+	test_cmp("MTY_CacheDestroy", !cache && evicted == 3);
+
+	// Byte budget across shards
+	evicted = 0;
+	cache = MTY_CacheCreate(MTY_CACHE_POLICY_LRU, 0, 4 * 1024, 4, struct_cache_evict, &evicted);
+
+	for (int64_t x = 0; x < 1000; x++)
+		MTY_CacheSetInt(cache, x, (void *) (intptr_t) (x + 1), 64);
+
+	MTY_CacheGetStats(cache, &stats, false);
+	test_cmp("MTY_CacheCreate", stats.bytes <= 4 * 1024 && stats.entries == stats.bytes / 64);
+	test_cmp("MTY_CacheCreate", stats.evictions == evicted && evicted + stats.entries == 1000);
+
+	MTY_CacheDestroy(&cache);
+
+	// Fewer entries than shards still bounds the cache
+	cache = MTY_CacheCreate(MTY_CACHE_POLICY_LRU, 2, 0, 8, NULL, NULL);
+
+	for (int64_t x = 0; x < 100; x++)
+		MTY_CacheSetInt(cache, x, (void *) (intptr_t) (x + 1), 0);
+
+	MTY_CacheGetStats(cache, &stats, false);
+	test_cmp("MTY_CacheCreate", stats.entries == 2);
+
+	MTY_CacheDestroy(&cache);
+
+	// 2Q keeps hot entries through a scan that flushes a plain LRU
+	uint32_t hot = struct_cache_scan(MTY_CACHE_POLICY_LRU);
+	test_cmp("MTY_CACHE_POLICY_LRU", hot == 0);
+
+	hot = struct_cache_scan(MTY_CACHE_POLICY_2Q);
+	test_cmp("MTY_CACHE_POLICY_2Q", hot == 4);
+
+	// JSON, long enough that strings and escapes cross the parser's 64 byte blocks
+	MTY_JSON *json = MTY_JSONParse(" {\"str\": \"a \\\"quoted\\\" \\\\ string that runs past one block \\\\\\\\\", "
+		"\"esc\": \"\\u00e9\\ud83d\\ude00\\n\\/\", \"num\": [0, -12, 3.5e2, 1e-3, 12345678901234567890, 2147483648], "
+		"\"obj\": {\"t\": true, \"f\": false, \"n\": null, \"nested\": [[[{}], []]]}} trailing");
+
+	char str[64] = {0};
+	bool r = MTY_JSONObjGetString(json, "str", str, sizeof(str));
+	test_cmp("MTY_JSONParse", r && !strcmp(str, "a \"quoted\" \\ string that runs past one block \\\\"));
+
+	r = MTY_JSONObjGetString(json, "esc", str, sizeof(str));
+	test_cmp("MTY_JSONParse", r && !strcmp(str, "\xC3\xA9\xF0\x9F\x98\x80\n/"));
+
+	const MTY_JSON *num = MTY_JSONObjGetItem(json, "num");
+	int32_t ival = 0;
+	float fval = 0;
+	r = MTY_JSONArrayGetInt(num, 1, &ival) && ival == -12;
+	r = r && MTY_JSONArrayGetFloat(num, 2, &fval) && fval == 350.0f;
+	r = r && MTY_JSONArrayGetFloat(num, 3, &fval) && fval == 0.001f;
+	r = r && MTY_JSONArrayGetFloat(num, 4, &fval) && fval == 12345678901234567890.0f;
+	r = r && MTY_JSONArrayGetInt(num, 5, &ival) && ival == INT32_MAX;
+	test_cmp("MTY_JSONParse", r && MTY_JSONGetLength(num) == 6);
+
+	const MTY_JSON *obj = MTY_JSONObjGetItem(json, "obj");
+	bool bval = false;
+	r = MTY_JSONObjGetBool(obj, "t", &bval) && bval;
+	r = r && MTY_JSONObjGetBool(obj, "f", &bval) && !bval;
+	r = r && MTY_JSONObjIsValNull(obj, "n");
+	test_cmp("MTY_JSONParse", r && !strcmp(MTY_JSONObjGetKey(obj, 3), "nested"));
+
+	// Parsed documents stay mutable
+	MTY_JSON *dup = MTY_JSONDuplicate(json);
+	MTY_JSONObjSetString(json, "str", "replaced");
+	MTY_JSONObjDeleteItem(json, "num");
+	MTY_JSONArrayAppendItem((MTY_JSON *) MTY_JSONObjGetItem(obj, "nested"), MTY_JSONObjCreate());
+
+	char *ser = MTY_JSONSerialize(obj);
+	test_cmp("MTY_JSONSerialize", !strcmp(ser, "{\"t\":true,\"f\":false,\"n\":null,\"nested\":[[[{}],[]],{}]}"));
+	MTY_Free(ser);
+
+	r = MTY_JSONObjGetString(json, "str", str, sizeof(str)) && !strcmp(str, "replaced");
+	test_cmp("MTY_JSONObjSetString", r && !MTY_JSONObjKeyExists(json, "num"));
+
+	MTY_JSONDestroy(&json);
+	test_cmp("MTY_JSONDestroy", !json);
+
+	r = MTY_JSONObjGetString(dup, "esc", str, sizeof(str));
+	test_cmp("MTY_JSONDuplicate", r && MTY_JSONObjKeyExists(dup, "num") && !strcmp(MTY_JSONObjGetKey(dup, 0), "str"));
+	MTY_JSONDestroy(&dup);
+
+	// Top level scalars
+	json = MTY_JSONParse("\"solo\"");
+	r = json && !strcmp((ser = MTY_JSONSerialize(json)), "\"solo\"");
+	test_cmp("MTY_JSONParse", r);
+	MTY_Free(ser);
+	MTY_JSONDestroy(&json);
+
+	// Invalid input
+	const char *invalid[] = {"", "  ", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[1 2]", "[1x]", "tru", "nul",
+		"\"open", "[\"\\x\"]", "[\"\\u12\"]", "[\"\\ud83d\"]", "01", "1.", "-", "1e", "{1:2}", "[", "{\"a\":}"};
+
+	r = true;
+	for (size_t x = 0; x < sizeof(invalid) / sizeof(invalid[0]); x++) {
+		json = MTY_JSONParse(invalid[x]);
+		r = r && !json;
+		MTY_JSONDestroy(&json);
+	}
+
+	test_cmp("MTY_JSONParse", r);
+
+	char *deep = MTY_Alloc(2003, 1);
+	memset(deep, '[', 1001);
+	memset(deep + 1001, ']', 1001);
+	json = MTY_JSONParse(deep);
+	test_cmp("MTY_JSONParse", !json);
+
+	memset(deep + 1000, ']', 1001);
+	deep[2001] = '\0';
+	json = MTY_JSONParse(deep);
+	test_cmp("MTY_JSONParse", json != NULL);
+	MTY_JSONDestroy(&json);
+	MTY_Free(deep);
+
+	int64_t ts = 0;
+	float json_ms = 0;
+
+	// Large objects and arrays are searched through a lookup table kept across mutations
+	MTY_JSON *big = MTY_JSONObjCreate();
+	char key[32];
+
+	for (int32_t x = 0; x < STRUCT_JSON_KEYS; x++) {
+		snprintf(key, sizeof(key), "key%d", x);
+		MTY_JSONObjSetInt(big, key, x);
+	}
+
+	// Replacing the last key, then appending, must leave the list intact
+	MTY_JSONObjSetInt(big, key, -1);
+	MTY_JSONObjSetInt(big, "after", 1);
+	MTY_JSONObjDeleteItem(big, "key0");
+	MTY_JSONObjDeleteItem(big, "key500");
+
+	r = MTY_JSONGetLength(big) == STRUCT_JSON_KEYS - 1;
+	r = r && MTY_JSONObjGetInt(big, key, &ival) && ival == -1;
+	r = r && !MTY_JSONObjKeyExists(big, "key0") && !MTY_JSONObjKeyExists(big, "key500");
+	r = r && !strcmp(MTY_JSONObjGetKey(big, 0), "key1") && !strcmp(MTY_JSONObjGetKey(big, STRUCT_JSON_KEYS - 2), "after");
+	test_cmp("MTY_JSONObjSetItem", r);
+
+	ts = MTY_GetTime();
+	r = true;
+
+	for (int32_t x = 1; x < STRUCT_JSON_KEYS - 1; x++) {
+		snprintf(key, sizeof(key), "key%d", x);
+		r = r && (x == 500 || (MTY_JSONObjGetInt(big, key, &ival) && ival == x));
+	}
+
+	json_ms = (float) MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_JSONObjGetItem", r, STRUCT_JSON_KEYS / json_ms / 1000.0f);
+
+	// The tables match what a fresh parse without them would see
+	ser = MTY_JSONSerialize(big);
+	json = MTY_JSONParse(ser);
+	dup = MTY_JSONDuplicate(big);
+	char *ser2 = MTY_JSONSerialize(json);
+	char *ser3 = MTY_JSONSerialize(dup);
+	test_cmp("MTY_JSONSerialize", !strcmp(ser, ser2) && !strcmp(ser, ser3));
+	MTY_Free(ser3);
+	MTY_Free(ser2);
+	MTY_Free(ser);
+	MTY_JSONDestroy(&dup);
+	MTY_JSONDestroy(&json);
+	MTY_JSONDestroy(&big);
+
+	big = MTY_JSONArrayCreate();
+
+	for (int32_t x = 0; x < STRUCT_JSON_KEYS; x++)
+		MTY_JSONArrayAppendItem(big, MTY_JSONObjCreate());
+
+	MTY_JSONArrayDeleteItem(big, 0);
+	MTY_JSONArrayDeleteItem(big, STRUCT_JSON_KEYS - 2);
+	MTY_JSONArraySetInt(big, 0, 1);
+	MTY_JSONArraySetInt(big, 100, 2);
+	MTY_JSONArraySetInt(big, UINT32_MAX, 3);
+	MTY_JSONArrayAppendItem(big, MTY_JSONArrayCreate());
+
+	r = MTY_JSONGetLength(big) == STRUCT_JSON_KEYS + 2;
+	r = r && MTY_JSONArrayGetInt(big, 0, &ival) && ival == 1;
+	r = r && MTY_JSONArrayGetInt(big, 100, &ival) && ival == 2;
+	r = r && MTY_JSONArrayGetInt(big, STRUCT_JSON_KEYS, &ival) && ival == 3;
+	r = r && !MTY_JSONArrayIndexExists(big, STRUCT_JSON_KEYS + 2);
+	test_cmp("MTY_JSONArraySetItem", r);
+
+	ser = MTY_JSONSerialize(big);
+	json = MTY_JSONParse(ser);
+	r = MTY_JSONGetLength(json) == STRUCT_JSON_KEYS + 2 && MTY_JSONArrayGetInt(json, 100, &ival) && ival == 2;
+	test_cmp("MTY_JSONArrayDeleteItem", r);
+	MTY_Free(ser);
+	MTY_JSONDestroy(&json);
+	MTY_JSONDestroy(&big);
+
+	// Duplicate keys resolve to the first, as with a linear search
+	json = MTY_JSONParse("{\"a\":1,\"b\":0,\"c\":0,\"d\":0,\"e\":0,\"f\":0,\"g\":0,\"h\":0,\"i\":0,\"j\":0,"
+		"\"k\":0,\"l\":0,\"m\":0,\"n\":0,\"o\":0,\"p\":0,\"a\":2}");
+
+	r = MTY_JSONObjGetInt(json, "a", &ival) && ival == 1;
+	MTY_JSONObjDeleteItem(json, "a");
+	r = r && MTY_JSONObjGetInt(json, "a", &ival) && ival == 2;
+	MTY_JSONObjDeleteItem(json, "a");
+	test_cmp("MTY_JSONObjDeleteItem", r && !MTY_JSONObjKeyExists(json, "a") && MTY_JSONGetLength(json) == 15);
+	MTY_JSONDestroy(&json);
+
+	// Throughput on an API style document
+	MTY_JSON *doc = MTY_JSONArrayCreate();
+
+	for (uint32_t x = 0; x < STRUCT_JSON_ITEMS; x++) {
+		MTY_JSON *item = MTY_JSONObjCreate();
+		MTY_JSONObjSetUInt(item, "id", x);
+		MTY_JSONObjSetString(item, "name", "an item with a reasonably long \"name\"");
+		MTY_JSONObjSetFloat(item, "score", x * 0.25f);
+		MTY_JSONObjSetBool(item, "active", x % 2 == 0);
+		MTY_JSONArrayAppendItem(doc, item);
+	}
+
+	ser = MTY_JSONSerialize(doc);
+	size_t ser_len = strlen(ser);
+	MTY_JSONDestroy(&doc);
+
+	ts = MTY_GetTime();
+	json = MTY_JSONParse(ser);
+	json_ms = (float) MTY_TimeDiff(ts, MTY_GetTime());
+
+	uint32_t id = 0;
+	const MTY_JSON *last = MTY_JSONArrayGetItem(json, STRUCT_JSON_ITEMS - 1);
+	r = MTY_JSONGetLength(json) == STRUCT_JSON_ITEMS && MTY_JSONObjGetUInt(last, "id", &id) && id == STRUCT_JSON_ITEMS - 1;
+	test_cmpf("MTY_JSONParse", r, ser_len / 1024.0f / 1024.0f / (json_ms / 1000.0f));
+
+	MTY_JSONDestroy(&json);
+	MTY_Free(ser);
+
+	return true;
+}
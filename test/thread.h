@@ -0,0 +1,465 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define THREAD_RWLOCK_OPS 200000
+
+struct thread_rwlock_info {
+	MTY_RWLock *rwlock;
+	int64_t *values;
+	bool writer;
+	bool ok;
+};
+
+static void *thread_rwlock_func(void *opaque)
+{
+	struct thread_rwlock_info *info = opaque;
+	info->ok = true;
+
+	for (uint32_t x = 0; x < THREAD_RWLOCK_OPS; x++) {
+		// Writers keep both values equal, readers must never see them differ
+		if (info->writer && x % 64 == 0) {
+			MTY_RWLockWriter(info->rwlock);
+			info->values[0]++;
+			info->values[1]++;
+			MTY_RWLockUnlock(info->rwlock);
+
+		} else {
+			MTY_RWLockReader(info->rwlock);
+			info->ok = info->ok && info->values[0] == info->values[1];
+			MTY_RWLockUnlock(info->rwlock);
+		}
+	}
+
+	return NULL;
+}
+
+static bool thread_rwlock_run(MTY_RWLock *rwlock, uint32_t readers, uint32_t writers, float *ms)
+{
+	int64_t values[2] = {0};
+	struct thread_rwlock_info info[16] = {{0}};
+	MTY_Thread *threads[16] = {0};
+
+	MTY_Time start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < readers + writers; x++) {
+		info[x].rwlock = rwlock;
+		info[x].values = values;
+		info[x].writer = x >= readers;
+		threads[x] = MTY_ThreadCreate(thread_rwlock_func, &info[x]);
+	}
+
+	bool ok = true;
+
+	for (uint32_t x = 0; x < readers + writers; x++) {
+		MTY_ThreadDestroy(&threads[x]);
+		ok = ok && info[x].ok;
+	}
+
+	*ms = MTY_TimeDiff(start, MTY_GetTime());
+
+	return ok && values[0] == writers * (THREAD_RWLOCK_OPS / 64);
+}
+
+#define THREAD_ATOMIC_OPS 100000
+
+static void *thread_atomic128_func(void *opaque)
+{
+	MTY_Atomic128 *atomic = opaque;
+
+	// Both halves are incremented together, a torn update would make them differ
+	for (uint32_t x = 0; x < THREAD_ATOMIC_OPS; x++) {
+		MTY_Atomic128 expected = {{0}};
+		MTY_Atomic128 desired = {{0}};
+
+		do {
+			desired.value[0] = expected.value[0] + 1;
+			desired.value[1] = expected.value[1] + 1;
+		} while (!MTY_Atomic128CompareExchange(atomic, &expected, desired));
+	}
+
+	return NULL;
+}
+
+static void *thread_desc_func(void *opaque)
+{
+	bool *ok = opaque;
+
+	// A lower priority never needs privileges
+	*ok = MTY_ThreadSetName("mty-low") && MTY_ThreadSetPriority(MTY_THREAD_PRIORITY_LOW);
+
+	return opaque;
+}
+
+static void thread_for_func(uint64_t begin, uint64_t end, void *opaque)
+{
+	int64_t sum = 0;
+
+	for (uint64_t x = begin; x < end; x++)
+		sum += x;
+
+	MTY_Atomic64FetchAdd(opaque, sum, MTY_MEMORY_ORDER_RELAXED);
+}
+
+static void thread_for_nested_func(uint64_t begin, uint64_t end, void *opaque)
+{
+	for (uint64_t x = begin; x < end; x++)
+		MTY_ParallelFor(0, 1000, 7, thread_for_func, opaque);
+}
+
+struct thread_task_info {
+	MTY_Atomic32 *clock;
+	int32_t stamp;
+};
+
+static void thread_task_func(void *opaque)
+{
+	struct thread_task_info *info = opaque;
+
+	info->stamp = MTY_Atomic32FetchAdd(info->clock, 1, MTY_MEMORY_ORDER_ACQ_REL);
+}
+
+struct thread_fiber_info {
+	char *log;
+	char id;
+	uint32_t sleep;
+};
+
+static void thread_fiber_func(void *opaque)
+{
+	struct thread_fiber_info *info = opaque;
+
+	for (uint8_t x = 0; x < 3; x++) {
+		size_t len = strlen(info->log);
+		info->log[len] = info->id;
+
+		if (info->sleep > 0) {
+			MTY_FiberSleep(info->sleep);
+
+		} else {
+			MTY_FiberYield();
+		}
+	}
+}
+
+#if !defined(_WIN32)
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define THREAD_HTTP_PORT 47123
+
+static bool thread_http_recv_header(int32_t s)
+{
+	char tail[4] = {0};
+
+	for (uint32_t x = 0; x < 4096; x++) {
+		struct pollfd pfd = {s, POLLIN, 0};
+		if (poll(&pfd, 1, 2000) != 1)
+			return false;
+
+		memmove(tail, tail + 1, 3);
+		if (recv(s, &tail[3], 1, 0) != 1)
+			return false;
+
+		if (!memcmp(tail, "\r\n\r\n", 4))
+			return true;
+	}
+
+	return false;
+}
+
+static void *thread_http_server_func(void *opaque)
+{
+	int32_t s = *(int32_t *) opaque;
+	int32_t c[2] = {-1, -1};
+
+	// Acts as the HTTP proxy, accepting the CONNECT of both clients
+	for (uint8_t x = 0; x < 2; x++) {
+		struct pollfd pfd = {s, POLLIN, 0};
+		if (poll(&pfd, 1, 2000) != 1)
+			goto except;
+
+		c[x] = accept(s, NULL, NULL);
+		if (c[x] == -1 || !thread_http_recv_header(c[x]))
+			goto except;
+
+		const char *res = "HTTP/1.1 200 OK\r\n\r\n";
+		send(c[x], res, strlen(res), 0);
+	}
+
+	// Requests are answered in reverse, a client that blocks its thread times out
+	for (int8_t x = 1; x >= 0; x--) {
+		if (!thread_http_recv_header(c[x]))
+			break;
+
+		const char *res = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfiber";
+		send(c[x], res, strlen(res), 0);
+	}
+
+	except:
+
+	for (uint8_t x = 0; x < 2; x++)
+		if (c[x] != -1)
+			close(c[x]);
+
+	return NULL;
+}
+
+static void thread_http_client_func(void *opaque)
+{
+	void *res = NULL;
+	size_t size = 0;
+	uint16_t status = 0;
+
+	bool ok = MTY_HttpRequest("localhost", false, "GET", "/", NULL, NULL, 0, 2000, &res, &size, &status);
+	*(bool *) opaque = ok && status == 200 && size == 5 && !memcmp(res, "fiber", 5);
+
+	MTY_Free(res);
+}
+
+static bool thread_http_run(void)
+{
+	int32_t s = socket(AF_INET, SOCK_STREAM, 0);
+	int32_t reuse = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int32_t));
+
+	struct sockaddr_in addr = {0};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(THREAD_HTTP_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(s, 2) != 0) {
+		close(s);
+		return false;
+	}
+
+	char proxy[64];
+	snprintf(proxy, 64, "http://127.0.0.1:%d", THREAD_HTTP_PORT);
+	MTY_HttpSetProxy(proxy);
+
+	MTY_Thread *server = MTY_ThreadCreate(thread_http_server_func, &s);
+
+	bool ok[2] = {0};
+	MTY_FiberStart(thread_http_client_func, &ok[0], 0);
+	MTY_FiberStart(thread_http_client_func, &ok[1], 0);
+	MTY_FiberRun();
+
+	MTY_ThreadDestroy(&server);
+	MTY_HttpSetProxy(NULL);
+	close(s);
+
+	return ok[0] && ok[1];
+}
+
+#endif
+
+static bool thread_main(void)
+{
+	// Fibers
+	char log[16] = {0};
+	struct thread_fiber_info fibers[2] = {{log, 'a', 0}, {log, 'b', 0}};
+
+	bool started = MTY_FiberStart(thread_fiber_func, &fibers[0], 0) &&
+		MTY_FiberStart(thread_fiber_func, &fibers[1], 64 * 1024);
+	test_cmp("MTY_FiberStart", started);
+
+	MTY_FiberRun();
+	test_cmp("MTY_FiberYield", !strcmp(log, "ababab"));
+
+	memset(log, 0, sizeof(log));
+	fibers[0].sleep = 30;
+	fibers[1].sleep = 4;
+
+	MTY_FiberStart(thread_fiber_func, &fibers[0], 0);
+	MTY_FiberStart(thread_fiber_func, &fibers[1], 0);
+	MTY_FiberRun();
+	test_cmp("MTY_FiberSleep", !strcmp(log, "abbbaa"));
+
+	#if !defined(_WIN32)
+		// Concurrent requests on one thread only complete if socket waits yield
+		bool http_ok = thread_http_run();
+		test_cmp("MTY_FiberRun", http_ok);
+	#endif
+
+	// ParallelFor
+	MTY_Atomic64 sum = {0};
+	MTY_ParallelFor(0, 1000000, 0, thread_for_func, &sum);
+	test_cmp("MTY_ParallelFor", sum.value == 499999500000);
+
+	sum.value = 0;
+	MTY_ParallelFor(10, 1010, 1, thread_for_func, &sum);
+	test_cmp("MTY_ParallelFor", sum.value == 509500);
+
+	sum.value = 0;
+	MTY_ParallelFor(0, 16, 1, thread_for_nested_func, &sum);
+	test_cmp("MTY_ParallelFor", sum.value == 16 * 499500);
+
+	// TaskGraph, a diamond followed by an independent task
+	MTY_Atomic32 clock = {0};
+	struct thread_task_info tasks[5] = {0};
+
+	MTY_TaskGraph *graph = MTY_TaskGraphCreate();
+
+	for (uint32_t x = 0; x < 5; x++) {
+		tasks[x].clock = &clock;
+		MTY_TaskGraphAdd(graph, thread_task_func, &tasks[x]);
+	}
+
+	MTY_TaskGraphDepend(graph, 1, 0);
+	MTY_TaskGraphDepend(graph, 2, 0);
+	MTY_TaskGraphDepend(graph, 3, 1);
+	MTY_TaskGraphDepend(graph, 3, 2);
+
+	for (uint32_t x = 0; x < 2; x++) {
+		clock.value = 0;
+
+		MTY_TaskGraphSubmit(graph);
+		MTY_TaskGraphWait(graph);
+
+		bool ordered = clock.value == 5 && tasks[1].stamp > tasks[0].stamp && tasks[2].stamp > tasks[0].stamp &&
+			tasks[3].stamp > tasks[1].stamp && tasks[3].stamp > tasks[2].stamp;
+		test_cmp("MTY_TaskGraphWait", ordered);
+	}
+
+	MTY_TaskGraphDestroy(&graph);
+	test_cmp("MTY_TaskGraphDestroy", !graph);
+
+	// Thread attributes
+	bool desc_ok = false;
+
+	MTY_ThreadDesc desc = {0};
+	desc.name = "mty-test-thread";
+	desc.affinity = 1;
+	desc.stackSize = 1024 * 1024;
+
+	MTY_Thread *desc_thread = MTY_ThreadCreateEx(thread_desc_func, &desc_ok, &desc);
+	void *desc_ret = MTY_ThreadDestroy(&desc_thread);
+	test_cmp("MTY_ThreadCreateEx", desc_ret == &desc_ok && desc_ok);
+
+	#if !defined(__APPLE__)
+		bool pinned = MTY_ThreadSetAffinity(1);
+		test_cmp("MTY_ThreadSetAffinity", pinned);
+
+		pinned = MTY_ThreadSetAffinity(UINT64_MAX);
+		test_cmp("MTY_ThreadSetAffinity", pinned);
+	#endif
+
+	// Atomics
+	MTY_Atomic32 a32 = {5};
+	int32_t prev32 = MTY_Atomic32Exchange(&a32, 6, MTY_MEMORY_ORDER_ACQ_REL);
+	test_cmp("MTY_Atomic32Exchange", prev32 == 5 && MTY_Atomic32Load(&a32, MTY_MEMORY_ORDER_ACQUIRE) == 6);
+
+	prev32 = MTY_Atomic32FetchOr(&a32, 0x10, MTY_MEMORY_ORDER_RELAXED);
+	test_cmp("MTY_Atomic32FetchOr", prev32 == 6 && a32.value == 0x16);
+
+	prev32 = MTY_Atomic32FetchAnd(&a32, 0x12, MTY_MEMORY_ORDER_RELAXED);
+	test_cmp("MTY_Atomic32FetchAnd", prev32 == 0x16 && a32.value == 0x12);
+
+	prev32 = MTY_Atomic32FetchXor(&a32, 0x3, MTY_MEMORY_ORDER_RELAXED);
+	test_cmp("MTY_Atomic32FetchXor", prev32 == 0x12 && a32.value == 0x11);
+
+	prev32 = MTY_Atomic32FetchAdd(&a32, -1, MTY_MEMORY_ORDER_SEQ_CST);
+	test_cmp("MTY_Atomic32FetchAdd", prev32 == 0x11 && a32.value == 0x10);
+
+	int32_t expected32 = 1;
+	bool swapped = MTY_Atomic32CompareExchange(&a32, &expected32, 2, MTY_MEMORY_ORDER_ACQ_REL);
+	test_cmp("MTY_Atomic32CompareExchange", !swapped && expected32 == 0x10);
+
+	swapped = MTY_Atomic32CompareExchange(&a32, &expected32, 2, MTY_MEMORY_ORDER_ACQ_REL);
+	test_cmp("MTY_Atomic32CompareExchange", swapped && a32.value == 2);
+
+	MTY_Atomic64 a64 = {0};
+	MTY_Atomic64Store(&a64, INT64_MAX - 1, MTY_MEMORY_ORDER_RELEASE);
+	int64_t prev64 = MTY_Atomic64FetchAdd(&a64, 1, MTY_MEMORY_ORDER_ACQ_REL);
+	test_cmp("MTY_Atomic64FetchAdd", prev64 == INT64_MAX - 1 && MTY_Atomic64Load(&a64, MTY_MEMORY_ORDER_RELAXED) == INT64_MAX);
+
+	int64_t expected64 = INT64_MAX;
+	swapped = MTY_Atomic64CompareExchange(&a64, &expected64, 0, MTY_MEMORY_ORDER_RELAXED);
+	test_cmp("MTY_Atomic64CompareExchange", swapped && a64.value == 0);
+
+	int32_t target = 0;
+	MTY_AtomicPtr ptr = {0};
+	void *prev_ptr = MTY_AtomicPtrExchange(&ptr, &target, MTY_MEMORY_ORDER_ACQ_REL);
+	test_cmp("MTY_AtomicPtrExchange", !prev_ptr && MTY_AtomicPtrLoad(&ptr, MTY_MEMORY_ORDER_ACQUIRE) == &target);
+
+	void *expected_ptr = NULL;
+	swapped = MTY_AtomicPtrCompareExchange(&ptr, &expected_ptr, NULL, MTY_MEMORY_ORDER_SEQ_CST);
+	test_cmp("MTY_AtomicPtrCompareExchange", !swapped && expected_ptr == &target);
+
+	MTY_AtomicFence(MTY_MEMORY_ORDER_SEQ_CST);
+
+	MTY_Atomic128 *a128 = MTY_AllocAligned(sizeof(MTY_Atomic128), 16);
+	MTY_Thread *threads[4] = {0};
+
+	for (uint32_t x = 0; x < 4; x++)
+		threads[x] = MTY_ThreadCreate(thread_atomic128_func, a128);
+
+	for (uint32_t x = 0; x < 4; x++)
+		MTY_ThreadDestroy(&threads[x]);
+
+	test_cmp("MTY_Atomic128CompareExchange", a128->value[0] == 4 * THREAD_ATOMIC_OPS && a128->value[1] == a128->value[0]);
+	MTY_FreeAligned(a128);
+
+	// More locks than the old fixed slot table allowed
+	MTY_RWLock *locks[300] = {0};
+
+	for (uint32_t x = 0; x < 300; x++)
+		locks[x] = MTY_RWLockCreate();
+
+	for (uint32_t x = 0; x < 300; x++)
+		MTY_RWLockReader(locks[x]);
+
+	bool locked = MTY_RWTryLockReader(locks[299]);
+	test_cmp("MTY_RWTryLockReader", locked);
+
+	MTY_RWLockUnlock(locks[299]);
+
+	for (uint32_t x = 0; x < 300; x++) {
+		MTY_RWLockUnlock(locks[x]);
+		MTY_RWLockDestroy(&locks[x]);
+	}
+
+	test_cmp("MTY_RWLockCreate", !locks[0] && !locks[299]);
+
+	// Recursion and upgrading a read lock to a write lock
+	MTY_RWLock *rwlock = MTY_RWLockCreate();
+
+	MTY_RWLockReader(rwlock);
+	MTY_RWLockReader(rwlock);
+	MTY_RWLockWriter(rwlock);
+	MTY_RWLockUnlock(rwlock);
+	MTY_RWLockUnlock(rwlock);
+	MTY_RWLockUnlock(rwlock);
+
+	MTY_RWLockWriter(rwlock);
+	MTY_RWLockWriter(rwlock);
+	MTY_RWLockUnlock(rwlock);
+	MTY_RWLockUnlock(rwlock);
+
+	locked = MTY_RWTryLockReader(rwlock);
+	test_cmp("MTY_RWLockWriter", locked);
+
+	MTY_RWLockUnlock(rwlock);
+
+	// Read scaling from 1 to 8 threads
+	for (uint32_t x = 1; x <= 8; x *= 2) {
+		float ms = 0;
+		bool ok = thread_rwlock_run(rwlock, x, 0, &ms);
+		test_cmpf("MTY_RWLockReader", ok, x * THREAD_RWLOCK_OPS / ms / 1000.0f);
+	}
+
+	float ms = 0;
+	bool ok = thread_rwlock_run(rwlock, 6, 2, &ms);
+	test_cmpf("MTY_RWLockWriter", ok, 8 * THREAD_RWLOCK_OPS / ms / 1000.0f);
+
+	MTY_RWLockDestroy(&rwlock);
+	test_cmp("MTY_RWLockDestroy", !rwlock);
+
+	return true;
+}
@@ -4,6 +4,12 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
+static void time_timer_func(uint64_t timer, void *opaque)
+{
+	uint32_t *fired = opaque;
+	(*fired)++;
+}
+
 static bool time_main(void)
 {
 	MTY_SetTimerResolution(1);
@@ -11,13 +17,96 @@ static bool time_main(void)
 	MTY_Time ts = MTY_GetTime();
 	test_cmpi64("MTY_GetTime", ts > 0, ts);
 
+	int64_t ns = MTY_GetTimeNs();
+
 	MTY_Sleep(100);
 	test_cmp("MTY_Sleep", 100);
 
 	float diff = MTY_TimeDiff(ts, MTY_GetTime());
 	test_cmpf("MTY_TimeDiff", diff >= 95.0f && diff <= 105.0f, diff);
 
+	int64_t ns_diff = MTY_GetTimeNs() - ns;
+	test_cmpi64("MTY_GetTimeNs", ns_diff >= 95000000 && ns_diff <= 105000000, ns_diff);
+
+	// Long enough to cross the switch to the TSC where it is available
+	bool monotonic = true;
+	ns = MTY_GetTimeNs();
+
+	for (int64_t end = ns + 100000000; ns < end;) {
+		int64_t next = MTY_GetTimeNs();
+		monotonic = monotonic && next >= ns;
+		ns = next;
+	}
+
+	test_cmp("MTY_GetTimeNs", monotonic);
+
+	// Preemption can make any single wakeup late, so most of them have to be on time
+	int64_t on_time = 0;
+	bool early = false;
+
+	for (uint32_t x = 0; x < 10; x++) {
+		int64_t deadline = MTY_GetTimeNs() + 3000000;
+		MTY_SleepUntil(deadline);
+
+		int64_t late = MTY_GetTimeNs() - deadline;
+		early = early || late < 0;
+
+		if (late < 1000000)
+			on_time++;
+	}
+
+	test_cmpi64("MTY_SleepUntil", !early && on_time >= 5, on_time);
+
+	ns = MTY_GetTimeNs();
+	MTY_SleepUntil(ns - 1000000);
+	ns_diff = MTY_GetTimeNs() - ns;
+	test_cmpi64("MTY_SleepUntil", ns_diff < 1000000, ns_diff);
+
 	MTY_RevertTimerResolution(1);
 
+	uint32_t fired = 0;
+	MTY_TimerWheel *wheel = MTY_TimerWheelCreate(1);
+
+	MTY_TimerWheelStart(wheel, 10, time_timer_func, &fired);
+	MTY_TimerWheelStart(wheel, 80, time_timer_func, &fired);
+	uint64_t canceled = MTY_TimerWheelStart(wheel, 40, time_timer_func, &fired);
+	uint64_t far = MTY_TimerWheelStart(wheel, 5000, time_timer_func, &fired);
+
+	bool r = MTY_TimerWheelCancel(wheel, canceled);
+	test_cmp("MTY_TimerWheelCancel", r);
+
+	r = MTY_TimerWheelCancel(wheel, canceled);
+	test_cmp("MTY_TimerWheelCancel", !r);
+
+	ts = MTY_GetTime();
+
+	while (fired < 2 && MTY_TimeDiff(ts, MTY_GetTime()) < 1000.0f)
+		if (MTY_TimerWheelWait(wheel, 100))
+			MTY_TimerWheelRun(wheel);
+
+	diff = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_TimerWheelRun", fired == 2 && diff >= 75.0f && diff <= 110.0f, diff);
+
+	int32_t timeout = MTY_TimerWheelGetTimeout(wheel);
+	test_cmpi64("MTY_TimerWheelGetTimeout", timeout > 0 && timeout <= 5000, (int64_t) timeout);
+
+	r = MTY_TimerWheelReset(wheel, far, 1);
+	test_cmp("MTY_TimerWheelReset", r);
+
+	MTY_Sleep(5);
+	MTY_TimerWheelRun(wheel);
+
+	timeout = MTY_TimerWheelGetTimeout(wheel);
+	test_cmp("MTY_TimerWheelReset", fired == 3 && timeout == -1);
+
+	far = MTY_TimerWheelStart(wheel, UINT32_MAX, time_timer_func, &fired);
+	MTY_TimerWheelRun(wheel);
+
+	timeout = MTY_TimerWheelGetTimeout(wheel);
+	r = MTY_TimerWheelCancel(wheel, far);
+	test_cmp("MTY_TimerWheelStart", fired == 3 && timeout > 0 && r);
+
+	MTY_TimerWheelDestroy(&wheel);
+
 	return true;
 }
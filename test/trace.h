@@ -0,0 +1,95 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+static void *trace_thread(void *opaque)
+{
+	MTY_TraceBegin("thread");
+	MTY_TraceEnd("thread");
+
+	return NULL;
+}
+
+static bool trace_phases(const MTY_JSON *events, const char *expect)
+{
+	char phases[32] = {0};
+	uint32_t len = MTY_JSONGetLength(events);
+
+	for (uint32_t x = 0; x < len && x < sizeof(phases) - 1; x++) {
+		char ph[4] = {0};
+		MTY_JSONObjGetString(MTY_JSONArrayGetItem(events, x), "ph", ph, sizeof(ph));
+		phases[x] = ph[0];
+	}
+
+	return !strcmp(phases, expect);
+}
+
+static bool trace_main(void)
+{
+	MTY_TraceInstant("ignored");
+
+	MTY_TraceStart(0);
+
+	MTY_TraceBegin("zone");
+	MTY_TraceCounter("counter", 42);
+	MTY_TraceInstant("instant \"quoted\"");
+	MTY_TraceEnd("zone");
+
+	MTY_Thread *thread = MTY_ThreadCreate(trace_thread, NULL);
+	MTY_ThreadDestroy(&thread);
+
+	MTY_TraceStop();
+	MTY_TraceInstant("ignored");
+
+	char *str = MTY_TraceSerialize();
+	MTY_JSON *json = MTY_JSONParse(str);
+	test_cmp("MTY_TraceSerialize", json != NULL);
+
+	const MTY_JSON *events = MTY_JSONObjGetItem(json, "traceEvents");
+	uint32_t len = MTY_JSONGetLength(events);
+	test_cmp("MTY_TraceSerialize", len == 6);
+
+	// The most recently registered thread is serialized first
+	bool r = trace_phases(events, "BEBCiE");
+	test_cmp("MTY_TraceEvent", r);
+
+	char name[32] = {0};
+	MTY_JSONObjGetString(MTY_JSONArrayGetItem(events, 4), "name", name, sizeof(name));
+	test_cmp("MTY_TraceEvent", !strcmp(name, "instant \"quoted\""));
+
+	float value = 0;
+	const MTY_JSON *args = MTY_JSONObjGetItem(MTY_JSONArrayGetItem(events, 3), "args");
+	r = MTY_JSONObjGetFloat(args, "value", &value);
+	test_cmp("MTY_TraceCounter", r && value == 42.0f);
+
+	MTY_JSONDestroy(&json);
+	MTY_Free(str);
+
+	// Only the newest events are kept once a thread's buffer is full
+	MTY_TraceStart(4);
+
+	for (uint32_t x = 0; x < 10; x++)
+		MTY_TraceInstant("wrap");
+
+	MTY_TraceCounter("last", 1);
+
+	// The exited thread's buffer is reused by the next one
+	thread = MTY_ThreadCreate(trace_thread, NULL);
+	MTY_ThreadDestroy(&thread);
+
+	MTY_TraceStop();
+
+	str = MTY_TraceSerialize();
+	json = MTY_JSONParse(str);
+
+	events = MTY_JSONObjGetItem(json, "traceEvents");
+	r = trace_phases(events, "BEiiiC");
+	test_cmp("MTY_TraceStart", r);
+
+	MTY_JSONDestroy(&json);
+	MTY_Free(str);
+
+	return true;
+}